@@ -0,0 +1,423 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "BlockStatistics.h"
+#include "Histogram.h"
+
+// platform
+#include <immintrin.h>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW 
+#endif 
+
+// Intrinsics can be used in any function with MSVC. gcc/clang need the target per function.
+#if defined( _MSC_VER )
+#define TARGET_SSE41
+#define TARGET_AVX2
+#define TARGET_AVX512BW
+#else
+#define TARGET_SSE41				__attribute__(( target( "sse4.1" ) ))
+#define TARGET_AVX2					__attribute__(( target( "avx2" ) ))
+#define TARGET_AVX512BW				__attribute__(( target( "avx512f,avx512bw" ) ))
+#endif
+
+// AVX-512 intrinsics are available from VS2017
+#if ! defined( _MSC_VER ) || _MSC_VER >= 1911
+#define HAS_AVX512
+#endif
+
+// Squares are accumulated from the biased signed value s = x - 32768 with madd, 
+// x^2 = s^2 + 65536 * x - 2^30, because pmaddwd is signed. 
+// s0^2 + s1^2 <= 2^31 always fits in an unsigned 32 bit lane, which is widened to 64 bit before adding.
+#define SQUARE_BIAS					( (UINT64) 1 << 30 )
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// kernel selected at load time
+E_SimdLevel CBlockStatistics::_eSimdLevel = CBlockStatistics::GetSupportedSimdLevel();
+CBlockStatistics::PFN_CalcBlock CBlockStatistics::_pfnCalcBlock = CBlockStatistics::_selectKernel( CBlockStatistics::_eSimdLevel );
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// cpuid
+static void _cpuid( int anInfo[ 4 ], int nLeaf, int nSubLeaf )
+{
+#if defined( _MSC_VER )
+	::__cpuidex( anInfo, nLeaf, nSubLeaf );
+#else
+	unsigned int a = 0, b = 0, c = 0, d = 0;
+	__cpuid_count( nLeaf, nSubLeaf, a, b, c, d );
+	anInfo[ 0 ] = (int) a; anInfo[ 1 ] = (int) b; anInfo[ 2 ] = (int) c; anInfo[ 3 ] = (int) d;
+#endif
+}
+
+// register state enabled by the OS
+static UINT64 _xgetbv0(void)
+{
+#if defined( _MSC_VER )
+	return ::_xgetbv( 0 );
+#else
+	unsigned int a = 0, d = 0;
+	__asm__ __volatile__( "xgetbv" : "=a"( a ), "=d"( d ) : "c"( 0 ) );
+	return ( (UINT64) d << 32 ) | a;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// best instruction set
+E_SimdLevel CBlockStatistics::GetSupportedSimdLevel(void)
+{
+	int anInfo[ 4 ];
+
+	_cpuid( anInfo, 0, 0 );
+	const int nMaxLeaf = anInfo[ 0 ];
+
+	_cpuid( anInfo, 1, 0 );
+	const bool bSSE41	= ( anInfo[ 2 ] & ( 1 << 19 ) ) != 0;
+	const bool bOSXSAVE	= ( anInfo[ 2 ] & ( 1 << 27 ) ) != 0;
+	const bool bAVX		= ( anInfo[ 2 ] & ( 1 << 28 ) ) != 0;
+
+	if ( ! bSSE41 )
+		return kSimdLevel_None;
+
+	if ( ! bOSXSAVE || ! bAVX || nMaxLeaf < 7 )
+		return kSimdLevel_SSE41;
+
+	const UINT64 ullXCR0 = _xgetbv0();
+
+	// xmm, ymm
+	if ( ( ullXCR0 & 0x06 ) != 0x06 )
+		return kSimdLevel_SSE41;
+
+	_cpuid( anInfo, 7, 0 );
+	const bool bAVX2	 = ( anInfo[ 1 ] & ( 1 << 5 ) ) != 0;
+	const bool bAVX512F	 = ( anInfo[ 1 ] & ( 1 << 16 ) ) != 0;
+	const bool bAVX512BW = ( anInfo[ 1 ] & ( 1 << 30 ) ) != 0;
+
+	if ( ! bAVX2 )
+		return kSimdLevel_SSE41;
+
+#ifdef HAS_AVX512
+	// opmask, zmm
+	if ( bAVX512F && bAVX512BW && ( ullXCR0 & 0xe6 ) == 0xe6 )
+		return kSimdLevel_AVX512BW;
+#else
+	UNREFERENCED_PARAMETER( bAVX512F );
+	UNREFERENCED_PARAMETER( bAVX512BW );
+#endif
+
+	return kSimdLevel_AVX2;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// force instruction set
+bool CBlockStatistics::SetSimdLevel( E_SimdLevel eLevel )
+{
+	if ( eLevel > GetSupportedSimdLevel() )
+		return false;
+
+	_eSimdLevel = eLevel;
+	_pfnCalcBlock = _selectKernel( eLevel );
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// kernel
+CBlockStatistics::PFN_CalcBlock CBlockStatistics::_selectKernel( E_SimdLevel eLevel )
+{
+	switch ( eLevel )
+	{
+	case kSimdLevel_SSE41:		return &CBlockStatistics::_calcBlock_SSE41;
+	case kSimdLevel_AVX2:		return &CBlockStatistics::_calcBlock_AVX2;
+	case kSimdLevel_AVX512BW:	return &CBlockStatistics::_calcBlock_AVX512BW;
+	default:					return &CBlockStatistics::_calcBlock_C;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// accumulators shared by the SSE kernel and the tails of the wider kernels
+namespace 
+{
+	struct SSEAccum
+	{
+		__m128i mMax, mMin;
+		__m128i mSumLo, mSumHi;		// 2 x 64 bit, sum of low / high bytes
+		__m128i mSqr;				// 2 x 64 bit, sum of biased squares
+	};
+
+	TARGET_SSE41 inline void _initSSE( SSEAccum& acc )
+	{
+		acc.mMax	= _mm_setzero_si128();
+		acc.mMin	= _mm_set1_epi16( -1 );
+		acc.mSumLo	= _mm_setzero_si128();
+		acc.mSumHi	= _mm_setzero_si128();
+		acc.mSqr	= _mm_setzero_si128();
+	}
+
+	// 8 pixels
+	TARGET_SSE41 inline void _accumulateSSE( SSEAccum& acc, const WORD* pw )
+	{
+		const __m128i mZeros	= _mm_setzero_si128();
+		const __m128i mLowByte	= _mm_set1_epi16( 0x00ff );
+		const __m128i mBias		= _mm_set1_epi16( (short) 0x8000 );
+
+		const __m128i mValue = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pw ) );
+
+		// min, max
+		acc.mMax = _mm_max_epu16( acc.mMax, mValue );
+		acc.mMin = _mm_min_epu16( acc.mMin, mValue );
+
+		// sum, psadbw adds 8 bytes into 64 bit directly
+		acc.mSumLo = _mm_add_epi64( acc.mSumLo, _mm_sad_epu8( _mm_and_si128( mValue, mLowByte ), mZeros ) );
+		acc.mSumHi = _mm_add_epi64( acc.mSumHi, _mm_sad_epu8( _mm_srli_epi16( mValue, 8 ), mZeros ) );
+
+		// sum of square
+		const __m128i mSigned = _mm_xor_si128( mValue, mBias );
+		const __m128i mSqr = _mm_madd_epi16( mSigned, mSigned );
+
+		acc.mSqr = _mm_add_epi64( acc.mSqr, _mm_unpacklo_epi32( mSqr, mZeros ) );
+		acc.mSqr = _mm_add_epi64( acc.mSqr, _mm_unpackhi_epi32( mSqr, mZeros ) );
+	}
+
+	// horizontal reduction, once per block
+	TARGET_SSE41 inline void _reduceSSE( const SSEAccum& acc, UINT64 ullPixels, BlockStatistics* pStat )
+	{
+		WORD awMax[ 8 ], awMin[ 8 ];
+		UINT64 aullSumLo[ 2 ], aullSumHi[ 2 ], aullSqr[ 2 ];
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( awMax ),		acc.mMax );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( awMin ),		acc.mMin );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( aullSumLo ),	acc.mSumLo );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( aullSumHi ),	acc.mSumHi );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( aullSqr ),	acc.mSqr );
+
+		for ( int i=0; i<8; i++ )
+		{
+			pStat->wMax = CLU_MAX( pStat->wMax, awMax[ i ] );
+			pStat->wMin = CLU_MIN( pStat->wMin, awMin[ i ] );
+		}
+
+		const UINT64 ullSum = ( aullSumLo[ 0 ] + aullSumLo[ 1 ] ) + ( ( aullSumHi[ 0 ] + aullSumHi[ 1 ] ) << 8 );
+
+		pStat->ullSum += ullSum;
+		pStat->ullSoS += ( aullSqr[ 0 ] + aullSqr[ 1 ] ) + ( ullSum << 16 ) - ullPixels * SQUARE_BIAS;
+	}
+
+	// scalar pixels
+	inline void _accumulateC( const WORD* pw, int nCount, BlockStatistics* pStat )
+	{
+		for ( int x=0; x<nCount; x++ )
+		{
+			const WORD w = pw[ x ];
+
+			pStat->wMax	 = CLU_MAX( pStat->wMax, w );
+			pStat->wMin	 = CLU_MIN( pStat->wMin, w );
+			pStat->ullSum += w;
+			pStat->ullSoS += (UINT64) w * w;
+		}
+	}
+
+	inline void _initStat( BlockStatistics* pStat )
+	{
+		pStat->wMax	  = 0x0000;
+		pStat->wMin	  = 0xffff;
+		pStat->ullSum = 0;
+		pStat->ullSoS = 0;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// plain c
+void CBlockStatistics::_calcBlock_C( const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH, 
+									 CValueHistogram* pValueHist, BlockStatistics* pStat )
+{
+	_initStat( pStat );
+
+	for ( int y=0; y<nBlkH; y++, pwBlk += nStrider )
+	{
+		_accumulateC( pwBlk, nBlkW, pStat );
+		pValueHist->AddLine( pwBlk, nBlkW );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SSE4.1, 8 pixels each
+TARGET_SSE41 
+void CBlockStatistics::_calcBlock_SSE41( const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH, 
+										 CValueHistogram* pValueHist, BlockStatistics* pStat )
+{
+	const int nBlkW_8 = ( nBlkW / 8 ) * 8;
+
+	SSEAccum acc;
+	_initSSE( acc );
+	_initStat( pStat );
+
+	for ( int y=0; y<nBlkH; y++, pwBlk += nStrider )
+	{
+		int x = 0;
+
+		for ( ; x<nBlkW_8; x+=8 )
+			_accumulateSSE( acc, pwBlk + x );
+
+		// remaining pixels
+		_accumulateC( pwBlk + x, nBlkW - x, pStat );
+
+		// value histogram of the line, while it is still in the cache
+		pValueHist->AddLine( pwBlk, nBlkW );
+	}
+
+	_reduceSSE( acc, (UINT64) nBlkW_8 * nBlkH, pStat );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AVX2, 16 pixels each
+TARGET_AVX2 
+void CBlockStatistics::_calcBlock_AVX2( const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH, 
+										CValueHistogram* pValueHist, BlockStatistics* pStat )
+{
+	const int nBlkW_16 = ( nBlkW / 16 ) * 16;
+	const int nBlkW_8  = ( nBlkW / 8 ) * 8;
+
+	const __m256i mZeros	= _mm256_setzero_si256();
+	const __m256i mLowByte	= _mm256_set1_epi16( 0x00ff );
+	const __m256i mBias		= _mm256_set1_epi16( (short) 0x8000 );
+
+	__m256i mMax	= mZeros;
+	__m256i mMin	= _mm256_set1_epi16( -1 );
+	__m256i mSumLo	= mZeros;
+	__m256i mSumHi	= mZeros;
+	__m256i mSqr	= mZeros;
+
+	SSEAccum acc;
+	_initSSE( acc );
+	_initStat( pStat );
+
+	for ( int y=0; y<nBlkH; y++, pwBlk += nStrider )
+	{
+		int x = 0;
+
+		for ( ; x<nBlkW_16; x+=16 )
+		{
+			const __m256i mValue = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pwBlk + x ) );
+
+			mMax = _mm256_max_epu16( mMax, mValue );
+			mMin = _mm256_min_epu16( mMin, mValue );
+
+			mSumLo = _mm256_add_epi64( mSumLo, _mm256_sad_epu8( _mm256_and_si256( mValue, mLowByte ), mZeros ) );
+			mSumHi = _mm256_add_epi64( mSumHi, _mm256_sad_epu8( _mm256_srli_epi16( mValue, 8 ), mZeros ) );
+
+			const __m256i mSigned = _mm256_xor_si256( mValue, mBias );
+			const __m256i mSquare = _mm256_madd_epi16( mSigned, mSigned );
+
+			mSqr = _mm256_add_epi64( mSqr, _mm256_unpacklo_epi32( mSquare, mZeros ) );
+			mSqr = _mm256_add_epi64( mSqr, _mm256_unpackhi_epi32( mSquare, mZeros ) );
+		}
+
+		// 8 pixels
+		for ( ; x<nBlkW_8; x+=8 )
+			_accumulateSSE( acc, pwBlk + x );
+
+		// remaining pixels
+		_accumulateC( pwBlk + x, nBlkW - x, pStat );
+
+		// value histogram of the line, while it is still in the cache
+		pValueHist->AddLine( pwBlk, nBlkW );
+	}
+
+	// fold into the SSE accumulators
+	acc.mMax	= _mm_max_epu16( acc.mMax, _mm_max_epu16( _mm256_castsi256_si128( mMax ), _mm256_extracti128_si256( mMax, 1 ) ) );
+	acc.mMin	= _mm_min_epu16( acc.mMin, _mm_min_epu16( _mm256_castsi256_si128( mMin ), _mm256_extracti128_si256( mMin, 1 ) ) );
+	acc.mSumLo	= _mm_add_epi64( acc.mSumLo, _mm_add_epi64( _mm256_castsi256_si128( mSumLo ), _mm256_extracti128_si256( mSumLo, 1 ) ) );
+	acc.mSumHi	= _mm_add_epi64( acc.mSumHi, _mm_add_epi64( _mm256_castsi256_si128( mSumHi ), _mm256_extracti128_si256( mSumHi, 1 ) ) );
+	acc.mSqr	= _mm_add_epi64( acc.mSqr, _mm_add_epi64( _mm256_castsi256_si128( mSqr ), _mm256_extracti128_si256( mSqr, 1 ) ) );
+
+	_reduceSSE( acc, (UINT64) nBlkW_8 * nBlkH, pStat );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AVX-512BW, 32 pixels each, masked for the remaining pixels
+#ifdef HAS_AVX512
+
+TARGET_AVX512BW 
+void CBlockStatistics::_calcBlock_AVX512BW( const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH, 
+											CValueHistogram* pValueHist, BlockStatistics* pStat )
+{
+	const int nBlkW_32 = ( nBlkW / 32 ) * 32;
+	const int nRemain  = nBlkW - nBlkW_32;
+	const __mmask32 kRemain = ( nRemain > 0 ) ? (__mmask32)( ( 1u << nRemain ) - 1 ) : 0;
+
+	const __m512i mZeros	= _mm512_setzero_si512();
+	const __m512i mLowByte	= _mm512_set1_epi16( 0x00ff );
+	const __m512i mBias		= _mm512_set1_epi16( (short) 0x8000 );
+
+	__m512i mMax	= mZeros;
+	__m512i mMin	= _mm512_set1_epi16( -1 );
+	__m512i mSumLo	= mZeros;
+	__m512i mSumHi	= mZeros;
+	__m512i mSqr	= mZeros;
+
+	_initStat( pStat );
+
+	for ( int y=0; y<nBlkH; y++, pwBlk += nStrider )
+	{
+		for ( int x=0; x<nBlkW; x+=32 )
+		{
+			// zero lanes are harmless for max and sum, and cancel out in the biased square. min is masked.
+			const __mmask32 k = ( x < nBlkW_32 ) ? (__mmask32) 0xffffffff : kRemain;
+			const __m512i mValue = _mm512_maskz_loadu_epi16( k, pwBlk + x );
+
+			mMax = _mm512_max_epu16( mMax, mValue );
+			mMin = _mm512_mask_min_epu16( mMin, k, mMin, mValue );
+
+			mSumLo = _mm512_add_epi64( mSumLo, _mm512_sad_epu8( _mm512_and_si512( mValue, mLowByte ), mZeros ) );
+			mSumHi = _mm512_add_epi64( mSumHi, _mm512_sad_epu8( _mm512_srli_epi16( mValue, 8 ), mZeros ) );
+
+			const __m512i mSigned = _mm512_xor_si512( mValue, mBias );
+			const __m512i mSquare = _mm512_madd_epi16( mSigned, mSigned );
+
+			mSqr = _mm512_add_epi64( mSqr, _mm512_unpacklo_epi32( mSquare, mZeros ) );
+			mSqr = _mm512_add_epi64( mSqr, _mm512_unpackhi_epi32( mSquare, mZeros ) );
+		}
+
+		// value histogram of the line, while it is still in the cache
+		pValueHist->AddLine( pwBlk, nBlkW );
+	}
+
+	// horizontal reduction
+	WORD awMax[ 32 ], awMin[ 32 ];
+	_mm512_storeu_si512( awMax, mMax );
+	_mm512_storeu_si512( awMin, mMin );
+
+	for ( int i=0; i<32; i++ )
+	{
+		pStat->wMax = CLU_MAX( pStat->wMax, awMax[ i ] );
+		pStat->wMin = CLU_MIN( pStat->wMin, awMin[ i ] );
+	}
+
+	const UINT64 ullLanes = (UINT64)( ( nBlkW + 31 ) / 32 ) * 32 * nBlkH;
+	const UINT64 ullSum = (UINT64) _mm512_reduce_add_epi64( mSumLo ) + ( (UINT64) _mm512_reduce_add_epi64( mSumHi ) << 8 );
+
+	pStat->ullSum = ullSum;
+	pStat->ullSoS = (UINT64) _mm512_reduce_add_epi64( mSqr ) + ( ullSum << 16 ) - ullLanes * SQUARE_BIAS;
+}
+
+#else
+
+void CBlockStatistics::_calcBlock_AVX512BW( const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH, 
+											CValueHistogram* pValueHist, BlockStatistics* pStat )
+{
+	// never selected
+	_calcBlock_AVX2( pwBlk, nStrider, nBlkW, nBlkH, pValueHist, pStat );
+}
+
+#endif 
@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+
+namespace comed { namespace abc 
+{
+	// forward declaration
+	class CValueHistogram;
+
+	/// <summary>
+	/// SIMD instruction set of the block kernels
+	/// </summary>
+	enum E_SimdLevel
+	{
+		kSimdLevel_None = 0,
+		kSimdLevel_SSE41,
+		kSimdLevel_AVX2,
+		kSimdLevel_AVX512BW,
+	};
+
+	/// <summary>
+	/// statistics of one block. sum and sum of square are exact.
+	/// </summary>
+	struct BlockStatistics
+	{
+		WORD	wMax, wMin;
+		UINT64	ullSum, ullSoS;
+	};
+
+	/// <summary>
+	/// block statistics kernels, selected by CPUID when the module is loaded
+	/// </summary>
+	class CBlockStatistics
+	{
+		CL_NO_INSTANTIATION( CBlockStatistics );
+
+		// kernel
+		typedef void (*PFN_CalcBlock)( const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH, 
+									   CValueHistogram* pValueHist, BlockStatistics* pStat );
+
+	public:
+		/// <summary>
+		/// min, max, sum, sum of square of the block and its value histogram ( added to pValueHist )
+		/// </summary>
+		static void Calc( 
+				IN		const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH, 
+				IN OUT	CValueHistogram* pValueHist, 
+				OUT		BlockStatistics* pStat )
+		{
+			_pfnCalcBlock( pwBlk, nStrider, nBlkW, nBlkH, pValueHist, pStat );
+		}
+
+		/// <summary>
+		/// best instruction set of this cpu
+		/// </summary>
+		static E_SimdLevel GetSupportedSimdLevel(void);
+
+		/// <summary>
+		/// instruction set in use
+		/// </summary>
+		static E_SimdLevel GetSimdLevel(void) { return _eSimdLevel; }
+
+		/// <summary>
+		/// force the instruction set ( benchmark ), false if not supported by this cpu
+		/// </summary>
+		static bool SetSimdLevel( E_SimdLevel eLevel );
+
+	private:
+		static PFN_CalcBlock _selectKernel( E_SimdLevel eLevel );
+
+		static void _calcBlock_C		( const WORD*, int, int, int, CValueHistogram*, BlockStatistics* );
+		static void _calcBlock_SSE41	( const WORD*, int, int, int, CValueHistogram*, BlockStatistics* );
+		static void _calcBlock_AVX2		( const WORD*, int, int, int, CValueHistogram*, BlockStatistics* );
+		static void _calcBlock_AVX512BW	( const WORD*, int, int, int, CValueHistogram*, BlockStatistics* );
+
+	private:
+		static E_SimdLevel _eSimdLevel;
+		static PFN_CalcBlock _pfnCalcBlock;
+	};
+}} // comed::abc
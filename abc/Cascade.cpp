@@ -0,0 +1,242 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "Cascade.h"
+#include "abc/FeatureBlock.h"
+
+// platform
+#include <algorithm>
+#include <vector>
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW 
+#endif 
+
+// macro
+#define CASCADE_FIT_STEPS			64			// candidate thresholds of a feature, its quantiles
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// fitting of a rule
+namespace 
+{
+	// a condition of a rule on one value, at least or at most a threshold
+	struct Condition
+	{
+		std::vector< double > vecEdges;			// candidate thresholds, ascending
+		bool bAtLeast;
+
+		// the quantiles of the values are the candidates
+		Condition( std::vector< double > vecValues, bool bLeast )
+			: bAtLeast( bLeast )
+		{
+			std::sort( vecValues.begin(), vecValues.end() );
+
+			const size_t nValues = vecValues.size();
+
+			for ( int k=0; k<CASCADE_FIT_STEPS && nValues > 0; k++ )
+			{
+				const double dEdge = vecValues[ (size_t)( ( k + 0.5 ) * nValues / CASCADE_FIT_STEPS ) ];
+
+				if ( vecEdges.empty() || dEdge > vecEdges.back() )
+					vecEdges.push_back( dEdge );
+			}
+		}
+
+		int GetCount(void) const				{ return (int) vecEdges.size(); }
+
+		// index of a value in [ 0, GetCount() ], the candidates are between the indices
+		int IndexOf( double dValue ) const
+		{
+			if ( bAtLeast )
+				return (int)( std::upper_bound( vecEdges.begin(), vecEdges.end(), dValue ) - vecEdges.begin() );
+
+			return (int)( std::lower_bound( vecEdges.begin(), vecEdges.end(), dValue ) - vecEdges.begin() );
+		}
+
+		// the indices of the values meeting the candidate k
+		void RangeOf( int k, int* pnFirst, int* pnLast ) const
+		{
+			*pnFirst = bAtLeast ? k + 1 : 0;
+			*pnLast  = bAtLeast ? GetCount() : k;
+		}
+	};
+
+	// The thresholds of a rule of two conditions deciding the most values, with at most dMaxError of them wrong.
+	// The values are counted by their indices once, the candidates are then sums over ranges of the counts.
+	// false if no candidates decide any value.
+	bool _fitRule( 
+			const std::vector< double >& vec1, bool bAtLeast1, const std::vector< double >& vec2, bool bAtLeast2, 
+			const std::vector< bool >& vecWrong, double dMaxError, 
+			double* pdThreshold1, double* pdThreshold2 )
+	{
+		const Condition cond1( vec1, bAtLeast1 ), cond2( vec2, bAtLeast2 );
+		const int nCount1 = cond1.GetCount(), nCount2 = cond2.GetCount();
+		const int nWidth = nCount2 + 2;
+
+		// counts by the indices, shifted by 1 for the prefix sums
+		std::vector< int > vecAll( (size_t)( nCount1 + 2 ) * nWidth, 0 );
+		std::vector< int > vecBad( (size_t)( nCount1 + 2 ) * nWidth, 0 );
+
+		for ( size_t n=0; n<vec1.size(); n++ )
+		{
+			const int i = cond1.IndexOf( vec1[ n ] ) + 1;
+			const int j = cond2.IndexOf( vec2[ n ] ) + 1;
+
+			vecAll[ i * nWidth + j ] ++;
+
+			if ( vecWrong[ n ] )
+				vecBad[ i * nWidth + j ] ++;
+		}
+
+		for ( int i=1; i<nCount1+2; i++ )
+		for ( int j=1; j<nWidth; j++ )
+		{
+			vecAll[ i * nWidth + j ] += vecAll[ ( i - 1 ) * nWidth + j ] + vecAll[ i * nWidth + j - 1 ] - vecAll[ ( i - 1 ) * nWidth + j - 1 ];
+			vecBad[ i * nWidth + j ] += vecBad[ ( i - 1 ) * nWidth + j ] + vecBad[ i * nWidth + j - 1 ] - vecBad[ ( i - 1 ) * nWidth + j - 1 ];
+		}
+
+		// values of the indices [ i0, i1 ] x [ j0, j1 ]
+		auto fnSum = [&]( const std::vector< int >& vecSum, int i0, int i1, int j0, int j1 ) -> int
+		{
+			return vecSum[ ( i1 + 1 ) * nWidth + j1 + 1 ] - vecSum[ i0 * nWidth + j1 + 1 ] 
+				 - vecSum[ ( i1 + 1 ) * nWidth + j0 ] + vecSum[ i0 * nWidth + j0 ];
+		};
+
+		int nBestAll = 0, nBestBad = 0, nBest1 = -1, nBest2 = -1;
+
+		for ( int k1=0; k1<nCount1; k1++ )
+		for ( int k2=0; k2<nCount2; k2++ )
+		{
+			int i0, i1, j0, j1;
+			cond1.RangeOf( k1, &i0, &i1 );
+			cond2.RangeOf( k2, &j0, &j1 );
+
+			if ( i0 > i1 || j0 > j1 )
+				continue;
+
+			const int nAll = fnSum( vecAll, i0, i1, j0, j1 );
+			const int nBad = fnSum( vecBad, i0, i1, j0, j1 );
+
+			if ( nAll == 0 || nBad > dMaxError * nAll )
+				continue;
+
+			if ( nAll > nBestAll || ( nAll == nBestAll && nBad < nBestBad ) )
+			{
+				nBestAll = nAll;
+				nBestBad = nBad;
+				nBest1 = k1;
+				nBest2 = k2;
+			}
+		}
+
+		if ( nBest1 < 0 )
+			return false;
+
+		*pdThreshold1 = cond1.vecEdges[ nBest1 ];
+		*pdThreshold2 = cond2.vecEdges[ nBest2 ];
+
+		return true;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// decide the blocks
+int CCascade::Resolve( 
+				IN		const CascadeThresholds& thresholds, const CFeatureBlock& features, const int anBlocks[], int nBlocks,
+				OUT		int anUncertain[], double adObjec[], double adMetal[] )
+{
+	const double* pdRows = features.GetRows();
+
+	ASSERT( pdRows != nullptr );
+	ASSERT( anUncertain != nullptr );
+
+	int nUncertain = 0;
+
+	for ( int i=0; i<nBlocks; i++ )
+	{
+		const int bi = ( anBlocks != nullptr ) ? anBlocks[ i ] : i;
+
+		switch ( Decide( thresholds, pdRows + (size_t) bi * ABC_FEATURE_COUNT ) )
+		{
+		case kCascadeDecision_Background:
+			adObjec[ bi ] =  CASCADE_OUTPUT;
+			adMetal[ bi ] = -CASCADE_OUTPUT;
+			break;
+
+		case kCascadeDecision_Metal:
+			adObjec[ bi ] = -CASCADE_OUTPUT;
+			adMetal[ bi ] =  CASCADE_OUTPUT;
+			break;
+
+		default:
+			anUncertain[ nUncertain++ ] = bi;
+			break;
+		}
+	}
+
+	return nUncertain;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// fit the thresholds
+void CCascade::Fit( 
+				IN		const double* pdRows, int nStride, const double* pdLabels, int nRows, double dMaxError,
+				OUT		CascadeThresholds* pThresholds )
+{
+	ASSERT( nRows == 0 || ( pdRows != nullptr && pdLabels != nullptr ) );
+	ASSERT( pThresholds );
+
+	// rules which can not be met, unless fitted
+	CascadeThresholds thresholds = { 2., -1., -1., 2. };
+
+	std::vector< double > vecMin( nRows ), vecStd( nRows ), vecContrast( nRows );
+	std::vector< bool > vecNotBackground( nRows ), vecNotMetal( nRows );
+
+	for ( int n=0; n<nRows; n++ )
+	{
+		const double* pdRow = pdRows + (size_t) n * nStride;
+		const double* pdLabel = pdLabels + (size_t) n * ABC_RESULT_COUNT;
+
+		vecMin[ n ]			= pdRow[ kABCFeatureId_Local_Min ];
+		vecStd[ n ]			= pdRow[ kABCFeatureId_Local_Std ];
+		vecContrast[ n ]	= pdRow[ kABCFeatureId_Local_Max ] - pdRow[ kABCFeatureId_Local_Min ];
+
+		const bool bBackground = ( pdLabel[ kABCResultId_Background ] > 0. );
+		const bool bMetal = ( pdLabel[ kABCResultId_Metal ] > 0. );
+
+		// what the rules decide has to be the whole label
+		vecNotBackground[ n ] = ! bBackground || bMetal;
+		vecNotMetal[ n ] = ! bMetal || bBackground;
+	}
+
+	if ( nRows == 0 )
+	{
+		*pThresholds = thresholds;
+		return;
+	}
+
+	_fitRule( vecMin, true, vecStd, false, vecNotBackground, dMaxError, &thresholds.dBackgroundMin, &thresholds.dBackgroundStd );
+
+	// the metal rule sees only the rows the background rule leaves, as Decide(...) applies them
+	std::vector< double > vecMetalMin, vecMetalContrast;
+	std::vector< bool > vecMetalWrong;
+
+	for ( int n=0; n<nRows; n++ )
+	{
+		if ( vecMin[ n ] >= thresholds.dBackgroundMin && vecStd[ n ] <= thresholds.dBackgroundStd )
+			continue;
+
+		vecMetalMin.push_back( vecMin[ n ] );
+		vecMetalContrast.push_back( vecContrast[ n ] );
+		vecMetalWrong.push_back( vecNotMetal[ n ] );
+	}
+
+	if ( ! vecMetalMin.empty() )
+		_fitRule( vecMetalMin, false, vecMetalContrast, true, vecMetalWrong, dMaxError, &thresholds.dMetalMin, &thresholds.dMetalContrast );
+
+	*pThresholds = thresholds;
+}
@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+#include "abc/abc_types.h"
+
+// forward declaration
+namespace comed { namespace abc { class CFeatureBlock; }}
+
+// macro
+#define CASCADE_OUTPUT				1.0			// network output of a decided block, as the labels
+
+namespace comed { namespace abc 
+{
+	/// <summary>
+	/// rules deciding the obvious blocks from their local statistics before the networks.
+	/// Near saturated blocks of little variance are background, dark blocks of high contrast are metal.
+	/// </summary>
+	class CCascade
+	{
+		CL_NO_INSTANTIATION( CCascade );
+
+	public:
+		/// <summary>
+		/// decision of a block from its features
+		/// </summary>
+		static E_CascadeDecision Decide( const CascadeThresholds& thresholds, const double adFeatures[ ABC_FEATURE_COUNT ] )
+		{
+			const double dMax = adFeatures[ kABCFeatureId_Local_Max ];
+			const double dMin = adFeatures[ kABCFeatureId_Local_Min ];
+
+			if ( dMin >= thresholds.dBackgroundMin && adFeatures[ kABCFeatureId_Local_Std ] <= thresholds.dBackgroundStd )
+				return kCascadeDecision_Background;
+
+			if ( dMin <= thresholds.dMetalMin && dMax - dMin >= thresholds.dMetalContrast )
+				return kCascadeDecision_Metal;
+
+			return kCascadeDecision_Uncertain;
+		}
+
+		/// <summary>
+		/// decide the blocks anBlocks ( nullptr for all nBlocks ) of a row major feature block.
+		/// The outputs of decided blocks are set as the networks would, by the block. The others are put in anUncertain,
+		/// their count is returned.
+		/// </summary>
+		static int Resolve( 
+				IN		const CascadeThresholds& thresholds, const CFeatureBlock& features, const int anBlocks[], int nBlocks,
+				OUT		int anUncertain[], double adObjec[], double adMetal[] );
+
+		/// <summary>
+		/// fit the thresholds to labeled rows ( features, nStride doubles each ) so that at most dMaxError
+		/// of the blocks decided by a rule are labeled otherwise, as Decide(...) decides them: the metal rule is fitted
+		/// to the blocks the background rule leaves. Each rule decides as many blocks as it can then.
+		/// pdLabels has ABC_RESULT_COUNT per row ( kABCResultId_... ), positive if true.
+		/// </summary>
+		static void Fit( 
+				IN		const double* pdRows, int nStride, const double* pdLabels, int nRows, double dMaxError,
+				OUT		CascadeThresholds* pThresholds );
+	};
+}} // comed::abc
@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "Collimation.h"
+
+// platform
+#include <vector>
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW 
+#endif 
+
+// macro
+#define COLLIMATION_SAMPLES			4			// 4 x 4 pixels of each block are sampled
+#define COLLIMATION_STACK_BLOCKS	( 32 * 32 )	// grids up to it need no heap
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// from the collimator rectangle
+void CCollimation::FromRect( 
+				IN		const RECT& rcField, int nBlkW, int nBlkH, int nDivide, 
+				OUT		bool abExposed[] )
+{
+	ASSERT( nBlkW > 0 && nBlkH > 0 );
+
+	for ( int by=0; by<nDivide; by++ )
+	for ( int bx=0; bx<nDivide; bx++ )
+	{
+		const long x = bx * nBlkW + nBlkW / 2;
+		const long y = by * nBlkH + nBlkH / 2;
+
+		abExposed[ bx + by * nDivide ] = 
+			( x >= rcField.left && x < rcField.right && y >= rcField.top && y < rcField.bottom );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// detect from the pixels
+bool CCollimation::Detect( 
+				IN		const WORD* pwSrc, int nStrider, int nBlkW, int nBlkH, int nDivide, double dRatio,
+				OUT		bool abExposed[] )
+{
+	ASSERT( pwSrc != nullptr );
+	ASSERT( nBlkW > 0 && nBlkH > 0 );
+
+	const int nBlocks = nDivide * nDivide;
+
+	// sampled mean of each block, cells of the sample grid are centred. On the stack for the compiled grids.
+	DWORD adwStack[ COLLIMATION_STACK_BLOCKS ];
+	std::vector< DWORD > vecHeap;
+	DWORD* adwMean = adwStack;
+
+	if ( nBlocks > COLLIMATION_STACK_BLOCKS )
+	{
+		vecHeap.resize( nBlocks );
+		adwMean = &vecHeap[ 0 ];
+	}
+	DWORD dwBrightest = 0;
+
+	for ( int by=0; by<nDivide; by++ )
+	for ( int bx=0; bx<nDivide; bx++ )
+	{
+		const WORD* pwBlk = pwSrc + by * nBlkH * nStrider + bx * nBlkW;
+		DWORD dwSum = 0;
+
+		for ( int sy=0; sy<COLLIMATION_SAMPLES; sy++ )
+		{
+			const WORD* pwLine = pwBlk + ( ( 2 * sy + 1 ) * nBlkH / ( 2 * COLLIMATION_SAMPLES ) ) * nStrider;
+
+			for ( int sx=0; sx<COLLIMATION_SAMPLES; sx++ )
+				dwSum += pwLine[ ( 2 * sx + 1 ) * nBlkW / ( 2 * COLLIMATION_SAMPLES ) ];
+		}
+
+		const DWORD dwMean = dwSum / ( COLLIMATION_SAMPLES * COLLIMATION_SAMPLES );
+
+		adwMean[ bx + by * nDivide ] = dwMean;
+		dwBrightest = CLU_MAX( dwBrightest, dwMean );
+	}
+
+	const double dThreshold = dRatio * (double) dwBrightest;
+
+	// bounding box of the bright blocks
+	int nLeft = nDivide, nTop = nDivide, nRight = -1, nBottom = -1;
+
+	for ( int by=0; by<nDivide; by++ )
+	for ( int bx=0; bx<nDivide; bx++ )
+	{
+		if ( dwBrightest > 0 && (double) adwMean[ bx + by * nDivide ] > dThreshold )
+		{
+			nLeft	= CLU_MIN( nLeft, bx );
+			nRight	= CLU_MAX( nRight, bx );
+			nTop	= CLU_MIN( nTop, by );
+			nBottom	= CLU_MAX( nBottom, by );
+		}
+	}
+
+	for ( int by=0; by<nDivide; by++ )
+	for ( int bx=0; bx<nDivide; bx++ )
+		abExposed[ bx + by * nDivide ] = ( bx >= nLeft && bx <= nRight && by >= nTop && by <= nBottom );
+
+	return nRight >= 0;
+}
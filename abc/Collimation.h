@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+
+namespace comed { namespace abc 
+{
+	/// <summary>
+	/// exposed blocks of a collimated frame. 
+	/// Blocks are nBlkW x nBlkH pixels of the frame ( not decimated ), nDivide x nDivide of them.
+	/// </summary>
+	class CCollimation
+	{
+		CL_NO_INSTANTIATION( CCollimation );
+
+	public:
+		/// <summary>
+		/// blocks whose centre is in the field ( pixels of the frame, right and bottom excluded )
+		/// </summary>
+		static void FromRect( 
+				IN		const RECT& rcField, int nBlkW, int nBlkH, int nDivide, 
+				OUT		bool abExposed[] );
+
+		/// <summary>
+		/// Detect the field from a sparse sample of each block. A block is exposed if its sampled mean is above
+		/// dRatio of the brightest block, so the frames have to be raw ( unexposed pixels are dark ).
+		/// The field is the bounding box of the exposed blocks, dark objects inside it stay exposed.
+		/// false if no block is exposed
+		/// </summary>
+		static bool Detect( 
+				IN		const WORD* pwSrc, int nStrider, int nBlkW, int nBlkH, int nDivide, double dRatio,
+				OUT		bool abExposed[] );
+	};
+}} // comed::abc
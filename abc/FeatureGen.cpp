@@ -1,410 +1,724 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 // Added by Hai Son
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#include "stdafx.h"
+#include "abc_core.h"
 #include "FeatureGen.h"
-
-// cl
+#include "Otsu.h"
+#include "BlockStatistics.h"
+#include "Histogram.h"
+#include "ThreadPool.h"
+#include "StageStatistics.h"
+#include "abc/FrameSnapshot.h"
+#include "abc/FeatureBlock.h"
+
+// cl, for the images of the MFC DLL
+#if ! defined( ABC_STANDALONE )
 #include "clImgProc/ImageBuf.h"
-#include "clImgProc/resize.h"
 #include "clUtils/utils.h"
+#endif
 
 // platform
-#include <smmintrin.h>
 #include <cmath>
-#include <omp.h>
+#include <cstring>
+#include <functional>
+#include <vector>
 
 // log
 #include "abc.logger.h"
 
 using namespace comed::abc;
 
-#ifdef _DEBUG
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
 #define new DEBUG_NEW 
 #endif 
 
 // macro
-#define HISTSIZE					256
+#define OTSU_MODE					kOtsuMode_Compatible
 #define THRESHOLD_IMG_SIZE			( 1024 * 1024 )
+#define CACHE_PROBE_STEP			4			// every 4th pixel of every 4th line is compared for the cache
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// only public methods
-bool CFeatureGen::CalcFeatures( IN const cl::img::CImageBuf & imgOrg, OUT double** adbFeatures )
+// sampling of the pixels, buffers of the workers
+namespace 
 {
-	if ( ! imgOrg.IsValid() )
-		return false;
-
-	// make half image if too large
-	cl::img::CImageBuf img;
-
-	if ( imgOrg.GetWidth() * imgOrg.GetHeight() >= THRESHOLD_IMG_SIZE )
+	// decimation factor actually used, 0 means 2 for large frames
+	inline int _decimationOf( int nW, int nH, int nDecimation )
 	{
-		VERIFY( cl::img::utils::ResizeWholeImage( imgOrg, imgOrg.GetWidth() / 2, imgOrg.GetHeight() / 2, 
-													cl::img::utils::EINTP_Nearest, &img ) );
+		if ( nDecimation == 0 )
+			return ( nW * nH >= THRESHOLD_IMG_SIZE ) ? 2 : 1;
+
+		ASSERT( nDecimation == 1 || nDecimation == 2 || nDecimation == 4 );
+		return nDecimation;
 	}
-	else 
+
+	// Sample one block of the decimated image into a small tile, which stays in the cache for the block kernels.
+	// Nearest takes the top left pixel of each cell, same as halving with ResizeWholeImage(...) and EINTP_Nearest.
+	void _sampleBlock( const WORD* pwSrc, int nStrider, int nDecimation, E_ABCSampling eSampling, 
+					   int nBlkW, int nBlkH, WORD* pwTile )
 	{
-        // It can be updated while computing in multi-thread environment.
-        // If you lock it, it will slow down because the other operation is stopped during the calculation time.
-        // Copy the image to the next best.
-		img.CopyFrom( imgOrg );
+		// cells are 2x2 or 4x4
+		const int nShift = ( nDecimation == 4 ) ? 4 : 2;
+
+		for ( int y=0; y<nBlkH; y++, pwSrc += nStrider * nDecimation, pwTile += nBlkW )
+		{
+			if ( eSampling == kABCSampling_Nearest )
+			{
+				for ( int x=0; x<nBlkW; x++ )
+					pwTile[ x ] = pwSrc[ x * nDecimation ];
+				continue;
+			}
+
+			for ( int x=0; x<nBlkW; x++ )
+			{
+				const WORD* pwCell = pwSrc + x * nDecimation;
+				DWORD dwSum = 0;
+
+				for ( int dy=0; dy<nDecimation; dy++, pwCell += nStrider )
+				for ( int dx=0; dx<nDecimation; dx++ )
+					dwSum += pwCell[ dx ];
+
+				pwTile[ x ] = (WORD)( ( dwSum + ( 1 << ( nShift - 1 ) ) ) >> nShift );
+			}
+		}
 	}
 
-	// asserting
-	ASSERT( img.GetType() == cl::img::EIT_Gray16bit );
-	ASSERT( adbFeatures != nullptr );
+	// one pixel of the decimated image
+	inline WORD _sampleCell( const WORD* pwCell, int nStrider, int nDecimation, E_ABCSampling eSampling )
+	{
+		if ( nDecimation == 1 || eSampling == kABCSampling_Nearest )
+			return pwCell[ 0 ];
 
-	// image dimension
-	const int nImgW = img.GetWidth(), nImgH = img.GetHeight();
+		const int nShift = ( nDecimation == 4 ) ? 4 : 2;
+		DWORD dwSum = 0;
 
-	ASSERT( nImgW > ABC_REGION_DIVIDE );
-	ASSERT( nImgH > ABC_REGION_DIVIDE );
+		for ( int dy=0; dy<nDecimation; dy++, pwCell += nStrider )
+		for ( int dx=0; dx<nDecimation; dx++ )
+			dwSum += pwCell[ dx ];
 
-	// block
-	const int nBlkW = nImgW / ABC_REGION_DIVIDE, nBlkH = nImgH / ABC_REGION_DIVIDE;
+		return (WORD)( ( dwSum + ( 1 << ( nShift - 1 ) ) ) >> nShift );
+	}
 
-	ASSERT( nBlkW > 0 );
-	ASSERT( nBlkH > 0 );
+	// Compare the probed pixels of a block with the tile it was computed from.
+	// true if they differ more than nTolerance on average. Changes between the probes are not seen.
+	bool _isBlockChanged( const WORD* pwSrc, int nStrider, int nDecimation, E_ABCSampling eSampling, 
+						  int nBlkW, int nBlkH, const WORD* pwTile, int nTolerance )
+	{
+		UINT64 ullDiff = 0;
+		int nCount = 0;
 
-	// pixel buffer
-	const WORD* pwSrc = img.GetPixelDataWord();
-	ASSERT( pwSrc != nullptr );
+		for ( int y=0; y<nBlkH; y+=CACHE_PROBE_STEP )
+		{
+			const WORD* pwLine = pwSrc + y * nDecimation * nStrider;
+			const WORD* pwTileLine = pwTile + y * nBlkW;
 
-	// first, we have to local statistics
-	WORD awLocalMax[ ABC_REGION_DIVIDE_2 ], awLocalMin[ ABC_REGION_DIVIDE_2 ];
-	double adLocalSum[ ABC_REGION_DIVIDE_2 ];
-	double adLocalSoS[ ABC_REGION_DIVIDE_2 ];
+			for ( int x=0; x<nBlkW; x+=CACHE_PROBE_STEP, nCount++ )
+			{
+				const int v = _sampleCell( pwLine + x * nDecimation, nStrider, nDecimation, eSampling );
 
-	_calcLocalStatistics( pwSrc, nImgW, nImgH, nBlkW, nBlkH, awLocalMax, awLocalMin, adLocalSum, adLocalSoS );
+				ullDiff += (UINT64) abs( v - (int) pwTileLine[ x ] );
+			}
+		}
 
-	// global statistics using local statistics
-	WORD wGlobalMax = 0x0, wGlobalMin = 0xffff;
-	double dGlobalSum = 0.0;
-	double dGlobalSoS = 0.0;
+		return ullDiff > (UINT64) nTolerance * nCount;
+	}
+}
 
-	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// per worker buffers of _calcLocalStatistics(...)
+struct CFeatureScratch::BandScratch
+{
+	CValueHistogram histBlock;			// value histogram of one block
+	CValueHistogram histGlobal;			// the blocks of this worker, merged into the global one at the end
+	std::vector< WORD > vecTile;		// decimated block
+	WORD wMin, wMax;					// range of histGlobal
+	LONGLONG llOtsuTicks;				// time in the otsu of the blocks, if the stages are timed
+
+	explicit BandScratch( int nBitDepth )
+		: histBlock( true, nBitDepth ), histGlobal( false, nBitDepth ), wMin( 0xffff ), wMax( 0x0000 ), llOtsuTicks( 0 )
 	{
-		wGlobalMax = CLU_MAX( wGlobalMax, awLocalMax[ bi ] );
-		wGlobalMin = CLU_MIN( wGlobalMin, awLocalMin[ bi ] );
-
-		dGlobalSum += adLocalSum[ bi ];
-		dGlobalSoS += adLocalSoS[ bi ];
 	}
+};
 
-	// global otsu
-	double dGlobalOtsu = 0.5, dGlobalInner = 0.5, dGlobalInter = 0.5, dGlobalMode = 0.5;
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// constructor
+CFeatureScratch::CFeatureScratch(void)
+	: _pGlobalHist( nullptr )
+{
+}
 
-	_calcOtsu( 
-		pwSrc + nBlkW + nBlkH * nImgW,		// exclude boundary blocks
-		nImgW,								// strider 
-		nBlkW * ( ABC_REGION_DIVIDE - 2 ),
-		nBlkH * ( ABC_REGION_DIVIDE - 2 ) , 
-		wGlobalMin, wGlobalMax, &dGlobalOtsu, &dGlobalInner, &dGlobalInter, &dGlobalMode );
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// destructor
+CFeatureScratch::~CFeatureScratch(void)
+{
+	for ( size_t w=0; w<_vecBands.size(); w++ )
+		delete _vecBands[ w ];
+
+	delete _pGlobalHist;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// buffers of a worker, the range of its global histogram is empty
+CFeatureScratch::BandScratch* CFeatureScratch::_getBand( int nWorker, int nTile, int nBitDepth )
+{
+	ASSERT( nWorker >= 0 && nWorker < (int) _vecBands.size() );
 
-	// local otsu
-	double adLocalOtsu[ ABC_REGION_DIVIDE_2 ];
-	double adLocalMode[ ABC_REGION_DIVIDE_2 ];
+	BandScratch*& pBand = _vecBands[ nWorker ];
 
-	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
+	if ( pBand == nullptr || pBand->histBlock.GetValueCount() != ( 1 << nBitDepth ) )
 	{
-		const int bx = bi % ABC_REGION_DIVIDE;
-		const int by = bi / ABC_REGION_DIVIDE;
+		delete pBand;
+		pBand = new BandScratch( nBitDepth );
+	}
 
-		double dLocalOtsu = 0.5, dLocalInner = 0.5, dLocalInter = 0.5, dLocalMode = 0.5;
+	if ( (int) pBand->vecTile.size() < nTile )
+		pBand->vecTile.resize( nTile );
 
-		if ( bx == 0 || bx == ABC_REGION_DIVIDE - 1 || by == 0 || by == ABC_REGION_DIVIDE - 1 )
-		{
-			// do nothing
-		}
-		else 
-		{
-			const WORD* pwBlk = pwSrc + ( bx * nBlkW ) + ( by * nBlkH ) * nImgW;
+	pBand->wMin = 0xffff;
+	pBand->wMax = 0x0000;
+	pBand->llOtsuTicks = 0;
 
-			_calcOtsu( pwBlk, nImgW, nBlkW, nBlkH, awLocalMin[ bi ], awLocalMax[ bi ], 
-							&dLocalOtsu, &dLocalInner, &dLocalInter, &dLocalMode );
-		}
-		
-		adLocalOtsu[ bi ] = dLocalOtsu;
-		adLocalMode[ bi ] = dLocalMode;
+	return pBand;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// the global value histogram
+CValueHistogram* CFeatureScratch::_getGlobalHist( int nBitDepth )
+{
+	if ( _pGlobalHist == nullptr || _pGlobalHist->GetValueCount() != ( 1 << nBitDepth ) )
+	{
+		delete _pGlobalHist;
+		_pGlobalHist = new CValueHistogram( false, nBitDepth );
 	}
 
-	// block population
-	const double dBlkPopulation = (double)( nBlkW * nBlkH );
-	const double dGlobalPopulation = dBlkPopulation * ( ABC_REGION_DIVIDE - 2 ) * ( ABC_REGION_DIVIDE - 2 );
+	return _pGlobalHist;
+}
 
-	const double dGlobalMax  = (double) wGlobalMax;
-	const double dGlobalMin  = (double) wGlobalMin;
-	const double dGlobalMean = dGlobalSum / dGlobalPopulation;
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// copy of a frame
+WORD* CFeatureScratch::_getFrame( size_t nPixels )
+{
+	if ( _vecFrame.size() < nPixels )
+		_vecFrame.resize( nPixels );
 
-	// FIX: When an image having the same value is input, it may have a value smaller than 0 due to an error.
-	const double dGlobalStd  = sqrt( CLU_LBOUND( dGlobalSoS / dGlobalPopulation - CLU_SQUARE( dGlobalMean ), 0. ) );
+	return &_vecFrame[ 0 ];
+}
 
-	// output
-	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// constructor
+template< int DIVIDE >
+CFeatureCacheT< DIVIDE >::CFeatureCacheT(void)
+	: _bValid( false )
+	, _nTolerance( 0 )
+	, _nSrcW( 0 ), _nSrcH( 0 ), _nDecimation( 0 ), _nBitDepth( 16 )
+	, _eSampling( kABCSampling_Nearest )
+	, _bMasked( false )
+	, _pGlobalHist( new CValueHistogram( false ) )
+{
+	for ( int bi=0; bi<DIVIDE*DIVIDE; bi++ )
 	{
-		double* pdFeatures = adbFeatures[ bi ];
-		ASSERT( pdFeatures );
-
-		pdFeatures[ kABCFeatureId_Global_Otsu	]	= dGlobalOtsu;
-		pdFeatures[ kABCFeatureId_Global_Max	]	= dGlobalMax	/ 65535.;
-		pdFeatures[ kABCFeatureId_Global_Min	]	= dGlobalMin	/ 65535.;
-		pdFeatures[ kABCFeatureId_Global_Mean	]	= dGlobalMean	/ 65535.;
-		pdFeatures[ kABCFeatureId_Global_Std	]	= dGlobalStd	/ 65535.;
-		pdFeatures[ kABCFeatureId_Global_Mode	]	= dGlobalMode;
-
-		const double dLocalMean = adLocalSum[ bi ] / dBlkPopulation;
-		const double dLocalStd  = sqrt( CLU_LBOUND( adLocalSoS[ bi ] / dBlkPopulation - CLU_SQUARE( dLocalMean ), 0. ) );
-
-		pdFeatures[ kABCFeatureId_Local_Otsu	]	= adLocalOtsu[ bi ];
-		pdFeatures[ kABCFeatureId_Local_Max		]	= (double) awLocalMax[ bi ] / 65535.;
-		pdFeatures[ kABCFeatureId_Local_Min		]	= (double) awLocalMin[ bi ] / 65535.;
-		pdFeatures[ kABCFeatureId_Local_Mean	]	= dLocalMean				/ 65535.;
-		pdFeatures[ kABCFeatureId_Local_Std		]	= dLocalStd					/ 65535.;
-		pdFeatures[ kABCFeatureId_Local_Mode	]	= adLocalMode[ bi ];
+		_abDirty[ bi ] = true;
+		_abExposed[ bi ] = true;
 	}
+}
 
-	return true;
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// destructor
+template< int DIVIDE >
+CFeatureCacheT< DIVIDE >::~CFeatureCacheT(void)
+{
+	delete _pGlobalHist;
 }
 
+#if ! defined( ABC_STANDALONE )
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// local
-void CFeatureGen::_calcLocalStatistics( 
-			const WORD* pwSrc, int nImgW, int nImgH, int nBlkW, int nBlkH, 
-			WORD awLocalMax[], WORD awLocalMin[], double adLocalSum[], double adLocalSoS[] )
+// only public methods
+template< int DIVIDE >
+bool CFeatureGenT< DIVIDE >::CalcFeatures( IN const cl::img::CImageBuf & imgOrg, OUT CFeatureBlock* pFeatures, 
+										   IN const FeatureGenOptions& options )
 {
-	UNREFERENCED_PARAMETER( nImgH );
+	if ( ! imgOrg.IsValid() )
+		return false;
+
+	// asserting
+	ASSERT( imgOrg.GetType() == cl::img::EIT_Gray16bit );
+
+	const int nW = imgOrg.GetWidth(), nH = imgOrg.GetHeight();
+
+	FeatureGenOptions opt = options;
+	opt.nDecimation = _decimationOf( nW, nH, options.nDecimation );
+	opt.nBitDepth = ( options.nBitDepth != 0 ) ? options.nBitDepth : 16;
+
+	// Decimated frames are sampled block by block straight from the image, as halving did before.
+	if ( opt.nDecimation > 1 )
+		return _calcFeatures( imgOrg.GetPixelDataWord(), nW, nH, nW, opt, pFeatures, nullptr );
 
-	// Using openmp does not get much faster. Removed.
-	// loop for blocks
-//	#pragma omp parallel for schedule(static)		\
-//				firstprivate( pwSrc, nBlkW, nBlkH, nImgW, awLocalMax, awLocalMin, anLocalSum, adbLocalSoS )
+	// It can be updated while computing in multi-thread environment.
+	// If you lock it, it will slow down because the other operation is stopped during the calculation time.
+	// Copy the image to the next best, into the scratch if there is one.
+	const LONGLONG llCopy = ( options.pStages != nullptr ) ? CStageStatistics::Now() : 0;
 
-	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
+	if ( options.pScratch != nullptr )
 	{
-		const int bx = bi % ABC_REGION_DIVIDE;
-		const int by = bi / ABC_REGION_DIVIDE;
+		WORD* pwCopy = options.pScratch->_getFrame( (size_t) nW * nH );
+		memcpy( pwCopy, imgOrg.GetPixelDataWord(), sizeof(WORD) * nW * nH );
 
-		// boundary blocks
-		if ( bx == 0 || bx == ABC_REGION_DIVIDE - 1 || by == 0 || by == ABC_REGION_DIVIDE - 1 )
-		{
-			awLocalMax[ bi ] = 0x0000;
-			awLocalMin[ bi ] = 0xffff;
-			adLocalSum[ bi ] = 0.;
-			adLocalSoS[ bi ] = 0.;
-		}
-		// non-boundary blocks
-		else 
-		{
-			const WORD* pwBlk = pwSrc + ( bx * nBlkW ) + ( by * nBlkH ) * nImgW;
+		if ( options.pStages != nullptr )
+			options.pStages->Record( kABCStage_Copy, llCopy, CStageStatistics::Now() );
 
-			_calcBlockStatistics( pwBlk, nImgW, nBlkW, nBlkH, 
-				awLocalMax + bi, awLocalMin + bi, adLocalSum + bi, adLocalSoS + bi );
-		}
+		return _calcFeatures( pwCopy, nW, nH, nW, opt, pFeatures, nullptr );
 	}
+
+	cl::img::CImageBuf img;
+	img.CopyFrom( imgOrg );
+
+	if ( options.pStages != nullptr )
+		options.pStages->Record( kABCStage_Copy, llCopy, CStageStatistics::Now() );
+
+	return _calcFeatures( img.GetPixelDataWord(), nW, nH, nW, opt, pFeatures, nullptr );
 }
+#endif
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// block
-void CFeatureGen::_calcBlockStatistics( const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH, 
-									    WORD* pwLocalMax, WORD* pwLocalMin, double* pdLocalSum, double* pdLocalSoS )
+// features of a frame snapshot, read in place
+template< int DIVIDE >
+bool CFeatureGenT< DIVIDE >::CalcFeatures( IN const CFrameSnapshot & frame, OUT CFeatureBlock* pFeatures, 
+										   IN const FeatureGenOptions& options )
 {
-	// local constant
-	const int nBlkW_8 = ( nBlkW / 8 ) * 8;
-	const __m128i mZeros = _mm_set1_epi16( 0 );
-	const __m128i mOnes  = _mm_set1_epi16( -1 );
-
-	// initialize
-	*pwLocalMax = 0x0000;
-	*pwLocalMin = 0xffff;
-	*pdLocalSum = 0.;
-	*pdLocalSoS = 0.;
-
-	__m128i mMax = mZeros;
-	__m128i mMin = mOnes;
-
-	// loop
-	for ( int y=0; y<nBlkH; y++ )
-	{
-		int x = 0;
+	if ( ! frame.IsValid() )
+		return false;
 
-		__m128i mSum = mZeros;
-		__m128  mfSoS = _mm_set1_ps( 0.f );
+	const int nW = frame.GetWidth(), nH = frame.GetHeight();
 
-		// Use SSE operation to process 8 pixels each.
-		for ( ; x<nBlkW_8; x+=8 )
-		{
-			__m128i mValue = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pwBlk + x ) );
+	FeatureGenOptions opt = options;
+	opt.nDecimation = _decimationOf( nW, nH, options.nDecimation );
+	opt.nBitDepth = ( options.nBitDepth != 0 ) ? options.nBitDepth : frame.GetBitDepth();
 
-			// min, max
-			mMax = _mm_max_epu16( mMax, mValue );
-			mMin = _mm_min_epu16( mMin, mValue );
+	// The snapshot cannot change, so nothing is copied.
+	return _calcFeatures( frame.GetPixelDataWord(), nW, nH, frame.GetStrider(), opt, pFeatures, nullptr );
+}
 
-			// convert to 32bit 
-			__m128i mValue0 = _mm_unpacklo_epi16( mValue, mZeros );
-			__m128i mValue1 = _mm_unpackhi_epi16( mValue, mZeros );
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// features of a frame of a stream
+template< int DIVIDE >
+bool CFeatureGenT< DIVIDE >::CalcFeatures( IN const CFrameSnapshot & frame, OUT CFeatureBlock* pFeatures, 
+										   IN OUT CFeatureCacheT< DIVIDE >* pCache, 
+										   IN const FeatureGenOptions& options )
+{
+	ASSERT( pCache != nullptr );
 
-			// sum
-			mSum = _mm_add_epi32( mSum, mValue0 );
-			mSum = _mm_add_epi32( mSum, mValue1 );
+	if ( ! frame.IsValid() )
+		return false;
 
-			// sum of square
-			__m128 mfValue0 = _mm_cvtepi32_ps( mValue0 );
-			__m128 mfValue1 = _mm_cvtepi32_ps( mValue1 );
+	const int nW = frame.GetWidth(), nH = frame.GetHeight();
 
-			mfValue0 = _mm_mul_ps( mfValue0, mfValue0 );
-			mfValue1 = _mm_mul_ps( mfValue1, mfValue1 );
+	FeatureGenOptions opt = options;
+	opt.nDecimation = _decimationOf( nW, nH, options.nDecimation );
+	opt.nBitDepth = ( options.nBitDepth != 0 ) ? options.nBitDepth : frame.GetBitDepth();
 
-			mfSoS = _mm_add_ps( mfSoS, mfValue0 );
-			mfSoS = _mm_add_ps( mfSoS, mfValue1 );
-		}
+	// blocks of another size can not be reused
+	if ( pCache->_nSrcW != nW || pCache->_nSrcH != nH || 
+		 pCache->_nDecimation != opt.nDecimation || pCache->_eSampling != opt.eSampling )
+	{
+		pCache->_bValid = false;
+	}
+
+	// neither can the global histogram of other blocks, or of another size
+	if ( pCache->_nBitDepth != opt.nBitDepth || pCache->_bMasked != ( opt.pbExposed != nullptr ) || 
+		 ( opt.pbExposed != nullptr && memcmp( pCache->_abExposed, opt.pbExposed, sizeof(bool) * kBlockCount ) != 0 ) )
+	{
+		pCache->_bValid = false;
+	}
 
-		// merge 
-		for ( int i=0; i<8; i++ )
+	if ( ! pCache->_bValid )
+	{
+		const int nBlkW = nW / opt.nDecimation / DIVIDE, nBlkH = nH / opt.nDecimation / DIVIDE;
+
+		pCache->_nSrcW = nW;
+		pCache->_nSrcH = nH;
+		pCache->_nDecimation = opt.nDecimation;
+		pCache->_eSampling = opt.eSampling;
+		pCache->_bMasked = ( opt.pbExposed != nullptr );
+
+		if ( opt.pbExposed != nullptr )
+			memcpy( pCache->_abExposed, opt.pbExposed, sizeof(bool) * kBlockCount );
+
+		pCache->_vecTiles.resize( (size_t) nBlkW * nBlkH * kBlockCount );
+
+		// the histogram is sized to the bit depth
+		if ( pCache->_nBitDepth != opt.nBitDepth )
 		{
-			*pwLocalMax   = CLU_MAX( *pwLocalMax, mMax.m128i_u16[ i ] );
-			*pwLocalMin   = CLU_MIN( *pwLocalMin, mMin.m128i_u16[ i ] );
+			delete pCache->_pGlobalHist;
+			pCache->_pGlobalHist = new CValueHistogram( false, opt.nBitDepth );
+			pCache->_nBitDepth = opt.nBitDepth;
 		}
-		for ( int i=0; i<4; i++ )
+		else
 		{
-			*pdLocalSum += static_cast<double>( mSum.m128i_u32[ i ] );
-			*pdLocalSoS += static_cast<double>( mfSoS.m128_f32[ i ] );
+			pCache->_pGlobalHist->Clear();
 		}
+	}
 
-		// remaining pixels
-		for ( ; x<nBlkW; x++ )
-		{
-			*pwLocalMax  = CLU_MAX( *pwLocalMax, pwBlk[ x ] );
-			*pwLocalMin  = CLU_MIN( *pwLocalMin, pwBlk[ x ] );
-			*pdLocalSum += static_cast<double>( pwBlk[ x ] );
-			*pdLocalSoS += static_cast<double>( pwBlk[ x ] );
-		}
+	return _calcFeatures( frame.GetPixelDataWord(), nW, nH, frame.GetStrider(), opt, pFeatures, pCache );
+}
 
-		// next line
-		pwBlk += nStrider;
-	}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// block size in pixels of the frame
+template< int DIVIDE >
+void CFeatureGenT< DIVIDE >::GetBlockSize( int nSrcW, int nSrcH, int nDecimation, OUT int* pnBlkW, OUT int* pnBlkH )
+{
+	ASSERT( pnBlkW != nullptr && pnBlkH != nullptr );
+
+	nDecimation = _decimationOf( nSrcW, nSrcH, nDecimation );
 
-	return;
+	*pnBlkW = ( nSrcW / nDecimation / DIVIDE ) * nDecimation;
+	*pnBlkH = ( nSrcH / nDecimation / DIVIDE ) * nDecimation;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// CalOtsu
-void CFeatureGen::_calcOtsu( 
-					const WORD* pwSrc, int nStrider, int nBlkW, int nBlkH, WORD wMin, WORD wMax,
-					double* pdOtsu, double* pdInner, double* pdInter, double* pdMode ) 
+// features of 16 bit pixels
+template< int DIVIDE >
+bool CFeatureGenT< DIVIDE >::_calcFeatures( 
+			const WORD* pwSrc, int nSrcW, int nSrcH, int nStrider, const FeatureGenOptions& options, 
+			CFeatureBlock* pFeatures, CFeatureCacheT< DIVIDE >* pCache )
 {
-	if ( wMin == wMax )
+	ASSERT( pwSrc != nullptr );
+	ASSERT( pFeatures != nullptr );
+
+	// size of the decimated image
+	const int nImgW = nSrcW / options.nDecimation, nImgH = nSrcH / options.nDecimation;
+
+	ASSERT( nImgW > DIVIDE );
+	ASSERT( nImgH > DIVIDE );
+
+	// block
+	const int nBlkW = nImgW / DIVIDE, nBlkH = nImgH / DIVIDE;
+
+	ASSERT( nBlkW > 0 );
+	ASSERT( nBlkH > 0 );
+
+	// buffers of this frame only, if none are kept
+	CFeatureScratch scratchFrame;
+	CFeatureScratch* pScratch = ( options.pScratch != nullptr ) ? options.pScratch : &scratchFrame;
+
+	// global value histogram, indexed by the pixel value itself. A stream keeps its own with the blocks.
+	LocalStatistics aLocalFrame[ kBlockCount ];
+
+	CValueHistogram* pGlobalHist = nullptr;
+	LocalStatistics* aLocal = nullptr;
+
+	if ( pCache != nullptr )
+	{
+		pGlobalHist = pCache->_pGlobalHist;
+		aLocal = pCache->_aLocal;
+	}
+	else 
 	{
-		*pdOtsu  = 0.5; *pdInner = 0.5; *pdInter = 0.5; *pdMode = 0.5;
-		return;
+		pGlobalHist = pScratch->_getGlobalHist( options.nBitDepth );
+		aLocal = aLocalFrame;
 	}
 
-	// histogram
-	int iHist[ HISTSIZE + 1 ];		// +1 simple bound
+	// the stages are timed only if asked, the timestamps are not free
+	CStageStatistics* pStages = options.pStages;
+	LONGLONG llStage = ( pStages != nullptr ) ? CStageStatistics::Now() : 0;
+
+	// first, we have to local statistics. local otsu and the global value histogram come from the same pass
+	_calcLocalStatistics( pwSrc, nStrider, options, nBlkW, nBlkH, aLocal, pGlobalHist, pCache, pScratch );
+
+	if ( pStages != nullptr )
+	{
+		const LONGLONG llNow = CStageStatistics::Now();
+		pStages->Record( kABCStage_LocalStatistics, llStage, llNow );
+		llStage = llNow;
+	}
+
+	// global statistics using local statistics. Unexposed blocks are empty like the boundary ones.
+	WORD wGlobalMax = 0x0, wGlobalMin = 0xffff;
+	UINT64 ullGlobalSum = 0;
+	UINT64 ullGlobalSoS = 0;
+
+	for ( int bi=0; bi<kBlockCount; bi++ )
+	{
+		wGlobalMax = CLU_MAX( wGlobalMax, aLocal[ bi ].wMax );
+		wGlobalMin = CLU_MIN( wGlobalMin, aLocal[ bi ].wMin );
+
+		ullGlobalSum += aLocal[ bi ].ullSum;
+		ullGlobalSoS += aLocal[ bi ].ullSoS;
+	}
+
+	// global otsu from the merged value histogram of non-boundary blocks, which a stream keeps for the next frame
+	double dGlobalOtsu = 0.5, dGlobalInner = 0.5, dGlobalInter = 0.5, dGlobalMode = 0.5;
+	int anGlobalHist[ HISTSIZE ];
+
+	if ( wGlobalMin <= wGlobalMax && 
+		 pGlobalHist->Bin( wGlobalMin, wGlobalMax, anGlobalHist ) )
+	{
+		COtsu::Calc( anGlobalHist, HISTSIZE, OTSU_MODE, &dGlobalOtsu, &dGlobalInner, &dGlobalInter, &dGlobalMode );
+	}
+
+	// the histogram of the scratch is cleared for the next frame, only the range of this one
+	if ( pCache == nullptr && wGlobalMin <= wGlobalMax )
+		pGlobalHist->Collapse( wGlobalMin, wGlobalMax, nullptr, nullptr, nullptr, 0, 0, 0 );
+
+	if ( pStages != nullptr )
+	{
+		const LONGLONG llNow = CStageStatistics::Now();
+		pStages->Record( kABCStage_GlobalOtsu, llStage, llNow );
+		llStage = llNow;
+	}
+
+	// non-boundary blocks in the field
+	int nExposedBlocks = 0;
+
+	for ( int by=1; by<DIVIDE-1; by++ )
+	for ( int bx=1; bx<DIVIDE-1; bx++ )
+	{
+		if ( options.pbExposed == nullptr || options.pbExposed[ bx + by * DIVIDE ] )
+			nExposedBlocks ++;
+	}
+
+	// block population
+	const double dBlkPopulation = (double)( nBlkW * nBlkH );
+	const double dGlobalPopulation = dBlkPopulation * CLU_MAX( nExposedBlocks, 1 );
+
+	const double dGlobalMax  = (double) wGlobalMax;
+	const double dGlobalMin  = (double) wGlobalMin;
+	const double dGlobalMean = (double) ullGlobalSum / dGlobalPopulation;
+
+	// FIX: When an image having the same value is input, it may have a value smaller than 0 due to an error.
+	const double dGlobalStd  = sqrt( CLU_LBOUND( (double) ullGlobalSoS / dGlobalPopulation - CLU_SQUARE( dGlobalMean ), 0. ) );
+
+	// output, row major as the networks read it. kV and mA are not touched
+	if ( pFeatures->GetBlockCount() != kBlockCount || pFeatures->GetLayout() != kABCFeatureLayout_RowMajor )
+		pFeatures->Create( kBlockCount, kABCFeatureLayout_RowMajor );
+
+	for ( int bi=0; bi<kBlockCount; bi++ )
 	{
-		const double dFactor = HISTSIZE / (double)( wMax - wMin + 1 );
-		const WORD* pwLine = pwSrc;
+		pFeatures->Set( bi, kABCFeatureId_Global_Otsu,	dGlobalOtsu );
+		pFeatures->Set( bi, kABCFeatureId_Global_Max,	dGlobalMax	/ 65535. );
+		pFeatures->Set( bi, kABCFeatureId_Global_Min,	dGlobalMin	/ 65535. );
+		pFeatures->Set( bi, kABCFeatureId_Global_Mean,	dGlobalMean	/ 65535. );
+		pFeatures->Set( bi, kABCFeatureId_Global_Std,	dGlobalStd	/ 65535. );
+		pFeatures->Set( bi, kABCFeatureId_Global_Mode,	dGlobalMode );
+
+		const LocalStatistics& local = aLocal[ bi ];
+
+		const double dLocalMean = (double) local.ullSum / dBlkPopulation;
+		const double dLocalStd  = sqrt( CLU_LBOUND( (double) local.ullSoS / dBlkPopulation - CLU_SQUARE( dLocalMean ), 0. ) );
+
+		pFeatures->Set( bi, kABCFeatureId_Local_Otsu,	local.dOtsu );
+		pFeatures->Set( bi, kABCFeatureId_Local_Max,	(double) local.wMax / 65535. );
+		pFeatures->Set( bi, kABCFeatureId_Local_Min,	(double) local.wMin / 65535. );
+		pFeatures->Set( bi, kABCFeatureId_Local_Mean,	dLocalMean			/ 65535. );
+		pFeatures->Set( bi, kABCFeatureId_Local_Std,	dLocalStd			/ 65535. );
+		pFeatures->Set( bi, kABCFeatureId_Local_Mode,	local.dMode );
+	}
+
+	if ( pStages != nullptr )
+		pStages->Record( kABCStage_Features, llStage, CStageStatistics::Now() );
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// local
+template< int DIVIDE >
+void CFeatureGenT< DIVIDE >::_calcLocalStatistics(
+			const WORD* pwSrc, int nStrider, const FeatureGenOptions& options, int nBlkW, int nBlkH,
+			LocalStatistics aLocal[], CValueHistogram* pGlobalHist, CFeatureCacheT< DIVIDE >* pCache, CFeatureScratch* pScratch )
+{
+	ASSERT( pScratch != nullptr );
 
-		::ZeroMemory( iHist, sizeof(int) * ( HISTSIZE + 1 ) );
+	const int nDecimation = options.nDecimation;
+	const int nTile = nBlkW * nBlkH;
 
-		for ( int y=0; y<nBlkH; y++, pwLine += nStrider )
-		for ( int x=0; x<nBlkW; x++ )
+	// blocks of the previous frames can be reused
+	const bool bReuse = ( pCache != nullptr && pCache->_bValid );
+
+	// boundary blocks
+	for ( int bi=0; bi<kBlockCount; bi++ )
+	{
+		const int bx = bi % DIVIDE;
+		const int by = bi / DIVIDE;
+
+		if ( bx == 0 || bx == DIVIDE - 1 || by == 0 || by == DIVIDE - 1 )
 		{
-			const register int nBin = (int)( ( pwLine[ x ] - wMin ) * dFactor );
+			aLocal[ bi ].wMax = 0x0000;
+			aLocal[ bi ].wMin = 0xffff;
+			aLocal[ bi ].ullSum = 0;
+			aLocal[ bi ].ullSoS = 0;
 
-#ifdef _DEBUG 
-			if ( nBin < 0 )
-			{
-				LOG_ERROR( _T("Invalid histogram: Min %d, Max %d, Pixel %d, dFactor %g, nBin %d"),
-					wMin, wMax, pwLine[ x ], dFactor, nBin );
-				ASSERT( 0 );
-			}
-			if ( nBin >= HISTSIZE )
-			{
-				LOG_ERROR( _T("Invalid histogram: Min %d, Max %d, Pixel %d, dFactor %g, nBin %d"),
-					wMin, wMax, pwLine[ x ], dFactor, nBin );
-				ASSERT( 0 );
-			}
-#endif 
+			aLocal[ bi ].dOtsu = 0.5;
+			aLocal[ bi ].dMode = 0.5;
 
-			iHist[ nBin ] ++;
+			if ( pCache != nullptr )
+				pCache->_abDirty[ bi ] = ! bReuse;
 		}
 	}
 
-	// cumulative histogram, mul-sum
-	int iCumHist[ HISTSIZE ];
-	int iCumMulHist[ HISTSIZE ];
-	int iHistSum = 0, iHistMulSum = 0;
+	// OpenMP did not get much faster, a team was forked for each frame.
+	// Rows of non-boundary blocks ( bands ) run on the persistent pool instead, each worker with its own scratch.
+	// The buffers of every worker are ready before they start. A stream samples into the tiles of the cache.
+	const int nWorkers = ( options.pPool != nullptr ) ? options.pPool->GetWorkerCount() : 1;
+
+	if ( (int) pScratch->_vecBands.size() < nWorkers )
+		pScratch->_vecBands.resize( nWorkers, nullptr );
+
+	for ( int w=0; w<nWorkers; w++ )
+		pScratch->_getBand( w, ( nDecimation > 1 && pCache == nullptr ) ? nTile : 0, options.nBitDepth );
+
+	auto fnBand = [&]( int nBand, int nWorker )
 	{
-		int nMode = 0, nModeValue = iHist[ 0 ];
+		CFeatureScratch::BandScratch& scratch = *pScratch->_vecBands[ nWorker ];
+
+		// worker 0 is the calling thread and the only one writing the global histogram directly
+		CValueHistogram* pTarget = ( nWorker == 0 ) ? pGlobalHist : &scratch.histGlobal;
 
-		for ( int i=0; i<HISTSIZE; i++ )
+		const int by = nBand + 1;
+
+		for ( int bx=1; bx<DIVIDE-1; bx++ )
 		{
-			iHistSum	+= iHist[ i ];
-			iHistMulSum += iHist[ i ] * i;
+			const int bi = bx + by * DIVIDE;
 
-			iCumHist[ i ] = iHistSum;
-			iCumMulHist[ i ] = iHistMulSum;
+			double dLocalOtsu = 0.5, dLocalInner = 0.5, dLocalInter = 0.5, dLocalMode = 0.5;
 
-			if ( nModeValue < iHist[ i ] )
+			// outside the collimator, nothing to compute
+			if ( options.pbExposed != nullptr && ! options.pbExposed[ bi ] )
 			{
-				nModeValue = iHist[ i ];
-				nMode = i;
+				aLocal[ bi ].wMax = 0x0000;
+				aLocal[ bi ].wMin = 0xffff;
+				aLocal[ bi ].ullSum = 0;
+				aLocal[ bi ].ullSoS = 0;
+
+				aLocal[ bi ].dOtsu = 0.5;
+				aLocal[ bi ].dMode = 0.5;
+
+				if ( pCache != nullptr )
+					pCache->_abDirty[ bi ] = ! bReuse;
+
+				continue;
 			}
-		}
 
-		// normalized mode
-		*pdMode = (double) nMode / HISTSIZE;
-	}
+			const WORD* pwBlk = pwSrc + ( bx * nBlkW + ( by * nBlkH ) * nStrider ) * nDecimation;
+			int nBlkStrider = nStrider;
 
-	// just for simplicity
-	const double dblHistSum = (double) iHistSum;
-	double dInner[ HISTSIZE ];
-	double dInter[ HISTSIZE ];
+			if ( pCache != nullptr )
+			{
+				WORD* pwTile = &pCache->_vecTiles[ (size_t) bi * nTile ];
+
+				// unchanged, the statistics and the pixels in the global histogram stay
+				if ( bReuse && ! _isBlockChanged( pwBlk, nStrider, nDecimation, options.eSampling,
+												  nBlkW, nBlkH, pwTile, pCache->_nTolerance ) )
+				{
+					pCache->_abDirty[ bi ] = false;
+					continue;
+				}
+
+				pCache->_abDirty[ bi ] = true;
+
+				// the previous pixels of the block leave the global histogram
+				if ( bReuse )
+				{
+					pTarget->RemoveBlock( pwTile, nBlkW, nBlkW, nBlkH );
+
+					scratch.wMin = CLU_MIN( scratch.wMin, aLocal[ bi ].wMin );
+					scratch.wMax = CLU_MAX( scratch.wMax, aLocal[ bi ].wMax );
+				}
+
+				// the tile is compared with the next frame
+				if ( nDecimation > 1 )
+				{
+					_sampleBlock( pwBlk, nStrider, nDecimation, options.eSampling, nBlkW, nBlkH, pwTile );
+				}
+				else
+				{
+					for ( int y=0; y<nBlkH; y++ )
+						memcpy( pwTile + y * nBlkW, pwBlk + y * nStrider, sizeof(WORD) * nBlkW );
+				}
+
+				pwBlk = pwTile;
+				nBlkStrider = nBlkW;
+			}
+			else if ( nDecimation > 1 )
+			{
+				// decimated blocks are sampled into a tile first
+				_sampleBlock( pwBlk, nStrider, nDecimation, options.eSampling, nBlkW, nBlkH, &scratch.vecTile[ 0 ] );
 
-	for ( int i=0; i<HISTSIZE; i++ )
-	{
-		double dCumVarB = 0.0;
-		double dCumVarF = 0.0;
+				pwBlk = &scratch.vecTile[ 0 ];
+				nBlkStrider = nBlkW;
+			}
 
-		const double dMeanB = (double) iCumMulHist[i] / iCumHist[i];
-		const double dMeanF = (double)( iHistMulSum - iCumMulHist[i] ) / ( iHistSum - iCumHist[i] );
+			// the only pass over the pixels
+			BlockStatistics stat;
+			CBlockStatistics::Calc( pwBlk, nBlkStrider, nBlkW, nBlkH, &scratch.histBlock, &stat );
 
-		for ( int j=0; j<i; j++ )
-		{
-			dCumVarB = dCumVarB + CLU_SQUARE( j - dMeanB ) * iHist[j];
-		}
-		for ( int k=i; k<HISTSIZE; k++ )
-		{
-			dCumVarF = dCumVarF + CLU_SQUARE( k - dMeanF ) * iHist[k];
-		}		
+			aLocal[ bi ].wMax	= stat.wMax;
+			aLocal[ bi ].wMin	= stat.wMin;
+			aLocal[ bi ].ullSum	= stat.ullSum;
+			aLocal[ bi ].ullSoS	= stat.ullSoS;
 
-		const double dVarB = dCumVarB / iCumHist[i];
-		const double dVarF = dCumVarF / ( iHistSum - iCumHist[i] );
+			scratch.wMin = CLU_MIN( scratch.wMin, stat.wMin );
+			scratch.wMax = CLU_MAX( scratch.wMax, stat.wMax );
 
-		const double dWeightB = iCumHist[ i ] / dblHistSum;
-		const double dWeightF = 1.0 - dWeightB;
+			// local otsu from the value histogram, which is merged into the global one at the same time
+			int anHist[ HISTSIZE ];
 
-		dInner[i] = dWeightB * dVarB + dWeightF * dVarF;
-		dInter[i] = dWeightB * dWeightF * ( ( dMeanB - dMeanF ) * ( dMeanB - dMeanF ) );
-	}	
+			if ( scratch.histBlock.Collapse( stat.wMin, stat.wMax, anHist, pTarget, pwBlk, nBlkStrider, nBlkW, nBlkH ) )
+			{
+				const LONGLONG llOtsu = ( options.pStages != nullptr ) ? CStageStatistics::Now() : 0;
 
-	// find maximum for otsu
-	double dTempMax = 0.0;
-	int nMaxIndex = 0;
+				COtsu::Calc( anHist, HISTSIZE, OTSU_MODE, &dLocalOtsu, &dLocalInner, &dLocalInter, &dLocalMode );
 
-	for ( int i=0; i<HISTSIZE; i++ )
-	{
-		const double rst = dInter[i] / dInner[i];
+				if ( options.pStages != nullptr )
+					scratch.llOtsuTicks += CStageStatistics::Now() - llOtsu;
+			}
 
-		if ( rst > dTempMax )
-		{
-			dTempMax = rst;
-			nMaxIndex = i;
+			aLocal[ bi ].dOtsu = dLocalOtsu;
+			aLocal[ bi ].dMode = dLocalMode;
 		}
+	};
+
+	if ( options.pPool != nullptr )
+	{
+		// by reference, the std::function does not copy the lambda to the heap
+		options.pPool->ParallelFor( DIVIDE - 2, std::ref( fnBand ) );
 	}
+	else
+	{
+		for ( int nBand=0; nBand<DIVIDE-2; nBand++ )
+			fnBand( nBand, 0 );
+	}
+
+	// The counts are integers, so the merge gives the same histogram in any order.
+	// Removed blocks wrap around in a partial histogram, and are right again after the merge.
+	for ( int w=1; w<nWorkers; w++ )
+	{
+		CFeatureScratch::BandScratch* pBand = pScratch->_vecBands[ w ];
+
+		if ( pBand->wMin <= pBand->wMax )
+			pBand->histGlobal.Collapse( pBand->wMin, pBand->wMax, nullptr, pGlobalHist, nullptr, 0, 0, 0 );
+	}
+
+	// the otsu of the blocks is spread over the workers, its time is their sum
+	if ( options.pStages != nullptr )
+	{
+		LONGLONG llOtsuTicks = 0;
 
-	*pdOtsu = (double) nMaxIndex / HISTSIZE;
-	*pdInner = dInner[ nMaxIndex ];
-	*pdInter = dInter[ nMaxIndex ];
-}
\ No newline at end of file
+		for ( int w=0; w<nWorkers; w++ )
+			llOtsuTicks += pScratch->_vecBands[ w ]->llOtsuTicks;
+
+		options.pStages->RecordTicks( kABCStage_BlockOtsu, llOtsuTicks, CStageStatistics::Now() );
+	}
+
+	if ( pCache != nullptr )
+		pCache->_bValid = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// grids compiled in
+template class CFeatureGenT< 8 >;
+template class CFeatureGenT< 16 >;
+template class CFeatureGenT< 32 >;
+
+template class CFeatureCacheT< 8 >;
+template class CFeatureCacheT< 16 >;
+template class CFeatureCacheT< 32 >;
@@ -3,47 +3,217 @@
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 
-#include "clUtils/defines.h"
+#include "abc/abc_platform.h"
 #include "abc/abc_types.h"
 
+// platform
+#include <vector>
+
 // forward declaration
 namespace cl { namespace img { class CImageBuf; }}
+namespace comed { namespace abc { class CValueHistogram; class CFrameSnapshot; class CFeatureBlock; class CThreadPool; class CStageStatistics; }}
 
 
 namespace comed { namespace abc 
 {
+	/// <summary>
+	/// statistics of one block
+	/// </summary>
+	struct LocalStatistics
+	{
+		WORD wMax, wMin;
+		UINT64 ullSum, ullSoS;
+		double dOtsu, dMode;
+	};
+
+	template< int DIVIDE > class CFeatureGenT;
+
+	/// <summary>
+	/// state of one frame stream for CFeatureGenT::CalcFeatures(...). 
+	/// A block whose sampled pixels did not change more than the tolerance keeps its statistics from the previous frames.
+	/// </summary>
+	template< int DIVIDE >
+	class CFeatureCacheT
+	{
+		CL_NO_COPY_CONSTRUCTOR( CFeatureCacheT )
+		CL_NO_ASSIGNMENT_OPERATOR( CFeatureCacheT )
+
+		friend class CFeatureGenT< DIVIDE >;
+
+	public:
+		/// <summary>
+		/// constructor, empty
+		/// </summary>
+		CFeatureCacheT(void);
+
+		/// <summary>
+		/// destructor
+		/// </summary>
+		~CFeatureCacheT(void);
+
+		/// <summary>
+		/// forget the previous frames, the next one is computed as a whole
+		/// </summary>
+		void Reset(void)							{ _bValid = false; }
+
+		/// <summary>
+		/// mean absolute difference of the sampled pixels ( gray values ) a block can have and still be reused.
+		/// 0 ( default ) reuses a block only if its sampled pixels are the same.
+		/// </summary>
+		void SetTolerance( int nTolerance )			{ ASSERT( nTolerance >= 0 ); _nTolerance = nTolerance; }
+		int GetTolerance(void) const				{ return _nTolerance; }
+
+		/// <summary>
+		/// true if the block was computed again for the last frame
+		/// </summary>
+		bool IsDirty( int nBlock ) const			{ return _abDirty[ nBlock ]; }
+
+	private:
+		bool _bValid;
+		int _nTolerance;
+
+		// the frames the cache is for
+		int _nSrcW, _nSrcH, _nDecimation, _nBitDepth;
+		E_ABCSampling _eSampling;
+		bool _bMasked, _abExposed[ DIVIDE * DIVIDE ];
+
+		LocalStatistics _aLocal[ DIVIDE * DIVIDE ];
+		bool _abDirty[ DIVIDE * DIVIDE ];
+
+		std::vector< WORD > _vecTiles;				// pixels the statistics are from, one tile per block
+		CValueHistogram* _pGlobalHist;				// value histogram of the tiles
+	};
+
+	/// <summary>
+	/// buffers of CFeatureGenT::CalcFeatures(...) kept from one frame to the next ( FeatureGenOptions::pScratch ).
+	/// They are made by the first frame and only again if the frames get larger, so the next frames allocate nothing.
+	/// One per thread calling CalcFeatures(...), any grid.
+	/// </summary>
+	class CFeatureScratch
+	{
+		CL_NO_COPY_CONSTRUCTOR( CFeatureScratch )
+		CL_NO_ASSIGNMENT_OPERATOR( CFeatureScratch )
+
+		template< int DIVIDE > friend class CFeatureGenT;
+
+		// internal data types
+		struct BandScratch;
+
+	public:
+		/// <summary>
+		/// constructor, nothing allocated yet
+		/// </summary>
+		CFeatureScratch(void);
+
+		/// <summary>
+		/// destructor
+		/// </summary>
+		~CFeatureScratch(void);
+
+	private:
+		// buffers of a worker, for tiles of nTile pixels
+		BandScratch* _getBand( int nWorker, int nTile, int nBitDepth );
+
+		// the global value histogram, all zero
+		CValueHistogram* _getGlobalHist( int nBitDepth );
+
+		// copy of a frame
+		WORD* _getFrame( size_t nPixels );
+
+	private:
+		std::vector< BandScratch* > _vecBands;		// one per worker of the pool, made on first use
+		CValueHistogram* _pGlobalHist;				// cleared over the range used after each frame
+		std::vector< WORD > _vecFrame;
+	};
+
+	/// <summary>
+	/// options of CFeatureGenT::CalcFeatures(...)
+	/// </summary>
+	struct FeatureGenOptions
+	{
+		int nDecimation;				// 1, 2 or 4. 0 halves frames of 1 MP or more
+		E_ABCSampling eSampling;		// sampling of decimated frames
+		CThreadPool* pPool;				// pool for the rows of blocks, nullptr to run on the calling thread
+		const bool* pbExposed;			// one flag per block, unexposed blocks are skipped. nullptr for all blocks
+		int nBitDepth;					// 12, 14 or 16, sizes the merged value histograms. 0 for the one of the frame ( 16 for CImageBuf )
+		CFeatureScratch* pScratch;		// buffers kept between frames, nullptr to allocate them for this frame only
+		CStageStatistics* pStages;		// latency of the stages is recorded, nullptr not to time them
+
+		FeatureGenOptions(void)
+			: nDecimation( 0 ), eSampling( kABCSampling_Nearest ), pPool( nullptr ), pbExposed( nullptr ), nBitDepth( 0 )
+			, pScratch( nullptr ), pStages( nullptr )
+		{
+		}
+	};
+
 	/// <summary>
 	/// aA opencvAC AUa| EƢeCN feature generatorAC OƢ AAo E oI CoCIA A
+	/// DIVIDE x DIVIDE blocks, compiled for 8, 16 and 32 ( FeatureGen.cpp ).
 	/// </summary>
-	class CFeatureGen
+	template< int DIVIDE >
+	class CFeatureGenT
 	{
-		CL_NO_INSTANTIATION( CFeatureGen );
+		CL_NO_INSTANTIATION( CFeatureGenT );
+
+		static_assert( DIVIDE > 2, "needs non-boundary blocks" );
+
+		// constants
+	public:
+		enum 
+		{ 
+			kDivide		= DIVIDE, 
+			kBlockCount	= DIVIDE * DIVIDE
+		};
 
 		// public methods
 	public:
 
+#if ! defined( ABC_STANDALONE )
+		/// <summary>
+		/// only public methods. pFeatures is made kBlockCount blocks, row major, if needed.
+		/// </summary>
+		static bool CalcFeatures( 
+				IN		const cl::img::CImageBuf & img, OUT		CFeatureBlock* pFeatures, 
+				IN		const FeatureGenOptions& options = FeatureGenOptions() );
+#endif
+
 		/// <summary>
-		/// only public methods
+		/// features of a frame snapshot. The pixels are read in place, no copy and no lock.
 		/// </summary>
 		static bool CalcFeatures( 
-				IN		const cl::img::CImageBuf & img, OUT		double **dbFeatures );
+				IN		const CFrameSnapshot & frame, OUT		CFeatureBlock* pFeatures, 
+				IN		const FeatureGenOptions& options = FeatureGenOptions() );
+
+		/// <summary>
+		/// features of a frame of a stream. Only the blocks changed since the previous frames are computed.
+		/// </summary>
+		static bool CalcFeatures( 
+				IN		const CFrameSnapshot & frame, OUT		CFeatureBlock* pFeatures, 
+				IN OUT	CFeatureCacheT< DIVIDE >* pCache,
+				IN		const FeatureGenOptions& options = FeatureGenOptions() );
+
+		/// <summary>
+		/// size of a block in pixels of the frame ( not decimated ). nDecimation is as in FeatureGenOptions.
+		/// </summary>
+		static void GetBlockSize( int nSrcW, int nSrcH, int nDecimation, OUT int* pnBlkW, OUT int* pnBlkH );
 
 		// private methods
 	private:
 
-		// calculate local statistics
+		// features of 16 bit pixels, sampled every options.nDecimation ( not 0 ) pixels
+		static bool _calcFeatures( 
+			const WORD* pwSrc, int nSrcW, int nSrcH, int nStrider, const FeatureGenOptions& options, 
+			CFeatureBlock* pFeatures, CFeatureCacheT< DIVIDE >* pCache );
+
+		// calculate local statistics, local otsu and the global value histogram in one pass
+		// With a cache, only the changed blocks are computed and the global histogram is updated.
 		static void _calcLocalStatistics( 
-			const WORD* pwSrc, int nImgW, int nImgH, int nBlkW, int nBlkH, 
-			WORD awLocalMax[], WORD awLocalMin[], double adbLocalSum[], double adbLocalSoS[] );
-
-		// calc one block statistics
-		static void _calcBlockStatistics( 
-			const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH, 
-			WORD* pwLocalMax, WORD* pwLocalMin, double* pdbLocalSum, double* pdbLocalSoS );
-
-		// calc otsu
-		static void _calcOtsu( 
-					const WORD* pwSrc, int nStrider, int nBlkW, int nBlkH, WORD wMin, WORD wMax,
-					double* pdOtsu, double* pdInner, double* pdInter, double* pdMode );
+			const WORD* pwSrc, int nStrider, const FeatureGenOptions& options, int nBlkW, int nBlkH, 
+			LocalStatistics aLocal[], CValueHistogram* pGlobalHist, CFeatureCacheT< DIVIDE >* pCache, CFeatureScratch* pScratch );
 	};
+
+	/// <summary>
+	/// the default 16 x 16 grid, ABC_REGION_DIVIDE
+	/// </summary>
+	typedef CFeatureGenT< ABC_REGION_DIVIDE > CFeatureGen;
 }} // comed::abc
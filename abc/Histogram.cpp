@@ -0,0 +1,224 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "Histogram.h"
+
+// platform
+#include <cstdlib>
+#include <cstring>
+
+// log
+#include "abc.logger.h"
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW 
+#endif 
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// constructor
+CValueHistogram::CValueHistogram( bool bBanked, int nValueBits )
+	: _nBanks( bBanked ? VALUEHISTBANKS : 1 )
+	, _nValues( 1 << nValueBits )
+	, _nStride( bBanked ? VALUEHISTSIZE : ( 1 << nValueBits ) )
+	, _wTop( (WORD)( ( 1 << nValueBits ) - 1 ) )
+{
+	ASSERT( nValueBits >= 8 && nValueBits <= 16 );
+
+	// calloc, not new + memset. Zero pages come from the OS on first touch, so only [min, max] of the frame is paid.
+	// The same keeps the banks above the bit depth free until a pixel lands there.
+	_pdwBanks = static_cast<DWORD*>( ::calloc( _nStride * _nBanks, sizeof(DWORD) ) );
+	ASSERT( _pdwBanks );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// destructor
+CValueHistogram::~CValueHistogram(void)
+{
+	::free( _pdwBanks );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// collapse the banks
+bool CValueHistogram::Collapse( 
+				IN		WORD wMin, WORD wMax, 
+				OUT		int anHist[], CValueHistogram* pTarget, 
+				IN		const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH )
+{
+	ASSERT( wMin <= wMax );
+	ASSERT( pTarget != this );
+	ASSERT( pTarget == nullptr || pTarget->_nValues == _nValues );
+
+	// pixels above the bit depth are counted as the top value
+	const WORD wMinAdded = wMin, wMaxAdded = wMax;
+
+	wMin = _clamp( wMin );
+	wMax = _clamp( wMax );
+
+	DWORD* adwBank0  = _pdwBanks;
+	DWORD* adwTarget = ( pTarget != nullptr ) ? pTarget->_pdwBanks : nullptr;
+
+	// no otsu for a flat range
+	if ( wMin == wMax )
+		anHist = nullptr;
+
+	const CHistogramBinning binning( wMin, wMax );
+
+	if ( anHist != nullptr )
+		memset( anHist, 0, sizeof(int) * HISTSIZE );
+
+	// Noisy blocks can have wider range than pixels. The block is still in the cache, so walk the pixels instead.
+	// The pixels themselves are binned, the banks are only cleared.
+	if ( pwBlk != nullptr && wMax - wMin + 1 > nBlkW * nBlkH )
+	{
+		for ( int y=0; y<nBlkH; y++, pwBlk += nStrider )
+		for ( int x=0; x<nBlkW; x++ )
+		{
+			const WORD v = _clamp( pwBlk[ x ] );
+
+			if ( anHist != nullptr )
+				anHist[ binning( v ) ] ++;
+
+			if ( adwTarget != nullptr )
+				adwTarget[ v ] ++;
+
+			// where AddLine counted it
+			const int nIndex = CLU_MIN( (int) pwBlk[ x ], _nStride - 1 );
+
+			for ( int b=0; b<_nBanks; b++ )
+				_pdwBanks[ b * _nStride + nIndex ] = 0;
+		}
+		return anHist != nullptr;
+	}
+
+	// AddLine does not clamp, so the pixels above the bit depth are moved to the top value here, once per block.
+	// Blocks without them ( every block of a detector within its bit depth ) skip it.
+	if ( wMaxAdded > _wTop && _nStride > _nValues )
+	{
+		for ( int b=0; b<_nBanks; b++ )
+		{
+			DWORD* adwBank = _pdwBanks + b * _nStride;
+
+			for ( int v=CLU_MAX( (int) wMinAdded, _wTop + 1 ); v<=wMaxAdded; v++ )
+			{
+				adwBank[ _wTop ] += adwBank[ v ];
+				adwBank[ v ] = 0;
+			}
+		}
+	}
+
+	// Fold the banks into the first one. Plain loops over contiguous values, the compiler vectorizes them.
+	for ( int b=1; b<_nBanks; b++ )
+	{
+		DWORD* adwBank = _pdwBanks + b * _nStride;
+
+		for ( int v=wMin; v<=wMax; v++ )
+			adwBank0[ v ] += adwBank[ v ];
+
+		memset( adwBank + wMin, 0, sizeof(DWORD) * ( wMax - wMin + 1 ) );
+	}
+
+	if ( adwTarget != nullptr )
+	{
+		for ( int v=wMin; v<=wMax; v++ )
+			adwTarget[ v ] += adwBank0[ v ];
+	}
+
+	// Bin each pixel value once instead of each pixel.
+	// Neighbouring values share a bin, so the count is kept in a register until the bin changes.
+	if ( anHist != nullptr )
+	{
+		int nCurBin = 0;
+		DWORD dwBinCount = 0;
+
+		for ( int v=wMin; v<=wMax; v++ )
+		{
+			const int nBin = binning( (WORD) v );
+
+#ifdef _DEBUG 
+			if ( nBin < 0 || nBin >= HISTSIZE )
+			{
+				LOG_ERROR( _T("Invalid histogram: Min %d, Max %d, Pixel %d, nBin %d"), wMin, wMax, v, nBin );
+				ASSERT( 0 );
+			}
+#endif 
+
+			if ( nBin != nCurBin )
+			{
+				anHist[ nCurBin ] += (int) dwBinCount;
+				nCurBin = nBin;
+				dwBinCount = 0;
+			}
+
+			dwBinCount += adwBank0[ v ];
+		}
+
+		anHist[ nCurBin ] += (int) dwBinCount;
+	}
+
+	memset( adwBank0 + wMin, 0, sizeof(DWORD) * ( wMax - wMin + 1 ) );
+
+	return anHist != nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// bin without clearing
+bool CValueHistogram::Bin( IN WORD wMin, WORD wMax, OUT int anHist[] ) const
+{
+	ASSERT( wMin <= wMax );
+	ASSERT( _nBanks == 1 );
+
+	wMin = _clamp( wMin );
+	wMax = _clamp( wMax );
+
+	if ( wMin == wMax )
+		return false;
+
+	const CHistogramBinning binning( wMin, wMax );
+
+	memset( anHist, 0, sizeof(int) * HISTSIZE );
+
+	// same as Collapse(...)
+	int nCurBin = 0;
+	DWORD dwBinCount = 0;
+
+	for ( int v=wMin; v<=wMax; v++ )
+	{
+		const int nBin = binning( (WORD) v );
+
+		if ( nBin != nCurBin )
+		{
+			anHist[ nCurBin ] += (int) dwBinCount;
+			nCurBin = nBin;
+			dwBinCount = 0;
+		}
+
+		dwBinCount += _pdwBanks[ v ];
+	}
+
+	anHist[ nCurBin ] += (int) dwBinCount;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// take a block out
+void CValueHistogram::RemoveBlock( IN const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH )
+{
+	ASSERT( _nBanks == 1 );
+
+	// Counts wrap around in a partial histogram, they are right again once added to the one holding the block.
+	for ( int y=0; y<nBlkH; y++, pwBlk += nStrider )
+	for ( int x=0; x<nBlkW; x++ )
+		_pdwBanks[ _clamp( pwBlk[ x ] ) ] --;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// clear all
+void CValueHistogram::Clear(void)
+{
+	memset( _pdwBanks, 0, sizeof(DWORD) * _nStride * _nBanks );
+}
@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+
+// macro
+#define HISTSIZE					256
+#define VALUEHISTSIZE				( 0xffff + 1 )
+#define VALUEHISTBANKS				4
+
+namespace comed { namespace abc 
+{
+	/// <summary>
+	/// maps pixel values of [wMin, wMax] to HISTSIZE bins with a fixed point reciprocal.
+	/// equal to floor( ( w - wMin ) * HISTSIZE / ( wMax - wMin + 1 ) ) for every 16 bit range
+	/// </summary>
+	class CHistogramBinning
+	{
+	public:
+		CHistogramBinning( WORD wMin, WORD wMax )
+			: _wMin( wMin )
+			, _ullReciprocal( ( (UINT64) HISTSIZE << 32 ) / ( (UINT64) wMax - wMin + 1 ) + 1 )
+		{
+		}
+
+		int operator()( WORD w ) const
+		{
+			return (int)( ( (UINT64)( w - _wMin ) * _ullReciprocal ) >> 32 );
+		}
+
+	private:
+		WORD	_wMin;
+		UINT64	_ullReciprocal;
+	};
+
+	/// <summary>
+	/// histogram indexed by the pixel value. 
+	/// Neighbouring pixels are scattered into different banks, so runs of equal values do not wait for the previous store.
+	/// Banks are summed ( and cleared ) only over the range actually touched.
+	/// Pixels above the bit depth are counted as its top value. AddLine does not clamp: the banks span all 16 bit
+	/// values ( 256 KB each ) whatever the bit depth, and Collapse folds the counts above the top into it once per
+	/// block, from the max of the block. Only the histograms without banks are sized to the bit depth.
+	/// </summary>
+	class CValueHistogram
+	{
+		CL_NO_COPY_CONSTRUCTOR( CValueHistogram )
+		CL_NO_ASSIGNMENT_OPERATOR( CValueHistogram )
+
+	public:
+		/// <summary>
+		/// constructor, all zero. Histograms only used as a Collapse() target need no banks.
+		/// nValueBits is 8 to 16, histograms used together must have the same.
+		/// </summary>
+		explicit CValueHistogram( bool bBanked = true, int nValueBits = 16 );
+
+		/// <summary>
+		/// destructor
+		/// </summary>
+		~CValueHistogram(void);
+
+		/// <summary>
+		/// number of values, 1 << nValueBits
+		/// </summary>
+		int GetValueCount(void) const			{ return _nValues; }
+
+		/// <summary>
+		/// add a line of pixels
+		/// </summary>
+		void AddLine( const WORD* pw, int nCount )
+		{
+			static_assert( VALUEHISTBANKS == 4, "AddLine is unrolled for 4 banks" );
+			ASSERT( _nBanks == VALUEHISTBANKS );
+
+			DWORD* adwBank0 = _pdwBanks;
+			DWORD* adwBank1 = _pdwBanks + VALUEHISTSIZE;
+			DWORD* adwBank2 = _pdwBanks + VALUEHISTSIZE * 2;
+			DWORD* adwBank3 = _pdwBanks + VALUEHISTSIZE * 3;
+			int x = 0;
+
+			for ( ; x + VALUEHISTBANKS <= nCount; x += VALUEHISTBANKS )
+			{
+				adwBank0[ pw[ x + 0 ] ] ++;
+				adwBank1[ pw[ x + 1 ] ] ++;
+				adwBank2[ pw[ x + 2 ] ] ++;
+				adwBank3[ pw[ x + 3 ] ] ++;
+			}
+			for ( ; x < nCount; x++ )
+			{
+				adwBank0[ pw[ x ] ] ++;
+			}
+		}
+
+		/// <summary>
+		/// Bin [wMin, wMax] into anHist ( HISTSIZE, if not nullptr ), add it to pTarget ( if not nullptr ) and clear it.
+		/// wMin and wMax are those of the pixels added, before clamping to the bit depth.
+		/// pwBlk is the block the pixels came from ( or nullptr ), walked instead of the range when it has less pixels.
+		/// false if no bin histogram was made ( wMin == wMax )
+		/// </summary>
+		bool Collapse( 
+				IN		WORD wMin, WORD wMax, 
+				OUT		int anHist[], CValueHistogram* pTarget, 
+				IN		const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH );
+
+		/// <summary>
+		/// Bin [wMin, wMax] into anHist ( HISTSIZE ) without clearing. Only for histograms without banks.
+		/// false if no bin histogram was made ( wMin == wMax )
+		/// </summary>
+		bool Bin( IN WORD wMin, WORD wMax, OUT int anHist[] ) const;
+
+		/// <summary>
+		/// take the pixels of a block out again. Only for histograms without banks.
+		/// </summary>
+		void RemoveBlock( IN const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH );
+
+		/// <summary>
+		/// clear all
+		/// </summary>
+		void Clear(void);
+
+	private:
+		// a pixel as counted
+		WORD _clamp( WORD w ) const				{ return CLU_MIN( w, _wTop ); }
+
+	private:
+		int _nBanks;
+		int _nValues;
+		int _nStride;			// values of a bank, VALUEHISTSIZE with banks ( AddLine ), else _nValues
+		WORD _wTop;				// _nValues - 1
+		DWORD* _pdwBanks;		// _nBanks x _nStride, bank after bank
+	};
+}} // comed::abc
@@ -0,0 +1,1206 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "MLPEngine.h"
+#include "BlockStatistics.h"
+
+// platform
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#if ! defined( _WIN32 )
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// networks generated by SaveHeader(...), from abc_mlpgen ( CMakeLists.txt ) or the trainer
+#ifdef ABC_BUILTIN_MLP
+#include "MLPBuiltIn.h"
+#endif
+
+// logger
+#include "abc.logger.h"
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW
+#endif
+
+// macro
+#define MLP_LANES					4			// blocks of a pass
+
+#define MLP_FILE_MAGIC				0x4d434241	// "ABCM"
+#define MLP_FILE_VERSION			2			// 2: the checksum covers the header
+#define MLP_ACTIVATION_SIGMOID_SYM	1			// folded into the weights as in CMLPEngine
+
+#define QUANT_LUT_SIZE				4096		// entries of the activation table
+#define QUANT_LUT_RANGE				16.f		// the table is of [ -16, 16 ], the activation is +-1 out of it
+#define QUANT_LUT_ONE				16384		// 1 in the table ( Q14 )
+#define QUANT_INPUT_MAX16			8191		// largest quantized input
+#define QUANT_INPUT_MAX8			127			// 127 x 127 x 2 does not saturate pmaddubsw
+#define QUANT_WEIGHT_MAX8			127
+#define QUANT_WEIGHT_MAX16			32767
+#define QUANT_PAD					4			// inputs of a unit are padded to a group of the int8 kernel
+
+// Intrinsics can be used in any function with MSVC. gcc/clang need the target per function.
+#if defined( _MSC_VER )
+#define TARGET_SSSE3
+#else
+#define TARGET_SSSE3				__attribute__(( target( "ssse3" ) ))
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// model file of SaveBinary(...), little endian. The floats of the hidden layer, then of the output follow it.
+struct MLPFileHeader
+{
+	DWORD dwMagic;
+	DWORD dwVersion;
+	DWORD dwHeaderSize;							// offset of the weights
+	DWORD dwChecksum;							// FNV-1a of the header ( with dwChecksum 0 ), then of the weights
+
+	int nInputs, nHidden, nHidden0;
+	int nActivation;
+
+	float afOutputBias[ 2 ];
+	float afOutputScale[ 2 ];
+	float afOutputShift[ 2 ];
+
+	DWORD adwReserved[ 2 ];
+};
+
+static_assert( sizeof( MLPFileHeader ) == 64, "the weights of a model file are 16 byte aligned" );
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// fixed point networks of Quantize(...)
+struct CMLPEngine::QuantizedNetworks
+{
+	E_ABCPrecision ePrecision;
+
+	int nPadded;								// inputs padded to QUANT_PAD
+	int nGroups;								// inputs of a lane of the kernels, 2 int16 or 4 int8
+	int nInputMax;								// largest quantized input
+	int nActivationShift;						// of the table for the output layer, Q14 or Q7
+
+	float afInputScale[ MLP_MAX_UNITS ];		// quantized input of 1
+
+	std::vector< int > vecUnits;				// hidden units x nGroups, each the weights of a group packed in 32 bit
+
+	float afIndexScale[ MLP_MAX_UNITS ];		// table index of the dot product of a unit
+	float afIndexBias[ MLP_MAX_UNITS ];
+	int anOutput[ MLP_MAX_UNITS ];				// output weight of a unit
+
+	float afOutputIndexScale[ 2 ];				// table index of the sum of an output
+	float afOutputIndexBias[ 2 ];
+
+	short asLut[ QUANT_LUT_SIZE ];				// ( 1 - exp( z ) ) / ( 1 + exp( z ) ) in Q14
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// a network as saved by CvANN_MLP
+struct CMLPEngine::Network
+{
+	int nInputs, nHidden;
+
+	double dAlpha, dBeta;						// f_param1 and f_param2 of SIGMOID_SYM
+
+	std::vector< double > vecInputScale;		// scale and shift of each input
+	std::vector< double > vecOutputScale;		// scale and shift of the output
+	std::vector< double > vecHidden;			// ( nInputs + 1 ) x nHidden, the bias is the last row
+	std::vector< double > vecOutput;			// nHidden + 1, the bias is the last
+
+	Network(void) : nInputs( 0 ), nHidden( 0 ), dAlpha( 0. ), dBeta( 0. )
+	{
+	}
+};
+
+namespace
+{
+	// a key at the start of a line ( after the indent ), with its ':'
+	const char* _findKey( const char* psz, const char* pszKey )
+	{
+		if ( psz == nullptr )
+			return nullptr;
+
+		const size_t nLength = strlen( pszKey );
+
+		for ( const char* p = strstr( psz, pszKey ); p != nullptr; p = strstr( p + 1, pszKey ) )
+		{
+			if ( ( p == psz || p[ -1 ] == ' ' || p[ -1 ] == '\n' || p[ -1 ] == '\t' ) && p[ nLength ] == ':' )
+				return p + nLength + 1;
+		}
+
+		return nullptr;
+	}
+
+	// a number after the key
+	bool _readNumber( const char* psz, double* pdValue )
+	{
+		if ( psz == nullptr )
+			return false;
+
+		char* pszEnd = nullptr;
+		*pdValue = strtod( psz, &pszEnd );
+
+		return pszEnd != psz;
+	}
+
+	// a list [ a, b, ... ], the end of it is returned
+	const char* _readList( const char* psz, std::vector< double >* pvecValues )
+	{
+		if ( psz == nullptr || ( psz = strchr( psz, '[' ) ) == nullptr )
+			return nullptr;
+
+		pvecValues->clear();
+		psz ++;
+
+		for ( ;; )
+		{
+			while ( *psz == ' ' || *psz == ',' || *psz == '\r' || *psz == '\n' || *psz == '\t' )
+				psz ++;
+
+			if ( *psz == ']' )
+				return psz + 1;
+
+			char* pszEnd = nullptr;
+			const double dValue = strtod( psz, &pszEnd );
+
+			if ( pszEnd == psz )
+				return nullptr;
+
+			pvecValues->push_back( dValue );
+			psz = pszEnd;
+		}
+	}
+
+	// whole file as text
+	bool _readFile( LPCTSTR lpszPath, std::string* pstrText )
+	{
+		std::ifstream file( lpszPath, std::ios::in | std::ios::binary );
+		std::ostringstream os;
+
+		if ( ! file || ! ( os << file.rdbuf() ) )
+		{
+			LOG_ERROR( _T("Can't read the network from [%s]"), lpszPath );
+			return false;
+		}
+
+		*pstrText = os.str();
+
+		return true;
+	}
+
+	// exp of 4 floats, polynomial of cephes expf ( 1 ulp or so )
+	inline __m128 _exp( __m128 mX )
+	{
+		mX = _mm_min_ps( _mm_max_ps( mX, _mm_set1_ps( -87.3f ) ), _mm_set1_ps( 88.3f ) );
+
+		// exp( x ) = 2^n x exp( r ), r = x - n x ln2
+		const __m128 mFx = _mm_add_ps( _mm_mul_ps( mX, _mm_set1_ps( 1.44269504088896341f ) ), _mm_set1_ps( 0.5f ) );
+
+		__m128i mN = _mm_cvttps_epi32( mFx );
+		__m128 mN_ = _mm_cvtepi32_ps( mN );
+
+		// truncated to floor
+		const __m128 mOver = _mm_cmpgt_ps( mN_, mFx );
+		mN_ = _mm_sub_ps( mN_, _mm_and_ps( mOver, _mm_set1_ps( 1.f ) ) );
+		mN = _mm_cvttps_epi32( mN_ );
+
+		const __m128 mR = _mm_sub_ps( _mm_sub_ps( mX, _mm_mul_ps( mN_, _mm_set1_ps( 0.693359375f ) ) ),
+									  _mm_mul_ps( mN_, _mm_set1_ps( -2.12194440e-4f ) ) );
+
+		__m128 mY = _mm_set1_ps( 1.9875691500e-4f );
+		mY = _mm_add_ps( _mm_mul_ps( mY, mR ), _mm_set1_ps( 1.3981999507e-3f ) );
+		mY = _mm_add_ps( _mm_mul_ps( mY, mR ), _mm_set1_ps( 8.3334519073e-3f ) );
+		mY = _mm_add_ps( _mm_mul_ps( mY, mR ), _mm_set1_ps( 4.1665795894e-2f ) );
+		mY = _mm_add_ps( _mm_mul_ps( mY, mR ), _mm_set1_ps( 1.6666665459e-1f ) );
+		mY = _mm_add_ps( _mm_mul_ps( mY, mR ), _mm_set1_ps( 5.0000001201e-1f ) );
+		mY = _mm_add_ps( _mm_add_ps( _mm_mul_ps( mY, _mm_mul_ps( mR, mR ) ), mR ), _mm_set1_ps( 1.f ) );
+
+		const __m128 mPow2n = _mm_castsi128_ps( _mm_slli_epi32( _mm_add_epi32( mN, _mm_set1_epi32( 127 ) ), 23 ) );
+
+		return _mm_mul_ps( mY, mPow2n );
+	}
+
+	// SIGMOID_SYM of OpenCV with -alpha and beta folded out, ( 1 - exp( x ) ) / ( 1 + exp( x ) )
+	inline __m128 _sigmoidSym( __m128 mX )
+	{
+		const __m128 mE = _exp( mX );
+		const __m128 mOne = _mm_set1_ps( 1.f );
+
+		return _mm_div_ps( _mm_sub_ps( mOne, mE ), _mm_add_ps( mOne, mE ) );
+	}
+
+	// sums of the lanes of 4 dot products
+	inline __m128i _sum4( __m128i m0, __m128i m1, __m128i m2, __m128i m3 )
+	{
+		// m0a + m0c, m1a + m1c, m0b + m0d, m1b + m1d
+		const __m128i m01 = _mm_add_epi32( _mm_unpacklo_epi32( m0, m1 ), _mm_unpackhi_epi32( m0, m1 ) );
+		const __m128i m23 = _mm_add_epi32( _mm_unpacklo_epi32( m2, m3 ), _mm_unpackhi_epi32( m2, m3 ) );
+
+		return _mm_add_epi32( _mm_unpacklo_epi64( m01, m23 ), _mm_unpackhi_epi64( m01, m23 ) );
+	}
+
+	// dot products of the units and MLP_LANES rows, a row per lane. amIn has the inputs of a group of each row,
+	// 2 int16 inputs a lane, pnUnits the weights of a group of each unit as 2 int16.
+	void _hiddenInt16( const __m128i amIn[], const int* pnUnits, int nGroups, int nUnits, __m128i amDot[] )
+	{
+		for ( int j=0; j<nUnits; j++ )
+		{
+			const int* pnUnit = pnUnits + (size_t) j * nGroups;
+			__m128i mSum = _mm_setzero_si128();
+
+			for ( int g=0; g<nGroups; g++ )
+				mSum = _mm_add_epi32( mSum, _mm_madd_epi16( amIn[ g ], _mm_set1_epi32( pnUnit[ g ] ) ) );
+
+			amDot[ j ] = mSum;
+		}
+	}
+
+	// as _hiddenInt16(...), 4 uint8 inputs a lane and 4 int8 weights
+	TARGET_SSSE3
+	void _hiddenInt8( const __m128i amIn[], const int* pnUnits, int nGroups, int nUnits, __m128i amDot[] )
+	{
+		const __m128i mOnes = _mm_set1_epi16( 1 );
+
+		for ( int j=0; j<nUnits; j++ )
+		{
+			const int* pnUnit = pnUnits + (size_t) j * nGroups;
+			__m128i mSum = _mm_setzero_si128();
+
+			for ( int g=0; g<nGroups; g++ )
+				mSum = _mm_add_epi32( mSum, _mm_madd_epi16( _mm_maddubs_epi16( amIn[ g ], _mm_set1_epi32( pnUnit[ g ] ) ), mOnes ) );
+
+			amDot[ j ] = mSum;
+		}
+	}
+
+	// entry of the activation table
+	inline int _lutIndex( float fIndex )
+	{
+		if ( fIndex <= 0.f )
+			return 0;
+
+		if ( fIndex >= (float)( QUANT_LUT_SIZE - 1 ) )
+			return QUANT_LUT_SIZE - 1;
+
+		return (int) fIndex;
+	}
+
+	// FNV-1a, continuing from dwHash
+	DWORD _fnv1a( const void* pv, size_t nSize, DWORD dwHash = 2166136261u )
+	{
+		const BYTE* pb = static_cast< const BYTE* >( pv );
+
+		for ( size_t i=0; i<nSize; i++ )
+			dwHash = ( dwHash ^ pb[ i ] ) * 16777619u;
+
+		return dwHash;
+	}
+
+	// checksum of a model file: the sizes, bias, scale and shift of the header are checked as the weights are
+	DWORD _checksum( const MLPFileHeader& header, const void* pvWeights, size_t nSize )
+	{
+		MLPFileHeader headerHashed = header;
+		headerHashed.dwChecksum = 0;
+
+		return _fnv1a( pvWeights, nSize, _fnv1a( &headerHashed, sizeof( headerHashed ) ) );
+	}
+
+	// Write a file as a whole: a temporary file next to it is written, then renamed over it.
+	// The old file is never truncated, so the models mapping it ( LoadBinary ) keep reading what they loaded.
+	bool _replaceFile( LPCTSTR lpszPath, const std::string& strData )
+	{
+		const std::basic_string< TCHAR > strTemp = std::basic_string< TCHAR >( lpszPath ) + _T(".tmp");
+
+		std::ofstream file( strTemp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+
+		file.write( strData.c_str(), (std::streamsize) strData.size() );
+		file.close();
+
+#if defined( _WIN32 )
+		// Fails while an older Windows still maps the old file. The mapping then stays as it is, nothing is written.
+		const bool bDone = ! file.fail() && ::MoveFileEx( strTemp.c_str(), lpszPath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH );
+
+		if ( ! bDone )
+			::DeleteFile( strTemp.c_str() );
+#else
+		const bool bDone = ! file.fail() && ::rename( strTemp.c_str(), lpszPath ) == 0;
+
+		if ( ! bDone )
+			::remove( strTemp.c_str() );
+#endif
+
+		return bDone;
+	}
+
+	// a float as a literal of C++, 9 digits restore it exactly
+	std::string _floatLiteral( float fValue )
+	{
+		std::ostringstream os;
+		os.precision( 9 );
+		os << fValue;
+
+		std::string str = os.str();
+
+		// 1 is not a float literal, 1.f is
+		if ( str.find_first_of( ".e" ) == std::string::npos )
+			str += '.';
+
+		return str + 'f';
+	}
+
+	// fused weights, as in CMLPEngine
+	struct MLPWeights
+	{
+		const float* pfHidden;
+		const float* pfOutput;
+		const float* pfOutputBias;
+		const float* pfOutputScale;
+		const float* pfOutputShift;
+
+		int nInputs, nHidden, nHidden0;
+	};
+
+	// Predict the rows, MLP_LANES at a time. Sizes not 0 are of the built-in networks, 
+	// known to the compiler so the loops of the layers can be unrolled.
+	template< int INPUTS, int HIDDEN, int HIDDEN0 >
+	void _predictPass( 
+				IN		const MLPWeights& weights, const double* pdRows, int nStride, const int anRows[], int nRows,
+				OUT		double adOut0[], double adOut1[] )
+	{
+		const int nInputs = ( INPUTS > 0 ) ? INPUTS : weights.nInputs;
+		const int nHidden = ( HIDDEN > 0 ) ? HIDDEN : weights.nHidden;
+		const int nHidden0 = ( HIDDEN > 0 ) ? HIDDEN0 : weights.nHidden0;
+
+		// inputs of MLP_LANES rows, one row per lane
+		__m128 amIn[ MLP_MAX_UNITS ];
+
+		for ( int r=0; r<nRows; r+=MLP_LANES )
+		{
+			// the last pass repeats its last row
+			int anRow[ MLP_LANES ];
+
+			for ( int k=0; k<MLP_LANES; k++ )
+			{
+				const int nRow = CLU_MIN( r + k, nRows - 1 );
+				anRow[ k ] = ( anRows != nullptr ) ? anRows[ nRow ] : nRow;
+			}
+
+			const double* pd0 = pdRows + (size_t) anRow[ 0 ] * nStride;
+			const double* pd1 = pdRows + (size_t) anRow[ 1 ] * nStride;
+			const double* pd2 = pdRows + (size_t) anRow[ 2 ] * nStride;
+			const double* pd3 = pdRows + (size_t) anRow[ 3 ] * nStride;
+
+			for ( int i=0; i<nInputs; i++ )
+				amIn[ i ] = _mm_setr_ps( (float) pd0[ i ], (float) pd1[ i ], (float) pd2[ i ], (float) pd3[ i ] );
+
+			// both hidden layers, each unit adds to the output of its network
+			__m128 amOut[ 2 ] = { _mm_set1_ps( weights.pfOutputBias[ 0 ] ), _mm_set1_ps( weights.pfOutputBias[ 1 ] ) };
+
+			for ( int j=0; j<nHidden; j++ )
+			{
+				const float* pfUnit = weights.pfHidden + (size_t) j * ( nInputs + 1 );
+				__m128 mSum = _mm_set1_ps( pfUnit[ nInputs ] );
+
+				for ( int i=0; i<nInputs; i++ )
+					mSum = _mm_add_ps( mSum, _mm_mul_ps( amIn[ i ], _mm_set1_ps( pfUnit[ i ] ) ) );
+
+				__m128& mOut = amOut[ ( j < nHidden0 ) ? 0 : 1 ];
+				mOut = _mm_add_ps( mOut, _mm_mul_ps( _sigmoidSym( mSum ), _mm_set1_ps( weights.pfOutput[ j ] ) ) );
+			}
+
+			// outputs
+			float afOut[ 2 ][ MLP_LANES ];
+
+			for ( int n=0; n<2; n++ )
+			{
+				const __m128 mOut = _mm_add_ps( _mm_mul_ps( _sigmoidSym( amOut[ n ] ), _mm_set1_ps( weights.pfOutputScale[ n ] ) ),
+												_mm_set1_ps( weights.pfOutputShift[ n ] ) );
+				_mm_storeu_ps( afOut[ n ], mOut );
+			}
+
+			for ( int k=0; k<MLP_LANES && r + k < nRows; k++ )
+			{
+				adOut0[ anRow[ k ] ] = afOut[ 0 ][ k ];
+				adOut1[ anRow[ k ] ] = afOut[ 1 ][ k ];
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// constructor
+CMLPEngine::CMLPEngine(void)
+	: _nInputs( 0 ), _nHidden( 0 ), _nHidden0( 0 ), _bBuiltIn( false )
+	, _pfHidden( nullptr ), _pfOutput( nullptr )
+#if defined( _WIN32 )
+	, _hFile( INVALID_HANDLE_VALUE ), _hMapping( nullptr )
+#else
+	, _nViewSize( 0 )
+#endif
+	, _pvView( nullptr )
+	, _pQuant( nullptr )
+{
+	for ( int n=0; n<2; n++ )
+	{
+		_afOutputBias[ n ] = 0.f;
+		_afOutputScale[ n ] = 0.f;
+		_afOutputShift[ n ] = 0.f;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// destructor
+CMLPEngine::~CMLPEngine(void)
+{
+	Reset();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// forget the networks
+void CMLPEngine::Reset(void)
+{
+	_nInputs = 0;
+	_bBuiltIn = false;
+
+	_pfHidden = nullptr;
+	_pfOutput = nullptr;
+
+	delete _pQuant;
+	_pQuant = nullptr;
+
+#if defined( _WIN32 )
+	if ( _pvView != nullptr )
+		::UnmapViewOfFile( _pvView );
+
+	if ( _hMapping != nullptr )
+		::CloseHandle( _hMapping );
+
+	if ( _hFile != INVALID_HANDLE_VALUE )
+		::CloseHandle( _hFile );
+
+	_hMapping = nullptr;
+	_hFile = INVALID_HANDLE_VALUE;
+#else
+	if ( _pvView != nullptr )
+		::munmap( const_cast< void* >( _pvView ), _nViewSize );
+
+	_nViewSize = 0;
+#endif
+
+	_pvView = nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// copy the float networks
+bool CMLPEngine::CopyFrom( const CMLPEngine& other )
+{
+	ASSERT( &other != this );
+
+	Reset();
+
+	if ( ! other.IsLoaded() )
+		return false;
+
+	for ( int n=0; n<2; n++ )
+	{
+		_afOutputBias[ n ] = other._afOutputBias[ n ];
+		_afOutputScale[ n ] = other._afOutputScale[ n ];
+		_afOutputShift[ n ] = other._afOutputShift[ n ];
+	}
+
+	_nInputs = other._nInputs;
+	_nHidden = other._nHidden;
+	_nHidden0 = other._nHidden0;
+
+	// the arrays compiled in are constants
+	if ( other._bBuiltIn )
+	{
+		_pfHidden = other._pfHidden;
+		_pfOutput = other._pfOutput;
+		_bBuiltIn = true;
+
+		return true;
+	}
+
+	_vecHidden.assign( other._pfHidden, other._pfHidden + (size_t) _nHidden * ( _nInputs + 1 ) );
+	_vecOutput.assign( other._pfOutput, other._pfOutput + _nHidden );
+
+	_pfHidden = &_vecHidden[ 0 ];
+	_pfOutput = &_vecOutput[ 0 ];
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// load the networks
+bool CMLPEngine::Load( LPCTSTR lpszPath_Objec, LPCTSTR lpszPath_Metal )
+{
+	Reset();
+
+	LPCTSTR alpszPath[ 2 ] = { lpszPath_Objec, lpszPath_Metal };
+	Network aNet[ 2 ];
+
+	for ( int n=0; n<2; n++ )
+	{
+		std::string strText;
+
+		if ( ! _readFile( alpszPath[ n ], &strText ) )
+			return false;
+
+		if ( ! _parse( strText.c_str(), &aNet[ n ] ) )
+		{
+			LOG_ERROR( _T("Not a network of the native engine - [%s]"), alpszPath[ n ] );
+			return false;
+		}
+	}
+
+	if ( aNet[ 0 ].nInputs != aNet[ 1 ].nInputs || aNet[ 0 ].nHidden + aNet[ 1 ].nHidden > MLP_MAX_UNITS )
+	{
+		LOG_ERROR( _T("Networks can not be fused - %d-%d-1 and %d-%d-1"),
+				   aNet[ 0 ].nInputs, aNet[ 0 ].nHidden, aNet[ 1 ].nInputs, aNet[ 1 ].nHidden );
+		return false;
+	}
+
+	_fuse( aNet[ 0 ], aNet[ 1 ] );
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// read a network
+bool CMLPEngine::_parse( const char* pszText, Network* pNet )
+{
+	ASSERT( pszText != nullptr && pNet != nullptr );
+
+	// [ inputs, hidden, 1 ]
+	std::vector< double > vecLayers;
+
+	if ( _readList( _findKey( _findKey( pszText, "layer_sizes" ), "data" ), &vecLayers ) == nullptr || vecLayers.size() != 3 )
+		return false;
+
+	pNet->nInputs = (int) vecLayers[ 0 ];
+	pNet->nHidden = (int) vecLayers[ 1 ];
+
+	if ( pNet->nInputs < 1 || pNet->nInputs > MLP_MAX_UNITS || pNet->nHidden < 1 || vecLayers[ 2 ] != 1. )
+		return false;
+
+	// activation
+	const char* psz = _findKey( pszText, "activation_function" );
+
+	if ( psz == nullptr )
+		return false;
+
+	while ( *psz == ' ' )
+		psz ++;
+
+	if ( strncmp( psz, "SIGMOID_SYM", 11 ) != 0 )
+		return false;
+
+	if ( ! _readNumber( _findKey( pszText, "f_param1" ), &pNet->dAlpha ) ||
+		 ! _readNumber( _findKey( pszText, "f_param2" ), &pNet->dBeta ) )
+	{
+		return false;
+	}
+
+	// scales
+	if ( _readList( _findKey( pszText, "input_scale" ), &pNet->vecInputScale ) == nullptr ||
+		 pNet->vecInputScale.size() != (size_t) pNet->nInputs * 2 )
+	{
+		return false;
+	}
+
+	if ( _readList( _findKey( pszText, "output_scale" ), &pNet->vecOutputScale ) == nullptr ||
+		 pNet->vecOutputScale.size() != 2 )
+	{
+		return false;
+	}
+
+	// weights of the hidden and the output layer
+	psz = _readList( _findKey( pszText, "weights" ), &pNet->vecHidden );
+
+	if ( psz == nullptr || pNet->vecHidden.size() != (size_t)( pNet->nInputs + 1 ) * pNet->nHidden )
+		return false;
+
+	if ( _readList( psz, &pNet->vecOutput ) == nullptr || pNet->vecOutput.size() != (size_t) pNet->nHidden + 1 )
+		return false;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// fused weights
+void CMLPEngine::_fuse( const Network& net0, const Network& net1 )
+{
+	ASSERT( net0.nInputs == net1.nInputs );
+
+	const Network* apNet[ 2 ] = { &net0, &net1 };
+	const int nInputs = net0.nInputs;
+	const int nHidden = net0.nHidden + net1.nHidden;
+
+	_vecHidden.assign( (size_t) nHidden * ( nInputs + 1 ), 0.f );
+	_vecOutput.assign( nHidden, 0.f );
+
+	for ( int n=0, nFirst=0; n<2; nFirst+=apNet[ n ]->nHidden, n++ )
+	{
+		const Network& net = *apNet[ n ];
+		const double dAlpha = net.dAlpha;
+
+		for ( int j=0; j<net.nHidden; j++ )
+		{
+			float* pfUnit = &_vecHidden[ (size_t)( nFirst + j ) * ( nInputs + 1 ) ];
+
+			// w.( x * scale + shift ) + bias, times -alpha
+			double dBias = net.vecHidden[ (size_t) nInputs * net.nHidden + j ];
+
+			for ( int i=0; i<nInputs; i++ )
+			{
+				const double dW = net.vecHidden[ (size_t) i * net.nHidden + j ];
+
+				pfUnit[ i ] = (float)( -dAlpha * dW * net.vecInputScale[ i * 2 ] );
+				dBias += dW * net.vecInputScale[ i * 2 + 1 ];
+			}
+
+			pfUnit[ nInputs ] = (float)( -dAlpha * dBias );
+
+			// beta of the unit, and -alpha of the output
+			_vecOutput[ nFirst + j ] = (float)( -dAlpha * net.dBeta * net.vecOutput[ j ] );
+		}
+
+		_afOutputBias[ n ] = (float)( -dAlpha * net.vecOutput[ net.nHidden ] );
+		_afOutputScale[ n ] = (float)( net.dBeta * net.vecOutputScale[ 0 ] );
+		_afOutputShift[ n ] = (float) net.vecOutputScale[ 1 ];
+	}
+
+	_nInputs = nInputs;
+	_nHidden = nHidden;
+	_nHidden0 = net0.nHidden;
+
+	_pfHidden = &_vecHidden[ 0 ];
+	_pfOutput = &_vecOutput[ 0 ];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// networks compiled in
+bool CMLPEngine::LoadBuiltIn(void)
+{
+	Reset();
+
+#ifdef ABC_BUILTIN_MLP
+	_nInputs = MLP_BUILTIN_INPUTS;
+	_nHidden = MLP_BUILTIN_HIDDEN;
+	_nHidden0 = MLP_BUILTIN_HIDDEN0;
+
+	_pfHidden = g_afMLPBuiltIn_Hidden;
+	_pfOutput = g_afMLPBuiltIn_Output;
+
+	for ( int n=0; n<2; n++ )
+	{
+		_afOutputBias[ n ] = g_afMLPBuiltIn_OutputBias[ n ];
+		_afOutputScale[ n ] = g_afMLPBuiltIn_OutputScale[ n ];
+		_afOutputShift[ n ] = g_afMLPBuiltIn_OutputShift[ n ];
+	}
+
+	_bBuiltIn = true;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// write the networks as a header
+bool CMLPEngine::SaveHeader( LPCTSTR lpszPath ) const
+{
+	if ( ! IsLoaded() )
+		return false;
+
+	std::ostringstream os;
+
+	const int nUnit = _nInputs + 1;
+
+	os << "/* SPDX-License-Identifier: LGPL-2.1+ */\n"
+	   << "// Generated by CMLPEngine::SaveHeader(...), do not edit. abc_mlpgen writes it from the result files.\n"
+	   << "// Compiled in with ABC_BUILTIN_MLP, see CMLPEngine::LoadBuiltIn().\n"
+	   << "#pragma once\n\n"
+	   << "#define MLP_BUILTIN_INPUTS\t\t\t" << _nInputs << "\n"
+	   << "#define MLP_BUILTIN_HIDDEN\t\t\t" << _nHidden << "\n"
+	   << "#define MLP_BUILTIN_HIDDEN0\t\t\t" << _nHidden0 << "\n\n";
+
+	os << "// MLP_BUILTIN_HIDDEN x ( MLP_BUILTIN_INPUTS + 1 ), the weights of a unit then its bias\n"
+	   << "static const float g_afMLPBuiltIn_Hidden[ " << _nHidden * nUnit << " ] =\n{\n";
+
+	for ( int j=0; j<_nHidden; j++ )
+	{
+		os << "\t";
+
+		for ( int i=0; i<nUnit; i++ )
+			os << _floatLiteral( _pfHidden[ (size_t) j * nUnit + i ] ) << ", ";
+
+		os << "\n";
+	}
+
+	os << "};\n\n"
+	   << "static const float g_afMLPBuiltIn_Output[ " << _nHidden << " ] =\n{\n";
+
+	for ( int j=0; j<_nHidden; j++ )
+		os << "\t" << _floatLiteral( _pfOutput[ j ] ) << ",\n";
+
+	os << "};\n\n"
+	   << "static const float g_afMLPBuiltIn_OutputBias[ 2 ] = { " << _floatLiteral( _afOutputBias[ 0 ] ) << ", " << _floatLiteral( _afOutputBias[ 1 ] ) << " };\n"
+	   << "static const float g_afMLPBuiltIn_OutputScale[ 2 ] = { " << _floatLiteral( _afOutputScale[ 0 ] ) << ", " << _floatLiteral( _afOutputScale[ 1 ] ) << " };\n"
+	   << "static const float g_afMLPBuiltIn_OutputShift[ 2 ] = { " << _floatLiteral( _afOutputShift[ 0 ] ) << ", " << _floatLiteral( _afOutputShift[ 1 ] ) << " };\n";
+
+	if ( ! _replaceFile( lpszPath, os.str() ) )
+	{
+		LOG_ERROR( _T("Can't write the networks to [%s]"), lpszPath );
+		return false;
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// map a model file
+bool CMLPEngine::LoadBinary( LPCTSTR lpszPath )
+{
+	Reset();
+
+#if defined( _WIN32 )
+	// SaveBinary(...) may replace the file while it is mapped
+	_hFile = ::CreateFile( lpszPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+
+	LARGE_INTEGER llSize;
+
+	if ( _hFile == INVALID_HANDLE_VALUE || ! ::GetFileSizeEx( _hFile, &llSize ) || llSize.QuadPart < (LONGLONG) sizeof( MLPFileHeader ) )
+	{
+		LOG_ERROR( _T("Can't open the model [%s]"), lpszPath );
+		Reset();
+		return false;
+	}
+
+	const ULONGLONG ullSize = (ULONGLONG) llSize.QuadPart;
+
+	_hMapping = ::CreateFileMapping( _hFile, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	_pvView = ( _hMapping != nullptr ) ? ::MapViewOfFile( _hMapping, FILE_MAP_READ, 0, 0, 0 ) : nullptr;
+#else
+	const int nFile = ::open( lpszPath, O_RDONLY );
+
+	struct stat st;
+
+	if ( nFile < 0 || ::fstat( nFile, &st ) != 0 || st.st_size < (off_t) sizeof( MLPFileHeader ) )
+	{
+		if ( nFile >= 0 )
+			::close( nFile );
+
+		LOG_ERROR( _T("Can't open the model [%s]"), lpszPath );
+		Reset();
+		return false;
+	}
+
+	const ULONGLONG ullSize = (ULONGLONG) st.st_size;
+
+	// the mapping keeps the file
+	void* pvView = ::mmap( nullptr, (size_t) ullSize, PROT_READ, MAP_SHARED, nFile, 0 );
+	::close( nFile );
+
+	if ( pvView != MAP_FAILED )
+	{
+		_pvView = pvView;
+		_nViewSize = (size_t) ullSize;
+	}
+#endif
+
+	if ( _pvView == nullptr )
+	{
+		LOG_ERROR( _T("Can't map the model [%s]"), lpszPath );
+		Reset();
+		return false;
+	}
+
+	// nothing is parsed, the header is checked and the weights are used where they are
+	const MLPFileHeader& header = *static_cast< const MLPFileHeader* >( _pvView );
+
+	if ( header.dwMagic != MLP_FILE_MAGIC || header.dwVersion != MLP_FILE_VERSION || 
+		 header.dwHeaderSize < sizeof( MLPFileHeader ) || header.dwHeaderSize % 16 != 0 ||
+		 header.nActivation != MLP_ACTIVATION_SIGMOID_SYM ||
+		 header.nInputs < 1 || header.nInputs > MLP_MAX_UNITS || 
+		 header.nHidden < 2 || header.nHidden > MLP_MAX_UNITS || header.nHidden0 < 1 || header.nHidden0 >= header.nHidden )
+	{
+		LOG_ERROR( _T("Not a model file of this version - [%s]"), lpszPath );
+		Reset();
+		return false;
+	}
+
+	// the sizes are in range now
+	const size_t nWeights = (size_t) header.nHidden * ( header.nInputs + 1 ) + header.nHidden;
+
+	if ( ullSize != header.dwHeaderSize + (ULONGLONG) nWeights * sizeof(float) )
+	{
+		LOG_ERROR( _T("Size of the model does not match - [%s]"), lpszPath );
+		Reset();
+		return false;
+	}
+
+	const BYTE* pbWeights = static_cast< const BYTE* >( _pvView ) + header.dwHeaderSize;
+
+	if ( _checksum( header, pbWeights, nWeights * sizeof(float) ) != header.dwChecksum )
+	{
+		LOG_ERROR( _T("Checksum of the model does not match - [%s]"), lpszPath );
+		Reset();
+		return false;
+	}
+
+	for ( int n=0; n<2; n++ )
+	{
+		_afOutputBias[ n ] = header.afOutputBias[ n ];
+		_afOutputScale[ n ] = header.afOutputScale[ n ];
+		_afOutputShift[ n ] = header.afOutputShift[ n ];
+	}
+
+	_pfHidden = reinterpret_cast< const float* >( pbWeights );
+	_pfOutput = _pfHidden + (size_t) header.nHidden * ( header.nInputs + 1 );
+
+	_nHidden = header.nHidden;
+	_nHidden0 = header.nHidden0;
+	_nInputs = header.nInputs;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// write a model file
+bool CMLPEngine::SaveBinary( LPCTSTR lpszPath ) const
+{
+	if ( ! IsLoaded() )
+		return false;
+
+	const size_t nHiddenSize = (size_t) _nHidden * ( _nInputs + 1 ) * sizeof(float);
+	const size_t nOutputSize = (size_t) _nHidden * sizeof(float);
+
+	std::vector< BYTE > vecWeights( nHiddenSize + nOutputSize );
+	memcpy( &vecWeights[ 0 ], _pfHidden, nHiddenSize );
+	memcpy( &vecWeights[ nHiddenSize ], _pfOutput, nOutputSize );
+
+	MLPFileHeader header;
+	memset( &header, 0, sizeof( header ) );
+
+	header.dwMagic = MLP_FILE_MAGIC;
+	header.dwVersion = MLP_FILE_VERSION;
+	header.dwHeaderSize = sizeof( MLPFileHeader );
+
+	header.nInputs = _nInputs;
+	header.nHidden = _nHidden;
+	header.nHidden0 = _nHidden0;
+	header.nActivation = MLP_ACTIVATION_SIGMOID_SYM;
+
+	for ( int n=0; n<2; n++ )
+	{
+		header.afOutputBias[ n ] = _afOutputBias[ n ];
+		header.afOutputScale[ n ] = _afOutputScale[ n ];
+		header.afOutputShift[ n ] = _afOutputShift[ n ];
+	}
+
+	header.dwChecksum = _checksum( header, &vecWeights[ 0 ], vecWeights.size() );
+
+	std::string strData( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+	strData.append( reinterpret_cast< const char* >( &vecWeights[ 0 ] ), vecWeights.size() );
+
+	if ( ! _replaceFile( lpszPath, strData ) )
+	{
+		LOG_ERROR( _T("Can't write the model to [%s]"), lpszPath );
+		return false;
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// predict the rows
+void CMLPEngine::Predict(
+				IN		const double* pdRows, int nStride, const int anRows[], int nRows,
+				OUT		double adOut0[], double adOut1[]
+			) const
+{
+	ASSERT( IsLoaded() );
+	ASSERT( pdRows != nullptr && nStride >= _nInputs );
+
+	if ( _pQuant != nullptr )
+	{
+		_predictQuantized( pdRows, nStride, anRows, nRows, adOut0, adOut1 );
+		return;
+	}
+
+#ifdef ABC_BUILTIN_MLP
+	// the arrays and the sizes are constants here
+	if ( _bBuiltIn )
+	{
+		const MLPWeights weights = 
+		{
+			g_afMLPBuiltIn_Hidden, g_afMLPBuiltIn_Output,
+			g_afMLPBuiltIn_OutputBias, g_afMLPBuiltIn_OutputScale, g_afMLPBuiltIn_OutputShift,
+			MLP_BUILTIN_INPUTS, MLP_BUILTIN_HIDDEN, MLP_BUILTIN_HIDDEN0
+		};
+
+		_predictPass< MLP_BUILTIN_INPUTS, MLP_BUILTIN_HIDDEN, MLP_BUILTIN_HIDDEN0 >( weights, pdRows, nStride, anRows, nRows, adOut0, adOut1 );
+		return;
+	}
+#endif
+
+	const MLPWeights weights = 
+	{
+		_pfHidden, _pfOutput,
+		_afOutputBias, _afOutputScale, _afOutputShift,
+		_nInputs, _nHidden, _nHidden0
+	};
+
+	_predictPass< 0, 0, 0 >( weights, pdRows, nStride, anRows, nRows, adOut0, adOut1 );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// arithmetic of the prediction
+E_ABCPrecision CMLPEngine::GetPrecision(void) const
+{
+	return ( _pQuant != nullptr ) ? _pQuant->ePrecision : kABCPrecision_Float;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// fixed point networks
+bool CMLPEngine::Quantize( E_ABCPrecision ePrecision, const float afInputRange[] )
+{
+	if ( ! IsLoaded() || ePrecision < 0 || ePrecision >= _END_ABC_Precisions )
+	{
+		LOG_ERROR( _T("Can't quantize the networks - precision %d"), ePrecision );
+		return false;
+	}
+
+	// pmaddubsw is SSSE3, the CPUs of the levels of the kernels ( kSimdLevel_SSE41 and up ) have it
+	if ( ePrecision == kABCPrecision_Int8 && CBlockStatistics::GetSupportedSimdLevel() < kSimdLevel_SSE41 )
+	{
+		LOG_ERROR( _T("8 bit prediction needs SSE4.1") );
+		return false;
+	}
+
+	delete _pQuant;
+	_pQuant = nullptr;
+
+	if ( ePrecision == kABCPrecision_Float )
+		return true;
+
+	std::unique_ptr< QuantizedNetworks > pQuant( new QuantizedNetworks );
+	QuantizedNetworks& quant = *pQuant;
+
+	const bool b8 = ( ePrecision == kABCPrecision_Int8 );
+	const int nInputs = _nInputs;
+
+	quant.ePrecision = ePrecision;
+	quant.nPadded = ( nInputs + QUANT_PAD - 1 ) / QUANT_PAD * QUANT_PAD;
+	quant.nGroups = quant.nPadded / ( b8 ? 4 : 2 );
+	quant.nInputMax = b8 ? QUANT_INPUT_MAX8 : QUANT_INPUT_MAX16;
+	quant.nActivationShift = b8 ? 7 : 0;
+
+	// a dot product of int16 has to fit 32 bit
+	const int nWeightMax = b8 ? QUANT_WEIGHT_MAX8 : 
+								(int) CLU_MIN( (INT64) QUANT_WEIGHT_MAX16, (INT64) INT_MAX / ( (INT64) quant.nPadded * quant.nInputMax ) );
+	const int nOutputMax = b8 ? QUANT_WEIGHT_MAX8 : QUANT_WEIGHT_MAX16;
+
+	// table entries per 1 of the argument
+	const double dIndexUnit = QUANT_LUT_SIZE / ( 2. * QUANT_LUT_RANGE );
+
+	for ( int i=0; i<nInputs; i++ )
+	{
+		const float fRange = ( afInputRange != nullptr && afInputRange[ i ] > 0.f ) ? afInputRange[ i ] : 1.f;
+		quant.afInputScale[ i ] = quant.nInputMax / fRange;
+	}
+
+	// hidden layer, each unit with a step of its own
+	quant.vecUnits.assign( (size_t) _nHidden * quant.nGroups, 0 );
+
+	for ( int j=0; j<_nHidden; j++ )
+	{
+		const float* pfUnit = _pfHidden + (size_t) j * ( nInputs + 1 );
+
+		// weights of the quantized inputs
+		double dMax = 0.;
+
+		for ( int i=0; i<nInputs; i++ )
+			dMax = CLU_MAX( dMax, fabs( pfUnit[ i ] / (double) quant.afInputScale[ i ] ) );
+
+		const double dStep = ( dMax > 0. ) ? dMax / nWeightMax : 1.;
+
+		// the weights of a group packed as the inputs of a lane, the padding 0
+		UINT* pnUnit = reinterpret_cast< UINT* >( &quant.vecUnits[ (size_t) j * quant.nGroups ] );
+
+		for ( int i=0; i<nInputs; i++ )
+		{
+			const int nW = (int) floor( pfUnit[ i ] / (double) quant.afInputScale[ i ] / dStep + 0.5 );
+
+			if ( b8 )
+				pnUnit[ i / 4 ] |= (UINT)(BYTE)(signed char) CLU_MIN( nW, QUANT_WEIGHT_MAX8 ) << ( i % 4 * 8 );
+			else
+				pnUnit[ i / 2 ] |= (UINT)(WORD)(short) nW << ( i % 2 * 16 );
+		}
+
+		// +0.5, the index is rounded
+		quant.afIndexScale[ j ] = (float)( dStep * dIndexUnit );
+		quant.afIndexBias[ j ] = (float)( ( pfUnit[ nInputs ] + QUANT_LUT_RANGE ) * dIndexUnit + 0.5 );
+	}
+
+	// output layer, each network with a step of its own
+	for ( int n=0; n<2; n++ )
+	{
+		const int nFirst = ( n == 0 ) ? 0 : _nHidden0;
+		const int nLast = ( n == 0 ) ? _nHidden0 : _nHidden;
+
+		double dMax = 0.;
+
+		for ( int j=nFirst; j<nLast; j++ )
+			dMax = CLU_MAX( dMax, fabs( (double) _pfOutput[ j ] ) );
+
+		const double dStep = ( dMax > 0. ) ? dMax / nOutputMax : 1.;
+
+		for ( int j=nFirst; j<nLast; j++ )
+			quant.anOutput[ j ] = (int) floor( _pfOutput[ j ] / dStep + 0.5 );
+
+		const double dOne = (double)( QUANT_LUT_ONE >> quant.nActivationShift );
+
+		quant.afOutputIndexScale[ n ] = (float)( dStep / dOne * dIndexUnit );
+		quant.afOutputIndexBias[ n ] = (float)( ( _afOutputBias[ n ] + QUANT_LUT_RANGE ) * dIndexUnit + 0.5 );
+	}
+
+	// the activation at each entry
+	for ( int k=0; k<QUANT_LUT_SIZE; k++ )
+	{
+		const double dZ = k / dIndexUnit - QUANT_LUT_RANGE;
+		quant.asLut[ k ] = (short) floor( -tanh( dZ * 0.5 ) * QUANT_LUT_ONE + 0.5 );
+	}
+
+	_pQuant = pQuant.release();
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// predict in fixed point, MLP_LANES rows at a time as _predictPass(...)
+void CMLPEngine::_predictQuantized(
+				IN		const double* pdRows, int nStride, const int anRows[], int nRows,
+				OUT		double adOut0[], double adOut1[]
+			) const
+{
+	ASSERT( _pQuant != nullptr );
+
+	const QuantizedNetworks& quant = *_pQuant;
+	const bool b8 = ( quant.ePrecision == kABCPrecision_Int8 );
+	const int nInputs = _nInputs;
+
+	// quantized inputs of the rows, the padding stays 0
+	int aanIn[ MLP_LANES ][ MLP_MAX_UNITS + QUANT_PAD ];
+	memset( aanIn, 0, sizeof( aanIn ) );
+
+	__m128i amIn[ MLP_MAX_UNITS ], amDot[ MLP_MAX_UNITS ];
+
+	const __m128 mLutLast = _mm_set1_ps( (float)( QUANT_LUT_SIZE - 1 ) );
+	const __m128i mShift = _mm_cvtsi32_si128( quant.nActivationShift );
+
+	for ( int r=0; r<nRows; r+=MLP_LANES )
+	{
+		// the last pass repeats its last row
+		int anRow[ MLP_LANES ];
+
+		for ( int k=0; k<MLP_LANES; k++ )
+		{
+			const int nRow = CLU_MIN( r + k, nRows - 1 );
+			anRow[ k ] = ( anRows != nullptr ) ? anRows[ nRow ] : nRow;
+
+			const double* pd = pdRows + (size_t) anRow[ k ] * nStride;
+
+			for ( int i=0; i<nInputs; i++ )
+			{
+				const double dIn = pd[ i ] * quant.afInputScale[ i ] + 0.5;
+				aanIn[ k ][ i ] = ( dIn <= 0. ) ? 0 : CLU_MIN( (int) dIn, quant.nInputMax );
+			}
+		}
+
+		// a group of inputs of each row in its lane
+		for ( int g=0; g<quant.nGroups; g++ )
+		{
+			int anLane[ MLP_LANES ];
+
+			for ( int k=0; k<MLP_LANES; k++ )
+			{
+				const int* pnIn = aanIn[ k ];
+
+				anLane[ k ] = b8 ? ( pnIn[ g * 4 ] | pnIn[ g * 4 + 1 ] << 8 | pnIn[ g * 4 + 2 ] << 16 | pnIn[ g * 4 + 3 ] << 24 )
+								 : ( pnIn[ g * 2 ] | pnIn[ g * 2 + 1 ] << 16 );
+			}
+
+			amIn[ g ] = _mm_setr_epi32( anLane[ 0 ], anLane[ 1 ], anLane[ 2 ], anLane[ 3 ] );
+		}
+
+		// hidden layer
+		if ( b8 )
+			_hiddenInt8( amIn, &quant.vecUnits[ 0 ], quant.nGroups, _nHidden, amDot );
+		else
+			_hiddenInt16( amIn, &quant.vecUnits[ 0 ], quant.nGroups, _nHidden, amDot );
+
+		// the activations times the output weights, summed exactly in double ( 2 lanes each )
+		__m128d aamSum[ 2 ][ 2 ] = { { _mm_setzero_pd(), _mm_setzero_pd() }, { _mm_setzero_pd(), _mm_setzero_pd() } };
+
+		for ( int j=0; j<_nHidden; j++ )
+		{
+			__m128 mIndex = _mm_add_ps( _mm_mul_ps( _mm_cvtepi32_ps( amDot[ j ] ), _mm_set1_ps( quant.afIndexScale[ j ] ) ), 
+										_mm_set1_ps( quant.afIndexBias[ j ] ) );
+			mIndex = _mm_min_ps( _mm_max_ps( mIndex, _mm_setzero_ps() ), mLutLast );
+
+			int anIndex[ MLP_LANES ];
+			_mm_storeu_si128( reinterpret_cast< __m128i* >( anIndex ), _mm_cvttps_epi32( mIndex ) );
+
+			const __m128i mHidden = _mm_sra_epi32( _mm_setr_epi32( quant.asLut[ anIndex[ 0 ] ], quant.asLut[ anIndex[ 1 ] ], 
+																   quant.asLut[ anIndex[ 2 ] ], quant.asLut[ anIndex[ 3 ] ] ), mShift );
+
+			// the activation is in the low 16 bit of a lane, the weight too: the product in 32 bit
+			const __m128i mProduct = _mm_madd_epi16( mHidden, _mm_set1_epi32( quant.anOutput[ j ] & 0xffff ) );
+
+			__m128d* pmSum = aamSum[ ( j < _nHidden0 ) ? 0 : 1 ];
+			pmSum[ 0 ] = _mm_add_pd( pmSum[ 0 ], _mm_cvtepi32_pd( mProduct ) );
+			pmSum[ 1 ] = _mm_add_pd( pmSum[ 1 ], _mm_cvtepi32_pd( _mm_srli_si128( mProduct, 8 ) ) );
+		}
+
+		// outputs
+		double aadOut[ 2 ][ MLP_LANES ];
+
+		for ( int n=0; n<2; n++ )
+		{
+			double adSum[ MLP_LANES ];
+			_mm_storeu_pd( adSum, aamSum[ n ][ 0 ] );
+			_mm_storeu_pd( adSum + 2, aamSum[ n ][ 1 ] );
+
+			for ( int k=0; k<MLP_LANES; k++ )
+			{
+				const int nIndex = _lutIndex( (float) adSum[ k ] * quant.afOutputIndexScale[ n ] + quant.afOutputIndexBias[ n ] );
+				aadOut[ n ][ k ] = quant.asLut[ nIndex ] * ( 1. / QUANT_LUT_ONE ) * _afOutputScale[ n ] + _afOutputShift[ n ];
+			}
+		}
+
+		for ( int k=0; k<MLP_LANES && r + k < nRows; k++ )
+		{
+			adOut0[ anRow[ k ] ] = aadOut[ 0 ][ k ];
+			adOut1[ anRow[ k ] ] = aadOut[ 1 ][ k ];
+		}
+	}
+}
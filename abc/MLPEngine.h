@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+#include "abc/abc_types.h"
+
+// platform
+#include <vector>
+
+// macro
+#define MLP_MAX_UNITS				64			// inputs, or hidden units of both networks
+
+namespace comed { namespace abc
+{
+	/// <summary>
+	/// native inference of the two networks of the classifier ( objec and metal ), without the OpenCV ML runtime.
+	/// It reads the files of CvANN_MLP::save(...) with one hidden layer, one output and SIGMOID_SYM,
+	/// and evaluates both networks as one fused float pass, the hidden layers side by side, 4 blocks at a time with SSE.
+	/// The outputs are not bit for bit the ones of CvANN_MLP::predict(...), which is double.
+	/// They agree within 1e-5, so only outputs that close to 0 can change their sign.
+	/// </summary>
+	class CMLPEngine
+	{
+		CL_NO_COPY_CONSTRUCTOR( CMLPEngine )
+		CL_NO_ASSIGNMENT_OPERATOR( CMLPEngine )
+
+		// internal data types
+		struct Network;
+		struct QuantizedNetworks;
+
+	public:
+		/// <summary>
+		/// constructor, nothing loaded
+		/// </summary>
+		CMLPEngine(void);
+
+		/// <summary>
+		/// destructor
+		/// </summary>
+		~CMLPEngine(void);
+
+		/// <summary>
+		/// load the networks saved by CvANN_MLP. Both need the same inputs.
+		/// false ( nothing loaded ) if a file can not be read or the network is of another kind.
+		/// </summary>
+		bool Load( LPCTSTR lpszPath_Objec, LPCTSTR lpszPath_Metal );
+
+		/// <summary>
+		/// load the networks compiled in from MLPBuiltIn.h, if built with ABC_BUILTIN_MLP.
+		/// Their sizes are constants of the prediction and nothing is read from files.
+		/// </summary>
+		bool LoadBuiltIn(void);
+
+		/// <summary>
+		/// write the loaded networks as MLPBuiltIn.h
+		/// </summary>
+		bool SaveHeader( LPCTSTR lpszPath ) const;
+
+		/// <summary>
+		/// map a model file of SaveBinary(...) read only. The weights are predicted in place, not parsed or copied,
+		/// and the pages are shared by the processes mapping the same file. false if the file is not valid.
+		/// </summary>
+		bool LoadBinary( LPCTSTR lpszPath );
+
+		/// <summary>
+		/// write the loaded networks as a model file. It replaces the file at once, engines mapping the old one keep it.
+		/// </summary>
+		bool SaveBinary( LPCTSTR lpszPath ) const;
+
+		/// <summary>
+		/// the float networks of other, not quantized. The weights of a mapped file are copied, the built-in ones shared.
+		/// </summary>
+		bool CopyFrom( const CMLPEngine& other );
+
+		/// <summary>
+		/// forget the networks
+		/// </summary>
+		void Reset(void);
+
+		/// <summary>
+		/// predict the loaded networks in fixed point, or float again ( kABCPrecision_Float ).
+		/// afInputRange is the largest value of each input ( calibration ), nullptr for 1 as of the normalized features.
+		/// Inputs are not negative, they are clamped to [ 0, range ]. Loading networks makes it float again.
+		/// </summary>
+		bool Quantize( E_ABCPrecision ePrecision, const float afInputRange[] = nullptr );
+
+		/// <summary>
+		/// arithmetic of Predict(...)
+		/// </summary>
+		E_ABCPrecision GetPrecision(void) const;
+
+		/// <summary>
+		/// true if the networks are loaded
+		/// </summary>
+		bool IsLoaded(void) const					{ return _nInputs > 0; }
+
+		/// <summary>
+		/// inputs of the networks, 0 if not loaded
+		/// </summary>
+		int GetInputCount(void) const				{ return _nInputs; }
+
+		/// <summary>
+		/// predict the rows anRows ( nullptr for rows 0 to nRows - 1 ) of pdRows, nStride doubles each.
+		/// The outputs are indexed by the row, as the inputs.
+		/// </summary>
+		void Predict(
+				IN		const double* pdRows, int nStride, const int anRows[], int nRows,
+				OUT		double adOut0[], double adOut1[]
+			) const;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private methods
+	private:
+		// read a network from the text of the file
+		static bool _parse( const char* pszText, Network* pNet );
+
+		// fused weights of the networks
+		void _fuse( const Network& net0, const Network& net1 );
+
+		// Predict(...) in fixed point
+		void _predictQuantized(
+				IN		const double* pdRows, int nStride, const int anRows[], int nRows,
+				OUT		double adOut0[], double adOut1[]
+			) const;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private data
+	private:
+		int _nInputs;
+		int _nHidden;					// hidden units of both networks
+		int _nHidden0;					// the first ones are of the network 0
+		bool _bBuiltIn;					// the arrays of MLPBuiltIn.h are predicted
+
+		// Everything but the exp is folded into the weights, the input scale, the bias and -alpha of the hidden layer,
+		// and beta of the hidden units into the output weights. A layer is then ( 1 - exp( w.x ) ) / ( 1 + exp( w.x ) ).
+		const float* _pfHidden;			// _nHidden x ( _nInputs + 1 ), the weights of a unit then its bias
+		const float* _pfOutput;			// _nHidden, each unit to the output of its network
+
+		// where the weights are, if not built in
+		std::vector< float > _vecHidden, _vecOutput;
+#if defined( _WIN32 )
+		HANDLE _hFile, _hMapping;
+#else
+		size_t _nViewSize;				// of the mapping, to unmap it
+#endif
+		LPCVOID _pvView;
+
+		QuantizedNetworks* _pQuant;		// nullptr for float
+
+		float _afOutputBias[ 2 ];
+		float _afOutputScale[ 2 ];		// beta and the output scale
+		float _afOutputShift[ 2 ];
+	};
+
+}} // comed::abc
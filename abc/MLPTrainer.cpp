@@ -0,0 +1,327 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "MLPTrainer.h"
+
+// platform
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+// logger
+#include "abc.logger.h"
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW
+#endif
+
+// SIGMOID_SYM of CvANN_MLP, beta * ( 1 - exp( -alpha x ) ) / ( 1 + exp( -alpha x ) )
+#define MLP_ALPHA					( 2.0 / 3.0 )
+#define MLP_BETA					1.7159
+
+// RPROP of CvANN_MLP_TrainParams
+#define RPROP_DW0					0.1
+#define RPROP_DW_PLUS				1.2
+#define RPROP_DW_MINUS				0.5
+#define RPROP_DW_MIN				FLT_EPSILON
+#define RPROP_DW_MAX				50.0
+
+namespace
+{
+	// activation
+	inline double _activate( double dSum )
+	{
+		const double dExp = exp( - MLP_ALPHA * dSum );
+		return MLP_BETA * ( 1.0 - dExp ) / ( 1.0 + dExp );
+	}
+
+	// its derivative by its value
+	inline double _derivative( double dValue )
+	{
+		return MLP_ALPHA / ( 2.0 * MLP_BETA ) * ( MLP_BETA * MLP_BETA - dValue * dValue );
+	}
+
+	// multiply with carry of cv::RNG
+	class CRNG
+	{
+	public:
+		explicit CRNG( UINT nSeed ) : _llState( nSeed ? nSeed : 0xffffffff ) {}
+
+		// uniform in [0, 1)
+		double Uniform(void)
+		{
+			_llState = (ULONGLONG)(UINT) _llState * 4164903690U + (UINT)( _llState >> 32 );
+			return (UINT) _llState * 2.3283064365386962890625e-10;
+		}
+
+	private:
+		ULONGLONG _llState;
+	};
+
+	// a step of RPROP on nCount weights, the step shrinks and the weight stays where the gradient changes its sign
+	void _rprop( double* pdWeights, const double* pdGrad, double* pdStep, signed char* pcSign, size_t nCount )
+	{
+		for ( size_t k=0; k<nCount; k++ )
+		{
+			const signed char cSign = (signed char)( ( pdGrad[ k ] > 0. ) - ( pdGrad[ k ] < 0. ) );
+			const int nSame = cSign * pcSign[ k ];
+
+			if ( nSame > 0 )
+			{
+				pdStep[ k ] = CLU_MIN( pdStep[ k ] * RPROP_DW_PLUS, RPROP_DW_MAX );
+				pdWeights[ k ] -= pdStep[ k ] * cSign;
+				pcSign[ k ] = cSign;
+			}
+			else if ( nSame < 0 )
+			{
+				pdStep[ k ] = CLU_MAX( pdStep[ k ] * RPROP_DW_MINUS, RPROP_DW_MIN );
+				pcSign[ k ] = 0;
+			}
+			else
+			{
+				pdWeights[ k ] -= pdStep[ k ] * cSign;
+				pcSign[ k ] = cSign;
+			}
+		}
+	}
+
+	// a row of weights in the format of cv::FileStorage
+	void _writeList( std::ostream& stream, const double* pdValues, size_t nCount )
+	{
+		stream << "[ ";
+
+		for ( size_t i=0; i<nCount; i++ )
+			stream << ( i ? ", " : "" ) << pdValues[ i ];
+
+		stream << " ]\n";
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// constructor
+CMLPTrainer::CMLPTrainer(void)
+	: _nInputs( 0 ), _nHidden( 0 )
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// random weights
+bool CMLPTrainer::Create( int nInputs, int nHidden, UINT nSeed )
+{
+	if ( nInputs < 1 || nHidden < 1 )
+	{
+		LOG_ERROR( _T("Invalid network of %d inputs, %d hidden units"), nInputs, nHidden );
+		return false;
+	}
+
+	_nInputs = nInputs;
+	_nHidden = nHidden;
+
+	_vecHidden.assign( (size_t)( nInputs + 1 ) * nHidden, 0. );
+	_vecOutput.assign( nHidden + 1, 0. );
+
+	// Nguyen-Widrow as CvANN_MLP::init_weights(), the hidden layer scaled
+	CRNG rng( nSeed );
+
+	const double dG = nHidden > 2 ? 0.7 * pow( (double) nInputs, 1.0 / ( nHidden - 1 ) ) : 1.0;
+
+	for ( int j=0; j<nHidden; j++ )
+	{
+		double dSum = 0., dValue = 0.;
+
+		for ( int k=0; k<=nInputs; k++ )
+		{
+			dValue = rng.Uniform() * 2.0 - 1.0;
+			_vecHidden[ (size_t) k * nHidden + j ] = dValue;
+			dSum += fabs( dValue );
+		}
+
+		const double dScale = 1.0 / ( dSum - fabs( dValue ) );
+
+		for ( int k=0; k<=nInputs; k++ )
+			_vecHidden[ (size_t) k * nHidden + j ] *= dScale;
+
+		_vecHidden[ (size_t) nInputs * nHidden + j ] *= dG * ( -1.0 + j * 2.0 / nHidden );
+	}
+
+	for ( int k=0; k<=nHidden; k++ )
+		_vecOutput[ k ] = rng.Uniform() * 2.0 - 1.0;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// activation of a row
+double CMLPTrainer::_forward( const double* pdRow, double adHidden[] ) const
+{
+	const double* pdBias = &_vecHidden[ (size_t) _nInputs * _nHidden ];
+	double dOutput = _vecOutput[ _nHidden ];
+
+	for ( int j=0; j<_nHidden; j++ )
+		adHidden[ j ] = pdBias[ j ];
+
+	for ( int i=0; i<_nInputs; i++ )
+	{
+		const double* pdW = &_vecHidden[ (size_t) i * _nHidden ];
+		const double dX = pdRow[ i ];
+
+		for ( int j=0; j<_nHidden; j++ )
+			adHidden[ j ] += pdW[ j ] * dX;
+	}
+
+	for ( int j=0; j<_nHidden; j++ )
+	{
+		adHidden[ j ] = _activate( adHidden[ j ] );
+		dOutput += _vecOutput[ j ] * adHidden[ j ];
+	}
+
+	return _activate( dOutput );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// batch RPROP
+int CMLPTrainer::Train(
+				IN		const double* pdRows, int nStride, const double* pdTargets, int nTargetStride, int nRows,
+				IN		int nMaxIter, double dEpsilon )
+{
+	ASSERT( pdRows != nullptr && pdTargets != nullptr );
+
+	if ( ! IsCreated() || nRows < 1 || nStride < _nInputs )
+		return 0;
+
+	std::vector< double > vecHidden( _nHidden ), vecDelta( _nHidden );
+
+	// gradients, steps and the previous signs of the hidden and the output weights
+	std::vector< double > vecGradHidden( _vecHidden.size() ), vecGradOutput( _vecOutput.size() );
+	std::vector< double > vecStepHidden( _vecHidden.size(), RPROP_DW0 ), vecStepOutput( _vecOutput.size(), RPROP_DW0 );
+	std::vector< signed char > vecSignHidden( _vecHidden.size(), 0 ), vecSignOutput( _vecOutput.size(), 0 );
+
+	double dPrevError = DBL_MAX;
+	int nIter = 0;
+
+	while ( nIter < nMaxIter )
+	{
+		vecGradHidden.assign( vecGradHidden.size(), 0. );
+		vecGradOutput.assign( vecGradOutput.size(), 0. );
+
+		double dError = 0.;
+
+		for ( int n=0; n<nRows; n++ )
+		{
+			const double* pdRow = pdRows + (size_t) n * nStride;
+			const double dOutput = _forward( pdRow, &vecHidden[ 0 ] );
+			const double dDiff = dOutput - pdTargets[ (size_t) n * nTargetStride ];
+
+			dError += dDiff * dDiff;
+
+			// output layer
+			const double dDelta = dDiff * _derivative( dOutput );
+
+			for ( int j=0; j<_nHidden; j++ )
+			{
+				vecGradOutput[ j ] += dDelta * vecHidden[ j ];
+				vecDelta[ j ] = dDelta * _vecOutput[ j ] * _derivative( vecHidden[ j ] );
+			}
+
+			vecGradOutput[ _nHidden ] += dDelta;
+
+			// hidden layer
+			for ( int i=0; i<_nInputs; i++ )
+			{
+				double* pdGrad = &vecGradHidden[ (size_t) i * _nHidden ];
+				const double dX = pdRow[ i ];
+
+				for ( int j=0; j<_nHidden; j++ )
+					pdGrad[ j ] += vecDelta[ j ] * dX;
+			}
+
+			double* pdGradBias = &vecGradHidden[ (size_t) _nInputs * _nHidden ];
+
+			for ( int j=0; j<_nHidden; j++ )
+				pdGradBias[ j ] += vecDelta[ j ];
+		}
+
+		nIter ++;
+
+		if ( fabs( dPrevError - dError ) < dEpsilon )
+			break;
+
+		dPrevError = dError;
+
+		_rprop( &_vecHidden[ 0 ], &vecGradHidden[ 0 ], &vecStepHidden[ 0 ], &vecSignHidden[ 0 ], _vecHidden.size() );
+		_rprop( &_vecOutput[ 0 ], &vecGradOutput[ 0 ], &vecStepOutput[ 0 ], &vecSignOutput[ 0 ], _vecOutput.size() );
+	}
+
+	LOG_DEBUG( _T("Trained %d rows, %d iterations, squared error %f"), nRows, nIter, dPrevError );
+
+	return nIter;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// output of a row
+double CMLPTrainer::Predict( const double* pdRow ) const
+{
+	ASSERT( IsCreated() );
+
+	std::vector< double > vecHidden( _nHidden );
+
+	return _forward( pdRow, &vecHidden[ 0 ] );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// the file of CvANN_MLP::save
+bool CMLPTrainer::Save( LPCTSTR lpszPath ) const
+{
+	if ( ! IsCreated() )
+		return false;
+
+	std::ofstream file( lpszPath );
+
+	if ( ! file )
+	{
+		LOG_ERROR( _T("Can't write the network to [%s]"), lpszPath );
+		return false;
+	}
+
+	file << std::scientific << std::setprecision( 16 );
+
+	file << "%YAML:1.0\nmy_nn: !!opencv-ml-ann-mlp\n";
+	file << "   layer_sizes: !!opencv-matrix\n      rows: 1\n      cols: 3\n      dt: i\n";
+	file << "      data: [ " << _nInputs << ", " << _nHidden << ", 1 ]\n";
+	file << "   activation_function: SIGMOID_SYM\n";
+	file << "   f_param1: " << MLP_ALPHA << "\n   f_param2: " << MLP_BETA << "\n";
+	file << "   min_val: " << -0.95 << "\n   max_val: " << 0.95 << "\n";
+	file << "   min_val1: " << -0.98 << "\n   max_val1: " << 0.98 << "\n";
+
+	// no scale of the inputs and the output
+	std::vector< double > vecScale( (size_t) _nInputs * 2, 0. );
+
+	for ( int i=0; i<_nInputs; i++ )
+		vecScale[ i * 2 ] = 1.;
+
+	file << "   input_scale: ";
+	_writeList( file, &vecScale[ 0 ], vecScale.size() );
+	file << "   output_scale: ";
+	_writeList( file, &vecScale[ 0 ], 2 );
+	file << "   inv_output_scale: ";
+	_writeList( file, &vecScale[ 0 ], 2 );
+
+	file << "   weights:\n      - ";
+	_writeList( file, &_vecHidden[ 0 ], _vecHidden.size() );
+	file << "      - ";
+	_writeList( file, &_vecOutput[ 0 ], _vecOutput.size() );
+
+	file.close();
+
+	if ( ! file )
+	{
+		LOG_ERROR( _T("Can't write the network to [%s]"), lpszPath );
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+
+// platform
+#include <vector>
+
+namespace comed { namespace abc
+{
+	/// <summary>
+	/// training of a network of the classifier without the OpenCV ML runtime, as CvANN_MLP::train(...) of the trainer:
+	/// nInputs-nHidden-1 with SIGMOID_SYM, NO_INPUT_SCALE and NO_OUTPUT_SCALE, Nguyen-Widrow weights, then batch RPROP.
+	/// Save(...) writes the file of CvANN_MLP::save(...), read by CMLPEngine::Load(...) and by OpenCV.
+	/// The weights are not those OpenCV trains, its random numbers and sums differ.
+	/// </summary>
+	class CMLPTrainer
+	{
+		CL_NO_COPY_CONSTRUCTOR( CMLPTrainer )
+		CL_NO_ASSIGNMENT_OPERATOR( CMLPTrainer )
+
+	public:
+		/// <summary>
+		/// constructor, no network
+		/// </summary>
+		CMLPTrainer(void);
+
+		/// <summary>
+		/// a network of random weights ( Nguyen-Widrow ), the same for the same sizes and seed
+		/// </summary>
+		bool Create( int nInputs, int nHidden, UINT nSeed = 0xffffffff );
+
+		/// <summary>
+		/// train to the targets ( 1 or -1, nTargetStride doubles apart ) of nRows rows ( nStride doubles each ).
+		/// It stops after nMaxIter iterations, or once the sum of the squared errors changes less than dEpsilon.
+		/// The iterations done, 0 if nothing was trained.
+		/// </summary>
+		int Train(
+				IN		const double* pdRows, int nStride, const double* pdTargets, int nTargetStride, int nRows,
+				IN		int nMaxIter = 1000, double dEpsilon = 1e-6 );
+
+		/// <summary>
+		/// output of a row, in double as CvANN_MLP::predict(...)
+		/// </summary>
+		double Predict( const double* pdRow ) const;
+
+		/// <summary>
+		/// write the network as CvANN_MLP::save(...)
+		/// </summary>
+		bool Save( LPCTSTR lpszPath ) const;
+
+		/// <summary>
+		/// true if the network is created
+		/// </summary>
+		bool IsCreated(void) const					{ return _nInputs > 0; }
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private methods
+	private:
+		// hidden and output activation of a row, the output returned
+		double _forward( const double* pdRow, double adHidden[] ) const;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private data
+	private:
+		int _nInputs, _nHidden;
+		std::vector< double > _vecHidden;		// ( _nInputs + 1 ) x _nHidden, the biases last, as CvANN_MLP
+		std::vector< double > _vecOutput;		// _nHidden + 1, the bias last
+	};
+}} // comed::abc
@@ -0,0 +1,156 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "Otsu.h"
+
+// platform
+#include <vector>
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW 
+#endif 
+
+// macro
+#define OTSU_STACK_BINS				256			// histograms up to it need no heap
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// otsu 
+void COtsu::Calc( 
+				IN		const int anHist[], int nHistSize, E_OtsuMode eMode,
+				OUT		double* pdOtsu, double* pdInner, double* pdInter, double* pdMode )
+{
+	ASSERT( anHist != nullptr );
+	ASSERT( nHistSize > 0 );
+
+	// Prefix sums of count, first and second moments, starting with an empty prefix.
+	// They are integers, so they are exact. ( 2nd moment of a 16M pixels histogram still fits in 64 bit )
+	// It is called for every block of every frame, so the usual sizes are on the stack.
+	INT64 allStack[ 3 ][ OTSU_STACK_BINS + 1 ];
+	std::vector< INT64 > vecHeap;
+
+	INT64* anCum	= allStack[ 0 ];
+	INT64* anCumMul	= allStack[ 1 ];
+	INT64* anCumSqr	= allStack[ 2 ];
+
+	if ( nHistSize > OTSU_STACK_BINS )
+	{
+		vecHeap.resize( 3 * ( nHistSize + 1 ) );
+
+		anCum	 = &vecHeap[ 0 ];
+		anCumMul = anCum + ( nHistSize + 1 );
+		anCumSqr = anCumMul + ( nHistSize + 1 );
+	}
+	{
+		int nMode = 0, nModeValue = anHist[ 0 ];
+
+		anCum[ 0 ] = anCumMul[ 0 ] = anCumSqr[ 0 ] = 0;
+
+		for ( int i=0; i<nHistSize; i++ )
+		{
+			const INT64 n = anHist[ i ];
+
+			anCum	 [ i + 1 ] = anCum	 [ i ] + n;
+			anCumMul [ i + 1 ] = anCumMul[ i ] + n * i;
+			anCumSqr [ i + 1 ] = anCumSqr[ i ] + n * i * i;
+
+			if ( nModeValue < anHist[ i ] )
+			{
+				nModeValue = anHist[ i ];
+				nMode = i;
+			}
+		}
+
+		// normalized mode
+		*pdMode = (double) nMode / nHistSize;
+	}
+
+	// totals
+	const double dN  = (double) anCum	 [ nHistSize ];
+	const double dS1 = (double) anCumMul [ nHistSize ];
+	const double dS2 = (double) anCumSqr [ nHistSize ];
+
+	// find maximum for otsu
+	double dTempMax = 0.0;
+	int nMaxIndex = 0;
+	double dMaxInner = 0.0, dMaxInter = 0.0;
+
+	for ( int i=0; i<nHistSize; i++ )
+	{
+		double dInner, dInter;
+
+		if ( eMode == kOtsuMode_Compatible )
+		{
+			// means over [0, i] and (i, bins)
+			const double dCntB = (double) anCum[ i + 1 ];
+			const double dCntF = dN - dCntB;
+
+			const double dMeanB = (double) anCumMul[ i + 1 ] / dCntB;
+			const double dMeanF = ( dS1 - anCumMul[ i + 1 ] ) / dCntF;
+
+			// sum of squared deviation over [0, i) and [i, bins)
+			// NOTE: CLU_LBOUND keeps NaN of the empty classes, same as the loop version.
+			const double dCntB0 = (double) anCum	[ i ];
+			const double dMulB0 = (double) anCumMul	[ i ];
+			const double dSqrB0 = (double) anCumSqr	[ i ];
+
+			const double dCumVarB = CLU_LBOUND( dSqrB0 - 2. * dMeanB * dMulB0 + dMeanB * dMeanB * dCntB0, 0. );
+			const double dCumVarF = CLU_LBOUND( ( dS2 - dSqrB0 ) - 2. * dMeanF * ( dS1 - dMulB0 ) 
+													+ dMeanF * dMeanF * ( dN - dCntB0 ), 0. );
+
+			const double dVarB = dCumVarB / dCntB;
+			const double dVarF = dCumVarF / dCntF;
+
+			const double dWeightB = dCntB / dN;
+			const double dWeightF = 1.0 - dWeightB;
+
+			dInner = dWeightB * dVarB + dWeightF * dVarF;
+			dInter = dWeightB * dWeightF * ( ( dMeanB - dMeanF ) * ( dMeanB - dMeanF ) );
+		}
+		else 
+		{
+			const double dCntB = (double) anCum[ i + 1 ];
+			const double dCntF = dN - dCntB;
+
+			// one of the classes is empty
+			if ( dCntB == 0. || dCntF == 0. )
+				continue;
+
+			const double dMeanB = (double) anCumMul[ i + 1 ] / dCntB;
+			const double dMeanF = ( dS1 - anCumMul[ i + 1 ] ) / dCntF;
+
+			const double dVarB = CLU_LBOUND( (double) anCumSqr[ i + 1 ] / dCntB - dMeanB * dMeanB, 0. );
+			const double dVarF = CLU_LBOUND( ( dS2 - anCumSqr[ i + 1 ] ) / dCntF - dMeanF * dMeanF, 0. );
+
+			const double dWeightB = dCntB / dN;
+			const double dWeightF = 1.0 - dWeightB;
+
+			dInner = dWeightB * dVarB + dWeightF * dVarF;
+			dInter = dWeightB * dWeightF * ( ( dMeanB - dMeanF ) * ( dMeanB - dMeanF ) );
+		}
+
+		// the loop version reports the first candidate when none is found
+		if ( i == 0 )
+		{
+			dMaxInner = dInner;
+			dMaxInter = dInter;
+		}
+
+		const double rst = dInter / dInner;
+
+		if ( rst > dTempMax )
+		{
+			dTempMax = rst;
+			nMaxIndex = i;
+			dMaxInner = dInner;
+			dMaxInter = dInter;
+		}
+	}
+
+	*pdOtsu = (double) nMaxIndex / nHistSize;
+	*pdInner = dMaxInner;
+	*pdInter = dMaxInter;
+}
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+
+namespace comed { namespace abc 
+{
+	/// <summary>
+	/// otsu evaluation mode
+	/// </summary>
+	enum E_OtsuMode
+	{
+		// Reproduces the classic CFeatureGen otsu: the background mean includes the threshold bin,
+		// but its variance does not, while the foreground variance does. 
+		// The trained data were made with it, so this is the default.
+		// Against the O(bins^2) loop, inner and inter agree within 1e-9 relative ( rounding of the moment sums ),
+		// so the threshold only differs when two candidates are tied within that.
+		kOtsuMode_Compatible = 0,
+
+		// Textbook otsu: background is [0, t], foreground is (t, bins).
+		kOtsuMode_Standard,
+	};
+
+	/// <summary>
+	/// otsu threshold using cumulative moments, O(bins) per histogram
+	/// </summary>
+	class COtsu
+	{
+		CL_NO_INSTANTIATION( COtsu );
+
+	public:
+		/// <summary>
+		/// calculate otsu threshold ( normalized ), inner / inter class variance at the threshold and mode ( normalized )
+		/// </summary>
+		static void Calc( 
+				IN		const int anHist[], int nHistSize, E_OtsuMode eMode,
+				OUT		double* pdOtsu, double* pdInner, double* pdInter, double* pdMode );
+	};
+}} // comed::abc
@@ -0,0 +1,223 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "abc/RegionTypeBatch.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/FrameSnapshot.h"
+#include "abc/FeatureBlock.h"
+#include "FeatureGen.h"
+#include "ThreadPool.h"
+
+// platform
+#include <functional>
+#include <thread>
+#include <vector>
+
+// logger
+#include "abc.logger.h"
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW
+#endif
+
+// local types
+typedef CFeatureGenT< ABC_REGION_DIVIDE > BatchFeatureGen;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// state of the batch
+struct CRegionTypeBatch::BatchState
+{
+	// a frame of the batch
+	struct Frame
+	{
+		CFeatureBlock features;
+		bool bMasked, abExposed[ ABC_REGION_DIVIDE_2 ];		// blocks in the collimator field
+
+		int nFirstRow, nRows;								// its predicted blocks in the matrix
+		int anBlocks[ ABC_REGION_DIVIDE_2 ];
+
+		double adObjec[ ABC_REGION_DIVIDE_2 ];
+		double adMetal[ ABC_REGION_DIVIDE_2 ];
+
+		Frame(void) : bMasked( false ), nFirstRow( 0 ), nRows( 0 )
+		{
+		}
+	};
+
+	CThreadPool pool;
+
+	std::vector< CFeatureScratch* > vecScratch;			// one per worker
+	std::vector< CFeatureBlock > vecCells;				// of the coarse grid, one per worker
+	std::vector< Frame > vecFrames;						// grows to the largest batch
+
+	CFeatureBlock matrix;								// the predicted blocks of all frames, grows to the largest batch
+	std::vector< double > vecObjec, vecMetal;			// by the row of the matrix
+
+	explicit BatchState( int nWorkers )
+		: pool( nWorkers )
+		, vecScratch( nWorkers, nullptr )
+		, vecCells( nWorkers )
+	{
+		for ( int w=0; w<nWorkers; w++ )
+			vecScratch[ w ] = new CFeatureScratch;
+	}
+
+	~BatchState(void)
+	{
+		for ( size_t w=0; w<vecScratch.size(); w++ )
+			delete vecScratch[ w ];
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// constructor
+CRegionTypeBatch::CRegionTypeBatch( const CRegionTypeClassifier& classifier, int nWorkers )
+	: _classifier( classifier )
+	, _pState( nullptr )
+{
+	ASSERT( nWorkers >= 0 );
+
+	if ( nWorkers <= 0 )
+		nWorkers = CLU_MAX( (int) std::thread::hardware_concurrency(), 1 );
+
+	_pState = new BatchState( nWorkers );
+	ASSERT( _pState );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// destructor
+CRegionTypeBatch::~CRegionTypeBatch(void)
+{
+	delete _pState;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// threads of the batch
+int CRegionTypeBatch::GetWorkerCount(void) const
+{
+	return _pState->pool.GetWorkerCount();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// do classfy the frames
+bool CRegionTypeBatch::ClassfyRegions(
+				IN		const CFrameSnapshot aFrames[], int nFrames,
+				OUT		RegionTypeBatchResult aResults[]
+			)
+{
+	ASSERT( nFrames >= 0 );
+	ASSERT( nFrames == 0 || ( aFrames != nullptr && aResults != nullptr ) );
+
+	for ( int i=0; i<nFrames; i++ )
+	{
+		if ( ! aFrames[ i ].IsValid() )
+		{
+			LOG_ERROR( _T("Invalid frame of the batch - %d"), i );
+			return false;
+		}
+	}
+
+	BatchState& state = *_pState;
+
+	if ( (int) state.vecFrames.size() < nFrames )
+		state.vecFrames.resize( nFrames );
+
+	// the networks of the whole batch, even if they are replaced meanwhile
+	CRegionTypeClassifier::ModelGuard guard( _classifier );
+
+	// Coarse to fine decides the blocks of a frame from its cells, so each frame is predicted by itself.
+	const int nCoarse = _classifier._nCoarseDivide;
+	const bool bCoarseToFine = ( nCoarse > 0 && nCoarse < ABC_REGION_DIVIDE && ABC_REGION_DIVIDE % nCoarse == 0 );
+
+	// The frames are computed side by side, each on one worker. The blocks of a frame are not split.
+	auto fnFeatures = [&]( int nFrame, int nWorker )
+	{
+		const CFrameSnapshot& frame = aFrames[ nFrame ];
+		BatchState::Frame& work = state.vecFrames[ nFrame ];
+
+		FeatureGenOptions options = _classifier._getFeatureGenOptions();
+		options.pbExposed = _classifier._getExposure< ABC_REGION_DIVIDE >( 
+								frame.GetPixelDataWord(), frame.GetWidth(), frame.GetHeight(), frame.GetStrider(), work.abExposed );
+		options.pScratch = state.vecScratch[ nWorker ];
+		options.pPool = nullptr;
+
+		work.bMasked = ( options.pbExposed != nullptr );
+
+		VERIFY( BatchFeatureGen::CalcFeatures( frame, &work.features, options ) );
+
+		if ( bCoarseToFine )
+		{
+			_classifier._predictBlocks< ABC_REGION_DIVIDE >( guard.Get(), work.features, options.pbExposed, 
+															 &state.vecCells[ nWorker ], work.adObjec, work.adMetal );
+		}
+	};
+
+	state.pool.ParallelFor( nFrames, std::ref( fnFeatures ) );
+
+	if ( ! bCoarseToFine )
+	{
+		// exposed non-boundary blocks of every frame, one row each
+		int nRows = 0;
+
+		for ( int i=0; i<nFrames; i++ )
+		{
+			BatchState::Frame& work = state.vecFrames[ i ];
+
+			work.nRows = CRegionTypeClassifier::_getPredictedBlocks< ABC_REGION_DIVIDE >( 
+								work.bMasked ? work.abExposed : nullptr, work.anBlocks );
+			work.nFirstRow = nRows;
+
+			nRows += work.nRows;
+		}
+
+		// the rows past nRows are kept, not predicted
+		if ( state.matrix.GetBlockCount() < nRows )
+			state.matrix.Create( nRows, kABCFeatureLayout_RowMajor );
+
+		if ( (int) state.vecObjec.size() < nRows )
+		{
+			state.vecObjec.resize( nRows );
+			state.vecMetal.resize( nRows );
+		}
+
+		for ( int i=0; i<nFrames; i++ )
+		{
+			const BatchState::Frame& work = state.vecFrames[ i ];
+
+			for ( int r=0; r<work.nRows; r++ )
+			for ( int f=0; f<ABC_FEATURE_COUNT; f++ )
+				state.matrix.Set( work.nFirstRow + r, f, work.features.Get( work.anBlocks[ r ], f ) );
+		}
+
+		// all the blocks of all the frames in one call
+		if ( nRows > 0 )
+			_classifier._predict( guard.Get(), state.matrix, nullptr, nRows, true, &state.vecObjec[ 0 ], &state.vecMetal[ 0 ] );
+
+		for ( int i=0; i<nFrames; i++ )
+		{
+			BatchState::Frame& work = state.vecFrames[ i ];
+
+			for ( int r=0; r<work.nRows; r++ )
+			{
+				work.adObjec[ work.anBlocks[ r ] ] = state.vecObjec[ work.nFirstRow + r ];
+				work.adMetal[ work.anBlocks[ r ] ] = state.vecMetal[ work.nFirstRow + r ];
+			}
+		}
+	}
+
+	// make output
+	for ( int i=0; i<nFrames; i++ )
+	{
+		const BatchState::Frame& work = state.vecFrames[ i ];
+		RegionTypeBatchResult& result = aResults[ i ];
+
+		CRegionTypeClassifier::_makeOutput< ABC_REGION_DIVIDE >( work.features, work.bMasked ? work.abExposed : nullptr, 
+									work.adObjec, work.adMetal, result.arrResult,
+									&result.nNumObjBlocks, &result.nMeanObjBlocks, &result.nMinObj, &result.nMaxObj );
+	}
+
+	return true;
+}
@@ -1,64 +1,260 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 // Added by Hai Son
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#include "stdafx.h"
+#include "abc_core.h"
 #include "abc/RegionTypeClassifier.h"
-#include "FeatureGenerator.h"
+#include "abc/FrameSnapshot.h"
+#include "abc/FeatureBlock.h"
+#include "abc/RegionTypeWorkspace.h"
 #include "FeatureGen.h"
+#include "ThreadPool.h"
+#include "Collimation.h"
+#include "MLPEngine.h"
+#include "Cascade.h"
+#include "StageStatistics.h"
+
+// networks of other kinds are predicted by OpenCV, not in the core library
+#if ! defined( ABC_STANDALONE )
+#include "FeatureGenerator.h"
 #include "opencv2/opencv.hpp"
 
 // cl
 #include "clImgProc/ImageBuf.h"
 #include "clUtils/path_utils.h"
+#endif
+
+// platform
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <float.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 // logger
 #include "abc.logger.h"
 
 using namespace comed::abc;
 
-#ifdef _DEBUG
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
 #define new DEBUG_NEW 
 #endif 
 
-// TODO: replace the followings
-static inline double CLU_BOUND( double val, double minValue, double maxValue )
+// macro
+#define COLLIMATION_RATIO			0.1			// exposed blocks are brighter than 10% of the brightest one
+#define CASCADE_STACK_BLOCKS		( 32 * 32 )	// blocks left by the cascade without heap, the blocks of a frame
+
+// milliseconds between two timestamps of CStageStatistics::Now()
+static inline float _calcTime( LONGLONG ll2, LONGLONG ll1 )
+{
+	return (float)( ( (double)( ll2 - ll1 ) / (double) CStageStatistics::Frequency() ) * 1000. );
+}
+
+// not a NaN or an infinity
+static inline bool _isFinite( double dValue )
+{
+#if defined( _MSC_VER )
+	return _finite( dValue ) != 0;
+#else
+	return std::isfinite( dValue );
+#endif
+}
+
+#if ! defined( ABC_STANDALONE )
+// a loaded network of ABC_FEATURE_COUNT inputs and one output
+static bool _isFeatureNetwork( CvANN_MLP& mlp )
+{
+	const CvMat* pLayers = mlp.get_layer_sizes();
+
+	if ( pLayers == nullptr || pLayers->rows * pLayers->cols < 2 )
+		return false;
+
+	return pLayers->data.i[ 0 ] == ABC_FEATURE_COUNT && pLayers->data.i[ pLayers->rows * pLayers->cols - 1 ] == 1;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// the networks of a frame, never changed while published
+struct CRegionTypeClassifier::Model
+{
+#if ! defined( ABC_STANDALONE )
+	CvANN_MLP mlpObjec, mlpMetal;
+	mutable std::mutex mutexMLP;		// CvANN_MLP::predict(...) has buffers of its own
+#endif
+	CMLPEngine engine;					// both networks, used instead of CvANN_MLP if loaded
+	UINT nVersion;
+
+	Model(void) : nVersion( 0 )
+	{
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The published networks, RCU style. A frame counts itself in the readers of the current epoch, lock free.
+// New networks are swapped in and the epoch turned, the previous ones are freed when the readers of the old epoch are gone.
+struct CRegionTypeClassifier::ModelHandle
+{
+	std::atomic< Model* > pModel;
+	std::atomic< UINT > nEpoch;
+	std::atomic< LONG > anReaders[ 2 ];	// frames holding a model, by the parity of the epoch
+
+	std::mutex mutexPublish;			// one replacement at a time, never taken by a frame
+	UINT nVersion;
+
+	std::thread threadLoad;				// InitializeAsync(...)
+	std::atomic< bool > bLoading;
+
+	std::atomic< UINT > nCascade;		// SetCascade(...) calls, the predictions of the old cascade are not reused
+
+	ModelHandle(void) : pModel( nullptr ), nEpoch( 0 ), nVersion( 0 ), bLoading( false ), nCascade( 0 )
+	{
+		anReaders[ 0 ].store( 0 );
+		anReaders[ 1 ].store( 0 );
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// the buffers of the overloads without a workspace, one thread at a time
+struct CRegionTypeClassifier::SharedWorkspace
+{
+	CRegionTypeWorkspace workspace;
+	std::mutex mutex;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// hold the current networks
+CRegionTypeClassifier::ModelGuard::ModelGuard( const CRegionTypeClassifier& classifier )
+	: _pHandle( classifier._pModels )
 {
-	if ( val < minValue )
-		return minValue;
-	else if ( val > maxValue )
-		return maxValue;
+	ASSERT( _pHandle );
+
+	// counted in an epoch not turned meanwhile, so a replacement waits for it
+	for ( ;; )
+	{
+		const UINT nEpoch = _pHandle->nEpoch.load();
 
-	return val;
+		_nSide = (int)( nEpoch & 1 );
+		_pHandle->anReaders[ _nSide ].fetch_add( 1 );
+
+		if ( _pHandle->nEpoch.load() == nEpoch )
+			break;
+
+		_pHandle->anReaders[ _nSide ].fetch_sub( 1 );
+	}
+
+	_pModel = _pHandle->pModel.load();
+	ASSERT( _pModel );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// release the networks
+CRegionTypeClassifier::ModelGuard::~ModelGuard(void)
+{
+	_pHandle->anReaders[ _nSide ].fetch_sub( 1 );
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// version of the networks held
+UINT CRegionTypeClassifier::ModelGuard::GetVersion(void) const
+{
+	return _pModel->nVersion;
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // constructor
 CRegionTypeClassifier::CRegionTypeClassifier(void)
+	: _nDecimation( 0 )
+	, _eSampling( kABCSampling_Nearest )
+	, _pPool( nullptr )
+	, _pWorkspace( nullptr )
+	, _eCollimation( kABCCollimation_None )
+	, _nCoarseDivide( 0 )
+	, _dCoarseMargin( 0.5 )
+	, _bInstrument( true )
+	, _ePrecision( kABCPrecision_Float )
+	, _bInputRange( false )
+	, _bCascade( false )
 {
-	_pMLP_Objec = new CvANN_MLP;
-	ASSERT( _pMLP_Objec );
+	memset( &_cascade, 0, sizeof(CascadeThresholds) );
+
+	memset( &_rcField, 0, sizeof(RECT) );
+
+	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
+		_abExposed[ bi ] = true;
+
+	for ( int f=0; f<ABC_FEATURE_COUNT; f++ )
+		_afInputRange[ f ] = 1.f;
+
+	_pStages = new CStageStatistics;
+	ASSERT( _pStages );
 
-	_pMLP_Metal = new CvANN_MLP;
-	ASSERT( _pMLP_Metal );
+	_pModels = new ModelHandle;
+	ASSERT( _pModels );
+
+	_pWorkspace = new SharedWorkspace;
+	ASSERT( _pWorkspace );
+
+	Model* pModel = new Model;
+	ASSERT( pModel );
+
+	// networks compiled in, if any. Initialize(...) can still load others.
+	if ( pModel->engine.LoadBuiltIn() )
+		LOG_DEBUG( _T("Classifier uses the built-in networks") );
+
+	_pModels->pModel.store( pModel );
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // destructor
 CRegionTypeClassifier::~CRegionTypeClassifier(void)
 {
-	delete _pMLP_Objec;
-	delete _pMLP_Metal;
+	if ( _pModels->threadLoad.joinable() )
+		_pModels->threadLoad.join();
+
+	delete _pModels->pModel.load();
+	delete _pModels;
+	delete _pStages;
+
+	delete _pWorkspace;
+	delete _pPool;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // load trained data for ABC algorithm
 bool CRegionTypeClassifier::Initialize( LPCTSTR lpszPath_Objec, LPCTSTR lpszPath_Metal )
 {
+#if defined( ABC_STANDALONE )
+	// only the native engine
+	const LONGLONG llLap1 = CStageStatistics::Now();
+
+	std::unique_ptr< Model > pModel( new Model );
+
+	if ( ! pModel->engine.Load( lpszPath_Objec, lpszPath_Metal ) )
+		return false;
+
+	if ( pModel->engine.GetInputCount() != ABC_FEATURE_COUNT )
+	{
+		LOG_ERROR( _T("Networks of %d inputs, %d features"), pModel->engine.GetInputCount(), ABC_FEATURE_COUNT );
+		return false;
+	}
+
+	if ( ! _publishModel( pModel.release() ) )
+		return false;
+
+	LOG_DEBUG( _T("Classifier loaded the data in %.3f ms"), _calcTime( CStageStatistics::Now(), llLap1 ) );
+
+	return true;
+#else
 	if ( CLU_IsPathExist( lpszPath_Objec ) && CLU_IsPathExist( lpszPath_Metal ) )
 	{
 		LOG_DEBUG( _T("Classifier tries to load data from [%s] and [%s]"), lpszPath_Objec, lpszPath_Metal );
 
+		// to profile time
+		const LONGLONG llLap1 = CStageStatistics::Now();
+
 		const int anLayerInfo[] = { ABC_FEATURE_COUNT, ABC_FEATURE_COUNT * 2, 1 };
 		const int nLayerInfoCount = sizeof( anLayerInfo ) / sizeof(int) ;
 
@@ -69,13 +265,47 @@ bool CRegionTypeClassifier::Initialize( LPCTSTR lpszPath_Objec, LPCTSTR lpszPath
 			layers.row( i ) = cv::Scalar( anLayerInfo[i] );
 		}
 
-		// create layers
-		_pMLP_Objec->create( layers );
-		_pMLP_Metal->create( layers );
+		// new networks, the current ones are still classifying
+		std::unique_ptr< Model > pModel( new Model );
+
+		// create layers and load the data. A broken file throws, which must not leave InitializeAsync(...).
+		try
+		{
+			pModel->mlpObjec.create( layers );
+			pModel->mlpMetal.create( layers );
+
+			pModel->mlpObjec.load( CT2A( lpszPath_Objec ) );
+			pModel->mlpMetal.load( CT2A( lpszPath_Metal ) );
+		}
+		catch ( const cv::Exception& e )
+		{
+			LOG_ERROR( _T("Classifier failed to load [%s] and [%s] - %s"), lpszPath_Objec, lpszPath_Metal, (LPCTSTR) CA2T( e.what() ) );
+			return false;
+		}
+
+		// the probe and the frames predict rows of the features
+		if ( ! _isFeatureNetwork( pModel->mlpObjec ) || ! _isFeatureNetwork( pModel->mlpMetal ) )
+		{
+			LOG_ERROR( _T("Networks are not of %d inputs and 1 output - [%s] and [%s]"), ABC_FEATURE_COUNT, lpszPath_Objec, lpszPath_Metal );
+			return false;
+		}
 
-		// load the data
-		_pMLP_Objec->load( CT2A( lpszPath_Objec ) );
-		_pMLP_Metal->load( CT2A( lpszPath_Metal ) );
+		// the same networks without OpenCV, for the prediction
+		CMLPEngine& engine = pModel->engine;
+
+		if ( engine.Load( lpszPath_Objec, lpszPath_Metal ) && engine.GetInputCount() != ABC_FEATURE_COUNT )
+		{
+			LOG_ERROR( _T("Networks of %d inputs, %d features"), engine.GetInputCount(), ABC_FEATURE_COUNT );
+			engine.Reset();
+		}
+
+		if ( ! engine.IsLoaded() )
+			LOG_DEBUG( _T("Classifier predicts with OpenCV") );
+
+		if ( ! _publishModel( pModel.release() ) )
+			return false;
+
+		LOG_DEBUG( _T("Classifier loaded the data in %.3f ms"), _calcTime( CStageStatistics::Now(), llLap1 ) );
 
 		return true;
 	}
@@ -83,28 +313,456 @@ bool CRegionTypeClassifier::Initialize( LPCTSTR lpszPath_Objec, LPCTSTR lpszPath
 	LOG_ERROR( _T("No trained data exists - [%s] and [%s]"), lpszPath_Objec, lpszPath_Metal );
 
 	return false;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// map a model file
+bool CRegionTypeClassifier::Initialize( LPCTSTR lpszModelPath )
+{
+	// to profile time
+	const LONGLONG llLap1 = CStageStatistics::Now();
+
+	std::unique_ptr< Model > pModel( new Model );
+
+	if ( ! pModel->engine.LoadBinary( lpszModelPath ) )
+		return false;
+
+	if ( pModel->engine.GetInputCount() != ABC_FEATURE_COUNT )
+	{
+		LOG_ERROR( _T("Model of %d inputs, %d features - [%s]"), pModel->engine.GetInputCount(), ABC_FEATURE_COUNT, lpszModelPath );
+		return false;
+	}
+
+	if ( ! _publishModel( pModel.release() ) )
+		return false;
+
+	LOG_DEBUG( _T("Classifier mapped the model [%s] in %.3f ms"), lpszModelPath, _calcTime( CStageStatistics::Now(), llLap1 ) );
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// load trained data on a background thread
+bool CRegionTypeClassifier::InitializeAsync( LPCTSTR lpszPath_Objec, LPCTSTR lpszPath_Metal )
+{
+	ModelHandle& handle = *_pModels;
+
+	bool bIdle = false;
+
+	if ( ! handle.bLoading.compare_exchange_strong( bIdle, true ) )
+	{
+		LOG_ERROR( _T("Classifier is still loading networks - [%s] and [%s]"), lpszPath_Objec, lpszPath_Metal );
+		return false;
+	}
+
+	// the previous load is over
+	if ( handle.threadLoad.joinable() )
+		handle.threadLoad.join();
+
+	const std::basic_string< TCHAR > strObjec( lpszPath_Objec ), strMetal( lpszPath_Metal );
+
+	handle.threadLoad = std::thread( [ this, strObjec, strMetal ]()
+	{
+		if ( ! Initialize( strObjec.c_str(), strMetal.c_str() ) )
+			LOG_ERROR( _T("Classifier keeps the current networks") );
+
+		_pModels->bLoading.store( false );
+	} );
+
+	return true;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// method used in ClassifyRegion(...)
-static inline float _calcTime( const LARGE_INTEGER& llFreq, const LARGE_INTEGER& ll2, const LARGE_INTEGER& ll1 )
+// loading on a background thread
+bool CRegionTypeClassifier::IsInitializing(void) const
 {
-	return (float)( ( (double)( ll2.QuadPart - ll1.QuadPart ) / (double) llFreq.QuadPart ) * 1000. );
+	return _pModels->bLoading.load();
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// version of the networks
+UINT CRegionTypeClassifier::GetModelVersion(void) const
+{
+	ModelGuard guard( *this );
+
+	return guard.GetVersion();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// replace the networks
+bool CRegionTypeClassifier::_publishModel( Model* pModel )
+{
+	ASSERT( pModel );
+
+	std::unique_ptr< Model > pNew( pModel );
+
+	// the precision is read under the lock of SetPrecision(...), which changes it and the networks together
+	std::lock_guard< std::mutex > lock( _pModels->mutexPublish );
+
+	// the precision set for the previous networks
+	CMLPEngine& engine = pNew->engine;
+
+	if ( engine.IsLoaded() && _ePrecision != kABCPrecision_Float )
+		engine.Quantize( _ePrecision, _bInputRange ? _afInputRange : nullptr );
+
+	return _replaceModel( pNew.release() );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// check the networks and swap them in, mutexPublish held
+bool CRegionTypeClassifier::_replaceModel( Model* pModel )
+{
+	ASSERT( pModel );
+
+	std::unique_ptr< Model > pNew( pModel );
+	const CMLPEngine& engine = pNew->engine;
+
+	// a row of zeros has to give finite outputs
+	double adProbe[ ABC_FEATURE_COUNT ] = { 0. };
+	double dObjec = 0., dMetal = 0.;
+
+	if ( engine.IsLoaded() )
+	{
+		engine.Predict( adProbe, ABC_FEATURE_COUNT, nullptr, 1, &dObjec, &dMetal );
+	}
+	else
+	{
+#if defined( ABC_STANDALONE )
+		LOG_ERROR( _T("Classifier has no networks to predict") );
+		return false;
+#else
+		const cv::Mat probe( 1, ABC_FEATURE_COUNT, cv::DataType<double>::type, adProbe );
+		cv::Mat resultObjec = cv::Mat::zeros( 1, 1, cv::DataType<double>::type );
+		cv::Mat resultMetal = cv::Mat::zeros( 1, 1, cv::DataType<double>::type );
+
+		try
+		{
+			pNew->mlpObjec.predict( probe, resultObjec );
+			pNew->mlpMetal.predict( probe, resultMetal );
+		}
+		catch ( const cv::Exception& e )
+		{
+			LOG_ERROR( _T("Classifier rejected networks failing to predict - %s"), (LPCTSTR) CA2T( e.what() ) );
+			return false;
+		}
+
+		dObjec = resultObjec.at<double>( 0 );
+		dMetal = resultMetal.at<double>( 0 );
+#endif
+	}
+
+	if ( ! _isFinite( dObjec ) || ! _isFinite( dMetal ) )
+	{
+		LOG_ERROR( _T("Classifier rejected networks of invalid outputs") );
+		return false;
+	}
+
+	ModelHandle& handle = *_pModels;
+
+	pNew->nVersion = ++ handle.nVersion;
+	Model* pOld = handle.pModel.exchange( pNew.release() );
+
+	// The frames from now on count in the other epoch, and hold the new networks.
+	// Those of the old epoch may hold the old ones, they are waited for.
+	const UINT nEpoch = handle.nEpoch.fetch_add( 1 );
+
+	while ( handle.anReaders[ nEpoch & 1 ].load() != 0 )
+		std::this_thread::yield();
+
+	LOG_DEBUG( _T("Classifier replaced the networks, version %u"), handle.nVersion );
+
+	delete pOld;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// sampling of the frames
+bool CRegionTypeClassifier::SetSampling( int nDecimation, E_ABCSampling eSampling )
+{
+	if ( ( nDecimation != 0 && nDecimation != 1 && nDecimation != 2 && nDecimation != 4 ) || 
+		 eSampling < 0 || eSampling >= _END_ABC_Samplings )
+	{
+		LOG_ERROR( _T("Invalid sampling - decimation %d, sampling %d"), nDecimation, eSampling );
+		return false;
+	}
+
+	_nDecimation = nDecimation;
+	_eSampling = eSampling;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// workers of the feature generation
+bool CRegionTypeClassifier::SetWorkerCount( int nWorkers )
+{
+	if ( nWorkers < 1 )
+	{
+		LOG_ERROR( _T("Invalid worker count - %d"), nWorkers );
+		return false;
+	}
+
+	const int nCurrent = ( _pPool != nullptr ) ? _pPool->GetWorkerCount() : 1;
+
+	if ( nWorkers == nCurrent )
+		return true;
+
+	delete _pPool;
+	_pPool = ( nWorkers > 1 ) ? new CThreadPool( nWorkers ) : nullptr;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// collimator field
+bool CRegionTypeClassifier::SetCollimation( E_ABCCollimation eCollimation, const RECT* prcField )
+{
+	if ( eCollimation < 0 || eCollimation >= _END_ABC_Collimations || 
+		 ( eCollimation == kABCCollimation_Rect && prcField == nullptr ) )
+	{
+		LOG_ERROR( _T("Invalid collimation - %d"), eCollimation );
+		return false;
+	}
+
+	_eCollimation = eCollimation;
+
+	if ( prcField != nullptr )
+		_rcField = *prcField;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// exposed blocks
+void CRegionTypeClassifier::SetExposureMask( const bool abExposed[ ABC_REGION_DIVIDE_2 ] )
+{
+	ASSERT( abExposed != nullptr );
+
+	memcpy( _abExposed, abExposed, sizeof(bool) * ABC_REGION_DIVIDE_2 );
+	_eCollimation = kABCCollimation_Mask;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// coarse to fine prediction
+bool CRegionTypeClassifier::SetCoarseToFine( int nCoarseDivide, double dMargin )
+{
+	if ( ( nCoarseDivide != 0 && nCoarseDivide != 4 && nCoarseDivide != 8 ) || dMargin < 0. )
+	{
+		LOG_ERROR( _T("Invalid coarse grid - %d, margin %f"), nCoarseDivide, dMargin );
+		return false;
+	}
+
+	_nCoarseDivide = nCoarseDivide;
+	_dCoarseMargin = dMargin;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// arithmetic of the prediction
+bool CRegionTypeClassifier::SetPrecision( E_ABCPrecision ePrecision, const float afInputRange[ ABC_FEATURE_COUNT ] )
+{
+	ModelHandle& handle = *_pModels;
+
+	// the networks are only replaced under the lock, a load waits for the new precision
+	std::lock_guard< std::mutex > lock( handle.mutexPublish );
+
+	const CMLPEngine& current = handle.pModel.load()->engine;
+
+	if ( ! current.IsLoaded() )
+	{
+		LOG_ERROR( _T("Precision %d needs the native engine"), ePrecision );
+		return false;
+	}
+
+	// a copy is quantized and published, the frames running keep the current networks
+	std::unique_ptr< Model > pModel( new Model );
+	VERIFY( pModel->engine.CopyFrom( current ) );
+
+	if ( ! pModel->engine.Quantize( ePrecision, afInputRange ) )
+		return false;
+
+	if ( ! _replaceModel( pModel.release() ) )
+		return false;
+
+	// for the networks loaded later
+	_ePrecision = ePrecision;
+	_bInputRange = ( afInputRange != nullptr );
+
+	for ( int f=0; f<ABC_FEATURE_COUNT; f++ )
+		_afInputRange[ f ] = ( afInputRange != nullptr ) ? afInputRange[ f ] : 1.f;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// rule cascade
+void CRegionTypeClassifier::SetCascade( const CascadeThresholds* pThresholds )
+{
+	_bCascade = ( pThresholds != nullptr );
+
+	if ( pThresholds != nullptr )
+		_cascade = *pThresholds;
+
+	_pModels->nCascade.fetch_add( 1 );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// changes of the cascade
+UINT CRegionTypeClassifier::_getCascadeVersion(void) const
+{
+	return _pModels->nCascade.load();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// latency of the stages
+void CRegionTypeClassifier::SetInstrumentation( bool bEnable, int nDumpSeconds )
+{
+	_bInstrument = bEnable;
+	_pStages->SetDumpPeriod( bEnable ? nDumpSeconds : 0 );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// latency of a stage
+void CRegionTypeClassifier::GetStageLatency( E_ABCStage eStage, OUT StageLatency* pLatency ) const
+{
+	ASSERT( eStage >= 0 && eStage < _END_ABC_Stages );
+	ASSERT( pLatency );
+
+	_pStages->Get( eStage, pLatency );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// forget the latency
+void CRegionTypeClassifier::ResetStageLatency(void)
+{
+	_pStages->Reset();
+}
+
+#if ! defined( ABC_STANDALONE )
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // do classfy 
 bool CRegionTypeClassifier::ClassfyRegion( 
 				IN		const cl::img::CImageBuf& img, 
-				OUT		RegionType arrResult[ ABC_REGION_DIVIDE ],
+				OUT		RegionType arrResult[ ABC_REGION_DIVIDE_2 ],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			) const
+{
+	if ( ! img.IsValid() )
+		return false;
+
+	return _classfyShared< ABC_REGION_DIVIDE >( &img, nullptr, arrResult, pnNumObjBlocks, pnMeanObjBlocks, pnMinObj, pnMaxObj );
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// do classfy, the frame is read in place
+bool CRegionTypeClassifier::ClassfyRegion( 
+				IN		const CFrameSnapshot& frame, 
+				OUT		RegionType arrResult[ ABC_REGION_DIVIDE_2 ],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			) const
+{
+	if ( ! frame.IsValid() )
+		return false;
+
+	return _classfyShared< ABC_REGION_DIVIDE >( nullptr, &frame, arrResult, pnNumObjBlocks, pnMeanObjBlocks, pnMinObj, pnMaxObj );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// do classfy on a nDivide x nDivide grid
+bool CRegionTypeClassifier::ClassfyRegion( 
+				IN		const CFrameSnapshot& frame, int nDivide,
+				OUT		RegionType arrResult[],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			) const
+{
+	if ( ! frame.IsValid() )
+		return false;
+
+	switch ( nDivide )
+	{
+	case 8:
+		return _classfyShared< 8 >( nullptr, &frame, arrResult, pnNumObjBlocks, pnMeanObjBlocks, pnMinObj, pnMaxObj );
+	case 16:
+		return _classfyShared< 16 >( nullptr, &frame, arrResult, pnNumObjBlocks, pnMeanObjBlocks, pnMinObj, pnMaxObj );
+	case 32:
+		return _classfyShared< 32 >( nullptr, &frame, arrResult, pnNumObjBlocks, pnMeanObjBlocks, pnMinObj, pnMaxObj );
+	}
+
+	LOG_ERROR( _T("Unsupported region grid - %d"), nDivide );
+
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// do classfy with the buffers of a workspace
+bool CRegionTypeClassifier::ClassfyRegion( 
+				IN		const CFrameSnapshot& frame, 
+				IN OUT	CRegionTypeWorkspace* pWorkspace,
+				OUT		RegionType arrResult[ ABC_REGION_DIVIDE_2 ],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			) const
+{
+	ASSERT( pWorkspace != nullptr );
+
+	if ( ! frame.IsValid() )
+		return false;
+
+	return _classfyRegion< ABC_REGION_DIVIDE >( nullptr, &frame, pWorkspace,
+												arrResult, pnNumObjBlocks, pnMeanObjBlocks, pnMinObj, pnMaxObj );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// classfy with the workspace of the classifier. A thread finding it busy does not wait, it makes its own for the frame.
+template< int DIVIDE >
+bool CRegionTypeClassifier::_classfyShared( 
+				IN		const cl::img::CImageBuf* pImg, const CFrameSnapshot* pFrame,
+				OUT		RegionType arrResult[],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			) const
+{
+	std::unique_lock< std::mutex > lock( _pWorkspace->mutex, std::try_to_lock );
+
+	if ( lock.owns_lock() )
+		return _classfyRegion< DIVIDE >( pImg, pFrame, &_pWorkspace->workspace, arrResult, pnNumObjBlocks, pnMeanObjBlocks, pnMinObj, pnMaxObj );
+
+	CRegionTypeWorkspace workspace;
+
+	return _classfyRegion< DIVIDE >( pImg, pFrame, &workspace, arrResult, pnNumObjBlocks, pnMeanObjBlocks, pnMinObj, pnMaxObj );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// classfy either an image or a frame snapshot
+template< int DIVIDE >
+bool CRegionTypeClassifier::_classfyRegion( 
+				IN		const cl::img::CImageBuf* pImg, const CFrameSnapshot* pFrame, CRegionTypeWorkspace* pWorkspace,
+				OUT		RegionType arrResult[],
 				OUT		int* pnNumObjBlocks,
 				OUT		int* pnMeanObjBlocks,
 				OUT		int* pnMinObj,
 				OUT		int* pnMaxObj
 			) const
 {
-	ASSERT( _pMLP_Objec );
-	ASSERT( _pMLP_Metal );
+	ASSERT( ( pImg != nullptr ) != ( pFrame != nullptr ) );
+	ASSERT( pWorkspace != nullptr );
 
 	ASSERT( arrResult != nullptr );
 	ASSERT( pnNumObjBlocks );
@@ -112,105 +770,488 @@ bool CRegionTypeClassifier::ClassfyRegion(
 	ASSERT( pnMinObj );
 	ASSERT( pnMaxObj );
 
-	if ( ! img.IsValid() )
-		return false;
+	// to profile time, if instrumented
+	CStageStatistics* pStages = _getStages();
+	const LONGLONG llStart = ( pStages != nullptr ) ? CStageStatistics::Now() : 0;
 
-	// to profile time
-	LARGE_INTEGER llLap1, llLap2;
-	LARGE_INTEGER llFreq;
-
-	::QueryPerformanceCounter( &llLap1 );
+	// the networks of this frame, even if they are replaced meanwhile
+	ModelGuard guard( *this );
+	const Model& model = guard.Get();
 
 	// local constants
-	const int nNumBlocks = ABC_REGION_DIVIDE * ABC_REGION_DIVIDE;
+	typedef CFeatureGenT< DIVIDE > FeatureGen;
 
-	// allocate temp buffers
-	double **ppDblFeatures = new double* [ nNumBlocks ];
-	ASSERT( ppDblFeatures );
+	// the pixels, an image of the MFC DLL or a frame
+	const WORD* pwSrc = nullptr;
+	int nSrcW = 0, nSrcH = 0, nStrider = 0, nBitDepth = 16;
 
-	for ( int i=0; i<nNumBlocks; i++ )
+#if ! defined( ABC_STANDALONE )
+	if ( pImg != nullptr )
+	{
+		pwSrc = pImg->GetPixelDataWord();
+		nSrcW = nStrider = pImg->GetWidth();
+		nSrcH = pImg->GetHeight();
+	}
+	else
+#endif
 	{
-		ppDblFeatures[i] = new double [ ABC_FEATURE_COUNT ];
-		ASSERT( ppDblFeatures[i] );
+		pwSrc = pFrame->GetPixelDataWord();
+		nSrcW = pFrame->GetWidth();
+		nSrcH = pFrame->GetHeight();
+		nStrider = pFrame->GetStrider();
+		nBitDepth = pFrame->GetBitDepth();
 	}
 
+	CThreadPool* pPool = pWorkspace->_getPool( _pPool );
+	const int nWorkers = ( pPool != nullptr ) ? pPool->GetWorkerCount() : 1;
+
+	pWorkspace->_beginFrame( nSrcW, nSrcH, DIVIDE, nBitDepth, _nDecimation, nWorkers, _nCoarseDivide );
+
+	// one contiguous buffer for all the blocks, made by the first frame
+	CFeatureBlock& features = pWorkspace->_getFeatures();
+
+	// blocks in the collimator field
+	bool abExposed[ FeatureGen::kBlockCount ];
+	const bool* pbExposed = _getExposure< DIVIDE >( pwSrc, nSrcW, nSrcH, nStrider, abExposed );
+
+	if ( pStages != nullptr )
+		pStages->Record( kABCStage_Exposure, llStart, CStageStatistics::Now() );
+
 	// feature generation
-	VERIFY( CFeatureGen::CalcFeatures( img, ppDblFeatures ) );
+	FeatureGenOptions options = _getFeatureGenOptions();
+	options.pbExposed = pbExposed;
+	options.pScratch = pWorkspace->_getScratch();
+	options.pPool = pPool;
+
+#if ! defined( ABC_STANDALONE )
+	if ( pImg != nullptr )
+		VERIFY( FeatureGen::CalcFeatures( *pImg, &features, options ) );
+	else
+#endif
+		VERIFY( FeatureGen::CalcFeatures( *pFrame, &features, options ) );
 
 	// do predict
+	double adObjec[ FeatureGen::kBlockCount ], adMetal[ FeatureGen::kBlockCount ];
+
+	_predictBlocks< DIVIDE >( model, features, pbExposed, &pWorkspace->_getCells(), adObjec, adMetal );
+
+	// make output
+	const LONGLONG llOutput = ( pStages != nullptr ) ? CStageStatistics::Now() : 0;
+
+	_makeOutput< DIVIDE >( features, pbExposed, adObjec, adMetal, 
+						   arrResult, pnNumObjBlocks, pnMeanObjBlocks, pnMinObj, pnMaxObj );
+
+	// OpenCV allocates in predict(...), the native engine does not
+	pWorkspace->_endFrame( model.engine.IsLoaded() );
+
+	if ( pStages != nullptr )
+	{
+		const LONGLONG llEnd = CStageStatistics::Now();
+
+		pStages->Record( kABCStage_Output, llOutput, llEnd );
+		pStages->Record( kABCStage_Total, llStart, llEnd );
+		pStages->DumpIfDue( llEnd );
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// options of the feature generation
+FeatureGenOptions CRegionTypeClassifier::_getFeatureGenOptions(void) const
+{
+	FeatureGenOptions options;
+	options.nDecimation = _nDecimation;
+	options.eSampling = _eSampling;
+	options.pPool = _pPool;
+	options.pStages = _getStages();
+
+	return options;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// exposed blocks of a frame
+template< int DIVIDE >
+const bool* CRegionTypeClassifier::_getExposure( 
+				IN		const WORD* pwSrc, int nSrcW, int nSrcH, int nStrider, 
+				OUT		bool abExposed[] 
+			) const
+{
+	int nBlkW = 0, nBlkH = 0;
+	CFeatureGenT< DIVIDE >::GetBlockSize( nSrcW, nSrcH, _nDecimation, &nBlkW, &nBlkH );
+
+	switch ( _eCollimation )
 	{
-		cv::Mat feature	( nNumBlocks, ABC_FEATURE_COUNT, cv::DataType<double>::type );
-		cv::Mat resultObjec	( nNumBlocks, 1,  cv::DataType<double>::type );
-		cv::Mat resultMetal ( nNumBlocks, 1,  cv::DataType<double>::type );
+	case kABCCollimation_Rect:
+		CCollimation::FromRect( _rcField, nBlkW, nBlkH, DIVIDE, abExposed );
+		return abExposed;
+
+	case kABCCollimation_Mask:
+		// the mask is made for the default grid only
+		if ( DIVIDE != ABC_REGION_DIVIDE )
+			return nullptr;
+
+		memcpy( abExposed, _abExposed, sizeof(bool) * DIVIDE * DIVIDE );
+		return abExposed;
+
+	case kABCCollimation_Auto:
+		// a dark frame has no field, all of it is used
+		if ( CCollimation::Detect( pwSrc, nStrider, nBlkW, nBlkH, DIVIDE, COLLIMATION_RATIO, abExposed ) )
+			return abExposed;
 
-		for ( int by=0; by<ABC_REGION_DIVIDE; by++ )
-		for ( int bx=0; bx<ABC_REGION_DIVIDE; bx++ )
+		return nullptr;
+
+	default:
+		return nullptr;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// predict the blocks
+template< int DIVIDE >
+void CRegionTypeClassifier::_predictBlocks( 
+				IN		const Model& model, const CFeatureBlock& features, const bool* pbExposed, 
+				OUT		CFeatureBlock* pCells, double adObjec[], double adMetal[] 
+			) const
+{
+	// the coarse grid has to divide the grid, and be coarser
+	if ( _nCoarseDivide > 0 && _nCoarseDivide < DIVIDE && DIVIDE % _nCoarseDivide == 0 )
+	{
+		_predictCoarseToFine< DIVIDE >( model, features, pbExposed, pCells, adObjec, adMetal );
+	}
+	else if ( pbExposed == nullptr )
+	{
+		_predict( model, features, nullptr, DIVIDE * DIVIDE, true, adObjec, adMetal );
+	}
+	else 
+	{
+		int anBlocks[ DIVIDE * DIVIDE ];
+		const int nBlocks = _getPredictedBlocks< DIVIDE >( pbExposed, anBlocks );
+
+		_predict( model, features, anBlocks, nBlocks, true, adObjec, adMetal );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// predict coarse to fine
+template< int DIVIDE >
+void CRegionTypeClassifier::_predictCoarseToFine( 
+				IN		const Model& model, const CFeatureBlock& features, const bool* pbExposed, 
+				OUT		CFeatureBlock* pCells, double adObjec[], double adMetal[] 
+			) const
+{
+	ASSERT( pCells != nullptr );
+
+	const int nCoarse = _nCoarseDivide;
+	const int nCellBlocks = DIVIDE / nCoarse;			// blocks per side of a cell
+
+	// the global features are the same for every block
+	const double dGlobalStd = features.Get( 0, kABCFeatureId_Global_Std );
+
+	// Features of the cells from the exposed non-boundary blocks of each. 
+	// Max, min, mean and std are exact ( the blocks have the same population ), otsu and mode are averaged.
+	CFeatureBlock& cells = *pCells;
+	cells.Create( nCoarse * nCoarse, kABCFeatureLayout_RowMajor );
+
+	int anCells[ DIVIDE * DIVIDE ];
+	bool abMixed[ DIVIDE * DIVIDE ];
+	int nCells = 0;
+
+	for ( int ci=0; ci<nCoarse*nCoarse; ci++ )
+	{
+		const int cx = ci % nCoarse;
+		const int cy = ci / nCoarse;
+
+		int nBlocks = 0, nFirst = -1;
+		double dMax = 0., dMin = 1., dMeanLo = 1., dMeanHi = 0.;
+		double dSumMean = 0., dSumMoment = 0., dSumOtsu = 0., dSumMode = 0.;
+
+		for ( int by=cy*nCellBlocks; by<(cy+1)*nCellBlocks; by++ )
+		for ( int bx=cx*nCellBlocks; bx<(cx+1)*nCellBlocks; bx++ )
 		{
-			const int bi = bx + by * ABC_REGION_DIVIDE;
+			const int bi = bx + by * DIVIDE;
+
+			if ( bx == 0 || bx == DIVIDE - 1 || by == 0 || by == DIVIDE - 1 || 
+				 ( pbExposed != nullptr && ! pbExposed[ bi ] ) )
+			{
+				continue;
+			}
+
+			const double dMean = features.Get( bi, kABCFeatureId_Local_Mean );
+			const double dStd  = features.Get( bi, kABCFeatureId_Local_Std );
+
+			dMax = CLU_MAX( dMax, features.Get( bi, kABCFeatureId_Local_Max ) );
+			dMin = CLU_MIN( dMin, features.Get( bi, kABCFeatureId_Local_Min ) );
+
+			dMeanLo = CLU_MIN( dMeanLo, dMean );
+			dMeanHi = CLU_MAX( dMeanHi, dMean );
 
-			for ( int i=0; i<ABC_FEATURE_COUNT; i++ )
-				feature.at<double>( bi,  i ) = ppDblFeatures[ bi ][ i ];
+			dSumMean	+= dMean;
+			dSumMoment	+= CLU_SQUARE( dStd ) + CLU_SQUARE( dMean );
+			dSumOtsu	+= features.Get( bi, kABCFeatureId_Local_Otsu );
+			dSumMode	+= features.Get( bi, kABCFeatureId_Local_Mode );
 
-			resultObjec.at<double>( bi ) = 0.;
-			resultMetal.at<double>( bi ) = 0.;
+			if ( nFirst < 0 )
+				nFirst = bi;
+
+			nBlocks ++;
 		}
 
-		const float s1 = _pMLP_Objec->predict( feature, resultObjec );
-		const float s2 = _pMLP_Metal->predict( feature, resultMetal );
+		// nothing to predict in this cell
+		if ( nBlocks == 0 )
+			continue;
+
+		for ( int f=kABCFeatureId_Global_Otsu; f<=kABCFeatureId_Global_MA; f++ )
+			cells.Set( ci, f, features.Get( nFirst, f ) );
+
+		const double dMean = dSumMean / nBlocks;
+
+		cells.Set( ci, kABCFeatureId_Local_Otsu,	dSumOtsu / nBlocks );
+		cells.Set( ci, kABCFeatureId_Local_Max,		dMax );
+		cells.Set( ci, kABCFeatureId_Local_Min,		dMin );
+		cells.Set( ci, kABCFeatureId_Local_Mean,	dMean );
+		cells.Set( ci, kABCFeatureId_Local_Std,		sqrt( CLU_LBOUND( dSumMoment / nBlocks - CLU_SQUARE( dMean ), 0. ) ) );
+		cells.Set( ci, kABCFeatureId_Local_Mode,	dSumMode / nBlocks );
 
-		UNREFERENCED_PARAMETER( s1 );
-		UNREFERENCED_PARAMETER( s2 );
+		// blocks much different from each other are not decided together
+		abMixed[ nCells ] = ( dMeanHi - dMeanLo > dGlobalStd );
+		anCells[ nCells++ ] = ci;
+	}
+
+	double adCellObjec[ DIVIDE * DIVIDE ], adCellMetal[ DIVIDE * DIVIDE ];
 
-		// make output
-		int nNumObjBlocks = 0;
-		double dSumObjBlocks = 0.;
-		double dMinObj = 1.0;
-		double dMaxObj = 0.0;
+	// the rules are fitted to blocks, not to the cells
+	_predict( model, cells, anCells, nCells, false, adCellObjec, adCellMetal );
 
-		for ( int bi=0; bi<nNumBlocks; bi++ )
+	// the blocks of certain cells take the result of the cell, the others are predicted
+	int anBlocks[ DIVIDE * DIVIDE ];
+	int nBlocks = 0;
+
+	for ( int i=0; i<nCells; i++ )
+	{
+		const int ci = anCells[ i ];
+		const int cx = ci % nCoarse;
+		const int cy = ci / nCoarse;
+
+		const bool bFine = abMixed[ i ] || 
+						   fabs( adCellObjec[ ci ] ) < _dCoarseMargin || 
+						   fabs( adCellMetal[ ci ] ) < _dCoarseMargin;
+
+		for ( int by=cy*nCellBlocks; by<(cy+1)*nCellBlocks; by++ )
+		for ( int bx=cx*nCellBlocks; bx<(cx+1)*nCellBlocks; bx++ )
 		{
-			const int bx = bi % ABC_REGION_DIVIDE;
-			const int by = bi / ABC_REGION_DIVIDE;
+			const int bi = bx + by * DIVIDE;
 
-			if ( bx == 0 || bx == ABC_REGION_DIVIDE - 1 || by == 0 || by == ABC_REGION_DIVIDE - 1 )
+			if ( bx == 0 || bx == DIVIDE - 1 || by == 0 || by == DIVIDE - 1 || 
+				 ( pbExposed != nullptr && ! pbExposed[ bi ] ) )
 			{
-				arrResult[ bi ].bMetal = false;
-				arrResult[ bi ].bBackground = true;
+				continue;
+			}
+
+			if ( bFine )
+			{
+				anBlocks[ nBlocks++ ] = bi;
 			}
 			else 
 			{
-				const bool bMetal = ( resultMetal.at<double>( bi ) > 0.0 );
-				const bool bBackg = ( resultObjec.at<double>( bi ) > 0.0 );
+				adObjec[ bi ] = adCellObjec[ ci ];
+				adMetal[ bi ] = adCellMetal[ ci ];
+			}
+		}
+	}
+
+	_predict( model, features, anBlocks, nBlocks, true, adObjec, adMetal );
+}
 
-				arrResult[ bi ].bMetal = bMetal;
-				arrResult[ bi ].bBackground = bBackg;
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// exposed non-boundary blocks
+template< int DIVIDE >
+int CRegionTypeClassifier::_getPredictedBlocks( IN const bool* pbExposed, OUT int anBlocks[] )
+{
+	int nBlocks = 0;
 
-				if ( ! bBackg && ! bMetal )
-				{
-					nNumObjBlocks ++;
-					dSumObjBlocks += ppDblFeatures[ bi ][ kABCFeatureId_Local_Mean ];
+	for ( int by=1; by<DIVIDE-1; by++ )
+	for ( int bx=1; bx<DIVIDE-1; bx++ )
+	{
+		const int bi = bx + by * DIVIDE;
 
-					dMinObj = std::min( dMinObj, ppDblFeatures[ bi ][ kABCFeatureId_Local_Min ] );
-					dMaxObj = std::max( dMaxObj, ppDblFeatures[ bi ][ kABCFeatureId_Local_Max ] );
-				}
-			}
+		if ( pbExposed == nullptr || pbExposed[ bi ] )
+			anBlocks[ nBlocks++ ] = bi;
+	}
+
+	return nBlocks;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// predict some or all blocks
+void CRegionTypeClassifier::_predict( 
+				IN		const Model& model, const CFeatureBlock& features, const int anBlocks[], int nBlocks, bool bCascade,
+				OUT		double adObjec[], double adMetal[] 
+			) const
+{
+	ASSERT( features.GetRows() != nullptr );
+
+	if ( nBlocks <= 0 )
+		return;
+
+	// The obvious blocks are decided by the rules, the networks predict the others.
+	int anUncertain[ CASCADE_STACK_BLOCKS ];
+	std::vector< int > vecUncertain;
+
+	if ( bCascade && _bCascade )
+	{
+		int* pnUncertain = anUncertain;
+
+		// the rows of a batch
+		if ( nBlocks > CASCADE_STACK_BLOCKS )
+		{
+			vecUncertain.resize( nBlocks );
+			pnUncertain = &vecUncertain[ 0 ];
 		}
 
-		// output value
-		*pnNumObjBlocks = nNumObjBlocks;
-		*pnMeanObjBlocks = ( nNumObjBlocks != 0 ) ? (int)( dSumObjBlocks * 65535. / nNumObjBlocks + 0.5 ) : 0;
-		*pnMinObj = (int) CLU_BOUND( dMinObj * 65535. + 0.5, 0, 65535 );
-		*pnMaxObj = (int) CLU_BOUND( dMaxObj * 65535. + 0.5, 0, 65535 );
+		nBlocks = CCascade::Resolve( _cascade, features, anBlocks, nBlocks, pnUncertain, adObjec, adMetal );
+		anBlocks = pnUncertain;
+
+		if ( nBlocks == 0 )
+			return;
 	}
 
-	// delete temp buffers
-	for ( int i=0; i<nNumBlocks; i++ )
-		delete [] ppDblFeatures[ i ];
-	delete [] ppDblFeatures;
+	CStageStatistics* pStages = _getStages();
 
-	::QueryPerformanceCounter( &llLap2 );
-	::QueryPerformanceFrequency( &llFreq );
+	// both networks in one pass, straight from the rows
+	if ( model.engine.IsLoaded() )
+	{
+		const LONGLONG llPredict = ( pStages != nullptr ) ? CStageStatistics::Now() : 0;
 
-	return true;
+		model.engine.Predict( features.GetRows(), ABC_FEATURE_COUNT, anBlocks, nBlocks, adObjec, adMetal );
+
+		if ( pStages != nullptr )
+			pStages->Record( kABCStage_Predict, llPredict, CStageStatistics::Now() );
+
+		return;
+	}
+
+#if defined( ABC_STANDALONE )
+	// _publishModel(...) has the engine loaded
+	ASSERT( FALSE );
+#else
+	// All the blocks are wrapped, no copy. Some blocks are gathered into rows of their own.
+	cv::Mat feature;
+
+	if ( anBlocks == nullptr )
+	{
+		ASSERT( nBlocks == features.GetBlockCount() );
+
+		feature = cv::Mat( nBlocks, ABC_FEATURE_COUNT, cv::DataType<double>::type, 
+						   const_cast< double* >( features.GetRows() ) );
+	}
+	else 
+	{
+		feature = cv::Mat( nBlocks, ABC_FEATURE_COUNT, cv::DataType<double>::type );
+
+		for ( int i=0; i<nBlocks; i++ )
+		for ( int f=0; f<ABC_FEATURE_COUNT; f++ )
+			feature.at<double>( i, f ) = features.Get( anBlocks[ i ], f );
+	}
+
+	cv::Mat resultObjec	= cv::Mat::zeros( nBlocks, 1, cv::DataType<double>::type );
+	cv::Mat resultMetal = cv::Mat::zeros( nBlocks, 1, cv::DataType<double>::type );
+
+	// the networks are shared by the threads, the engine is not loaded
+	float s1 = 0.f, s2 = 0.f;
+	{
+		std::lock_guard< std::mutex > lock( model.mutexMLP );
+
+		// the wait for the lock is not in the stages
+		const LONGLONG llObjec = ( pStages != nullptr ) ? CStageStatistics::Now() : 0;
+
+		s1 = model.mlpObjec.predict( feature, resultObjec );
+
+		const LONGLONG llMetal = ( pStages != nullptr ) ? CStageStatistics::Now() : 0;
+
+		s2 = model.mlpMetal.predict( feature, resultMetal );
+
+		if ( pStages != nullptr )
+		{
+			const LONGLONG llEnd = CStageStatistics::Now();
+
+			pStages->Record( kABCStage_PredictObjec, llObjec, llMetal );
+			pStages->Record( kABCStage_PredictMetal, llMetal, llEnd );
+		}
+	}
+
+	UNREFERENCED_PARAMETER( s1 );
+	UNREFERENCED_PARAMETER( s2 );
+
+	for ( int i=0; i<nBlocks; i++ )
+	{
+		const int bi = ( anBlocks != nullptr ) ? anBlocks[ i ] : i;
+
+		adObjec[ bi ] = resultObjec.at<double>( i );
+		adMetal[ bi ] = resultMetal.at<double>( i );
+	}
+#endif
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// make output
+template< int DIVIDE >
+void CRegionTypeClassifier::_makeOutput( 
+				IN		const CFeatureBlock& features, const bool* pbExposed, const double adObjec[], const double adMetal[],
+				OUT		RegionType arrResult[],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			)
+{
+	int nNumObjBlocks = 0;
+	double dSumObjBlocks = 0.;
+	double dMinObj = 1.0;
+	double dMaxObj = 0.0;
+
+	for ( int bi=0; bi<DIVIDE*DIVIDE; bi++ )
+	{
+		const int bx = bi % DIVIDE;
+		const int by = bi / DIVIDE;
+
+		if ( bx == 0 || bx == DIVIDE - 1 || by == 0 || by == DIVIDE - 1 || 
+			 ( pbExposed != nullptr && ! pbExposed[ bi ] ) )
+		{
+			arrResult[ bi ].bMetal = false;
+			arrResult[ bi ].bBackground = true;
+		}
+		else 
+		{
+			const bool bMetal = ( adMetal[ bi ] > 0.0 );
+			const bool bBackg = ( adObjec[ bi ] > 0.0 );
+
+			arrResult[ bi ].bMetal = bMetal;
+			arrResult[ bi ].bBackground = bBackg;
+
+			if ( ! bBackg && ! bMetal )
+			{
+				nNumObjBlocks ++;
+				dSumObjBlocks += features.Get( bi, kABCFeatureId_Local_Mean );
+
+				dMinObj = std::min( dMinObj, features.Get( bi, kABCFeatureId_Local_Min ) );
+				dMaxObj = std::max( dMaxObj, features.Get( bi, kABCFeatureId_Local_Max ) );
+			}
+		}
+	}
+
+	// output value
+	*pnNumObjBlocks = nNumObjBlocks;
+	*pnMeanObjBlocks = ( nNumObjBlocks != 0 ) ? (int)( dSumObjBlocks * 65535. / nNumObjBlocks + 0.5 ) : 0;
+	*pnMinObj = (int) CLU_MIN( CLU_LBOUND( dMinObj * 65535. + 0.5, 0. ), 65535. );
+	*pnMaxObj = (int) CLU_MIN( CLU_LBOUND( dMaxObj * 65535. + 0.5, 0. ), 65535. );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// used by CRegionTypeStream and CRegionTypePipeline on the default grid
+template const bool* CRegionTypeClassifier::_getExposure< ABC_REGION_DIVIDE >( const WORD*, int, int, int, bool[] ) const;
+template int CRegionTypeClassifier::_getPredictedBlocks< ABC_REGION_DIVIDE >( const bool*, int[] );
+template void CRegionTypeClassifier::_predictBlocks< ABC_REGION_DIVIDE >( 
+				const Model&, const CFeatureBlock&, const bool*, CFeatureBlock*, double[], double[] ) const;
+template void CRegionTypeClassifier::_makeOutput< ABC_REGION_DIVIDE >( 
+				const CFeatureBlock&, const bool*, const double[], const double[], RegionType[], int*, int*, int*, int* );
@@ -0,0 +1,348 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "abc/RegionTypePipeline.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/FrameSnapshot.h"
+#include "abc/FeatureBlock.h"
+#include "FeatureGen.h"
+#include "StageStatistics.h"
+
+// platform
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW
+#endif
+
+// macro
+#define PIPELINE_FEATURES			3			// computed, ready and predicted
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// state of the pipeline
+struct CRegionTypePipeline::PipelineState
+{
+	// a frame waiting for the features
+	struct Job
+	{
+		CFrameSnapshot frame;
+		UINT64 ullFrameId;
+		LONGLONG llSubmit;								// CStageStatistics::Now()
+
+		Job(void) : ullFrameId( 0 ), llSubmit( 0 )
+		{
+		}
+	};
+
+	// features waiting for the prediction. PIPELINE_FEATURES of them rotate between the stages, one each.
+	// So the feature stage always finds a free one, and nothing is allocated per frame.
+	struct Features
+	{
+		CFeatureBlock features;
+		UINT64 ullFrameId;
+		LONGLONG llSubmit;
+		LONGLONG llStart;								// the feature stage started, 0 if not instrumented
+
+		bool bMasked, abExposed[ ABC_REGION_DIVIDE_2 ];		// blocks in the collimator field
+
+		Features(void) : features( ABC_REGION_DIVIDE_2 ), ullFrameId( 0 ), llSubmit( 0 ), llStart( 0 ), bMasked( false )
+		{
+		}
+	};
+
+	const CRegionTypeClassifier& classifier;
+	const ResultCallback fnCallback;
+	const int nQueueSize;
+
+	const LONGLONG llFreq;
+
+	std::mutex mutex;
+	std::condition_variable cvFrame, cvFeatures, cvIdle;
+
+	CFeatureScratch scratch;							// buffers of the feature generation, stage 1 only
+
+	// frames waiting, a ring of nQueueSize made by the constructor
+	std::unique_ptr< Job[] > aFrames;
+	int nFirst;											// the oldest
+	int nFrames;
+
+	Features aFeatures[ PIPELINE_FEATURES ];
+	Features* pReady;									// computed, not predicted yet
+	Features* apFree[ PIPELINE_FEATURES ];				// neither computed nor predicted
+	int nFree;
+
+	bool bExtracting, bPredicting;						// a stage is working on a frame
+	bool bQuit;
+	UINT64 ullDropped;
+
+	std::thread threadFeatures, threadPredict;
+
+	PipelineState( const CRegionTypeClassifier& c, const ResultCallback& fn, int nSize )
+		: classifier( c ), fnCallback( fn ), nQueueSize( nSize )
+		, llFreq( CStageStatistics::Frequency() )
+		, aFrames( new Job[ nSize ] ), nFirst( 0 ), nFrames( 0 )
+		, pReady( nullptr ), nFree( 0 )
+		, bExtracting( false ), bPredicting( false ), bQuit( false ), ullDropped( 0 )
+	{
+		for ( int i=0; i<PIPELINE_FEATURES; i++ )
+			apFree[ nFree ++ ] = &aFeatures[ i ];
+	}
+
+	bool IsIdle(void) const
+	{
+		return nFrames == 0 && pReady == nullptr && ! bExtracting && ! bPredicting;
+	}
+
+	// queue a frame under the mutex, the oldest is dropped if the ring is full
+	void PushFrame( const Job& job )
+	{
+		if ( nFrames == nQueueSize )
+		{
+			aFrames[ nFirst ].frame = CFrameSnapshot();
+			nFirst = ( nFirst + 1 ) % nQueueSize;
+			nFrames --;
+			ullDropped ++;
+		}
+
+		aFrames[ ( nFirst + nFrames ) % nQueueSize ] = job;
+		nFrames ++;
+	}
+
+	// the oldest frame under the mutex, its slot lets the pixels go
+	void PopFrame( OUT Job* pJob )
+	{
+		ASSERT( nFrames > 0 );
+
+		Job& job = aFrames[ nFirst ];
+		*pJob = job;
+		job.frame = CFrameSnapshot();
+
+		nFirst = ( nFirst + 1 ) % nQueueSize;
+		nFrames --;
+	}
+
+	// a free features, under the mutex. 
+	// The feature stage holds one, the prediction at most one, and none is free only while another one is ready.
+	Features* PopFree(void)
+	{
+		ASSERT( nFree > 0 );
+		return apFree[ -- nFree ];
+	}
+
+	// stage 1, feature generation
+	void FeatureMain(void)
+	{
+		Features* pWork;
+		{
+			std::lock_guard< std::mutex > lock( mutex );
+			pWork = PopFree();
+		}
+
+		for ( ;; )
+		{
+			Job job;
+			{
+				std::unique_lock< std::mutex > lock( mutex );
+
+				while ( ! bQuit && nFrames == 0 )
+					cvFrame.wait( lock );
+
+				if ( bQuit )
+					return;
+
+				PopFrame( &job );
+				bExtracting = true;
+			}
+
+			const CFrameSnapshot& frame = job.frame;
+
+			// to profile time, if instrumented
+			CStageStatistics* pStages = classifier._getStages();
+			const LONGLONG llStart = ( pStages != nullptr ) ? CStageStatistics::Now() : 0;
+
+			FeatureGenOptions options = classifier._getFeatureGenOptions();
+			options.pbExposed = classifier._getExposure< ABC_REGION_DIVIDE >( 
+									frame.GetPixelDataWord(), frame.GetWidth(), frame.GetHeight(), frame.GetStrider(), pWork->abExposed );
+
+			if ( pStages != nullptr )
+				pStages->Record( kABCStage_Exposure, llStart, CStageStatistics::Now() );
+
+			pWork->bMasked = ( options.pbExposed != nullptr );
+			options.pScratch = &scratch;
+
+			VERIFY( CFeatureGen::CalcFeatures( frame, &pWork->features, options ) );
+
+			pWork->ullFrameId = job.ullFrameId;
+			pWork->llSubmit = job.llSubmit;
+			pWork->llStart = llStart;
+
+			// the pixels are not needed any more
+			job.frame = CFrameSnapshot();
+
+			{
+				std::lock_guard< std::mutex > lock( mutex );
+
+				// features not predicted yet are older, they are dropped
+				if ( pReady != nullptr )
+				{
+					ullDropped ++;
+					std::swap( pReady, pWork );
+				}
+				else
+				{
+					pReady = pWork;
+					pWork = PopFree();
+				}
+
+				bExtracting = false;
+			}
+			cvFeatures.notify_one();
+			cvIdle.notify_all();
+		}
+	}
+
+	// stage 2, prediction and output
+	void PredictMain(void)
+	{
+		double adObjec[ ABC_REGION_DIVIDE_2 ], adMetal[ ABC_REGION_DIVIDE_2 ];
+		CFeatureBlock cells;							// of the coarse grid
+		RegionTypeResult result;
+
+		for ( ;; )
+		{
+			Features* pWork;
+			{
+				std::unique_lock< std::mutex > lock( mutex );
+
+				while ( ! bQuit && pReady == nullptr )
+					cvFeatures.wait( lock );
+
+				if ( bQuit )
+					return;
+
+				pWork = pReady;
+				pReady = nullptr;
+				bPredicting = true;
+			}
+
+			const bool* pbExposed = pWork->bMasked ? pWork->abExposed : nullptr;
+			{
+				// the networks of this frame, even if they are replaced meanwhile
+				CRegionTypeClassifier::ModelGuard guard( classifier );
+
+				classifier._predictBlocks< ABC_REGION_DIVIDE >( guard.Get(), pWork->features, pbExposed, &cells, adObjec, adMetal );
+			}
+
+			// make output
+			CStageStatistics* pStages = classifier._getStages();
+			const LONGLONG llOutput = ( pStages != nullptr ) ? CStageStatistics::Now() : 0;
+
+			CRegionTypeClassifier::_makeOutput< ABC_REGION_DIVIDE >( pWork->features, pbExposed, adObjec, adMetal, result.arrResult,
+										&result.nNumObjBlocks, &result.nMeanObjBlocks, &result.nMinObj, &result.nMaxObj );
+
+			const LONGLONG llNow = CStageStatistics::Now();
+
+			// the frame from its features, the time waiting in the queue is in fLatency only
+			if ( pStages != nullptr )
+			{
+				pStages->Record( kABCStage_Output, llOutput, llNow );
+				if ( pWork->llStart != 0 )
+					pStages->Record( kABCStage_Total, pWork->llStart, llNow );
+				pStages->DumpIfDue( llNow );
+			}
+
+			result.ullFrameId = pWork->ullFrameId;
+			result.fLatency = (float)( (double)( llNow - pWork->llSubmit ) / (double) llFreq * 1000. );
+
+			if ( fnCallback )
+				fnCallback( result );
+
+			{
+				std::lock_guard< std::mutex > lock( mutex );
+
+				apFree[ nFree ++ ] = pWork;
+				bPredicting = false;
+			}
+			cvIdle.notify_all();
+		}
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// constructor
+CRegionTypePipeline::CRegionTypePipeline( const CRegionTypeClassifier& classifier, const ResultCallback& fnCallback, int nQueueSize )
+	: _pState( new PipelineState( classifier, fnCallback, CLU_MAX( nQueueSize, 1 ) ) )
+{
+	ASSERT( _pState );
+	ASSERT( nQueueSize >= 1 );
+
+	_pState->threadFeatures = std::thread( &PipelineState::FeatureMain, _pState );
+	_pState->threadPredict = std::thread( &PipelineState::PredictMain, _pState );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// destructor
+CRegionTypePipeline::~CRegionTypePipeline(void)
+{
+	{
+		std::lock_guard< std::mutex > lock( _pState->mutex );
+		_pState->bQuit = true;
+	}
+	_pState->cvFrame.notify_all();
+	_pState->cvFeatures.notify_all();
+
+	_pState->threadFeatures.join();
+	_pState->threadPredict.join();
+
+	delete _pState;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// queue a frame
+bool CRegionTypePipeline::Submit( IN const CFrameSnapshot& frame, UINT64 ullFrameId )
+{
+	if ( ! frame.IsValid() )
+		return false;
+
+	PipelineState::Job job;
+	job.frame = frame;
+	job.ullFrameId = ullFrameId;
+	job.llSubmit = CStageStatistics::Now();
+
+	// only held to move the queue, never while a frame is computed
+	{
+		std::lock_guard< std::mutex > lock( _pState->mutex );
+
+		_pState->PushFrame( job );
+	}
+	_pState->cvFrame.notify_one();
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// wait for the submitted frames
+void CRegionTypePipeline::Flush(void)
+{
+	std::unique_lock< std::mutex > lock( _pState->mutex );
+
+	while ( ! _pState->IsIdle() )
+		_pState->cvIdle.wait( lock );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// frames dropped
+UINT64 CRegionTypePipeline::GetDroppedCount(void) const
+{
+	std::lock_guard< std::mutex > lock( _pState->mutex );
+
+	return _pState->ullDropped;
+}
@@ -0,0 +1,214 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "abc/RegionTypeStream.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/FrameSnapshot.h"
+#include "abc/FeatureBlock.h"
+#include "FeatureGen.h"
+#include "StageStatistics.h"
+
+// logger
+#include "abc.logger.h"
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW
+#endif
+
+// local types
+typedef CFeatureGenT< ABC_REGION_DIVIDE > StreamFeatureGen;
+typedef CFeatureCacheT< ABC_REGION_DIVIDE > StreamFeatureCache;
+
+// the global features computed from the frame, kV and mA are not
+static const int _anGlobalFeatures[] =
+{
+	kABCFeatureId_Global_Otsu,
+	kABCFeatureId_Global_Max,
+	kABCFeatureId_Global_Min,
+	kABCFeatureId_Global_Mean,
+	kABCFeatureId_Global_Std,
+	kABCFeatureId_Global_Mode,
+};
+
+static const int _nGlobalFeatureCount = sizeof( _anGlobalFeatures ) / sizeof(int);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// state of the stream
+struct CRegionTypeStream::StreamState
+{
+	StreamFeatureCache cache;							// statistics of the blocks
+	CFeatureScratch scratch;							// buffers of the feature generation
+	CFeatureBlock features;								// features of the last frame
+
+	bool bPredicted;									// adObjec and adMetal are of the last frame
+	UINT nModelVersion;									// of the networks predicting them
+	UINT nCascadeVersion;								// of the rule cascade deciding them
+	double adObjec[ ABC_REGION_DIVIDE_2 ];
+	double adMetal[ ABC_REGION_DIVIDE_2 ];
+
+	StreamState(void)
+		: features( ABC_REGION_DIVIDE_2 ), bPredicted( false ), nModelVersion( 0 ), nCascadeVersion( 0 )
+	{
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// constructor
+CRegionTypeStream::CRegionTypeStream( const CRegionTypeClassifier& classifier )
+	: _classifier( classifier )
+	, _pState( new StreamState )
+{
+	ASSERT( _pState );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// destructor
+CRegionTypeStream::~CRegionTypeStream(void)
+{
+	delete _pState;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// tolerance of the reused blocks
+bool CRegionTypeStream::SetTolerance( int nTolerance )
+{
+	if ( nTolerance < 0 || nTolerance > 0xffff )
+	{
+		LOG_ERROR( _T("Invalid tolerance - %d"), nTolerance );
+		return false;
+	}
+
+	_pState->cache.SetTolerance( nTolerance );
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// forget the previous frames
+void CRegionTypeStream::Reset(void)
+{
+	_pState->cache.Reset();
+	_pState->bPredicted = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// changed blocks of the last frame
+int CRegionTypeStream::GetDirtyBlockCount(void) const
+{
+	int nDirty = 0;
+
+	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
+	{
+		if ( _pState->cache.IsDirty( bi ) )
+			nDirty ++;
+	}
+
+	return nDirty;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// do classfy the next frame
+bool CRegionTypeStream::ClassfyRegion(
+				IN		const CFrameSnapshot& frame,
+				OUT		RegionType arrResult[ ABC_REGION_DIVIDE_2 ],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			)
+{
+	ASSERT( arrResult != nullptr );
+	ASSERT( pnNumObjBlocks );
+	ASSERT( pnMeanObjBlocks );
+	ASSERT( pnMinObj );
+	ASSERT( pnMaxObj );
+
+	if ( ! frame.IsValid() )
+		return false;
+
+	StreamState& state = *_pState;
+
+	// to profile time, if instrumented
+	CStageStatistics* pStages = _classifier._getStages();
+	const LONGLONG llStart = ( pStages != nullptr ) ? CStageStatistics::Now() : 0;
+
+	// the networks of this frame, even if they are replaced meanwhile
+	CRegionTypeClassifier::ModelGuard guard( _classifier );
+	const CRegionTypeClassifier::Model& model = guard.Get();
+	const UINT nCascadeVersion = _classifier._getCascadeVersion();
+
+	// global features of the previous frame
+	double adPrevGlobal[ _nGlobalFeatureCount ];
+
+	for ( int i=0; i<_nGlobalFeatureCount; i++ )
+		adPrevGlobal[ i ] = state.features.Get( 0, _anGlobalFeatures[ i ] );
+
+	// blocks in the collimator field
+	bool abExposed[ ABC_REGION_DIVIDE_2 ];
+	const bool* pbExposed = _classifier._getExposure< ABC_REGION_DIVIDE >( 
+									frame.GetPixelDataWord(), frame.GetWidth(), frame.GetHeight(), frame.GetStrider(), abExposed );
+
+	if ( pStages != nullptr )
+		pStages->Record( kABCStage_Exposure, llStart, CStageStatistics::Now() );
+
+	// only the changed blocks are computed
+	FeatureGenOptions options = _classifier._getFeatureGenOptions();
+	options.pbExposed = pbExposed;
+	options.pScratch = &state.scratch;
+
+	VERIFY( StreamFeatureGen::CalcFeatures( frame, &state.features, &state.cache, options ) );
+
+	// The global features are inputs of every block. If any of them changed, every block is predicted again.
+	// So is every block if the networks ( or their precision ) or the cascade were replaced.
+	bool bSameGlobal = state.bPredicted && state.nModelVersion == guard.GetVersion() && state.nCascadeVersion == nCascadeVersion;
+
+	for ( int i=0; i<_nGlobalFeatureCount && bSameGlobal; i++ )
+	{
+		if ( state.features.Get( 0, _anGlobalFeatures[ i ] ) != adPrevGlobal[ i ] )
+			bSameGlobal = false;
+	}
+
+	if ( pbExposed == nullptr && ! bSameGlobal )
+	{
+		_classifier._predict( model, state.features, nullptr, ABC_REGION_DIVIDE_2, true, state.adObjec, state.adMetal );
+	}
+	else
+	{
+		// exposed non-boundary blocks, only the ones computed again if the global features are the same
+		int anBlocks[ ABC_REGION_DIVIDE_2 ];
+		const int nExposed = CRegionTypeClassifier::_getPredictedBlocks< ABC_REGION_DIVIDE >( pbExposed, anBlocks );
+		int nBlocks = 0;
+
+		for ( int i=0; i<nExposed; i++ )
+		{
+			if ( ! bSameGlobal || state.cache.IsDirty( anBlocks[ i ] ) )
+				anBlocks[ nBlocks++ ] = anBlocks[ i ];
+		}
+
+		_classifier._predict( model, state.features, anBlocks, nBlocks, true, state.adObjec, state.adMetal );
+	}
+
+	state.bPredicted = true;
+	state.nModelVersion = guard.GetVersion();
+	state.nCascadeVersion = nCascadeVersion;
+
+	// make output
+	const LONGLONG llOutput = ( pStages != nullptr ) ? CStageStatistics::Now() : 0;
+
+	CRegionTypeClassifier::_makeOutput< ABC_REGION_DIVIDE >( state.features, pbExposed, state.adObjec, state.adMetal,
+								arrResult, pnNumObjBlocks, pnMeanObjBlocks, pnMinObj, pnMaxObj );
+
+	if ( pStages != nullptr )
+	{
+		const LONGLONG llEnd = CStageStatistics::Now();
+
+		pStages->Record( kABCStage_Output, llOutput, llEnd );
+		pStages->Record( kABCStage_Total, llStart, llEnd );
+		pStages->DumpIfDue( llEnd );
+	}
+
+	return true;
+}
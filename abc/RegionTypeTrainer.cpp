@@ -1,86 +1,81 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 // Added by Hai Son
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#include "stdafx.h"
+#include "abc_core.h"
 #include "abc/RegionTypeTrainer.h"
+#include "abc/FrameSnapshot.h"
+#include "abc/FeatureBlock.h"
 #include "FeatureGen.h"
+#include "MLPEngine.h"
+#include "MLPTrainer.h"
+#include "TrainingData.h"
+#include "Cascade.h"
 
-// openCV2
-#include "opencv2/opencv.hpp"
+// platform
+#include <cmath>
+#include <thread>
+#include <vector>
 
+#if ! defined( ABC_STANDALONE )
 // cl
 #include "clImgProc/ImageBuf.h"
-#include "clUtils/path_utils.h"
+#endif
 
 // logger
 #include "abc.logger.h"
 
 using namespace comed::abc;
 
-#ifdef _DEBUG
-#define new DEBUG_NEW 
-#endif 
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW
+#endif
 
-#define DATA_FILE_VERSION			_T("CXVIEW3.ABC.TRAININGDATA.V.1")
+// criteria of the training
+#define TRAIN_MAX_ITER				1000
+#define TRAIN_EPSILON				0.000001
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// internal data types
-struct CRegionTypeTrainer::DataTrainingParams
+// state of the trainer
+struct CRegionTypeTrainer::TrainerState
 {
-	int nCol, nRow;
-	double adFeatures[ ABC_FEATURE_COUNT ];
-	double adResults[ ABC_RESULT_COUNT ];
+	CMLPTrainer objec, metal;
+	CTrainingData data;
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // default constructor
 CRegionTypeTrainer::CRegionTypeTrainer(void)
 {
-	_pMLP_Objec = new CvANN_MLP;
-	ASSERT( _pMLP_Objec );
-
-	_pMLP_Metal = new CvANN_MLP;
-	ASSERT( _pMLP_Metal );
+	_pState = new TrainerState;
+	ASSERT( _pState );
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // destructor
 CRegionTypeTrainer::~CRegionTypeTrainer(void)
 {
-	ClearTrainingData();
-
-	delete _pMLP_Objec;
-	delete _pMLP_Metal;
+	delete _pState;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // initialize
 bool CRegionTypeTrainer::Initialize(void)
 {
-	const int anLayerInfo[] = { ABC_FEATURE_COUNT, ABC_FEATURE_COUNT * 2, 1 };
-	const int nLayerInfoCount = sizeof( anLayerInfo ) / sizeof(int) ;
-
-	cv::Mat layers( nLayerInfoCount, 1, CV_32SC1 );
-
-	for ( int i=0; i<nLayerInfoCount; i++ )
+	// create 
+	if ( ! _pState->objec.Create( ABC_FEATURE_COUNT, ABC_FEATURE_COUNT * 2 ) ||
+		 ! _pState->metal.Create( ABC_FEATURE_COUNT, ABC_FEATURE_COUNT * 2 ) )
 	{
-		layers.row( i ) = cv::Scalar( anLayerInfo[i] );
+		return false;
 	}
 
-	// create 
-	ASSERT( _pMLP_Objec );
-	_pMLP_Objec->create( layers );
-
-	ASSERT( _pMLP_Metal );
-	_pMLP_Metal->create( layers );
-
 	// clear previous data
 	ClearTrainingData();
 
 	return true;
 }
 
+#if ! defined( ABC_STANDALONE )
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // add training data
 bool CRegionTypeTrainer::AddTrainingData( 
@@ -95,55 +90,45 @@ bool CRegionTypeTrainer::AddTrainingData(
 		return false;
 	}
 
-	// temp buffers
-	double** ppdbFeatures = new double* [ ABC_REGION_DIVIDE_2 ];
-	ASSERT( ppdbFeatures );
-
-	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
-	{
-		ppdbFeatures[ bi ] = new double [ ABC_FEATURE_COUNT ];
-		ASSERT( ppdbFeatures[ bi ] );
-
-		ppdbFeatures[ bi ][ kABCFeatureId_Global_KV ] = (double) nKv;
-		ppdbFeatures[ bi ][ kABCFeatureId_Global_MA ] = (double) fMa;
-	}
+	// features of all the blocks
+	CFeatureBlock features( ABC_REGION_DIVIDE_2 );
 
 	// feature generation
-	CFeatureGen::CalcFeatures( img, ppdbFeatures ); 
+	if ( ! CFeatureGen::CalcFeatures( img, &features ) )
+		return false;
 
-	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
-	{
-		const int bx = bi % ABC_REGION_DIVIDE;
-		const int by = bi / ABC_REGION_DIVIDE;
+	features.SetAll( kABCFeatureId_Global_KV, (double) nKv );
+	features.SetAll( kABCFeatureId_Global_MA, (double) fMa );
 
-		if ( bx == 0 || bx == ABC_REGION_DIVIDE - 1 || by == 0 || by == ABC_REGION_DIVIDE - 1 )
-		{
-			// ignore the boundary blocks
-		}
-		else 
-		{
-			DataTrainingParams * pTraningData = new DataTrainingParams;
-			ASSERT( pTraningData );
+	return _pState->data.Add( features, arrTypes );
+}
+#endif
 
-			pTraningData->nCol = bx;
-			pTraningData->nRow = by;
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// add training data of a frame snapshot
+bool CRegionTypeTrainer::AddTrainingData( 
+	int nKv, float fMa,
+	const CFrameSnapshot& frame, const RegionType arrTypes[ ABC_REGION_DIVIDE_2 ] )
+{
+	ASSERT( arrTypes != nullptr );
 
-			for ( int j=0; j<ABC_FEATURE_COUNT; j++ )
-				pTraningData->adFeatures[ j ] = ppdbFeatures[ bi ][ j ];
+	if ( ! frame.IsValid() )
+	{
+		LOG_ERROR( _T("Invalid image to train.") );
+		return false;
+	}
 
-			pTraningData->adResults[ 0 ] = arrTypes[ bi ].bMetal      ? 1. : -1.;
-			pTraningData->adResults[ 1 ] = arrTypes[ bi ].bBackground ? 1. : -1.;
+	// features of all the blocks
+	CFeatureBlock features( ABC_REGION_DIVIDE_2 );
 
-			_listData.AddTail( pTraningData );
-		}
-	}
+	// feature generation
+	if ( ! CFeatureGen::CalcFeatures( frame, &features ) )
+		return false;
 
-	// delete 
-	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
-		delete [] ppdbFeatures[ bi ];
-	delete [] ppdbFeatures;
+	features.SetAll( kABCFeatureId_Global_KV, (double) nKv );
+	features.SetAll( kABCFeatureId_Global_MA, (double) fMa );
 
-	return true;
+	return _pState->data.Add( features, arrTypes );
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -151,7 +136,7 @@ bool CRegionTypeTrainer::AddTrainingData(
 bool CRegionTypeTrainer::SaveTrainingResult( LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal ) const
 {
 	// training data count
-	const int nTrainingDataCount = static_cast<int>( _listData.GetCount() );
+	const int nTrainingDataCount = _pState->data.GetCount();
 
 	if ( nTrainingDataCount < ABC_MIN_TRAININGDATACOUNT )
 	{
@@ -159,298 +144,281 @@ bool CRegionTypeTrainer::SaveTrainingResult( LPCTSTR lpszResultPath_Objec, LPCTS
 		return false;
 	}
 
-	// open cv
-	cv::Mat feature		( nTrainingDataCount, ABC_FEATURE_COUNT, cv::DataType<double>::type );
-	cv::Mat resultObjec	( nTrainingDataCount, 1,  cv::DataType<double>::type );
-	cv::Mat resultMetal ( nTrainingDataCount, 1,  cv::DataType<double>::type );
-
-	int nIndex = 0;
-	POSITION pos = _listData.GetHeadPosition();
-
-	while( pos )
+	if ( ! _pState->objec.IsCreated() || ! _pState->metal.IsCreated() )
 	{
-		DataTrainingParams* pData = _listData.GetNext( pos );
-		ASSERT( pData );
-
-		// feature
-		for ( int i=0 ; i<ABC_FEATURE_COUNT; i++ )
-		{
-			feature.at<double>( nIndex, i ) = pData->adFeatures[ i ];
-		}
-
-		// result
-		resultObjec.at<double>( nIndex ) = pData->adResults[ kABCResultId_Background ];
-		resultMetal.at<double>( nIndex ) = pData->adResults[ kABCResultId_Metal      ];
-
-		nIndex ++;
+		LOG_ERROR( _T("The trainer is not initialized.") );
+		return false;
 	}
 
-	// criteria
-	CvTermCriteria criteria;
-	criteria.max_iter = 1000;
-	criteria.epsilon = 0.000001f;
-	criteria.type = CV_TERMCRIT_ITER | CV_TERMCRIT_EPS;
+	std::vector< double > vecRows, vecLabels;
+	_pState->data.GetRows( &vecRows, &vecLabels );
 
-	CvANN_MLP_TrainParams params;
-	params.train_method = CvANN_MLP_TrainParams::RPROP;
-	params.bp_dw_scale = 0.1f;
-	params.bp_moment_scale = 0.1f;
-	params.term_crit = criteria;
+	// do train, the metal network on a thread of its own
+	int nCountMetal = 0;
 
-	// do train
-	ASSERT( _pMLP_Objec );
-	const int nCountObjec = _pMLP_Objec->train( feature, resultObjec, cv::Mat(), cv::Mat(), params, 
-												CvANN_MLP::NO_INPUT_SCALE | CvANN_MLP::NO_OUTPUT_SCALE );
+	std::thread thread( [&]()
+	{
+		nCountMetal = _pState->metal.Train( &vecRows[ 0 ], ABC_FEATURE_COUNT, &vecLabels[ kABCResultId_Metal ], ABC_RESULT_COUNT, 
+											nTrainingDataCount, TRAIN_MAX_ITER, TRAIN_EPSILON );
+	} );
 
-	ASSERT( _pMLP_Metal );
-	const int nCountMetal = _pMLP_Metal->train( feature, resultMetal, cv::Mat(), cv::Mat(), params, 
-												CvANN_MLP::NO_INPUT_SCALE | CvANN_MLP::NO_OUTPUT_SCALE );
+	const int nCountObjec = _pState->objec.Train( &vecRows[ 0 ], ABC_FEATURE_COUNT, &vecLabels[ kABCResultId_Background ], ABC_RESULT_COUNT, 
+												 nTrainingDataCount, TRAIN_MAX_ITER, TRAIN_EPSILON );
+	thread.join();
 
 	if ( nCountObjec > 0 && nCountMetal > 0 )
 	{
-		// TODO: how to check ?
-		_pMLP_Objec->save( CT2A( lpszResultPath_Objec ) );
-		_pMLP_Metal->save( CT2A( lpszResultPath_Metal ) );
-
-		return true;
+		return _pState->objec.Save( lpszResultPath_Objec ) && _pState->metal.Save( lpszResultPath_Metal );
 	}
 
 	return false;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// clear all the training data
-void CRegionTypeTrainer::ClearTrainingData(void)
+// the result as a header
+bool CRegionTypeTrainer::SaveTrainingResultAsHeader( LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal, LPCTSTR lpszHeaderPath )
 {
-	POSITION pos = _listData.GetHeadPosition();
-	while ( pos )
+	CMLPEngine engine;
+
+	if ( ! engine.Load( lpszResultPath_Objec, lpszResultPath_Metal ) )
+		return false;
+
+	if ( engine.GetInputCount() != ABC_FEATURE_COUNT )
 	{
-		delete _listData.GetNext( pos );
+		LOG_ERROR( _T("Networks of %d inputs, %d features"), engine.GetInputCount(), ABC_FEATURE_COUNT );
+		return false;
 	}
-	_listData.RemoveAll();
-}
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// get number of data instances
-int CRegionTypeTrainer::GetTrainingDataCount(void) const
-{
-	return (int) _listData.GetCount();
+	return engine.SaveHeader( lpszHeaderPath );
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// extract parameters
-int CRegionTypeTrainer::_extractData( const CString strLine, DataTrainingParams* pParam )
+// the result as a model file
+bool CRegionTypeTrainer::SaveTrainingResultAsModel( LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal, LPCTSTR lpszModelPath )
 {
-	ASSERT( pParam != nullptr );
-	
-	int nCount = 0;
+	CMLPEngine engine;
 
-	int nCurPos = 0;
-	CString strToken = strLine.Tokenize( _T("\t "), nCurPos );
+	if ( ! engine.Load( lpszResultPath_Objec, lpszResultPath_Metal ) )
+		return false;
 
-	while ( ! strToken.IsEmpty() )
+	if ( engine.GetInputCount() != ABC_FEATURE_COUNT )
 	{
-		if ( nCount == 0 )
-		{
-			pParam->nCol = ::_tstoi( strToken );
-		}
-		else if ( nCount == 1 )
-		{
-			pParam->nRow = ::_tstoi( strToken );
-		}
-		else if ( nCount < ABC_FEATURE_COUNT + 2 )
-		{
-			pParam->adFeatures[ nCount - 2 ] = ::_tstof( strToken );
-		}
-		else if ( nCount < ABC_RESULT_COUNT + ABC_FEATURE_COUNT + 2 )
-		{
-			pParam->adResults[ nCount - ( ABC_FEATURE_COUNT + 2 ) ] = ::_tstof( strToken );
-		}
-		else 
-		{
-			break;
-		}
-
-		nCount ++;
-		strToken = strLine.Tokenize( _T("\t "), nCurPos );
+		LOG_ERROR( _T("Networks of %d inputs, %d features"), engine.GetInputCount(), ABC_FEATURE_COUNT );
+		return false;
 	}
 
-	return nCount;
-
-	// ¾Æ·¡°¡ µ¿ÀÛÇÏÁö ¾ÊÀ½....
-	/*
-	return ::_stscanf_s( strLine, strFormat, 
-								&( pData->nCol ),
-								&( pData->nRow ),
-								&( pData->adFeatures[  0 ] ),
-								&( pData->adFeatures[  1 ] ),
-								&( pData->adFeatures[  2 ] ),
-								&( pData->adFeatures[  3 ] ),
-								&( pData->adFeatures[  4 ] ),
-								&( pData->adFeatures[  5 ] ),
-								&( pData->adFeatures[  6 ] ),
-								&( pData->adFeatures[  7 ] ),
-								&( pData->adFeatures[  8 ] ),
-								&( pData->adFeatures[  9 ] ),
-								&( pData->adFeatures[ 10 ] ),
-								&( pData->adFeatures[ 11 ] ),
-								&( pData->adFeatures[ 12 ] ),
-								&( pData->adFeatures[ 13 ] ),
-								&( pData->adResults [  0 ] ),
-								&( pData->adResults [  1 ] ) );
-	*/
+	return engine.SaveBinary( lpszModelPath );
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// load data from file
-bool CRegionTypeTrainer::AddTrainingDataFrom( LPCTSTR lpszFilePath )
+// input ranges of the quantized prediction
+bool CRegionTypeTrainer::CalibrateQuantization( 
+				IN		LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal, E_ABCPrecision ePrecision,
+				OUT		float afInputRange[ ABC_FEATURE_COUNT ], 
+				OUT		QuantizationReport* pReport 
+			) const
 {
-	bool bOk = true;
+	ASSERT( afInputRange != nullptr );
+	ASSERT( pReport );
+
+	const int nTrainingDataCount = _pState->data.GetCount();
 
-	TRY 
+	if ( nTrainingDataCount == 0 )
 	{
-		// format 
-		CString strFormat( _T("%d\t%d\t") );
-
-		for ( int i=0; i<ABC_FEATURE_COUNT + ABC_RESULT_COUNT; i++ )
-			strFormat += _T("%f\t");
-
-		strFormat.TrimRight();
-
-		// open file
-		CStdioFile file( lpszFilePath, CFile::modeRead );
-		CString strLine;
-		int nLineCount = 0;
-		bool bFirstLineParsed = false;
-
-		while ( bOk && file.ReadString( strLine ) )
-		{
-			nLineCount ++;
-
-			strLine.Trim();
-			if ( strLine.IsEmpty() )
-				continue;
-
-			if ( ! bFirstLineParsed )
-			{
-				if ( strLine == DATA_FILE_VERSION )
-				{
-					bFirstLineParsed = true;
-					continue;
-				}
-			}
-
-			DataTrainingParams *pData = new DataTrainingParams;
-			ASSERT( pData );
-
-			const int nExtracted = _extractData( strLine, pData );
-
-			if ( nExtracted != 2 + ABC_FEATURE_COUNT + ABC_RESULT_COUNT )
-			{
-				LOG_ERROR( _T("Can't read line %d from [%s]"), nLineCount, lpszFilePath );
-
-				delete pData;
-				bOk = false;
-			}
-			else if ( pData->nCol == 0 || pData->nCol == ABC_REGION_DIVIDE - 1 ||
-					  pData->nRow == 0 || pData->nRow == ABC_REGION_DIVIDE - 1 )
-			{
-				// ignore boundary blocks
-				delete pData;
-			}
-			else 
-			{
-				_listData.AddTail( pData );
-			}
-		}
-
-		file.Close();
+		LOG_ERROR( _T("No training data to calibrate") );
+		return false;
 	}
-	CATCH ( CException, e )
+
+	CMLPEngine engine;
+
+	if ( ! engine.Load( lpszResultPath_Objec, lpszResultPath_Metal ) )
+		return false;
+
+	if ( engine.GetInputCount() != ABC_FEATURE_COUNT )
 	{
-		LOG_ERROR( _T("Can't read training data from [%s] - %s"), lpszFilePath, CLU_GetErrorMessageFromException( e ) );
-		bOk = false;
+		LOG_ERROR( _T("Networks of %d inputs, %d features"), engine.GetInputCount(), ABC_FEATURE_COUNT );
+		return false;
 	}
-	END_CATCH;
 
-	return bOk;
-}
+	// the features of the data as rows
+	std::vector< double > vecRows;
+	_pState->data.GetRows( &vecRows, nullptr );
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// get data 
-bool CRegionTypeTrainer::GetCurrentData( RegionType arrTypes[ ABC_REGION_DIVIDE_2 ] ) const 
-{
-	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
+	// largest value of each feature
+	for ( int i=0; i<ABC_FEATURE_COUNT; i++ )
 	{
-		arrTypes[ bi ].bBackground = false;
-		arrTypes[ bi ].bMetal = false;
+		double dMax = 0.;
+
+		for ( int n=0; n<nTrainingDataCount; n++ )
+			dMax = CLU_MAX( dMax, vecRows[ (size_t) n * ABC_FEATURE_COUNT + i ] );
+
+		afInputRange[ i ] = ( dMax > 0. ) ? (float) dMax : 1.f;
 	}
 
-	POSITION pos = _listData.GetHeadPosition();
-	while ( pos )
+	// float and quantized outputs
+	std::vector< double > vecObjec( nTrainingDataCount ), vecMetal( nTrainingDataCount );
+	std::vector< double > vecQuantObjec( nTrainingDataCount ), vecQuantMetal( nTrainingDataCount );
+
+	engine.Predict( &vecRows[ 0 ], ABC_FEATURE_COUNT, nullptr, nTrainingDataCount, &vecObjec[ 0 ], &vecMetal[ 0 ] );
+
+	if ( ! engine.Quantize( ePrecision, afInputRange ) )
+		return false;
+
+	engine.Predict( &vecRows[ 0 ], ABC_FEATURE_COUNT, nullptr, nTrainingDataCount, &vecQuantObjec[ 0 ], &vecQuantMetal[ 0 ] );
+
+	// compare the decisions
+	QuantizationReport report = { nTrainingDataCount, 0, 0, 0, 0. };
+
+	for ( int n=0; n<nTrainingDataCount; n++ )
 	{
-		DataTrainingParams* pData = _listData.GetNext( pos );
-		ASSERT( pData );
+		const bool bMetalDiffers = ( vecMetal[ n ] > 0. ) != ( vecQuantMetal[ n ] > 0. );
+		const bool bBackgDiffers = ( vecObjec[ n ] > 0. ) != ( vecQuantObjec[ n ] > 0. );
 
-		const int bi = pData->nCol + pData->nRow * ABC_REGION_DIVIDE;
+		if ( bMetalDiffers ) report.nMetalDiffers ++;
+		if ( bBackgDiffers ) report.nBackgroundDiffers ++;
+		if ( bMetalDiffers || bBackgDiffers ) report.nAnyDiffers ++;
 
-		arrTypes[ bi ].bBackground = pData->adResults[ kABCResultId_Background ] > 0.0 ? true : false;
-		arrTypes[ bi ].bMetal      = pData->adResults[ kABCResultId_Metal      ] > 0.0 ? true : false;
+		report.dMaxError = CLU_MAX( report.dMaxError, fabs( vecMetal[ n ] - vecQuantMetal[ n ] ) );
+		report.dMaxError = CLU_MAX( report.dMaxError, fabs( vecObjec[ n ] - vecQuantObjec[ n ] ) );
 	}
 
+	LOG_DEBUG( _T("Quantization %d - %d blocks, metal %d, background %d, any %d differ, max error %f"), 
+				ePrecision, report.nBlocks, report.nMetalDiffers, report.nBackgroundDiffers, report.nAnyDiffers, report.dMaxError );
+
+	*pReport = report;
+
 	return true;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// save the data to the file
-bool CRegionTypeTrainer::SaveTrainingData( LPCTSTR lpszFilePath )
+// thresholds of the rule cascade
+bool CRegionTypeTrainer::FitCascade( 
+				IN		LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal, double dMaxError,
+				OUT		CascadeThresholds* pThresholds, 
+				OUT		CascadeReport* pReport,
+				OUT		E_CascadeDecision aeDecisions[]
+			) const
 {
-	if ( GetTrainingDataCount() == 0 )
+	ASSERT( pThresholds );
+	ASSERT( pReport );
+
+	const int nTrainingDataCount = _pState->data.GetCount();
+
+	if ( nTrainingDataCount == 0 )
 	{
-		LOG_ERROR( _T("No data to save.") );
+		LOG_ERROR( _T("No training data to fit the cascade") );
+		return false;
+	}
+
+	if ( dMaxError < 0. || dMaxError >= 1. )
+	{
+		LOG_ERROR( _T("Invalid error of the cascade - %f"), dMaxError );
 		return false;
 	}
 
-	bool bOk = true;
+	CMLPEngine engine;
 
-	TRY 
+	if ( ! engine.Load( lpszResultPath_Objec, lpszResultPath_Metal ) )
+		return false;
+
+	if ( engine.GetInputCount() != ABC_FEATURE_COUNT )
 	{
-		CStdioFile file( lpszFilePath, CFile::modeWrite | CFile::modeCreate );
+		LOG_ERROR( _T("Networks of %d inputs, %d features"), engine.GetInputCount(), ABC_FEATURE_COUNT );
+		return false;
+	}
+
+	// the features and the labels of the data as rows
+	std::vector< double > vecRows, vecLabels;
+	_pState->data.GetRows( &vecRows, &vecLabels );
 
-		// write version
-		file.WriteString( CString( DATA_FILE_VERSION ) + _T("\n") );
+	CascadeThresholds thresholds;
+	CCascade::Fit( &vecRows[ 0 ], ABC_FEATURE_COUNT, &vecLabels[ 0 ], nTrainingDataCount, dMaxError, &thresholds );
 
-		POSITION pos = _listData.GetHeadPosition();
-		while ( pos )
-		{
-			DataTrainingParams* pParam = _listData.GetNext( pos );
-			ASSERT( pParam != nullptr );
+	// the decided blocks against the labels and the networks
+	std::vector< double > vecObjec( nTrainingDataCount ), vecMetal( nTrainingDataCount );
+
+	engine.Predict( &vecRows[ 0 ], ABC_FEATURE_COUNT, nullptr, nTrainingDataCount, &vecObjec[ 0 ], &vecMetal[ 0 ] );
+
+	CascadeReport report = { nTrainingDataCount, 0, 0, 0., 0, 0 };
+
+	for ( int n=0; n<nTrainingDataCount; n++ )
+	{
+		const E_CascadeDecision eDecision = CCascade::Decide( thresholds, &vecRows[ (size_t) n * ABC_FEATURE_COUNT ] );
 
-			CString strLine;
-			strLine.Format( _T("%d\t%d\t"), pParam->nCol, pParam->nRow );
+		if ( aeDecisions != nullptr )
+			aeDecisions[ n ] = eDecision;
 
-			for ( int i=0; i<ABC_FEATURE_COUNT; i++ )
-				strLine += CLU_FormatText( _T("%g\t"), pParam->adFeatures[ i ] );
+		if ( eDecision == kCascadeDecision_Uncertain )
+			continue;
 
-			for ( int i=0; i<ABC_RESULT_COUNT; i++ )
-				strLine += CLU_FormatText( _T("%g\t"), pParam->adResults[ i ] );
+		const bool bBackground = ( eDecision == kCascadeDecision_Background );
 
-			strLine.TrimRight();
-			strLine += _T("\n");
+		if ( bBackground )
+			report.nBackground ++;
+		else
+			report.nMetal ++;
 
-			file.WriteString( strLine );
-		}
+		const double* pdLabel = &vecLabels[ (size_t) n * ABC_RESULT_COUNT ];
 
-		file.Close();
+		if ( ( pdLabel[ kABCResultId_Background ] > 0. ) != bBackground || ( pdLabel[ kABCResultId_Metal ] > 0. ) == bBackground )
+			report.nLabelDiffers ++;
 
-		LOG_DEBUG( _T("Successfully write %d data to [%s]"), GetTrainingDataCount(), lpszFilePath );
+		if ( ( vecObjec[ n ] > 0. ) != bBackground || ( vecMetal[ n ] > 0. ) == bBackground )
+			report.nNetworkDiffers ++;
 	}
-	CATCH ( CException, e )
+
+	report.dSkipRate = (double)( report.nBackground + report.nMetal ) / nTrainingDataCount;
+
+	LOG_DEBUG( _T("Cascade - background min %f std %f, metal min %f contrast %f"), 
+				thresholds.dBackgroundMin, thresholds.dBackgroundStd, thresholds.dMetalMin, thresholds.dMetalContrast );
+	LOG_DEBUG( _T("Cascade - %d blocks, background %d, metal %d, skip rate %.3f, %d differ from the labels, %d from the networks"), 
+				report.nBlocks, report.nBackground, report.nMetal, report.dSkipRate, report.nLabelDiffers, report.nNetworkDiffers );
+
+	*pThresholds = thresholds;
+	*pReport = report;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// clear all the training data
+void CRegionTypeTrainer::ClearTrainingData(void)
+{
+	_pState->data.Clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// get number of data instances
+int CRegionTypeTrainer::GetTrainingDataCount(void) const
+{
+	return _pState->data.GetCount();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// load data from file
+bool CRegionTypeTrainer::AddTrainingDataFrom( LPCTSTR lpszFilePath )
+{
+	return _pState->data.Read( lpszFilePath );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// get data 
+bool CRegionTypeTrainer::GetCurrentData( RegionType arrTypes[ ABC_REGION_DIVIDE_2 ] ) const 
+{
+	_pState->data.GetTypes( arrTypes );
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// save the data to the file
+bool CRegionTypeTrainer::SaveTrainingData( LPCTSTR lpszFilePath )
+{
+	if ( GetTrainingDataCount() == 0 )
 	{
-		LOG_ERROR( _T("Can't write training data to [%s] - %s"), lpszFilePath, CLU_GetErrorMessageFromException( e ) );
-		bOk = false;
+		LOG_ERROR( _T("No data to save.") );
+		return false;
 	}
-	END_CATCH;
 
-	return bOk;
-}
\ No newline at end of file
+	return _pState->data.Write( lpszFilePath );
+}
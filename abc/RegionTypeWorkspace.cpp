@@ -0,0 +1,208 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "abc/RegionTypeWorkspace.h"
+#include "abc/FeatureBlock.h"
+#include "FeatureGen.h"
+#include "ThreadPool.h"
+
+// logger
+#include "abc.logger.h"
+
+// the heap allocations are counted with the debug heap of the CRT
+#if defined( _DEBUG ) && defined( _MSC_VER )
+#define COUNT_ALLOCATIONS
+#endif
+
+// platform
+#ifdef COUNT_ALLOCATIONS
+#include <crtdbg.h>
+#include <atomic>
+#include <mutex>
+#endif
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// counting the heap allocations of all the threads while frames are classified.
+// The workers of a pool allocate for the frame of the calling thread, so no thread is left out.
+// Frames of other workspaces overlapping a frame are counted in it too, such a frame is not checked.
+#ifdef COUNT_ALLOCATIONS
+namespace
+{
+	std::atomic< long > _nAllocations;		// of all the threads, while _nFrames > 0
+	std::atomic< long > _nFrames;			// frames being classified
+
+	std::mutex _mutexFrames;
+	long _nFramesBegun = 0;					// frames started, guarded by _mutexFrames
+
+	_CRT_ALLOC_HOOK _pfnPrevAllocHook = nullptr;
+	std::once_flag _onceAllocHook;
+
+	// the hook of the debug heap, for every thread
+	int __cdecl _allocHook( int nAllocType, void* pvData, size_t nSize, int nBlockUse, long lRequest, 
+							const unsigned char* pszFile, int nLine )
+	{
+		if ( nAllocType != _HOOK_FREE && _nFrames.load( std::memory_order_relaxed ) > 0 )
+			_nAllocations.fetch_add( 1, std::memory_order_relaxed );
+
+		if ( _pfnPrevAllocHook != nullptr )
+			return _pfnPrevAllocHook( nAllocType, pvData, nSize, nBlockUse, lRequest, pszFile, nLine );
+
+		return TRUE;
+	}
+
+	void _installAllocHook(void)
+	{
+		_pfnPrevAllocHook = _CrtSetAllocHook( _allocHook );
+	}
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// state of the workspace
+struct CRegionTypeWorkspace::WorkspaceState
+{
+	CFeatureBlock features;					// features of the frame
+	CFeatureBlock cells;					// features of the coarse grid
+	CFeatureScratch scratch;				// buffers of the feature generation
+
+	int nPoolWorkers;						// 0 for the pool of the classifier
+	CThreadPool* pPool;						// of this context, nullptr for the calling thread
+
+	// the previous frame and settings
+	int nSrcW, nSrcH, nDivide, nBitDepth, nDecimation, nWorkers, nCoarseDivide;
+	bool bSteady;
+
+	// debug builds only
+	long nAllocations;						// of all the threads when the frame started
+	long nFramesBegun;						// frames started until the frame did
+	bool bAlone;							// no other frame running when it started
+
+	WorkspaceState(void)
+		: nPoolWorkers( 0 ), pPool( nullptr )
+		, nSrcW( 0 ), nSrcH( 0 ), nDivide( 0 ), nBitDepth( 0 ), nDecimation( 0 ), nWorkers( 0 ), nCoarseDivide( 0 )
+		, bSteady( false ), nAllocations( 0 ), nFramesBegun( 0 ), bAlone( false )
+	{
+	}
+
+	~WorkspaceState(void)
+	{
+		delete pPool;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// constructor
+CRegionTypeWorkspace::CRegionTypeWorkspace(void)
+	: _pState( new WorkspaceState )
+{
+	ASSERT( _pState );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// destructor
+CRegionTypeWorkspace::~CRegionTypeWorkspace(void)
+{
+	delete _pState;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// threads of the context
+bool CRegionTypeWorkspace::SetWorkerCount( int nWorkers )
+{
+	if ( nWorkers < 0 )
+	{
+		LOG_ERROR( _T("Invalid worker count - %d"), nWorkers );
+		return false;
+	}
+
+	WorkspaceState& state = *_pState;
+
+	if ( nWorkers == state.nPoolWorkers )
+		return true;
+
+	delete state.pPool;
+	state.pPool = ( nWorkers > 1 ) ? new CThreadPool( nWorkers ) : nullptr;
+	state.nPoolWorkers = nWorkers;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// a frame starts
+void CRegionTypeWorkspace::_beginFrame( int nSrcW, int nSrcH, int nDivide, int nBitDepth, int nDecimation, int nWorkers, int nCoarseDivide )
+{
+	WorkspaceState& state = *_pState;
+
+	state.bSteady = ( state.nSrcW == nSrcW && state.nSrcH == nSrcH && state.nDivide == nDivide && state.nBitDepth == nBitDepth && 
+					  state.nDecimation == nDecimation && state.nWorkers == nWorkers && state.nCoarseDivide == nCoarseDivide );
+
+	state.nSrcW = nSrcW;
+	state.nSrcH = nSrcH;
+	state.nDivide = nDivide;
+	state.nBitDepth = nBitDepth;
+	state.nDecimation = nDecimation;
+	state.nWorkers = nWorkers;
+	state.nCoarseDivide = nCoarseDivide;
+
+#ifdef COUNT_ALLOCATIONS
+	std::call_once( _onceAllocHook, _installAllocHook );
+
+	std::lock_guard< std::mutex > lock( _mutexFrames );
+
+	state.bAlone = ( _nFrames.fetch_add( 1 ) == 0 );
+	state.nFramesBegun = ++ _nFramesBegun;
+	state.nAllocations = _nAllocations.load();
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// the frame ends
+void CRegionTypeWorkspace::_endFrame( bool bCheck )
+{
+#ifdef COUNT_ALLOCATIONS
+	const WorkspaceState& state = *_pState;
+
+	std::unique_lock< std::mutex > lock( _mutexFrames );
+
+	const long nAllocations = _nAllocations.load() - state.nAllocations;
+	const bool bAlone = state.bAlone && _nFramesBegun == state.nFramesBegun;
+	_nFrames.fetch_sub( 1 );
+
+	lock.unlock();
+
+	// the buffers of a steady frame are all there
+	ASSERT( ! bCheck || ! state.bSteady || ! bAlone || nAllocations == 0 );
+#else
+	UNREFERENCED_PARAMETER( bCheck );
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// buffers
+CFeatureBlock& CRegionTypeWorkspace::_getFeatures(void)
+{
+	return _pState->features;
+}
+
+CFeatureBlock& CRegionTypeWorkspace::_getCells(void)
+{
+	return _pState->cells;
+}
+
+CFeatureScratch* CRegionTypeWorkspace::_getScratch(void)
+{
+	return &_pState->scratch;
+}
+
+CThreadPool* CRegionTypeWorkspace::_getPool( CThreadPool* pShared ) const
+{
+	return ( _pState->nPoolWorkers == 0 ) ? pShared : _pState->pPool;
+}
@@ -0,0 +1,281 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "StageStatistics.h"
+
+// platform
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+// logger
+#include "abc.logger.h"
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW
+#endif
+
+// macro
+#define STAGE_UNITS_PER_SECOND		10000000	// 100 ns
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// buckets and names
+namespace
+{
+	// names of the stages for the log
+	const LPCTSTR _aszStages[] = 
+	{
+		_T("copy"),
+		_T("exposure"),
+		_T("local statistics"),
+		_T("block otsu"),
+		_T("global otsu"),
+		_T("features"),
+		_T("predict"),
+		_T("predict objec"),
+		_T("predict metal"),
+		_T("output"),
+		_T("total"),
+	};
+
+	static_assert( sizeof( _aszStages ) / sizeof( _aszStages[ 0 ] ) == _END_ABC_Stages, "a name for each stage" );
+
+	// highest set bit of a non-zero value
+	inline int _highestBit( UINT nValue )
+	{
+#if defined( _MSC_VER )
+		unsigned long nBit = 0;
+		::_BitScanReverse( &nBit, nValue );
+		return (int) nBit;
+#else
+		return 31 - __builtin_clz( nValue );
+#endif
+	}
+
+	// bucket of a value, exact below 16, then 8 per octave
+	inline int _bucketOf( UINT nValue )
+	{
+		if ( nValue < 16 )
+			return (int) nValue;
+
+		const int nBit = _highestBit( nValue );
+
+		return 8 * ( nBit - 2 ) + (int)( ( nValue >> ( nBit - 3 ) ) & 7 );
+	}
+
+	// largest value of a bucket
+	inline UINT64 _bucketTop( int nBucket )
+	{
+		if ( nBucket < 16 )
+			return (UINT64) nBucket;
+
+		const int nBit = nBucket / 8 + 2;
+		const UINT64 ullBottom = (UINT64)( 8 + nBucket % 8 ) << ( nBit - 3 );
+
+		return ullBottom + ( (UINT64) 1 << ( nBit - 3 ) ) - 1;
+	}
+
+	// 100 ns to microseconds
+	inline float _toMicroseconds( UINT64 ullUnits )
+	{
+		return (float)( ullUnits / 10. );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// histogram of a stage over a window
+struct CStageStatistics::Window
+{
+	std::atomic< LONGLONG > llId;						// Now() / _llWindowTicks, -1 empty
+	std::atomic< UINT > anCounts[ STAGE_HIST_BUCKETS ];	// of 100 ns units
+	std::atomic< UINT > nMax;
+
+	Window(void)
+	{
+		Clear( -1 );
+	}
+
+	void Clear( LONGLONG llNewId )
+	{
+		for ( int b=0; b<STAGE_HIST_BUCKETS; b++ )
+			anCounts[ b ].store( 0, std::memory_order_relaxed );
+
+		nMax.store( 0, std::memory_order_relaxed );
+		llId.store( llNewId );
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// constructor
+CStageStatistics::CStageStatistics(void)
+	: _pWindows( new Window[ _END_ABC_Stages * 2 ] )
+{
+	ASSERT( _pWindows );
+
+	_llFreq = Frequency();
+	_llWindowTicks = _llFreq * STAGE_WINDOW_SECONDS;
+
+	_llDumpTicks.store( 0 );
+	_llNextDump.store( 0 );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// destructor
+CStageStatistics::~CStageStatistics(void)
+{
+	delete [] _pWindows;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// record a stage
+void CStageStatistics::RecordTicks( E_ABCStage eStage, LONGLONG llTicks, LONGLONG llNow )
+{
+	ASSERT( eStage >= 0 && eStage < _END_ABC_Stages );
+
+	const double dUnits = (double) CLU_MAX( llTicks, (LONGLONG) 0 ) * STAGE_UNITS_PER_SECOND / (double) _llFreq;
+	const UINT nUnits = (UINT) CLU_MIN( dUnits, 4294967295. );
+
+	Window& window = _getWindow( eStage, llNow );
+
+	window.anCounts[ _bucketOf( nUnits ) ].fetch_add( 1, std::memory_order_relaxed );
+
+	UINT nMax = window.nMax.load( std::memory_order_relaxed );
+
+	while ( nUnits > nMax && ! window.nMax.compare_exchange_weak( nMax, nUnits, std::memory_order_relaxed ) )
+	{
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// the window of a time
+CStageStatistics::Window& CStageStatistics::_getWindow( E_ABCStage eStage, LONGLONG llNow )
+{
+	const LONGLONG llId = llNow / _llWindowTicks;
+	Window& window = _pWindows[ eStage * 2 + (int)( llId & 1 ) ];
+
+	// The first thread of a new window clears it. A late thread of the previous one adds to the new one.
+	LONGLONG llOld = window.llId.load();
+
+	if ( llOld < llId && window.llId.compare_exchange_strong( llOld, llId ) )
+		window.Clear( llId );
+
+	return window;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// percentiles of the current and the previous window
+void CStageStatistics::Get( E_ABCStage eStage, OUT StageLatency* pLatency ) const
+{
+	ASSERT( eStage >= 0 && eStage < _END_ABC_Stages );
+	ASSERT( pLatency );
+
+	const LONGLONG llId = Now() / _llWindowTicks;
+
+	UINT anCounts[ STAGE_HIST_BUCKETS ] = { 0 };
+	UINT64 ullCount = 0;
+	UINT nMax = 0;
+
+	for ( int w=0; w<2; w++ )
+	{
+		const Window& window = _pWindows[ eStage * 2 + w ];
+		const LONGLONG llWindow = window.llId.load();
+
+		if ( llWindow != llId && llWindow != llId - 1 )
+			continue;
+
+		for ( int b=0; b<STAGE_HIST_BUCKETS; b++ )
+		{
+			const UINT n = window.anCounts[ b ].load( std::memory_order_relaxed );
+
+			anCounts[ b ] += n;
+			ullCount += n;
+		}
+
+		nMax = CLU_MAX( nMax, window.nMax.load( std::memory_order_relaxed ) );
+	}
+
+	pLatency->nCount = (UINT) ullCount;
+	pLatency->fMax = _toMicroseconds( nMax );
+
+	// the top of the bucket of each percentile, the max is the top of all
+	const double adPercentiles[ 3 ] = { 0.50, 0.95, 0.99 };
+	float afValues[ 3 ] = { 0.f, 0.f, 0.f };
+
+	for ( int p=0; p<3 && ullCount > 0; p++ )
+	{
+		const UINT64 ullRank = CLU_MAX( (UINT64)( adPercentiles[ p ] * ullCount + 0.999999 ), (UINT64) 1 );
+		UINT64 ullSum = 0;
+		int b = 0;
+
+		for ( ; b<STAGE_HIST_BUCKETS - 1; b++ )
+		{
+			ullSum += anCounts[ b ];
+
+			if ( ullSum >= ullRank )
+				break;
+		}
+
+		afValues[ p ] = _toMicroseconds( CLU_MIN( _bucketTop( b ), (UINT64) nMax ) );
+	}
+
+	pLatency->fP50 = afValues[ 0 ];
+	pLatency->fP95 = afValues[ 1 ];
+	pLatency->fP99 = afValues[ 2 ];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// forget all
+void CStageStatistics::Reset(void)
+{
+	for ( int w=0; w<_END_ABC_Stages * 2; w++ )
+		_pWindows[ w ].Clear( -1 );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// period of the log
+void CStageStatistics::SetDumpPeriod( int nSeconds )
+{
+	const LONGLONG llTicks = _llFreq * CLU_MAX( nSeconds, 0 );
+
+	_llNextDump.store( Now() + llTicks );
+	_llDumpTicks.store( llTicks );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// log if the period is over
+void CStageStatistics::DumpIfDue( LONGLONG llNow )
+{
+	const LONGLONG llTicks = _llDumpTicks.load();
+
+	if ( llTicks <= 0 )
+		return;
+
+	LONGLONG llNext = _llNextDump.load();
+
+	if ( llNow < llNext )
+		return;
+
+	if ( _llNextDump.compare_exchange_strong( llNext, llNow + llTicks ) )
+		Dump();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// log the stages
+void CStageStatistics::Dump(void) const
+{
+	for ( int s=0; s<_END_ABC_Stages; s++ )
+	{
+		StageLatency latency;
+		Get( static_cast< E_ABCStage >( s ), &latency );
+
+		if ( latency.nCount == 0 )
+			continue;
+
+		LOG_DEBUG( _T("Stage %s - %u, p50 %.1f us, p95 %.1f us, p99 %.1f us, max %.1f us"), 
+					_aszStages[ s ], latency.nCount, latency.fP50, latency.fP95, latency.fP99, latency.fMax );
+	}
+}
@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+#include "abc/abc_types.h"
+
+// platform
+#include <atomic>
+
+#if ! defined( _WIN32 )
+#include <time.h>
+#endif
+
+// macro
+#define STAGE_HIST_BUCKETS			240			// 8 per octave of 100 ns, up to 7 minutes
+#define STAGE_WINDOW_SECONDS		60			// the histograms cover the last 60 to 120 s
+
+namespace comed { namespace abc
+{
+	/// <summary>
+	/// latency histograms of the stages of the classification.
+	/// Recording is lock free and can come from any thread: an atomic increment of a log scale bucket.
+	/// Each stage has two windows of STAGE_WINDOW_SECONDS, the older is cleared when a new one starts,
+	/// so the percentiles roll. A few samples at the turn of a window can be lost.
+	/// </summary>
+	class CStageStatistics
+	{
+		CL_NO_COPY_CONSTRUCTOR( CStageStatistics )
+		CL_NO_ASSIGNMENT_OPERATOR( CStageStatistics )
+
+		// internal data types
+		struct Window;
+
+	public:
+		/// <summary>
+		/// constructor, all empty
+		/// </summary>
+		CStageStatistics(void);
+
+		/// <summary>
+		/// destructor
+		/// </summary>
+		~CStageStatistics(void);
+
+		/// <summary>
+		/// monotonic timestamp of the stages, QueryPerformanceCounter or CLOCK_MONOTONIC in ns
+		/// </summary>
+		static LONGLONG Now(void)
+		{
+#if defined( _WIN32 )
+			LARGE_INTEGER ll;
+			::QueryPerformanceCounter( &ll );
+
+			return ll.QuadPart;
+#else
+			struct timespec ts;
+			::clock_gettime( CLOCK_MONOTONIC, &ts );
+
+			return (LONGLONG) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+		}
+
+		/// <summary>
+		/// ticks of Now() per second
+		/// </summary>
+		static LONGLONG Frequency(void)
+		{
+#if defined( _WIN32 )
+			LARGE_INTEGER ll;
+			::QueryPerformanceFrequency( &ll );
+
+			return ll.QuadPart;
+#else
+			return 1000000000;
+#endif
+		}
+
+		/// <summary>
+		/// record a stage from llStart to llEnd ( Now() )
+		/// </summary>
+		void Record( E_ABCStage eStage, LONGLONG llStart, LONGLONG llEnd )
+		{
+			RecordTicks( eStage, llEnd - llStart, llEnd );
+		}
+
+		/// <summary>
+		/// record llTicks of a stage ( e.g. summed over workers ) at llNow
+		/// </summary>
+		void RecordTicks( E_ABCStage eStage, LONGLONG llTicks, LONGLONG llNow );
+
+		/// <summary>
+		/// percentiles of the recent frames
+		/// </summary>
+		void Get( E_ABCStage eStage, OUT StageLatency* pLatency ) const;
+
+		/// <summary>
+		/// forget all. Not while recording.
+		/// </summary>
+		void Reset(void);
+
+		/// <summary>
+		/// log the stages every nSeconds ( 0 never ) when DumpIfDue(...) is called
+		/// </summary>
+		void SetDumpPeriod( int nSeconds );
+
+		/// <summary>
+		/// log the stages if the period is over. Only one of the threads calling it does.
+		/// </summary>
+		void DumpIfDue( LONGLONG llNow );
+
+		/// <summary>
+		/// log the stages with a count
+		/// </summary>
+		void Dump(void) const;
+
+	private:
+		// the window of llNow, cleared if it was an older one
+		Window& _getWindow( E_ABCStage eStage, LONGLONG llNow );
+
+	private:
+		LONGLONG _llFreq;
+		LONGLONG _llWindowTicks;
+
+		Window* _pWindows;							// 2 per stage
+
+		std::atomic< LONGLONG > _llDumpTicks;		// 0 never
+		std::atomic< LONGLONG > _llNextDump;
+	};
+
+}} // comed::abc
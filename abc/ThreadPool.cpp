@@ -0,0 +1,156 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "ThreadPool.h"
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// constructor
+CThreadPool::CThreadPool( int nWorkers )
+	: _aSlices( new Slice[ CLU_MAX( nWorkers, 1 ) ] )
+	, _pfnTask( nullptr )
+	, _ullGeneration( 0 )
+	, _nFinished( 0 )
+	, _bQuit( false )
+{
+	ASSERT( nWorkers >= 1 );
+
+	for ( int w=0; w<CLU_MAX( nWorkers, 1 ); w++ )
+	{
+		_aSlices[ w ].nNext = 0;
+		_aSlices[ w ].nEnd = 0;
+	}
+
+	// worker 0 is the calling thread
+	for ( int w=1; w<nWorkers; w++ )
+		_vecThreads.push_back( std::thread( &CThreadPool::_workerMain, this, w ) );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// destructor
+CThreadPool::~CThreadPool(void)
+{
+	{
+		std::lock_guard< std::mutex > lock( _mutex );
+		_bQuit = true;
+	}
+	_cvStart.notify_all();
+
+	for ( size_t i=0; i<_vecThreads.size(); i++ )
+		_vecThreads[ i ].join();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// parallel loop
+void CThreadPool::ParallelFor( int nTasks, const std::function< void( int nTask, int nWorker ) >& fnTask )
+{
+	if ( nTasks <= 0 )
+		return;
+
+	// the workers are busy with the job of another thread, this one runs alone
+	std::unique_lock< std::mutex > lockJob( _mutexJob, std::try_to_lock );
+
+	if ( ! lockJob.owns_lock() )
+	{
+		for ( int nTask=0; nTask<nTasks; nTask++ )
+			fnTask( nTask, 0 );
+		return;
+	}
+
+	const int nWorkers = GetWorkerCount();
+
+	// even slices, stealing evens out the rest
+	for ( int w=0; w<nWorkers; w++ )
+	{
+		_aSlices[ w ].nEnd  = (int)( (INT64) nTasks * ( w + 1 ) / nWorkers );
+		_aSlices[ w ].nNext = (int)( (INT64) nTasks * w / nWorkers );
+	}
+
+	if ( _vecThreads.empty() )
+	{
+		_pfnTask = &fnTask;
+		_runTasks( 0 );
+		_pfnTask = nullptr;
+		return;
+	}
+
+	// start
+	{
+		std::lock_guard< std::mutex > lock( _mutex );
+
+		_pfnTask = &fnTask;
+		_nFinished = 0;
+		_ullGeneration ++;
+	}
+	_cvStart.notify_all();
+
+	_runTasks( 0 );
+
+	// Every thread has to leave the job, fnTask is gone after return.
+	std::unique_lock< std::mutex > lock( _mutex );
+
+	while ( _nFinished < static_cast<int>( _vecThreads.size() ) )
+		_cvDone.wait( lock );
+
+	_pfnTask = nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// thread main
+void CThreadPool::_workerMain( int nWorker )
+{
+	UINT64 ullGeneration = 0;
+
+	for ( ;; )
+	{
+		{
+			std::unique_lock< std::mutex > lock( _mutex );
+
+			while ( ! _bQuit && _ullGeneration == ullGeneration )
+				_cvStart.wait( lock );
+
+			if ( _bQuit )
+				return;
+
+			ullGeneration = _ullGeneration;
+		}
+
+		_runTasks( nWorker );
+
+		{
+			std::lock_guard< std::mutex > lock( _mutex );
+			_nFinished ++;
+		}
+		_cvDone.notify_one();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// own slice first, then steal from the next ones
+void CThreadPool::_runTasks( int nWorker )
+{
+	const int nWorkers = GetWorkerCount();
+	const std::function< void( int, int ) >& fnTask = *_pfnTask;
+
+	for ( int k=0; k<nWorkers; k++ )
+	{
+		Slice& slice = _aSlices[ ( nWorker + k ) % nWorkers ];
+
+		for ( ;; )
+		{
+			const int nTask = slice.nNext.fetch_add( 1 );
+
+			if ( nTask >= slice.nEnd )
+				break;
+
+			fnTask( nTask, nWorker );
+		}
+	}
+}
@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+
+// platform
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace comed { namespace abc
+{
+	/// <summary>
+	/// persistent worker threads for small parallel loops.
+	/// Tasks are split into one slice per worker, and a worker with an empty slice steals from the others.
+	/// The calling thread is worker 0, so a pool of 1 worker has no thread at all.
+	/// </summary>
+	class CThreadPool
+	{
+		CL_NO_COPY_CONSTRUCTOR( CThreadPool )
+		CL_NO_ASSIGNMENT_OPERATOR( CThreadPool )
+
+	public:
+		/// <summary>
+		/// constructor, nWorkers including the calling thread
+		/// </summary>
+		explicit CThreadPool( int nWorkers );
+
+		/// <summary>
+		/// destructor, joins the threads
+		/// </summary>
+		~CThreadPool(void);
+
+		/// <summary>
+		/// number of workers including the calling thread
+		/// </summary>
+		int GetWorkerCount(void) const			{ return static_cast<int>( _vecThreads.size() ) + 1; }
+
+		/// <summary>
+		/// run fnTask( nTask, nWorker ) for nTask in [0, nTasks) and wait for all of them.
+		/// nWorker is in [0, GetWorkerCount()). A call while another thread has the workers runs all its tasks
+		/// on the calling thread as worker 0, it does not wait for the other job.
+		/// </summary>
+		void ParallelFor( int nTasks, const std::function< void( int nTask, int nWorker ) >& fnTask );
+
+	private:
+		// thread main
+		void _workerMain( int nWorker );
+
+		// run tasks until no slice has any left
+		void _runTasks( int nWorker );
+
+	private:
+		// tasks [nNext, nEnd) of a worker. Claimed by fetch_add, by the owner or a thief.
+		struct Slice
+		{
+			std::atomic< int > nNext;
+			int nEnd;
+			char _padding[ 64 - sizeof(int) * 2 ];		// one cache line each
+		};
+
+		std::vector< std::thread > _vecThreads;
+		std::unique_ptr< Slice[] > _aSlices;
+
+		std::mutex _mutexJob;							// the job having the workers
+		std::mutex _mutex;
+		std::condition_variable _cvStart, _cvDone;
+
+		const std::function< void( int, int ) >* _pfnTask;
+		UINT64 _ullGeneration;							// incremented for each job
+		int _nFinished;									// threads done with the current job
+		bool _bQuit;
+	};
+}} // comed::abc
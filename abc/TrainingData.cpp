@@ -0,0 +1,255 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "abc_core.h"
+#include "TrainingData.h"
+#include "abc/FeatureBlock.h"
+
+// platform
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// logger
+#include "abc.logger.h"
+
+using namespace comed::abc;
+
+#if defined( _DEBUG ) && defined( DEBUG_NEW )
+#define new DEBUG_NEW
+#endif
+
+#define DATA_FILE_VERSION			"CXVIEW3.ABC.TRAININGDATA.V.1"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// blocks of a frame
+bool CTrainingData::Add( const CFeatureBlock& features, const RegionType arrTypes[ ABC_REGION_DIVIDE_2 ] )
+{
+	ASSERT( arrTypes != nullptr );
+
+	if ( features.GetBlockCount() != ABC_REGION_DIVIDE_2 )
+	{
+		LOG_ERROR( _T("Features of %d blocks to train, %d needed"), features.GetBlockCount(), ABC_REGION_DIVIDE_2 );
+		return false;
+	}
+
+	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
+	{
+		const int bx = bi % ABC_REGION_DIVIDE;
+		const int by = bi / ABC_REGION_DIVIDE;
+
+		// ignore the boundary blocks
+		if ( bx == 0 || bx == ABC_REGION_DIVIDE - 1 || by == 0 || by == ABC_REGION_DIVIDE - 1 )
+			continue;
+
+		TrainingRow row;
+
+		row.nCol = bx;
+		row.nRow = by;
+
+		for ( int j=0; j<ABC_FEATURE_COUNT; j++ )
+			row.adFeatures[ j ] = features.Get( bi, j );
+
+		row.adResults[ kABCResultId_Metal      ] = arrTypes[ bi ].bMetal      ? 1. : -1.;
+		row.adResults[ kABCResultId_Background ] = arrTypes[ bi ].bBackground ? 1. : -1.;
+
+		_vecRows.push_back( row );
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// a line of a file
+bool CTrainingData::_parse( const char* pszLine, TrainingRow* pRow )
+{
+	ASSERT( pszLine != nullptr && pRow != nullptr );
+
+	// column, row, features and labels
+	std::istringstream stream( pszLine );
+	double adValues[ 2 + ABC_FEATURE_COUNT + ABC_RESULT_COUNT + 1 ];
+	int nCount = 0;
+
+	while ( nCount < (int)( sizeof( adValues ) / sizeof( double ) ) && stream >> adValues[ nCount ] )
+		nCount ++;
+
+	if ( ! stream.eof() )
+		return false;
+
+	const int nFeatures = nCount - 2 - ABC_RESULT_COUNT;
+
+	if ( nFeatures != ABC_FEATURE_COUNT && nFeatures != TRAINING_LEGACY_FEATURE_COUNT )
+		return false;
+
+	pRow->nCol = (int) adValues[ 0 ];
+	pRow->nRow = (int) adValues[ 1 ];
+
+	const double* pdFeatures = &adValues[ 2 ];
+
+	if ( nFeatures == ABC_FEATURE_COUNT )
+	{
+		memcpy( pRow->adFeatures, pdFeatures, sizeof( pRow->adFeatures ) );
+	}
+	else
+	{
+		// the global features but kV and mA, then the local ones
+		const int nGlobal = kABCFeatureId_Global_KV;
+
+		memcpy( pRow->adFeatures, pdFeatures, nGlobal * sizeof( double ) );
+		pRow->adFeatures[ kABCFeatureId_Global_KV ] = 0.;
+		pRow->adFeatures[ kABCFeatureId_Global_MA ] = 0.;
+		memcpy( &pRow->adFeatures[ kABCFeatureId_Local_Otsu ], &pdFeatures[ nGlobal ], ( nFeatures - nGlobal ) * sizeof( double ) );
+	}
+
+	memcpy( pRow->adResults, &pdFeatures[ nFeatures ], sizeof( pRow->adResults ) );
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// blocks of a file
+bool CTrainingData::Read( LPCTSTR lpszFilePath )
+{
+	std::ifstream file( lpszFilePath );
+
+	if ( ! file )
+	{
+		LOG_ERROR( _T("Can't open training data [%s]"), lpszFilePath );
+		return false;
+	}
+
+	std::vector< TrainingRow > vecRows;
+	std::string strLine;
+	int nLineCount = 0;
+	bool bFirstLineParsed = false;
+
+	while ( std::getline( file, strLine ) )
+	{
+		nLineCount ++;
+
+		// trim
+		const size_t nFirst = strLine.find_first_not_of( " \t\r\n" );
+		if ( nFirst == std::string::npos )
+			continue;
+
+		strLine = strLine.substr( nFirst, strLine.find_last_not_of( " \t\r\n" ) + 1 - nFirst );
+
+		if ( ! bFirstLineParsed )
+		{
+			bFirstLineParsed = true;
+
+			if ( strLine == DATA_FILE_VERSION )
+				continue;
+		}
+
+		TrainingRow row;
+
+		if ( ! _parse( strLine.c_str(), &row ) )
+		{
+			LOG_ERROR( _T("Can't read line %d from [%s]"), nLineCount, lpszFilePath );
+			return false;
+		}
+
+		// ignore boundary blocks
+		if ( row.nCol <= 0 || row.nCol >= ABC_REGION_DIVIDE - 1 || row.nRow <= 0 || row.nRow >= ABC_REGION_DIVIDE - 1 )
+			continue;
+
+		vecRows.push_back( row );
+	}
+
+	if ( file.bad() )
+	{
+		LOG_ERROR( _T("Can't read training data from [%s]"), lpszFilePath );
+		return false;
+	}
+
+	_vecRows.insert( _vecRows.end(), vecRows.begin(), vecRows.end() );
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// all blocks to a file
+bool CTrainingData::Write( LPCTSTR lpszFilePath ) const
+{
+	std::ofstream file( lpszFilePath );
+
+	if ( ! file )
+	{
+		LOG_ERROR( _T("Can't write training data to [%s]"), lpszFilePath );
+		return false;
+	}
+
+	// version, then the blocks as %g
+	file << DATA_FILE_VERSION << "\n";
+
+	for ( size_t n=0; n<_vecRows.size(); n++ )
+	{
+		const TrainingRow& row = _vecRows[ n ];
+
+		file << row.nCol << "\t" << row.nRow;
+
+		for ( int i=0; i<ABC_FEATURE_COUNT; i++ )
+			file << "\t" << row.adFeatures[ i ];
+
+		for ( int i=0; i<ABC_RESULT_COUNT; i++ )
+			file << "\t" << row.adResults[ i ];
+
+		file << "\n";
+	}
+
+	file.close();
+
+	if ( ! file )
+	{
+		LOG_ERROR( _T("Can't write training data to [%s]"), lpszFilePath );
+		return false;
+	}
+
+	LOG_DEBUG( _T("Successfully write %d data to [%s]"), GetCount(), lpszFilePath );
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// labels by the place of the blocks
+void CTrainingData::GetTypes( RegionType arrTypes[ ABC_REGION_DIVIDE_2 ] ) const
+{
+	ASSERT( arrTypes != nullptr );
+
+	for ( int bi=0; bi<ABC_REGION_DIVIDE_2; bi++ )
+	{
+		arrTypes[ bi ].bBackground = false;
+		arrTypes[ bi ].bMetal = false;
+	}
+
+	for ( size_t n=0; n<_vecRows.size(); n++ )
+	{
+		const TrainingRow& row = _vecRows[ n ];
+		const int bi = row.nCol + row.nRow * ABC_REGION_DIVIDE;
+
+		arrTypes[ bi ].bBackground = row.adResults[ kABCResultId_Background ] > 0.0;
+		arrTypes[ bi ].bMetal      = row.adResults[ kABCResultId_Metal      ] > 0.0;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// rows of the features and the labels
+void CTrainingData::GetRows( std::vector< double >* pvecRows, std::vector< double >* pvecLabels ) const
+{
+	ASSERT( pvecRows != nullptr );
+
+	pvecRows->resize( _vecRows.size() * ABC_FEATURE_COUNT );
+
+	if ( pvecLabels )
+		pvecLabels->resize( _vecRows.size() * ABC_RESULT_COUNT );
+
+	for ( size_t n=0; n<_vecRows.size(); n++ )
+	{
+		memcpy( &( *pvecRows )[ n * ABC_FEATURE_COUNT ], _vecRows[ n ].adFeatures, sizeof( _vecRows[ n ].adFeatures ) );
+
+		if ( pvecLabels )
+			memcpy( &( *pvecLabels )[ n * ABC_RESULT_COUNT ], _vecRows[ n ].adResults, sizeof( _vecRows[ n ].adResults ) );
+	}
+}
@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+#include "abc/abc_types.h"
+
+// platform
+#include <vector>
+
+// forward declaration
+namespace comed { namespace abc { class CFeatureBlock; }}
+
+// macro
+#define TRAINING_LEGACY_FEATURE_COUNT	12			// features of the data files before kV and mA
+
+namespace comed { namespace abc
+{
+	/// <summary>
+	/// a block of the training data
+	/// </summary>
+	struct TrainingRow
+	{
+		int nCol, nRow;
+		double adFeatures[ ABC_FEATURE_COUNT ];
+		double adResults[ ABC_RESULT_COUNT ];			// 1 or -1, by kABCResultId_...
+	};
+
+	/// <summary>
+	/// training data of the region classifier, the blocks of the default grid but its boundary.
+	/// The file is a version line, then a line a block: its column, row, features and labels separated by tabs.
+	/// Lines of 12 features ( the files before kV and mA ) are read with 0 for those two, as the classifier predicts.
+	/// </summary>
+	class CTrainingData
+	{
+		CL_NO_COPY_CONSTRUCTOR( CTrainingData )
+		CL_NO_ASSIGNMENT_OPERATOR( CTrainingData )
+
+	public:
+		/// <summary>
+		/// constructor, no data
+		/// </summary>
+		CTrainingData(void)							{}
+
+		/// <summary>
+		/// add the blocks of the features of a frame ( ABC_REGION_DIVIDE_2 blocks ) labeled by arrTypes
+		/// </summary>
+		bool Add( const CFeatureBlock& features, const RegionType arrTypes[ ABC_REGION_DIVIDE_2 ] );
+
+		/// <summary>
+		/// add the blocks of a file. Nothing is added if a line can not be read.
+		/// </summary>
+		bool Read( LPCTSTR lpszFilePath );
+
+		/// <summary>
+		/// write all blocks to a file, with 14 features
+		/// </summary>
+		bool Write( LPCTSTR lpszFilePath ) const;
+
+		/// <summary>
+		/// forget all blocks
+		/// </summary>
+		void Clear(void)							{ _vecRows.clear(); }
+
+		/// <summary>
+		/// number of blocks
+		/// </summary>
+		int GetCount(void) const					{ return (int) _vecRows.size(); }
+
+		/// <summary>
+		/// a block
+		/// </summary>
+		const TrainingRow& Get( int n ) const		{ ASSERT( n >= 0 && n < GetCount() ); return _vecRows[ n ]; }
+
+		/// <summary>
+		/// labels of the blocks by their place in the grid, the last block added for a place. false for the others.
+		/// </summary>
+		void GetTypes( OUT RegionType arrTypes[ ABC_REGION_DIVIDE_2 ] ) const;
+
+		/// <summary>
+		/// features ( ABC_FEATURE_COUNT a row ) and labels ( ABC_RESULT_COUNT a row ) of all blocks as row major matrices
+		/// </summary>
+		void GetRows( OUT std::vector< double >* pvecRows, OUT std::vector< double >* pvecLabels ) const;
+
+	private:
+		// a line of a file, false if it is not a block
+		static bool _parse( const char* pszLine, TrainingRow* pRow );
+
+	private:
+		std::vector< TrainingRow > _vecRows;
+	};
+}} // comed::abc
@@ -3,10 +3,27 @@
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#if ! defined( ABC_STANDALONE )
+
 // set logger namespace
 #define _LOGCL_MODULE_NAMESPACE				cxview3
 
 // include utility inline header
 #include "clUtils/log_utils.inl"
 
+#else
+
+// The core library logs errors to stderr, and debug messages only if built with ABC_LOG_DEBUG.
+#include <cstdio>
+
+#define LOG_ERROR( ... )					( fprintf( stderr, __VA_ARGS__ ), fputc( '\n', stderr ) )
+
+#if defined( ABC_LOG_DEBUG )
+#define LOG_DEBUG( ... )					( fprintf( stderr, __VA_ARGS__ ), fputc( '\n', stderr ) )
+#else
+#define LOG_DEBUG( ... )					do { if ( false ) fprintf( stderr, __VA_ARGS__ ); } while ( 0 )
+#endif
+
+#endif
+
 
@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// First include of the translation units of the core library, instead of stdafx.h.
+// They do not use the precompiled header of the MFC DLL, so the same sources build without MFC ( ABC_STANDALONE ).
+#if ! defined( ABC_STANDALONE )
+#include "stdafx.h"
+#endif
+
+#include "abc/abc_platform.h"
@@ -0,0 +1,139 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+#include "abc/abc_types.h"
+
+// platform
+#include <vector>
+
+namespace comed { namespace abc
+{
+	/// <summary>
+	/// layout of a feature block
+	/// </summary>
+	enum E_ABCFeatureLayout
+	{
+		kABCFeatureLayout_RowMajor = 0,		// double, ABC_FEATURE_COUNT per block, block after block
+		kABCFeatureLayout_SoA32,			// float, one column of all blocks per feature. Not for the feature generation
+											// and the networks, they make and read row major blocks
+
+		_END_ABC_FeatureLayouts
+	};
+
+	/// <summary>
+	/// features of all blocks of a frame in one contiguous buffer.
+	/// Keep one and pass it again, the buffer is reused while the block count is the same.
+	/// </summary>
+	class CFeatureBlock
+	{
+	public:
+		/// <summary>
+		/// empty block
+		/// </summary>
+		CFeatureBlock(void)
+			: _nBlocks( 0 ), _eLayout( kABCFeatureLayout_RowMajor )
+		{
+		}
+
+		/// <summary>
+		/// nBlocks blocks, all zero
+		/// </summary>
+		explicit CFeatureBlock( int nBlocks, E_ABCFeatureLayout eLayout = kABCFeatureLayout_RowMajor )
+			: _nBlocks( 0 ), _eLayout( eLayout )
+		{
+			Create( nBlocks, eLayout );
+		}
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// public methods
+	public:
+		/// <summary>
+		/// (re)create with nBlocks blocks, all zero. No allocation if the size did not grow.
+		/// </summary>
+		void Create( int nBlocks, E_ABCFeatureLayout eLayout )
+		{
+			ASSERT( nBlocks >= 0 );
+
+			_nBlocks = nBlocks;
+			_eLayout = eLayout;
+
+			if ( eLayout == kABCFeatureLayout_RowMajor )
+			{
+				_vecRows.assign( (size_t) nBlocks * ABC_FEATURE_COUNT, 0. );
+				_vecColumns.clear();
+			}
+			else
+			{
+				_vecColumns.assign( (size_t) nBlocks * ABC_FEATURE_COUNT, 0.f );
+				_vecRows.clear();
+			}
+		}
+
+		int GetBlockCount(void) const				{ return _nBlocks; }
+		E_ABCFeatureLayout GetLayout(void) const	{ return _eLayout; }
+
+		/// <summary>
+		/// a feature of a block
+		/// </summary>
+		double Get( int nBlock, int nFeature ) const
+		{
+			ASSERT( nBlock >= 0 && nBlock < _nBlocks );
+			ASSERT( nFeature >= 0 && nFeature < ABC_FEATURE_COUNT );
+
+			if ( _eLayout == kABCFeatureLayout_RowMajor )
+				return _vecRows[ nBlock * ABC_FEATURE_COUNT + nFeature ];
+
+			return (double) _vecColumns[ nFeature * _nBlocks + nBlock ];
+		}
+
+		void Set( int nBlock, int nFeature, double dValue )
+		{
+			ASSERT( nBlock >= 0 && nBlock < _nBlocks );
+			ASSERT( nFeature >= 0 && nFeature < ABC_FEATURE_COUNT );
+
+			if ( _eLayout == kABCFeatureLayout_RowMajor )
+				_vecRows[ nBlock * ABC_FEATURE_COUNT + nFeature ] = dValue;
+			else
+				_vecColumns[ nFeature * _nBlocks + nBlock ] = (float) dValue;
+		}
+
+		/// <summary>
+		/// set a feature of every block, e.g. kV and mA
+		/// </summary>
+		void SetAll( int nFeature, double dValue )
+		{
+			for ( int bi=0; bi<_nBlocks; bi++ )
+				Set( bi, nFeature, dValue );
+		}
+
+		/// <summary>
+		/// row major data, GetBlockCount() x ABC_FEATURE_COUNT. nullptr unless kABCFeatureLayout_RowMajor
+		/// </summary>
+		const double* GetRows(void) const
+		{
+			return ( _eLayout == kABCFeatureLayout_RowMajor && _nBlocks > 0 ) ? &_vecRows[ 0 ] : nullptr;
+		}
+
+		/// <summary>
+		/// one feature of all blocks. nullptr unless kABCFeatureLayout_SoA32
+		/// </summary>
+		const float* GetColumn( int nFeature ) const
+		{
+			ASSERT( nFeature >= 0 && nFeature < ABC_FEATURE_COUNT );
+
+			return ( _eLayout == kABCFeatureLayout_SoA32 && _nBlocks > 0 ) ? &_vecColumns[ nFeature * _nBlocks ] : nullptr;
+		}
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private data
+	private:
+		int _nBlocks;
+		E_ABCFeatureLayout _eLayout;
+
+		std::vector< double > _vecRows;
+		std::vector< float > _vecColumns;
+	};
+}} // comed::abc
@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+
+// platform
+#include <memory>
+
+namespace comed { namespace abc
+{
+	/// <summary>
+	/// immutable, reference counted view of a 16 bit gray frame.
+	/// The owner ( e.g. a slot of the acquisition ring buffer ) must not write the pixels while any snapshot holds them,
+	/// so the features can be computed in place, without copying or locking.
+	/// </summary>
+	class CFrameSnapshot
+	{
+	public:
+		/// <summary>
+		/// empty snapshot
+		/// </summary>
+		CFrameSnapshot(void)
+			: _nWidth( 0 ), _nHeight( 0 ), _nStrider( 0 ), _nBitDepth( 16 )
+		{
+		}
+
+		/// <summary>
+		/// snapshot sharing the ownership of the pixels. nStrider is in pixels.
+		/// nBitDepth is of the detector ( 12, 14 or 16 ), the merged value histograms are sized to it.
+		/// </summary>
+		CFrameSnapshot( std::shared_ptr< const WORD > spPixels, int nWidth, int nHeight, int nStrider, int nBitDepth = 16 )
+			: _spPixels( spPixels ), _nWidth( nWidth ), _nHeight( nHeight ), _nStrider( nStrider ), _nBitDepth( nBitDepth )
+		{
+			ASSERT( nStrider >= nWidth );
+			ASSERT( nBitDepth >= 8 && nBitDepth <= 16 );
+		}
+
+		/// <summary>
+		/// snapshot not owning the pixels. The caller keeps them alive and unchanged while it is used.
+		/// </summary>
+		CFrameSnapshot( const WORD* pwPixels, int nWidth, int nHeight, int nStrider, int nBitDepth = 16 )
+			: _spPixels( std::shared_ptr< const WORD >(), pwPixels )
+			, _nWidth( nWidth ), _nHeight( nHeight ), _nStrider( nStrider ), _nBitDepth( nBitDepth )
+		{
+			ASSERT( nStrider >= nWidth );
+			ASSERT( nBitDepth >= 8 && nBitDepth <= 16 );
+		}
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// public methods
+	public:
+		bool IsValid(void) const					{ return _spPixels.get() != nullptr && _nWidth > 0 && _nHeight > 0; }
+
+		int GetWidth(void) const					{ return _nWidth; }
+		int GetHeight(void) const					{ return _nHeight; }
+		int GetStrider(void) const					{ return _nStrider; }
+		int GetBitDepth(void) const					{ return _nBitDepth; }
+
+		const WORD* GetPixelDataWord(void) const	{ return _spPixels.get(); }
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private data
+	private:
+		std::shared_ptr< const WORD > _spPixels;
+		int _nWidth, _nHeight, _nStrider;
+		int _nBitDepth;
+	};
+}} // comed::abc
@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+#include "abc/abc_types.h"
+
+// forward declaration
+namespace comed { namespace abc { class CRegionTypeClassifier; class CFrameSnapshot; }}
+
+namespace comed { namespace abc
+{
+	/// <summary>
+	/// result of one frame of CRegionTypeBatch
+	/// </summary>
+	struct RegionTypeBatchResult
+	{
+		RegionType arrResult[ ABC_REGION_DIVIDE_2 ];
+
+		int nNumObjBlocks;
+		int nMeanObjBlocks;
+		int nMinObj;
+		int nMaxObj;
+	};
+
+	/// <summary>
+	/// region classifier for many frames at once, e.g. the re-analysis of recorded studies.
+	/// The features of the frames are computed in parallel, one frame per worker, then the blocks of all frames
+	/// are predicted as one matrix. The results are those of CRegionTypeClassifier::ClassfyRegion(...) frame by frame.
+	/// The buffers are kept from one batch to the next, one instance per thread.
+	/// </summary>
+	class AFX_EXT_CLASS CRegionTypeBatch
+	{
+		CL_NO_COPY_CONSTRUCTOR( CRegionTypeBatch )
+		CL_NO_ASSIGNMENT_OPERATOR( CRegionTypeBatch )
+
+		// internal data types
+		struct BatchState;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// constructor and destrucrtor
+	public:
+		/// <summary>
+		/// constructor, the classifier has to live longer than the batch.
+		/// nWorkers threads including the calling one, 0 for one per core.
+		/// </summary>
+		explicit CRegionTypeBatch( const CRegionTypeClassifier& classifier, int nWorkers = 0 );
+
+		/// <summary>
+		/// destructor
+		/// </summary>
+		virtual ~CRegionTypeBatch(void);
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// public methods
+	public:
+
+		/// <summary>
+		/// classfy the region of nFrames frames into aResults, one per frame.
+		/// false if a frame is not valid, nothing is classified then.
+		/// </summary>
+		bool ClassfyRegions(
+				IN		const CFrameSnapshot aFrames[], int nFrames,
+				OUT		RegionTypeBatchResult aResults[]
+			);
+
+		/// <summary>
+		/// threads including the calling one
+		/// </summary>
+		int GetWorkerCount(void) const;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private data
+	private:
+		const CRegionTypeClassifier& _classifier;
+
+		BatchState* _pState;
+	};
+
+}} // comed::abc
@@ -3,23 +3,60 @@
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 
-#include "clUtils/defines.h"
+#include "abc/abc_platform.h"
 #include "abc/abc_types.h"
 
 // forward declaration
-class CvANN_MLP;
 namespace cl { namespace img { class CImageBuf; }}
+namespace comed { namespace abc { class CFrameSnapshot; class CThreadPool; class CFeatureBlock; class CRegionTypeWorkspace; class CStageStatistics; struct FeatureGenOptions; }}
 
 namespace comed { namespace abc 
 {
 	/// <summary>
-	/// region classifier with pre-trained data
+	/// region classifier with pre-trained data.
+	/// Initialize and set it up first. ClassfyRegion(...) only reads it then, so several threads ( detectors, replay )
+	/// can share one classifier and one copy of the weights, each with a CRegionTypeWorkspace of its own.
+	/// The native engine needs no lock. Networks predicted by OpenCV are, one thread at a time.
+	/// The networks can be replaced while frames are classified ( Initialize... ), a frame finishes on the ones it started with.
 	/// </summary>
 	class AFX_EXT_CLASS CRegionTypeClassifier
 	{
 		CL_NO_COPY_CONSTRUCTOR( CRegionTypeClassifier )
 		CL_NO_ASSIGNMENT_OPERATOR( CRegionTypeClassifier )
 
+		// internal data types
+		struct Model;
+		struct ModelHandle;
+		struct SharedWorkspace;
+
+		// the published networks, held for a frame. They are not freed while held ( the read side of RCU ).
+		class ModelGuard
+		{
+			CL_NO_COPY_CONSTRUCTOR( ModelGuard )
+			CL_NO_ASSIGNMENT_OPERATOR( ModelGuard )
+
+		public:
+			explicit ModelGuard( const CRegionTypeClassifier& classifier );
+			~ModelGuard(void);
+
+			const Model& Get(void) const		{ return *_pModel; }
+			UINT GetVersion(void) const;
+
+		private:
+			ModelHandle* _pHandle;
+			const Model* _pModel;
+			int _nSide;						// readers of the epoch it was taken in
+		};
+
+		// predicts the changed blocks of a stream only
+		friend class CRegionTypeStream;
+
+		// predicts on a thread of its own
+		friend class CRegionTypePipeline;
+
+		// predicts the frames of a batch together
+		friend class CRegionTypeBatch;
+
 	public:
 		/// <summary>
 		/// default constructor
@@ -34,27 +71,258 @@ namespace comed { namespace abc
 	public:
 
 		/// <summary>
-		/// initialize the classfier with the pre-trained data
+		/// initialize the classfier with the pre-trained data.
+		/// Networks of one hidden layer are predicted by the native engine, others by OpenCV.
+		/// Not needed if the networks are built in ( ABC_BUILTIN_MLP ).
+		/// They are loaded and checked aside, then replace the current ones at once, so it can be called while classifying.
+		/// Frames running finish on the previous networks, which are freed after them. They are kept if loading fails.
 		/// </summary>
 		bool Initialize( LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal );
 
+		/// <summary>
+		/// initialize the classfier with a model file of CRegionTypeTrainer::SaveTrainingResultAsModel(...).
+		/// The file is mapped read only and predicted in place, without OpenCV. It replaces the networks as above.
+		/// </summary>
+		bool Initialize( LPCTSTR lpszModelPath );
+
+		/// <summary>
+		/// Initialize( lpszResultPath_Objec, lpszResultPath_Metal ) on a background thread, for networks re-trained 
+		/// while frames are classified. false if networks are still loading. GetModelVersion() tells when they are replaced.
+		/// </summary>
+		bool InitializeAsync( LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal );
+
+		/// <summary>
+		/// true while InitializeAsync(...) is loading
+		/// </summary>
+		bool IsInitializing(void) const;
+
+		/// <summary>
+		/// version of the networks, counted up each time they are replaced. 0 for none or the built-in ones.
+		/// </summary>
+		UINT GetModelVersion(void) const;
+
+		/// <summary>
+		/// sampling of the frames. nDecimation is 1, 2 or 4, 0 ( default ) halves frames of 1 MP or more.
+		/// </summary>
+		bool SetSampling( int nDecimation, E_ABCSampling eSampling );
+
+		/// <summary>
+		/// threads for the feature generation, including the calling one. 1 ( default ) runs on the calling thread only.
+		/// Not while ClassfyRegion(...) is running.
+		/// </summary>
+		bool SetWorkerCount( int nWorkers );
+
+		/// <summary>
+		/// collimator field. Blocks outside it are not computed, they are background and not in the global features.
+		/// prcField is needed for kABCCollimation_Rect, in pixels of the frame.
+		/// </summary>
+		bool SetCollimation( E_ABCCollimation eCollimation, const RECT* prcField = nullptr );
+
+		/// <summary>
+		/// exposed blocks of the default grid, for kABCCollimation_Mask. Other grids use all blocks.
+		/// </summary>
+		void SetExposureMask( const bool abExposed[ ABC_REGION_DIVIDE_2 ] );
+
+		/// <summary>
+		/// coarse to fine prediction. A nCoarseDivide x nCoarseDivide grid ( 4 or 8, 0 to disable ) is predicted first
+		/// from the block statistics aggregated upwards. Only cells with an output within dMargin of 0 or with blocks 
+		/// of much different means are predicted block by block, the other blocks take the result of their cell.
+		/// </summary>
+		bool SetCoarseToFine( int nCoarseDivide, double dMargin = 0.5 );
+
+		/// <summary>
+		/// arithmetic of the native engine, after Initialize(...). afInputRange is of CRegionTypeTrainer::CalibrateQuantization(...),
+		/// nullptr for 1. Not for networks predicted by OpenCV. Networks loaded later are quantized the same.
+		/// The quantized networks are a new version ( GetModelVersion() ), the frames running finish on the previous one.
+		/// </summary>
+		bool SetPrecision( E_ABCPrecision ePrecision, const float afInputRange[ ABC_FEATURE_COUNT ] = nullptr );
+
+		/// <summary>
+		/// rule cascade in front of the networks, with the thresholds of CRegionTypeTrainer::FitCascade(...).
+		/// The obvious blocks are decided from their local statistics, only the others are predicted. nullptr ( default ) 
+		/// predicts all blocks. Not the cells of the coarse grid, the rules are of blocks. A CRegionTypeStream predicts
+		/// all its blocks again after a change. Not while ClassfyRegion(...) is running.
+		/// </summary>
+		void SetCascade( const CascadeThresholds* pThresholds );
+
+		/// <summary>
+		/// latency of the stages of ClassfyRegion(...), on by default. The stages are logged every nDumpSeconds ( 0 never ).
+		/// Not while ClassfyRegion(...) is running.
+		/// </summary>
+		void SetInstrumentation( bool bEnable, int nDumpSeconds = 0 );
+
+		/// <summary>
+		/// latency of a stage over the last minute or two, of all the threads classifying with this classifier
+		/// </summary>
+		void GetStageLatency( E_ABCStage eStage, OUT StageLatency* pLatency ) const;
+
+		/// <summary>
+		/// forget the latency of the stages. Not while ClassfyRegion(...) is running.
+		/// </summary>
+		void ResetStageLatency(void);
+
+#if ! defined( ABC_STANDALONE )
 		/// <summary>
 		/// classfy the region
 		/// </summary>
 		bool ClassfyRegion( 
 				IN		const cl::img::CImageBuf& img, 
-				OUT		RegionType arrResult[ ABC_REGION_DIVIDE ],
+				OUT		RegionType arrResult[ ABC_REGION_DIVIDE_2 ],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			) const;
+#endif
+
+		/// <summary>
+		/// classfy the region of a frame snapshot, without copying it
+		/// </summary>
+		bool ClassfyRegion( 
+				IN		const CFrameSnapshot& frame, 
+				OUT		RegionType arrResult[ ABC_REGION_DIVIDE_2 ],
 				OUT		int* pnNumObjBlocks,
 				OUT		int* pnMeanObjBlocks,
 				OUT		int* pnMinObj,
 				OUT		int* pnMaxObj
 			) const;
 
+		/// <summary>
+		/// classfy the region of a frame snapshot on a nDivide x nDivide grid ( 8, 16 or 32 ).
+		/// arrResult has nDivide x nDivide items.
+		/// </summary>
+		bool ClassfyRegion( 
+				IN		const CFrameSnapshot& frame, int nDivide,
+				OUT		RegionType arrResult[],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			) const;
+
+		/// <summary>
+		/// classfy the region with the buffers of pWorkspace. The other overloads share a workspace of the classifier,
+		/// a thread finding it busy makes one for the frame. With a workspace kept by the caller the frames of the same size allocate nothing.
+		/// </summary>
+		bool ClassfyRegion( 
+				IN		const CFrameSnapshot& frame, 
+				IN OUT	CRegionTypeWorkspace* pWorkspace,
+				OUT		RegionType arrResult[ ABC_REGION_DIVIDE_2 ],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			) const;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private methods
+	private:
+		template< int DIVIDE >
+		bool _classfyRegion( 
+				IN		const cl::img::CImageBuf* pImg, const CFrameSnapshot* pFrame, CRegionTypeWorkspace* pWorkspace,
+				OUT		RegionType arrResult[],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			) const;
+
+		// _classfyRegion(...) with the workspace of the classifier, or a new one while another thread has it
+		template< int DIVIDE >
+		bool _classfyShared( 
+				IN		const cl::img::CImageBuf* pImg, const CFrameSnapshot* pFrame,
+				OUT		RegionType arrResult[],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			) const;
+
+		// check the networks, quantize them as set and make them the current ones. pModel is taken.
+		bool _publishModel( Model* pModel );
+
+		// check the networks and make them the current ones, as they are. pModel is taken, mutexPublish held.
+		bool _replaceModel( Model* pModel );
+
+		// options of the feature generation
+		FeatureGenOptions _getFeatureGenOptions(void) const;
+
+		// latency of the stages, nullptr if not instrumented
+		CStageStatistics* _getStages(void) const		{ return _bInstrument ? _pStages : nullptr; }
+
+		// exposed blocks of a frame into abExposed, nullptr if all of them are
+		template< int DIVIDE >
+		const bool* _getExposure( 
+				IN		const WORD* pwSrc, int nSrcW, int nSrcH, int nStrider, 
+				OUT		bool abExposed[] 
+			) const;
+
+		// predict the exposed non-boundary blocks, coarse to fine if enabled ( the features of the cells into pCells )
+		template< int DIVIDE >
+		void _predictBlocks( 
+				IN		const Model& model, const CFeatureBlock& features, const bool* pbExposed, 
+				OUT		CFeatureBlock* pCells, double adObjec[], double adMetal[] 
+			) const;
+
+		// predict a coarse grid first, then the blocks of the uncertain cells
+		template< int DIVIDE >
+		void _predictCoarseToFine( 
+				IN		const Model& model, const CFeatureBlock& features, const bool* pbExposed, 
+				OUT		CFeatureBlock* pCells, double adObjec[], double adMetal[] 
+			) const;
+
+		// exposed non-boundary blocks into anBlocks, the count is returned
+		template< int DIVIDE >
+		static int _getPredictedBlocks( IN const bool* pbExposed, OUT int anBlocks[] );
+
+		// predict the blocks anBlocks ( nullptr for all nBlocks ), results are indexed by the block.
+		// bCascade, the rule cascade decides the obvious ones if set. Not for the cells of the coarse grid.
+		void _predict( 
+				IN		const Model& model, const CFeatureBlock& features, const int anBlocks[], int nBlocks, bool bCascade,
+				OUT		double adObjec[], double adMetal[] 
+			) const;
+
+		// incremented by SetCascade(...), predictions of another one are not reused
+		UINT _getCascadeVersion(void) const;
+
+		// make the output from the predictions, unexposed blocks ( pbExposed ) are background
+		template< int DIVIDE >
+		static void _makeOutput( 
+				IN		const CFeatureBlock& features, const bool* pbExposed, const double adObjec[], const double adMetal[],
+				OUT		RegionType arrResult[],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			);
+
 		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		// private data
 	private:
-		CvANN_MLP* _pMLP_Objec;
-		CvANN_MLP* _pMLP_Metal;
+		ModelHandle* _pModels;				// the current networks, replaced as a whole
+
+		int _nDecimation;
+		E_ABCSampling _eSampling;
+
+		CThreadPool* _pPool;
+		SharedWorkspace* _pWorkspace;		// of the overloads without a workspace
+
+		E_ABCCollimation _eCollimation;
+		RECT _rcField;
+		bool _abExposed[ ABC_REGION_DIVIDE_2 ];
+
+		int _nCoarseDivide;
+		double _dCoarseMargin;
+
+		CStageStatistics* _pStages;			// recorded by all the threads, lock free
+		bool _bInstrument;
+
+		E_ABCPrecision _ePrecision;			// of the networks loaded later, guarded by the lock of publishing them
+		float _afInputRange[ ABC_FEATURE_COUNT ];
+		bool _bInputRange;
+
+		CascadeThresholds _cascade;
+		bool _bCascade;
 	};
 
 }} // comed::abc 
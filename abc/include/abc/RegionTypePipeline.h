@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+#include "abc/abc_types.h"
+
+// platform
+#include <functional>
+
+// forward declaration
+namespace comed { namespace abc { class CRegionTypeClassifier; class CFrameSnapshot; }}
+
+namespace comed { namespace abc
+{
+	/// <summary>
+	/// result of one frame of CRegionTypePipeline
+	/// </summary>
+	struct RegionTypeResult
+	{
+		UINT64 ullFrameId;								// as given to Submit(...)
+		RegionType arrResult[ ABC_REGION_DIVIDE_2 ];
+
+		int nNumObjBlocks;
+		int nMeanObjBlocks;
+		int nMinObj;
+		int nMaxObj;
+
+		float fLatency;									// ms from Submit(...) to the callback
+	};
+
+	/// <summary>
+	/// asynchronous region classifier for a stream of frames.
+	/// The features of a frame are computed on one thread while the previous frame is predicted on another.
+	/// Frames waiting for the classifier are kept in a bounded queue, and the oldest is dropped when it is full,
+	/// so a slow frame does not delay the following ones. The stages are timed as CRegionTypeClassifier::ClassfyRegion(...)
+	/// times them, kABCStage_Total from the feature generation on, the time in the queue is only in the latency of the result.
+	/// </summary>
+	class AFX_EXT_CLASS CRegionTypePipeline
+	{
+		CL_NO_COPY_CONSTRUCTOR( CRegionTypePipeline )
+		CL_NO_ASSIGNMENT_OPERATOR( CRegionTypePipeline )
+
+		// internal data types
+		struct PipelineState;
+
+	public:
+		/// <summary>
+		/// called on the prediction thread for each frame not dropped
+		/// </summary>
+		typedef std::function< void( const RegionTypeResult& result ) > ResultCallback;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// constructor and destrucrtor
+	public:
+		/// <summary>
+		/// constructor, starts the threads. The classifier has to live longer than the pipeline.
+		/// nQueueSize frames can wait for the feature generation, 1 keeps only the newest one.
+		/// </summary>
+		CRegionTypePipeline( const CRegionTypeClassifier& classifier, const ResultCallback& fnCallback, int nQueueSize = 1 );
+
+		/// <summary>
+		/// destructor, waiting frames are dropped and the threads are joined
+		/// </summary>
+		virtual ~CRegionTypePipeline(void);
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// public methods
+	public:
+
+		/// <summary>
+		/// queue a frame and return at once. The snapshot should own its pixels, they are read later on another thread.
+		/// false if the frame is not valid
+		/// </summary>
+		bool Submit( IN const CFrameSnapshot& frame, UINT64 ullFrameId );
+
+		/// <summary>
+		/// wait until every submitted frame is classified or dropped
+		/// </summary>
+		void Flush(void);
+
+		/// <summary>
+		/// frames dropped so far
+		/// </summary>
+		UINT64 GetDroppedCount(void) const;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private data
+	private:
+		PipelineState* _pState;
+	};
+
+}} // comed::abc
@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+#include "abc/abc_types.h"
+
+// forward declaration
+namespace comed { namespace abc { class CRegionTypeClassifier; class CFrameSnapshot; }}
+
+namespace comed { namespace abc
+{
+	/// <summary>
+	/// region classifier for the frames of one continuous stream ( fluoroscopy ).
+	/// Blocks which did not change since the previous frames keep their statistics,
+	/// and their predictions too while the global features stay the same. The blocks are predicted one by one,
+	/// the coarse grid of CRegionTypeClassifier::SetCoarseToFine(...) is not used.
+	/// One instance per stream, the classifier can be shared.
+	/// </summary>
+	class AFX_EXT_CLASS CRegionTypeStream
+	{
+		CL_NO_COPY_CONSTRUCTOR( CRegionTypeStream )
+		CL_NO_ASSIGNMENT_OPERATOR( CRegionTypeStream )
+
+		// internal data types
+		struct StreamState;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// constructor and destrucrtor
+	public:
+		/// <summary>
+		/// constructor, the classifier has to live longer than the stream
+		/// </summary>
+		explicit CRegionTypeStream( const CRegionTypeClassifier& classifier );
+
+		/// <summary>
+		/// destructor
+		/// </summary>
+		virtual ~CRegionTypeStream(void);
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// public methods
+	public:
+
+		/// <summary>
+		/// mean absolute difference ( gray values ) of the probed pixels of a block which is still reused.
+		/// 0 ( default ) reuses a block only if the probed pixels are the same.
+		/// </summary>
+		bool SetTolerance( int nTolerance );
+
+		/// <summary>
+		/// forget the previous frames, e.g. a new run or changed kV
+		/// </summary>
+		void Reset(void);
+
+		/// <summary>
+		/// classfy the region of the next frame of the stream
+		/// </summary>
+		bool ClassfyRegion(
+				IN		const CFrameSnapshot& frame,
+				OUT		RegionType arrResult[ ABC_REGION_DIVIDE_2 ],
+				OUT		int* pnNumObjBlocks,
+				OUT		int* pnMeanObjBlocks,
+				OUT		int* pnMinObj,
+				OUT		int* pnMaxObj
+			);
+
+		/// <summary>
+		/// blocks whose features were computed again for the last frame
+		/// </summary>
+		int GetDirtyBlockCount(void) const;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private data
+	private:
+		const CRegionTypeClassifier& _classifier;
+
+		StreamState* _pState;
+	};
+
+}} // comed::abc
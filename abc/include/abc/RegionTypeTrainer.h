@@ -3,17 +3,18 @@
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 
-#include "clUtils/defines.h"
+#include "abc/abc_platform.h"
 #include "abc/abc_types.h"
 
 // forward declaration
-class CvANN_MLP;
 namespace cl { namespace img { class CImageBuf; }}
+namespace comed { namespace abc { class CFrameSnapshot; }}
 
 namespace comed { namespace abc 
 {
 	/// <summary>
-	/// region classifer - training helper
+	/// region classifer - training helper.
+	/// The networks are trained by the native RPROP of CMLPTrainer, the data is kept and read by CTrainingData.
 	/// </summary>
 	class AFX_EXT_CLASS CRegionTypeTrainer
 	{
@@ -21,7 +22,7 @@ namespace comed { namespace abc
 		CL_NO_COPY_CONSTRUCTOR( CRegionTypeTrainer )
 
 		// internal data types
-		struct DataTrainingParams;
+		struct TrainerState;
 
 		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		// constructor and destrucrtor
@@ -45,12 +46,21 @@ namespace comed { namespace abc
 		/// </summary>
 		bool Initialize(void);
 
+#if ! defined( ABC_STANDALONE )
 		/// <summary>
 		/// add training data
 		/// </summary>
 		bool AddTrainingData( 
 				int nKv, float fMa,
 				const cl::img::CImageBuf& img, const RegionType arrTypes[ ABC_REGION_DIVIDE_2 ] );
+#endif
+
+		/// <summary>
+		/// add training data of a frame snapshot
+		/// </summary>
+		bool AddTrainingData( 
+				int nKv, float fMa,
+				const CFrameSnapshot& frame, const RegionType arrTypes[ ABC_REGION_DIVIDE_2 ] );
 
 		/// <summary>
 		/// clear all the training data
@@ -63,7 +73,7 @@ namespace comed { namespace abc
 		int GetTrainingDataCount(void) const;
 
 		/// <summary>
-		/// load data from file
+		/// load data from file. Files of 12 features ( before kV and mA ) are read with 0 for those.
 		/// </summary>
 		bool AddTrainingDataFrom( LPCTSTR lpszFilePath );
 
@@ -82,16 +92,47 @@ namespace comed { namespace abc
 		/// </summary>
 		bool SaveTrainingResult( LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal ) const;
 
+		/// <summary>
+		/// turn the stored result into a header ( MLPBuiltIn.h ) of the networks, 
+		/// compiled into the classifier with ABC_BUILTIN_MLP so nothing is read from files at start.
+		/// </summary>
+		static bool SaveTrainingResultAsHeader( LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal, LPCTSTR lpszHeaderPath );
+
+		/// <summary>
+		/// convert the stored result into a binary model file for CRegionTypeClassifier::Initialize( lpszModelPath ).
+		/// It has the weights as floats and a checksum, so it is mapped instead of parsed.
+		/// </summary>
+		static bool SaveTrainingResultAsModel( LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal, LPCTSTR lpszModelPath );
+
+		/// <summary>
+		/// calibrate the stored result for CRegionTypeClassifier::SetPrecision(...) with the training data.
+		/// afInputRange is the largest value of each feature, and the report tells the blocks the quantized networks
+		/// decide otherwise than the float ones.
+		/// </summary>
+		bool CalibrateQuantization( 
+				IN		LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal, E_ABCPrecision ePrecision,
+				OUT		float afInputRange[ ABC_FEATURE_COUNT ], 
+				OUT		QuantizationReport* pReport 
+			) const;
+
+		/// <summary>
+		/// fit the rule cascade of CRegionTypeClassifier::SetCascade(...) to the training data. At most dMaxError of the 
+		/// blocks decided by a rule are labeled otherwise. The report tells the blocks decided without the networks
+		/// ( the stored result ), and those decided otherwise than labeled or predicted.
+		/// aeDecisions, if not nullptr, gets the decision of each block of the data in its order ( GetTrainingDataCount() ),
+		/// kCascadeDecision_Uncertain for the blocks let through to the networks.
+		/// </summary>
+		bool FitCascade( 
+				IN		LPCTSTR lpszResultPath_Objec, LPCTSTR lpszResultPath_Metal, double dMaxError,
+				OUT		CascadeThresholds* pThresholds, 
+				OUT		CascadeReport* pReport,
+				OUT		E_CascadeDecision aeDecisions[] = nullptr
+			) const;
 
-		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		// private methods
-	private:
-		static int _extractData( const CString strLine, DataTrainingParams* pParam );
 
 		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		// private data 
 	private:
-		CvANN_MLP *_pMLP_Objec, *_pMLP_Metal;
-		CList< DataTrainingParams* > _listData;
+		TrainerState* _pState;
 	};
 }} // comed::abc
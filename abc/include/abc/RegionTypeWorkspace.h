@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "abc/abc_platform.h"
+#include "abc/abc_types.h"
+
+// forward declaration
+namespace comed { namespace abc { class CFeatureBlock; class CFeatureScratch; class CThreadPool; }}
+
+namespace comed { namespace abc
+{
+	/// <summary>
+	/// inference context of CRegionTypeClassifier::ClassfyRegion(...), the buffers kept from one frame to the next.
+	/// The first frame makes them, and the following frames of the same size and settings allocate nothing
+	/// ( asserted in MSVC debug builds with the native engine ).
+	/// One per thread or stream. The classifier is only read, so threads with their own contexts share it without locks.
+	/// </summary>
+	class AFX_EXT_CLASS CRegionTypeWorkspace
+	{
+		CL_NO_COPY_CONSTRUCTOR( CRegionTypeWorkspace )
+		CL_NO_ASSIGNMENT_OPERATOR( CRegionTypeWorkspace )
+
+		// uses the buffers
+		friend class CRegionTypeClassifier;
+
+		// internal data types
+		struct WorkspaceState;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// constructor and destrucrtor
+	public:
+		/// <summary>
+		/// constructor, nothing allocated but the state
+		/// </summary>
+		CRegionTypeWorkspace(void);
+
+		/// <summary>
+		/// destructor
+		/// </summary>
+		virtual ~CRegionTypeWorkspace(void);
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// public methods
+	public:
+
+		/// <summary>
+		/// threads for the feature generation of this context, including the calling one. 
+		/// 0 ( default ) uses the pool of the classifier. It works on one frame at a time, the frames of the other
+		/// contexts meanwhile run on their calling threads.
+		/// 1 runs on the calling thread only, more gives the context a pool of its own.
+		/// </summary>
+		bool SetWorkerCount( int nWorkers );
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private methods
+	private:
+		// a frame starts. It is steady if the frame and the settings are the same as of the previous one.
+		void _beginFrame( int nSrcW, int nSrcH, int nDivide, int nBitDepth, int nDecimation, int nWorkers, int nCoarseDivide );
+
+		// the frame ends. bCheck, the steady frame must not have allocated ( debug builds )
+		void _endFrame( bool bCheck );
+
+		CFeatureBlock& _getFeatures(void);
+		CFeatureBlock& _getCells(void);
+		CFeatureScratch* _getScratch(void);
+
+		// the pool of the context, or pShared of the classifier
+		CThreadPool* _getPool( CThreadPool* pShared ) const;
+
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		// private data
+	private:
+		WorkspaceState* _pState;
+	};
+
+}} // comed::abc
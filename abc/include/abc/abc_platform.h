@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// The MFC DLL ( abc.vcxproj ) builds on clUtils and the Windows headers of stdafx.h.
+// The core library ( CMakeLists.txt ) defines ABC_STANDALONE and builds with the standard library only:
+// the Windows types and the macros of clUtils the core uses are defined here, nothing else.
+#if ! defined( ABC_STANDALONE )
+
+#include "clUtils/defines.h"
+
+#else
+
+// platform
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+// types
+typedef uint8_t						BYTE;
+typedef uint16_t					WORD;
+typedef uint32_t					DWORD;
+typedef int32_t						LONG;
+typedef unsigned int				UINT;
+typedef int							BOOL;
+typedef int64_t						INT64;
+typedef uint64_t					UINT64;
+typedef int64_t						LONGLONG;
+typedef uint64_t					ULONGLONG;
+typedef char						TCHAR;
+typedef const char*					LPCTSTR;
+typedef const void*					LPCVOID;
+
+typedef struct tagRECT
+{
+	LONG left, top, right, bottom;
+} RECT;
+
+// macro
+#define TRUE						1
+#define FALSE						0
+
+#define _T( x )						x
+#define IN
+#define OUT
+#define AFX_EXT_CLASS
+
+#define ASSERT( x )					assert( x )
+#define VERIFY( x )					do { const bool _bVerify = !! ( x ); assert( _bVerify ); (void) _bVerify; } while ( 0 )
+#define UNREFERENCED_PARAMETER( x )	(void)( x )
+
+// clUtils/defines.h
+#define CL_NO_COPY_CONSTRUCTOR( c )		private: c( const c& );
+#define CL_NO_ASSIGNMENT_OPERATOR( c )	private: c& operator=( const c& );
+#define CL_NO_INSTANTIATION( c )		private: c(void);
+
+#define CLU_MAX( a, b )				( ( (a) > (b) ) ? (a) : (b) )
+#define CLU_MIN( a, b )				( ( (a) < (b) ) ? (a) : (b) )
+#define CLU_LBOUND( a, b )			( ( (a) < (b) ) ? (b) : (a) )
+#define CLU_SQUARE( a )				( (a) * (a) )
+
+#endif
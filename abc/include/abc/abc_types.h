@@ -3,6 +3,8 @@
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once 
 
+#include "abc/abc_platform.h"
+
 namespace comed { namespace abc 
 {
 	/// <summary>
@@ -40,6 +42,119 @@ namespace comed { namespace abc
 		_END_ABC_Results
 	};
 
+	/// <summary>
+	/// how a decimated frame is sampled
+	/// </summary>
+	enum E_ABCSampling
+	{
+		kABCSampling_Nearest = 0,		// top left pixel of each cell
+		kABCSampling_BoxAverage,		// mean of each cell
+
+		_END_ABC_Samplings
+	};
+
+	/// <summary>
+	/// how the field of the collimator is found
+	/// </summary>
+	enum E_ABCCollimation
+	{
+		kABCCollimation_None = 0,		// all blocks are exposed
+		kABCCollimation_Rect,			// a rectangle in pixels of the frame
+		kABCCollimation_Mask,			// a flag for each block of the default grid
+		kABCCollimation_Auto,			// detected from a sparse sample of each frame
+
+		_END_ABC_Collimations
+	};
+
+	/// <summary>
+	/// arithmetic of the prediction
+	/// </summary>
+	enum E_ABCPrecision
+	{
+		kABCPrecision_Float = 0,		// float weights and activations
+		kABCPrecision_Int16,			// 16 bit weights and inputs, activation from a table
+		kABCPrecision_Int8,				// 8 bit weights and inputs, activation from a table. SSE4.1 is needed
+
+		_END_ABC_Precisions
+	};
+
+	/// <summary>
+	/// blocks of the calibration data a quantized prediction decides otherwise than the float one
+	/// </summary>
+	struct QuantizationReport
+	{
+		int nBlocks;
+		int nMetalDiffers;
+		int nBackgroundDiffers;
+		int nAnyDiffers;				// blocks with either of them
+		double dMaxError;				// largest difference of an output
+	};
+
+	/// <summary>
+	/// thresholds of the rule cascade in front of the networks, on the local features ( 0 to 1 ).
+	/// A rule whose thresholds can not be met decides nothing, e.g. dBackgroundMin above 1.
+	/// </summary>
+	struct CascadeThresholds
+	{
+		double dBackgroundMin;			// background if Local_Min is at least this
+		double dBackgroundStd;			// and Local_Std at most this
+		double dMetalMin;				// metal if Local_Min is at most this
+		double dMetalContrast;			// and Local_Max - Local_Min at least this
+	};
+
+	/// <summary>
+	/// decision of the rule cascade
+	/// </summary>
+	enum E_CascadeDecision
+	{
+		kCascadeDecision_Uncertain = 0,		// left to the networks
+		kCascadeDecision_Background,
+		kCascadeDecision_Metal,
+	};
+
+	/// <summary>
+	/// blocks of the training data decided by the rule cascade
+	/// </summary>
+	struct CascadeReport
+	{
+		int nBlocks;
+		int nBackground;				// decided background
+		int nMetal;						// decided metal
+		double dSkipRate;				// of the blocks, not predicted by the networks
+		int nLabelDiffers;				// decided otherwise than labeled
+		int nNetworkDiffers;			// decided otherwise than the networks
+	};
+
+	/// <summary>
+	/// stages of the classification, timed by the instrumentation of the classifier
+	/// </summary>
+	enum E_ABCStage
+	{
+		kABCStage_Copy = 0,				// copy of an image ( CImageBuf ), frame snapshots are read in place
+		kABCStage_Exposure,				// collimator field
+		kABCStage_LocalStatistics,		// block statistics, value histograms and the otsu of the blocks
+		kABCStage_BlockOtsu,			// otsu of the blocks, summed over the workers
+		kABCStage_GlobalOtsu,			// otsu of the merged value histogram
+		kABCStage_Features,				// packing of the features
+		kABCStage_Predict,				// both networks by the native engine, a call
+		kABCStage_PredictObjec,			// the objec network by OpenCV, a call
+		kABCStage_PredictMetal,			// the metal network by OpenCV, a call
+		kABCStage_Output,				// aggregation of the predictions
+		kABCStage_Total,				// a frame
+
+		_END_ABC_Stages
+	};
+
+	/// <summary>
+	/// latency of a stage over the last minute or two, in microseconds. Percentiles are within 1/8 of the value.
+	/// </summary>
+	struct StageLatency
+	{
+		UINT nCount;
+		float fP50, fP95, fP99;
+		float fMax;
+	};
+
 	/// <summary>
 	/// classfier result
 	/// </summary>
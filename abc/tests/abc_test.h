@@ -0,0 +1,193 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// Checks and data of the tests of the core ( tests/CMakeLists.txt ).
+// A test is a main returning ABC_TEST_RESULT(), ctest fails it on a non zero exit code.
+
+#include "abc/abc_platform.h"
+
+// platform
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace comed { namespace abc { namespace test
+{
+	/// <summary>
+	/// failed checks of the test
+	/// </summary>
+	inline int& Failures(void)
+	{
+		static int s_nFailures = 0;
+		return s_nFailures;
+	}
+
+	/// <summary>
+	/// linear congruential generator, the same numbers on every platform
+	/// </summary>
+	class CRandom
+	{
+	public:
+		explicit CRandom( UINT nSeed ) : _nState( nSeed ) {}
+
+		UINT Next(void)
+		{
+			_nState = _nState * 1664525u + 1013904223u;
+			return _nState >> 8;
+		}
+
+		/// <summary>
+		/// uniform in [dMin, dMax)
+		/// </summary>
+		double Uniform( double dMin, double dMax )
+		{
+			return dMin + ( dMax - dMin ) * ( Next() / 16777216.0 );
+		}
+
+	protected:
+		UINT _nState;
+	};
+
+	/// <summary>
+	/// network of nInputs-nHidden-1 with SIGMOID_SYM, as CvANN_MLP keeps it
+	/// </summary>
+	struct Network
+	{
+		int nInputs, nHidden;
+		std::vector< double > vecInputScale;	// scale and shift of each input
+		std::vector< double > vecHidden;		// ( nInputs + 1 ) x nHidden, the biases last
+		std::vector< double > vecOutput;		// nHidden + 1, the bias last
+		double adOutputScale[ 2 ];
+	};
+
+	/// <summary>
+	/// random network
+	/// </summary>
+	inline Network MakeNetwork( int nInputs, int nHidden, UINT nSeed )
+	{
+		CRandom random( nSeed );
+		Network net;
+
+		net.nInputs = nInputs;
+		net.nHidden = nHidden;
+		for ( int i = 0; i < nInputs; i ++ )
+		{
+			net.vecInputScale.push_back( random.Uniform( 0.5, 2.0 ) );
+			net.vecInputScale.push_back( random.Uniform( -0.3, 0.3 ) );
+		}
+		for ( int i = 0; i < ( nInputs + 1 ) * nHidden; i ++ )
+			net.vecHidden.push_back( random.Uniform( -3.0, 3.0 ) );
+		for ( int i = 0; i < nHidden + 1; i ++ )
+			net.vecOutput.push_back( random.Uniform( -5.0, 5.0 ) );
+		net.adOutputScale[ 0 ] = 1.3;
+		net.adOutputScale[ 1 ] = -0.1;
+
+		return net;
+	}
+
+	/// <summary>
+	/// write a network in the format of CvANN_MLP::save, the values exactly
+	/// </summary>
+	inline bool WriteNetwork( const char* pszPath, const Network& net )
+	{
+		FILE* pFile = fopen( pszPath, "w" );
+		if ( ! pFile )
+			return false;
+
+		const std::vector< double >* apvecWeights[ 2 ] = { &net.vecHidden, &net.vecOutput };
+
+		fprintf( pFile, "%%YAML:1.0\nmy_nn: !!opencv-ml-ann-mlp\n" );
+		fprintf( pFile, "   layer_sizes: !!opencv-matrix\n      rows: 1\n      cols: 3\n      dt: i\n      data: [ %d, %d, 1 ]\n", net.nInputs, net.nHidden );
+		fprintf( pFile, "   activation_function: SIGMOID_SYM\n   f_param1: 6.6666666666666663e-001\n   f_param2: 1.7159000000000000e+000\n" );
+		fprintf( pFile, "   min_val: -9.4999999999999996e-001\n" );
+
+		fprintf( pFile, "   input_scale: [ " );
+		for ( size_t i = 0; i < net.vecInputScale.size(); i ++ )
+			fprintf( pFile, "%s%.17g", i ? ", " : "", net.vecInputScale[ i ] );
+		fprintf( pFile, " ]\n   output_scale: [ %.17g, %.17g ]\n   inv_output_scale: [ 7., 3. ]\n   weights:\n", net.adOutputScale[ 0 ], net.adOutputScale[ 1 ] );
+
+		for ( int nLayer = 0; nLayer < 2; nLayer ++ )
+		{
+			fprintf( pFile, "      - [ " );
+			for ( size_t i = 0; i < apvecWeights[ nLayer ]->size(); i ++ )
+				fprintf( pFile, "%s%.17g", i ? ", " : "", ( *apvecWeights[ nLayer ] )[ i ] );
+			fprintf( pFile, " ]\n" );
+		}
+
+		return fclose( pFile ) == 0;
+	}
+
+	/// <summary>
+	/// random network written to pszPath
+	/// </summary>
+	inline bool WriteNetwork( const char* pszPath, int nInputs, int nHidden, UINT nSeed )
+	{
+		return WriteNetwork( pszPath, MakeNetwork( nInputs, nHidden, nSeed ) );
+	}
+
+	/// <summary>
+	/// CvANN_MLP::predict of a row, in double: scaled inputs, SIGMOID_SYM on both layers, scaled output
+	/// </summary>
+	inline double PredictNetwork( const Network& net, const double* pdRow )
+	{
+		const double dAlpha = 6.6666666666666663e-001, dBeta = 1.7159;
+		double dOutput = net.vecOutput[ net.nHidden ];
+
+		for ( int j = 0; j < net.nHidden; j ++ )
+		{
+			double dSum = net.vecHidden[ net.nInputs * net.nHidden + j ];
+			for ( int i = 0; i < net.nInputs; i ++ )
+				dSum += net.vecHidden[ i * net.nHidden + j ] * ( pdRow[ i ] * net.vecInputScale[ i * 2 ] + net.vecInputScale[ i * 2 + 1 ] );
+
+			const double dExp = std::exp( - dAlpha * dSum );
+			dOutput += net.vecOutput[ j ] * dBeta * ( 1.0 - dExp ) / ( 1.0 + dExp );
+		}
+
+		const double dExp = std::exp( - dAlpha * dOutput );
+		return dBeta * ( 1.0 - dExp ) / ( 1.0 + dExp ) * net.adOutputScale[ 0 ] + net.adOutputScale[ 1 ];
+	}
+
+	/// <summary>
+	/// 16 bit frame of an object of radius nRadius in front of the background, with some texture on both
+	/// </summary>
+	inline std::vector< WORD > MakeFrame( int nWidth, int nHeight, int nRadius, UINT nSeed )
+	{
+		std::vector< WORD > vecPixels( nWidth * nHeight );
+		CRandom random( nSeed );
+		for ( int y = 0; y < nHeight; y ++ )
+		{
+			for ( int x = 0; x < nWidth; x ++ )
+			{
+				const int nDx = x - nWidth / 2, nDy = y - nHeight * 2 / 5;
+				const bool bObject = nDx * nDx + nDy * nDy < nRadius * nRadius;
+				vecPixels[ y * nWidth + x ] = (WORD)( bObject ? 4000 + random.Next() % 500 : 30000 + random.Next() % 3000 );
+			}
+		}
+		return vecPixels;
+	}
+}}}
+
+// macro
+#define ABC_CHECK( x )																\
+	do {																			\
+		if ( ! ( x ) )																\
+		{																			\
+			fprintf( stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #x );	\
+			comed::abc::test::Failures() ++;										\
+		}																			\
+	} while ( 0 )
+
+#define ABC_CHECK_NEAR( a, b, eps )													\
+	do {																			\
+		const double _dA = (double)( a ), _dB = (double)( b );						\
+		if ( ! ( std::fabs( _dA - _dB ) <= ( eps ) ) )								\
+		{																			\
+			fprintf( stderr, "%s(%d): check failed: %s = %.9g, %s = %.9g\n", __FILE__, __LINE__, #a, _dA, #b, _dB );	\
+			comed::abc::test::Failures() ++;										\
+		}																			\
+	} while ( 0 )
+
+#define ABC_TEST_RESULT()	( comed::abc::test::Failures() ? ( fprintf( stderr, "%d checks failed\n", comed::abc::test::Failures() ), 1 ) : 0 )
@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Performance of the core: frames per second of the classifier and its stages, rows per second of the engine
+// and the time to load the networks.
+// The numbers are printed for the benchmarks, the test itself fails only if the results are not repeatable.
+
+#include "abc_test.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/RegionTypeWorkspace.h"
+#include "abc/FrameSnapshot.h"
+#include "MLPEngine.h"
+#include "StageStatistics.h"
+
+// platform
+#include <cstdlib>
+#include <cstring>
+
+using namespace comed::abc;
+
+namespace
+{
+	struct Result
+	{
+		RegionType arrResult[ ABC_REGION_DIVIDE_2 ];
+		int nNumObjBlocks, nMeanObjBlocks, nMinObj, nMaxObj;
+
+		bool operator==( const Result& other ) const
+		{
+			return nNumObjBlocks == other.nNumObjBlocks && nMeanObjBlocks == other.nMeanObjBlocks
+				&& nMinObj == other.nMinObj && nMaxObj == other.nMaxObj
+				&& memcmp( arrResult, other.arrResult, sizeof( arrResult ) ) == 0;
+		}
+	};
+
+	const char* const s_apszStages[ _END_ABC_Stages ] =
+	{
+		"copy", "exposure", "local statistics", "block otsu", "global otsu", "features",
+		"predict", "predict objec", "predict metal", "output", "total",
+	};
+
+	// classfy nFrames frames of nSize x nSize with nWorkers and print the latency
+	void BenchClassifier( int nSize, int nWorkers, int nFrames )
+	{
+		CRegionTypeClassifier classifier;
+		ABC_CHECK( classifier.Initialize( _T( "perf_objec.yml" ), _T( "perf_metal.yml" ) ) );
+
+		const std::vector< WORD > vecPixels = test::MakeFrame( nSize, nSize, nSize / 6, 1 );
+		const CFrameSnapshot frame( vecPixels.data(), nSize, nSize, nSize );
+
+		CRegionTypeWorkspace workspace;
+		VERIFY( workspace.SetWorkerCount( nWorkers ) );
+
+		Result first, result;
+		ABC_CHECK( classifier.ClassfyRegion( frame, &workspace, first.arrResult, &first.nNumObjBlocks, &first.nMeanObjBlocks, &first.nMinObj, &first.nMaxObj ) );
+		classifier.ResetStageLatency();
+
+		const LONGLONG llStart = CStageStatistics::Now();
+		for ( int i = 0; i < nFrames; i ++ )
+		{
+			classifier.ClassfyRegion( frame, &workspace, result.arrResult, &result.nNumObjBlocks, &result.nMeanObjBlocks, &result.nMinObj, &result.nMaxObj );
+			ABC_CHECK( result == first );
+		}
+		const double dSeconds = (double)( CStageStatistics::Now() - llStart ) / CStageStatistics::Frequency();
+
+		printf( "classifier %dx%d, %d workers: %.3f ms a frame, %.1f fps\n", nSize, nSize, nWorkers, dSeconds * 1000.0 / nFrames, nFrames / dSeconds );
+		for ( int nStage = 0; nStage < _END_ABC_Stages; nStage ++ )
+		{
+			StageLatency latency;
+			classifier.GetStageLatency( (E_ABCStage) nStage, &latency );
+			if ( latency.nCount )
+				printf( "  %-16s p50 %8.1f  p99 %8.1f  max %8.1f us\n", s_apszStages[ nStage ], latency.fP50, latency.fP99, latency.fMax );
+		}
+	}
+
+	// predict nRows random rows nRepeat times
+	void BenchEngine( int nRows, int nRepeat )
+	{
+		CMLPEngine engine;
+		ABC_CHECK( engine.Load( _T( "perf_objec.yml" ), _T( "perf_metal.yml" ) ) );
+
+		test::CRandom random( 2 );
+		std::vector< double > vecRows( nRows * ABC_FEATURE_COUNT );
+		for ( size_t i = 0; i < vecRows.size(); i ++ )
+			vecRows[ i ] = random.Uniform( 0.0, 1.0 );
+
+		std::vector< double > vecOut0( nRows ), vecOut1( nRows ), vecFirst0( nRows ), vecFirst1( nRows );
+		engine.Predict( vecRows.data(), ABC_FEATURE_COUNT, nullptr, nRows, vecFirst0.data(), vecFirst1.data() );
+
+		const LONGLONG llStart = CStageStatistics::Now();
+		for ( int i = 0; i < nRepeat; i ++ )
+			engine.Predict( vecRows.data(), ABC_FEATURE_COUNT, nullptr, nRows, vecOut0.data(), vecOut1.data() );
+		const double dSeconds = (double)( CStageStatistics::Now() - llStart ) / CStageStatistics::Frequency();
+
+		ABC_CHECK( vecOut0 == vecFirst0 && vecOut1 == vecFirst1 );
+		printf( "engine: %.1f ns a row, %.2f M rows a second\n", dSeconds * 1e9 / ( (double) nRows * nRepeat ), (double) nRows * nRepeat / dSeconds / 1e6 );
+	}
+
+	// load the networks nRepeat times from the result files and from a model file
+	void BenchLoader( int nRepeat )
+	{
+		CMLPEngine engine;
+		ABC_CHECK( engine.Load( _T( "perf_objec.yml" ), _T( "perf_metal.yml" ) ) );
+		ABC_CHECK( engine.SaveBinary( _T( "perf.mlp" ) ) );
+
+		LONGLONG llStart = CStageStatistics::Now();
+		for ( int i = 0; i < nRepeat; i ++ )
+		{
+			CMLPEngine text;
+			ABC_CHECK( text.Load( _T( "perf_objec.yml" ), _T( "perf_metal.yml" ) ) );
+		}
+		const double dText = (double)( CStageStatistics::Now() - llStart ) / CStageStatistics::Frequency();
+
+		llStart = CStageStatistics::Now();
+		for ( int i = 0; i < nRepeat; i ++ )
+		{
+			CMLPEngine binary;
+			ABC_CHECK( binary.LoadBinary( _T( "perf.mlp" ) ) );
+		}
+		const double dBinary = (double)( CStageStatistics::Now() - llStart ) / CStageStatistics::Frequency();
+
+		// the model file predicts as the result files
+		CMLPEngine binary;
+		ABC_CHECK( binary.LoadBinary( _T( "perf.mlp" ) ) );
+
+		test::CRandom random( 3 );
+		double adRow[ ABC_FEATURE_COUNT ], adOut[ 4 ];
+		for ( int i = 0; i < ABC_FEATURE_COUNT; i ++ )
+			adRow[ i ] = random.Uniform( 0.0, 1.0 );
+		engine.Predict( adRow, ABC_FEATURE_COUNT, nullptr, 1, &adOut[ 0 ], &adOut[ 1 ] );
+		binary.Predict( adRow, ABC_FEATURE_COUNT, nullptr, 1, &adOut[ 2 ], &adOut[ 3 ] );
+		ABC_CHECK( adOut[ 0 ] == adOut[ 2 ] && adOut[ 1 ] == adOut[ 3 ] );
+
+		printf( "loader: %.1f us from the result files, %.1f us from the model file\n", dText * 1e6 / nRepeat, dBinary * 1e6 / nRepeat );
+	}
+}
+
+int main( int argc, char* argv[] )
+{
+	// the number of frames, a larger one for the benchmarks
+	const int nFrames = argc > 1 ? atoi( argv[ 1 ] ) : 20;
+
+	ABC_CHECK( test::WriteNetwork( "perf_objec.yml", ABC_FEATURE_COUNT, 28, 1 ) );
+	ABC_CHECK( test::WriteNetwork( "perf_metal.yml", ABC_FEATURE_COUNT, 20, 2 ) );
+
+	BenchLoader( nFrames * 5 );
+	BenchEngine( ABC_REGION_DIVIDE_2, nFrames * 50 );
+	BenchClassifier( 512, 1, nFrames );
+	BenchClassifier( 2048, 1, nFrames / 4 + 1 );
+	BenchClassifier( 2048, 4, nFrames / 4 + 1 );
+
+	return ABC_TEST_RESULT();
+}
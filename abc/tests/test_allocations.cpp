@@ -0,0 +1,179 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Steady frames allocate nothing. operator new is replaced to count the allocations of every thread, the workers of
+// the pools included, and after a frame to warm up each context classifies frames with none: a workspace on the pool
+// of the classifier, on the calling thread and on a pool of its own, the workspace of the classifier, the 16 and 32
+// grids, coarse to fine, the quantized networks and the cascade.
+
+#include "abc_test.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/RegionTypeWorkspace.h"
+#include "abc/FrameSnapshot.h"
+
+// platform
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace comed::abc;
+
+namespace
+{
+	const int s_nSize = 512;
+	const int s_nFrames = 4;
+
+	std::atomic< bool > s_bCounting( false );
+	std::atomic< long > s_nAllocations( 0 );
+
+	void* Allocate( size_t nSize )
+	{
+		if ( s_bCounting.load( std::memory_order_relaxed ) )
+			s_nAllocations.fetch_add( 1, std::memory_order_relaxed );
+
+		return malloc( nSize > 0 ? nSize : 1 );
+	}
+}
+
+// every allocation of the program, of any thread
+void* operator new( size_t nSize )
+{
+	void* pv = Allocate( nSize );
+	if ( pv == nullptr )
+		throw std::bad_alloc();
+	return pv;
+}
+
+void* operator new[]( size_t nSize )
+{
+	return operator new( nSize );
+}
+
+void* operator new( size_t nSize, const std::nothrow_t& ) throw()
+{
+	return Allocate( nSize );
+}
+
+void* operator new[]( size_t nSize, const std::nothrow_t& ) throw()
+{
+	return Allocate( nSize );
+}
+
+void operator delete( void* pv ) throw()
+{
+	free( pv );
+}
+
+void operator delete[]( void* pv ) throw()
+{
+	free( pv );
+}
+
+void operator delete( void* pv, const std::nothrow_t& ) throw()
+{
+	free( pv );
+}
+
+void operator delete[]( void* pv, const std::nothrow_t& ) throw()
+{
+	free( pv );
+}
+
+namespace
+{
+	std::vector< std::vector< WORD > > s_vecPixels;
+
+	// the allocations of nFrames frames after one to warm up
+	template< typename Classfy >
+	long Count( const char* pszCase, const Classfy& fnClassfy )
+	{
+		fnClassfy( 0 );
+
+		s_nAllocations = 0;
+		s_bCounting = true;
+
+		for ( int f = 1; f <= 2 * s_nFrames; f ++ )
+			fnClassfy( f % s_nFrames );
+
+		s_bCounting = false;
+
+		const long nAllocations = s_nAllocations;
+		printf( "%s: %ld allocations\n", pszCase, nAllocations );
+
+		return nAllocations;
+	}
+
+	// frames with a workspace
+	long CountWorkspace( const char* pszCase, const CRegionTypeClassifier& classifier, CRegionTypeWorkspace* pWorkspace )
+	{
+		RegionType arrResult[ ABC_REGION_DIVIDE_2 ];
+		int nNumObjBlocks = 0, nMeanObjBlocks = 0, nMinObj = 0, nMaxObj = 0;
+
+		return Count( pszCase, [&]( int f )
+		{
+			const CFrameSnapshot frame( s_vecPixels[ f ].data(), s_nSize, s_nSize, s_nSize );
+			ABC_CHECK( classifier.ClassfyRegion( frame, pWorkspace, arrResult, &nNumObjBlocks, &nMeanObjBlocks, &nMinObj, &nMaxObj ) );
+		} );
+	}
+
+	// frames of a grid with the workspace of the classifier
+	template< int DIVIDE >
+	long CountGrid( const char* pszCase, const CRegionTypeClassifier& classifier )
+	{
+		RegionType arrResult[ DIVIDE * DIVIDE ];
+		int nNumObjBlocks = 0, nMeanObjBlocks = 0, nMinObj = 0, nMaxObj = 0;
+
+		return Count( pszCase, [&]( int f )
+		{
+			const CFrameSnapshot frame( s_vecPixels[ f ].data(), s_nSize, s_nSize, s_nSize );
+			ABC_CHECK( classifier.ClassfyRegion( frame, DIVIDE, arrResult, &nNumObjBlocks, &nMeanObjBlocks, &nMinObj, &nMaxObj ) );
+		} );
+	}
+}
+
+int main(void)
+{
+	ABC_CHECK( test::WriteNetwork( "allocations_objec.yml", ABC_FEATURE_COUNT, 24, 111 ) );
+	ABC_CHECK( test::WriteNetwork( "allocations_metal.yml", ABC_FEATURE_COUNT, 16, 112 ) );
+
+	for ( int f = 0; f < s_nFrames; f ++ )
+		s_vecPixels.push_back( test::MakeFrame( s_nSize, s_nSize, 60 + f * 30, 113 + f ) );
+
+	CRegionTypeClassifier classifier;
+	ABC_CHECK( classifier.Initialize( _T( "allocations_objec.yml" ), _T( "allocations_metal.yml" ) ) );
+	ABC_CHECK( classifier.SetWorkerCount( 4 ) );
+
+	// the contexts
+	CRegionTypeWorkspace shared, alone, own;
+	ABC_CHECK( alone.SetWorkerCount( 1 ) );
+	ABC_CHECK( own.SetWorkerCount( 3 ) );
+
+	ABC_CHECK( CountWorkspace( "pool of the classifier", classifier, &shared ) == 0 );
+	ABC_CHECK( CountWorkspace( "calling thread", classifier, &alone ) == 0 );
+	ABC_CHECK( CountWorkspace( "pool of the workspace", classifier, &own ) == 0 );
+
+	ABC_CHECK( CountGrid< ABC_REGION_DIVIDE >( "workspace of the classifier", classifier ) == 0 );
+	ABC_CHECK( CountGrid< 16 >( "grid 16", classifier ) == 0 );
+	ABC_CHECK( CountGrid< 32 >( "grid 32", classifier ) == 0 );
+
+	// the settings of the frame path
+	ABC_CHECK( classifier.SetCoarseToFine( 8 ) );
+	ABC_CHECK( CountWorkspace( "coarse to fine", classifier, &shared ) == 0 );
+	ABC_CHECK( classifier.SetCoarseToFine( 0 ) );
+
+	ABC_CHECK( classifier.SetPrecision( kABCPrecision_Int16 ) );
+	ABC_CHECK( CountWorkspace( "int16", classifier, &shared ) == 0 );
+	ABC_CHECK( classifier.SetPrecision( kABCPrecision_Float ) );
+
+	CascadeThresholds thresholds;
+	thresholds.dBackgroundMin = 0.4;
+	thresholds.dBackgroundStd = 1.0;
+	thresholds.dMetalMin = 0.1;
+	thresholds.dMetalContrast = 0.0;
+
+	classifier.SetCascade( &thresholds );
+	ABC_CHECK( CountWorkspace( "cascade", classifier, &shared ) == 0 );
+	classifier.SetCascade( nullptr );
+
+	return ABC_TEST_RESULT();
+}
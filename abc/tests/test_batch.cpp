@@ -0,0 +1,113 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A batch classifies as CRegionTypeClassifier::ClassfyRegion(...) frame by frame: with and without the rule cascade,
+// coarse to fine and collimated, and for batches growing and shrinking on the same buffers.
+
+#include "abc_test.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/RegionTypeBatch.h"
+#include "abc/FrameSnapshot.h"
+
+// platform
+#include <cstring>
+
+using namespace comed::abc;
+
+namespace
+{
+	const int s_nSize = 512;
+	const int s_nFrames = 6;
+
+	bool Same( const RegionTypeBatchResult& a, const RegionTypeBatchResult& b )
+	{
+		return a.nNumObjBlocks == b.nNumObjBlocks && a.nMeanObjBlocks == b.nMeanObjBlocks
+			&& a.nMinObj == b.nMinObj && a.nMaxObj == b.nMaxObj
+			&& memcmp( a.arrResult, b.arrResult, sizeof( a.arrResult ) ) == 0;
+	}
+
+	// the first nFrames frames by the batch, each against the classifier
+	void CheckBatch( const CRegionTypeClassifier& classifier, CRegionTypeBatch& batch, const CFrameSnapshot aFrames[], int nFrames )
+	{
+		RegionTypeBatchResult aResults[ s_nFrames ];
+		ABC_CHECK( batch.ClassfyRegions( aFrames, nFrames, aResults ) );
+
+		for ( int i = 0; i < nFrames; i ++ )
+		{
+			RegionTypeBatchResult expected;
+			ABC_CHECK( classifier.ClassfyRegion( aFrames[ i ], expected.arrResult,
+						&expected.nNumObjBlocks, &expected.nMeanObjBlocks, &expected.nMinObj, &expected.nMaxObj ) );
+			ABC_CHECK( Same( aResults[ i ], expected ) );
+		}
+	}
+
+	// batches of all the frames, a few, then all again
+	void CheckBatches( const CRegionTypeClassifier& classifier, CRegionTypeBatch& batch, const CFrameSnapshot aFrames[] )
+	{
+		CheckBatch( classifier, batch, aFrames, s_nFrames );
+		CheckBatch( classifier, batch, aFrames + 3, 2 );
+		CheckBatch( classifier, batch, aFrames, s_nFrames );
+	}
+}
+
+int main(void)
+{
+	ABC_CHECK( test::WriteNetwork( "batch_objec.yml", ABC_FEATURE_COUNT, 24, 61 ) );
+	ABC_CHECK( test::WriteNetwork( "batch_metal.yml", ABC_FEATURE_COUNT, 16, 62 ) );
+
+	CRegionTypeClassifier classifier;
+	ABC_CHECK( classifier.Initialize( _T( "batch_objec.yml" ), _T( "batch_metal.yml" ) ) );
+
+	// objects of several sizes
+	std::vector< WORD > avecPixels[ s_nFrames ];
+	CFrameSnapshot aFrames[ s_nFrames ];
+
+	for ( int i = 0; i < s_nFrames; i ++ )
+	{
+		avecPixels[ i ] = test::MakeFrame( s_nSize, s_nSize, 40 + i * 30, 70 + i );
+		aFrames[ i ] = CFrameSnapshot( avecPixels[ i ].data(), s_nSize, s_nSize, s_nSize );
+	}
+
+	CRegionTypeBatch batch( classifier, 3 );
+	ABC_CHECK( batch.GetWorkerCount() == 3 );
+
+	// no frames, an invalid one
+	RegionTypeBatchResult aResults[ s_nFrames ];
+	ABC_CHECK( batch.ClassfyRegions( aFrames, 0, aResults ) );
+
+	CFrameSnapshot aInvalid[ 2 ] = { aFrames[ 0 ], CFrameSnapshot() };
+	ABC_CHECK( ! batch.ClassfyRegions( aInvalid, 2, aResults ) );
+
+	// the networks only
+	CheckBatches( classifier, batch, aFrames );
+
+	// the rule cascade decides the dark blocks
+	CascadeThresholds thresholds;
+	thresholds.dBackgroundMin = 2.0;
+	thresholds.dBackgroundStd = -1.0;
+	thresholds.dMetalMin = 0.1;
+	thresholds.dMetalContrast = 0.0;
+
+	classifier.SetCascade( &thresholds );
+	CheckBatches( classifier, batch, aFrames );
+	classifier.SetCascade( nullptr );
+
+	// coarse to fine, each frame predicted by itself
+	ABC_CHECK( classifier.SetCoarseToFine( 4, 0.5 ) );
+	CheckBatches( classifier, batch, aFrames );
+
+	ABC_CHECK( classifier.SetCoarseToFine( 8, 0.0 ) );
+	CheckBatches( classifier, batch, aFrames );
+
+	ABC_CHECK( classifier.SetCoarseToFine( 0 ) );
+
+	// the blocks outside the field are not predicted, fewer rows than the last batch
+	RECT rcField = { 64, 96, 448, 416 };
+	ABC_CHECK( classifier.SetCollimation( kABCCollimation_Rect, &rcField ) );
+	CheckBatches( classifier, batch, aFrames );
+
+	ABC_CHECK( classifier.SetCollimation( kABCCollimation_None ) );
+	CheckBatches( classifier, batch, aFrames );
+
+	return ABC_TEST_RESULT();
+}
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// test_builtin <objec network> <metal network>
+// The engine built with the networks compiled in ( abc_builtin_mlp ) predicts as the engine loading the files.
+
+#include "abc_test.h"
+#include "MLPEngine.h"
+
+using namespace comed::abc;
+
+int main( int argc, char* argv[] )
+{
+	if ( argc != 3 )
+		return 2;
+
+	CMLPEngine builtin, loaded;
+	ABC_CHECK( builtin.LoadBuiltIn() );
+	ABC_CHECK( builtin.GetInputCount() == ABC_FEATURE_COUNT );
+	ABC_CHECK( loaded.Load( argv[ 1 ], argv[ 2 ] ) );
+
+	const int nRows = 37, nStride = ABC_FEATURE_COUNT;
+	test::CRandom random( 33 );
+	std::vector< double > vecRows( nRows * nStride );
+	for ( size_t i = 0; i < vecRows.size(); i ++ )
+		vecRows[ i ] = random.Uniform( -0.1, 1.1 );
+
+	std::vector< double > vecObjec( nRows ), vecMetal( nRows ), vecRefObjec( nRows ), vecRefMetal( nRows );
+	builtin.Predict( vecRows.data(), nStride, nullptr, nRows, vecObjec.data(), vecMetal.data() );
+	loaded.Predict( vecRows.data(), nStride, nullptr, nRows, vecRefObjec.data(), vecRefMetal.data() );
+
+	// the same float weights, the same arithmetic
+	ABC_CHECK( vecObjec == vecRefObjec );
+	ABC_CHECK( vecMetal == vecRefMetal );
+
+	return ABC_TEST_RESULT();
+}
@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The rule cascade decides blocks only: the cells of the coarse grid are predicted by the networks,
+// and a stream predicts again after the cascade is changed.
+
+#include "abc_test.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/RegionTypeStream.h"
+#include "abc/FrameSnapshot.h"
+
+// platform
+#include <cstring>
+
+using namespace comed::abc;
+
+namespace
+{
+	const int s_nSize = 512;
+
+	struct Result
+	{
+		RegionType arrResult[ ABC_REGION_DIVIDE_2 ];
+		int nNumObjBlocks, nMeanObjBlocks, nMinObj, nMaxObj;
+
+		bool operator==( const Result& other ) const
+		{
+			return nNumObjBlocks == other.nNumObjBlocks && nMeanObjBlocks == other.nMeanObjBlocks
+				&& nMinObj == other.nMinObj && nMaxObj == other.nMaxObj
+				&& memcmp( arrResult, other.arrResult, sizeof( arrResult ) ) == 0;
+		}
+	};
+
+	bool Same( const RegionType& a, const RegionType& b )
+	{
+		return a.bMetal == b.bMetal && a.bBackground == b.bBackground;
+	}
+
+	Result Classfy( const CRegionTypeClassifier& classifier, const CFrameSnapshot& frame )
+	{
+		Result result;
+		ABC_CHECK( classifier.ClassfyRegion( frame, result.arrResult, &result.nNumObjBlocks, &result.nMeanObjBlocks, &result.nMinObj, &result.nMaxObj ) );
+		return result;
+	}
+
+	Result Classfy( CRegionTypeStream& stream, const CFrameSnapshot& frame )
+	{
+		Result result;
+		ABC_CHECK( stream.ClassfyRegion( frame, result.arrResult, &result.nNumObjBlocks, &result.nMeanObjBlocks, &result.nMinObj, &result.nMaxObj ) );
+		return result;
+	}
+}
+
+int main(void)
+{
+	ABC_CHECK( test::WriteNetwork( "cascade_objec.yml", ABC_FEATURE_COUNT, 28, 45 ) );
+	ABC_CHECK( test::WriteNetwork( "cascade_metal.yml", ABC_FEATURE_COUNT, 20, 46 ) );
+
+	CRegionTypeClassifier classifier;
+	ABC_CHECK( classifier.Initialize( _T( "cascade_objec.yml" ), _T( "cascade_metal.yml" ) ) );
+
+	const std::vector< WORD > vecPixels = test::MakeFrame( s_nSize, s_nSize, 120, 5 );
+	const CFrameSnapshot frame( vecPixels.data(), s_nSize, s_nSize, s_nSize );
+
+	// every block is background by the rules
+	CascadeThresholds background;
+	background.dBackgroundMin = -1.0;
+	background.dBackgroundStd = 2.0;
+	background.dMetalMin = -1.0;
+	background.dMetalContrast = 2.0;
+
+	const Result networks = Classfy( classifier, frame );
+
+	classifier.SetCascade( &background );
+	const Result rules = Classfy( classifier, frame );
+	ABC_CHECK( ! ( rules == networks ) );
+
+	// the certain cells keep the outputs of the networks, the blocks of the others are decided by the rules
+	classifier.SetCascade( nullptr );
+	ABC_CHECK( classifier.SetCoarseToFine( 4, 0.0 ) );
+	const Result coarse = Classfy( classifier, frame );
+
+	classifier.SetCascade( &background );
+	const Result coarseRules = Classfy( classifier, frame );
+
+	int nOther = 0;
+	for ( int bi = 0; bi < ABC_REGION_DIVIDE_2; bi ++ )
+	{
+		ABC_CHECK( Same( coarseRules.arrResult[ bi ], coarse.arrResult[ bi ] ) || Same( coarseRules.arrResult[ bi ], rules.arrResult[ bi ] ) );
+		nOther += ! Same( coarseRules.arrResult[ bi ], rules.arrResult[ bi ] );
+	}
+	ABC_CHECK( nOther > 0 );
+
+	ABC_CHECK( classifier.SetCoarseToFine( 0 ) );
+
+	// a stream on the same frame predicts again when the cascade changes
+	classifier.SetCascade( nullptr );
+	CRegionTypeStream stream( classifier );
+	ABC_CHECK( Classfy( stream, frame ) == networks );
+	ABC_CHECK( Classfy( stream, frame ) == networks );
+
+	classifier.SetCascade( &background );
+	ABC_CHECK( Classfy( stream, frame ) == rules );
+
+	classifier.SetCascade( nullptr );
+	ABC_CHECK( Classfy( stream, frame ) == networks );
+
+	return ABC_TEST_RESULT();
+}
@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The rule cascade fitted by the trainer to labeled rows: of the rows decided by each rule at most the target error
+// are labeled otherwise, the rows it decides are those of CCascade::Decide(...), and the report counts them.
+// Bright flat rows are background, dark rows of high contrast metal and the body between is let through, 1 % of the
+// labels are flipped. argv[ 1 ] is data/abc.training.data, fitted as well.
+
+#include "abc_test.h"
+#include "abc/RegionTypeTrainer.h"
+#include "Cascade.h"
+#include "MLPEngine.h"
+#include "TrainingData.h"
+
+// platform
+#include <fstream>
+
+using namespace comed::abc;
+
+namespace
+{
+	enum E_Kind { kKind_Background = 0, kKind_Metal, kKind_Body, _END_Kinds };
+
+	// rows of each kind and the flipped labels, written as the trainer does
+	bool WriteRows( const char* pszPath, int nRows, UINT nSeed )
+	{
+		test::CRandom random( nSeed );
+		std::ofstream file( pszPath );
+
+		for ( int n = 0; n < nRows; n ++ )
+		{
+			const int nKind = n % _END_Kinds;
+			double adFeatures[ ABC_FEATURE_COUNT ];
+
+			for ( int i = 0; i < ABC_FEATURE_COUNT; i ++ )
+				adFeatures[ i ] = random.Uniform( 0., 1. );
+
+			double dMin = 0., dContrast = 0., dStd = 0.;
+			switch ( nKind )
+			{
+			case kKind_Background:
+				dMin = random.Uniform( 0.70, 0.95 );	dContrast = random.Uniform( 0.00, 0.05 );	dStd = random.Uniform( 0.000, 0.010 );	break;
+			case kKind_Metal:
+				dMin = random.Uniform( 0.00, 0.10 );	dContrast = random.Uniform( 0.30, 0.80 );	dStd = random.Uniform( 0.050, 0.200 );	break;
+			default:
+				dMin = random.Uniform( 0.08, 0.75 );	dContrast = random.Uniform( 0.03, 0.40 );	dStd = random.Uniform( 0.008, 0.080 );	break;
+			}
+
+			adFeatures[ kABCFeatureId_Local_Min ] = dMin;
+			adFeatures[ kABCFeatureId_Local_Max ] = dMin + dContrast;
+			adFeatures[ kABCFeatureId_Local_Std ] = dStd;
+
+			bool bBackground = ( nKind == kKind_Background ), bMetal = ( nKind == kKind_Metal );
+			if ( random.Next() % 100 == 0 )
+			{
+				bBackground = ( nKind != kKind_Background );
+				bMetal = false;
+			}
+
+			file << 1 + n % ( ABC_REGION_DIVIDE - 2 ) << "\t" << 1 + n / ( ABC_REGION_DIVIDE - 2 ) % ( ABC_REGION_DIVIDE - 2 );
+			for ( int i = 0; i < ABC_FEATURE_COUNT; i ++ )
+				file << "\t" << adFeatures[ i ];
+			file << "\t" << ( bMetal ? 1 : -1 ) << "\t" << ( bBackground ? 1 : -1 ) << "\n";
+		}
+
+		return !! file;
+	}
+
+	// fit to the rows of a file, the report and the decisions checked against the rows and the networks
+	CascadeReport CheckFit( const char* pszDataPath, double dMaxError )
+	{
+		CRegionTypeTrainer trainer;
+		ABC_CHECK( trainer.Initialize() );
+		ABC_CHECK( trainer.AddTrainingDataFrom( pszDataPath ) );
+
+		const int nRows = trainer.GetTrainingDataCount();
+		std::vector< E_CascadeDecision > vecDecisions( nRows, (E_CascadeDecision) -1 );
+
+		CascadeThresholds thresholds;
+		CascadeReport report;
+		ABC_CHECK( trainer.FitCascade( _T( "cascade_fit_objec.yml" ), _T( "cascade_fit_metal.yml" ), dMaxError, &thresholds, &report, vecDecisions.data() ) );
+
+		CTrainingData data;
+		std::vector< double > vecRows, vecLabels;
+		ABC_CHECK( data.Read( pszDataPath ) );
+		data.GetRows( &vecRows, &vecLabels );
+		ABC_CHECK( data.GetCount() == nRows );
+
+		CMLPEngine engine;
+		std::vector< double > vecObjec( nRows ), vecMetal( nRows );
+		ABC_CHECK( engine.Load( _T( "cascade_fit_objec.yml" ), _T( "cascade_fit_metal.yml" ) ) );
+		engine.Predict( vecRows.data(), ABC_FEATURE_COUNT, nullptr, nRows, vecObjec.data(), vecMetal.data() );
+
+		// decided, and decided otherwise than labeled, by each decision
+		int anDecided[ 3 ] = { 0, 0, 0 }, anWrong[ 3 ] = { 0, 0, 0 };
+		int nNetworkDiffers = 0;
+
+		for ( int n = 0; n < nRows; n ++ )
+		{
+			const E_CascadeDecision eDecision = vecDecisions[ n ];
+			ABC_CHECK( eDecision == CCascade::Decide( thresholds, &vecRows[ n * ABC_FEATURE_COUNT ] ) );
+
+			if ( eDecision == kCascadeDecision_Uncertain )
+				continue;
+
+			const bool bBackground = ( eDecision == kCascadeDecision_Background );
+			const double* pdLabel = &vecLabels[ n * ABC_RESULT_COUNT ];
+
+			anDecided[ eDecision ] ++;
+			anWrong[ eDecision ] += ( pdLabel[ kABCResultId_Background ] > 0. ) != bBackground || ( pdLabel[ kABCResultId_Metal ] > 0. ) == bBackground;
+			nNetworkDiffers += ( vecObjec[ n ] > 0. ) != bBackground || ( vecMetal[ n ] > 0. ) == bBackground;
+		}
+
+		printf( "%s, error %.2f: background %d ( %d wrong ), metal %d ( %d wrong ), skip rate %.3f\n", pszDataPath, dMaxError,
+				anDecided[ kCascadeDecision_Background ], anWrong[ kCascadeDecision_Background ],
+				anDecided[ kCascadeDecision_Metal ], anWrong[ kCascadeDecision_Metal ], report.dSkipRate );
+
+		// the target precision of each rule
+		ABC_CHECK( anWrong[ kCascadeDecision_Background ] <= dMaxError * anDecided[ kCascadeDecision_Background ] );
+		ABC_CHECK( anWrong[ kCascadeDecision_Metal ] <= dMaxError * anDecided[ kCascadeDecision_Metal ] );
+
+		// the report of the decided rows
+		ABC_CHECK( report.nBlocks == nRows );
+		ABC_CHECK( report.nBackground == anDecided[ kCascadeDecision_Background ] );
+		ABC_CHECK( report.nMetal == anDecided[ kCascadeDecision_Metal ] );
+		ABC_CHECK( report.dSkipRate == (double)( report.nBackground + report.nMetal ) / nRows );
+		ABC_CHECK( report.nLabelDiffers == anWrong[ kCascadeDecision_Background ] + anWrong[ kCascadeDecision_Metal ] );
+		ABC_CHECK( report.nNetworkDiffers == nNetworkDiffers );
+
+		return report;
+	}
+}
+
+int main( int argc, char* argv[] )
+{
+	const int nRows = 3000;
+
+	ABC_CHECK( WriteRows( "cascade_fit.data", nRows, 7 ) );
+	ABC_CHECK( test::WriteNetwork( "cascade_fit_objec.yml", ABC_FEATURE_COUNT, 8, 1 ) );
+	ABC_CHECK( test::WriteNetwork( "cascade_fit_metal.yml", ABC_FEATURE_COUNT, 8, 2 ) );
+
+	// no rows, or no error allowed
+	{
+		CRegionTypeTrainer trainer;
+		CascadeThresholds thresholds;
+		CascadeReport report;
+		ABC_CHECK( trainer.Initialize() );
+		ABC_CHECK( ! trainer.FitCascade( _T( "cascade_fit_objec.yml" ), _T( "cascade_fit_metal.yml" ), 0.02, &thresholds, &report ) );
+		ABC_CHECK( trainer.AddTrainingDataFrom( "cascade_fit.data" ) );
+		ABC_CHECK( ! trainer.FitCascade( _T( "cascade_fit_objec.yml" ), _T( "cascade_fit_metal.yml" ), 1., &thresholds, &report ) );
+	}
+
+	const double adMaxError[ 3 ] = { 0., 0.02, 0.05 };
+	int nPrevDecided = 0;
+
+	for ( int e = 0; e < 3; e ++ )
+	{
+		const CascadeReport report = CheckFit( "cascade_fit.data", adMaxError[ e ] );
+
+		// most of the background and the metal decided, the body let through; more the more error allowed
+		ABC_CHECK( report.nBackground + report.nMetal >= nPrevDecided );
+		nPrevDecided = report.nBackground + report.nMetal;
+		if ( adMaxError[ e ] > 0. )
+			ABC_CHECK( report.nBackground >= nRows / 3 * 8 / 10 && report.nMetal >= nRows / 3 * 8 / 10 );
+	}
+
+	if ( argc > 1 )
+	{
+		const CascadeReport report = CheckFit( argv[ 1 ], 0.01 );
+		ABC_CHECK( report.dSkipRate > 0. );
+	}
+
+	return ABC_TEST_RESULT();
+}
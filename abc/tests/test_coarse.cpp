@@ -0,0 +1,176 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// How far coarse to fine can classify otherwise than block by block. Only the blocks of the cells decided whole
+// can differ, so the blocks which differ at a margin differ at every smaller one too, and none differ once the margin
+// is above any output. With networks trained on objects of several sizes, on other objects sharp and fading at most
+// 1 of 8 blocks differs at margin 0 and 1 of 16 at the default margin ( 0.5 ). None differ on a frame whose blocks
+// are all the same.
+
+#include "abc_test.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/RegionTypeTrainer.h"
+#include "abc/FrameSnapshot.h"
+
+// platform
+#include <cmath>
+
+using namespace comed::abc;
+
+namespace
+{
+	const int s_nSize = 512;
+	const int s_nBlock = s_nSize / ABC_REGION_DIVIDE;
+
+	// blocks of the predicted grid
+	const int s_nBlocks = ( ABC_REGION_DIVIDE - 2 ) * ( ABC_REGION_DIVIDE - 2 );
+
+	// margins, the last above any output
+	const double s_adMargins[] = { 0., 0.25, 0.5, 1.0, 1e9 };
+	const int s_nMargins = sizeof( s_adMargins ) / sizeof( double );
+
+	// the blocks of the object are metal, the others background
+	void Label( int nRadius, RegionType arrTypes[ ABC_REGION_DIVIDE_2 ] )
+	{
+		for ( int bi = 0; bi < ABC_REGION_DIVIDE_2; bi ++ )
+		{
+			const int nDx = ( bi % ABC_REGION_DIVIDE ) * s_nBlock + s_nBlock / 2 - s_nSize / 2;
+			const int nDy = ( bi / ABC_REGION_DIVIDE ) * s_nBlock + s_nBlock / 2 - s_nSize * 2 / 5;
+
+			arrTypes[ bi ].bMetal = nDx * nDx + nDy * nDy < nRadius * nRadius;
+			arrTypes[ bi ].bBackground = ! arrTypes[ bi ].bMetal;
+		}
+	}
+
+	// an object fading into the background over nRadius, the blocks of a cell differ less than the frame
+	std::vector< WORD > MakeSoftFrame( int nRadius, UINT nSeed )
+	{
+		std::vector< WORD > vecPixels( s_nSize * s_nSize );
+		test::CRandom random( nSeed );
+
+		for ( int y = 0; y < s_nSize; y ++ )
+		for ( int x = 0; x < s_nSize; x ++ )
+		{
+			const int nDx = x - s_nSize / 2, nDy = y - s_nSize * 2 / 5;
+			const double dRatio = CLU_MIN( sqrt( (double)( nDx * nDx + nDy * nDy ) ) / nRadius, 1.0 );
+
+			vecPixels[ y * s_nSize + x ] = (WORD)( 4000 + 26000 * dRatio + random.Next() % 1500 );
+		}
+
+		return vecPixels;
+	}
+
+	void Classfy( const CRegionTypeClassifier& classifier, const CFrameSnapshot& frame, RegionType arrResult[ ABC_REGION_DIVIDE_2 ] )
+	{
+		int nNumObjBlocks = 0, nMeanObjBlocks = 0, nMinObj = 0, nMaxObj = 0;
+		ABC_CHECK( classifier.ClassfyRegion( frame, arrResult, &nNumObjBlocks, &nMeanObjBlocks, &nMinObj, &nMaxObj ) );
+	}
+
+	bool Same( const RegionType& a, const RegionType& b )
+	{
+		return a.bMetal == b.bMetal && a.bBackground == b.bBackground;
+	}
+
+	// blocks differing from block by block at each margin of a coarse grid, those at margin 0 and 0.5 returned
+	void CheckFrame( CRegionTypeClassifier& classifier, int nCoarse, const CFrameSnapshot& frame, int* pnDiffers0, int* pnDiffers05 )
+	{
+		RegionType arrFine[ ABC_REGION_DIVIDE_2 ], arrCoarse[ ABC_REGION_DIVIDE_2 ];
+		bool abPrevDiffers[ ABC_REGION_DIVIDE_2 ];
+
+		ABC_CHECK( classifier.SetCoarseToFine( 0 ) );
+		Classfy( classifier, frame, arrFine );
+
+		for ( int m = 0; m < s_nMargins; m ++ )
+		{
+			ABC_CHECK( classifier.SetCoarseToFine( nCoarse, s_adMargins[ m ] ) );
+			Classfy( classifier, frame, arrCoarse );
+
+			int nDiffers = 0;
+			for ( int bi = 0; bi < ABC_REGION_DIVIDE_2; bi ++ )
+			{
+				const bool bDiffers = ! Same( arrCoarse[ bi ], arrFine[ bi ] );
+
+				// fewer cells are decided whole at a larger margin
+				ABC_CHECK( m == 0 || ! bDiffers || abPrevDiffers[ bi ] );
+				abPrevDiffers[ bi ] = bDiffers;
+				nDiffers += bDiffers;
+			}
+
+			if ( s_adMargins[ m ] == 0. )
+				*pnDiffers0 = nDiffers;
+			if ( s_adMargins[ m ] == 0.5 )
+				*pnDiffers05 = nDiffers;
+
+			printf( "%d x %d, margin %g: %d blocks differ\n", nCoarse, nCoarse, s_adMargins[ m ], nDiffers );
+		}
+
+		// none above any output
+		for ( int bi = 0; bi < ABC_REGION_DIVIDE_2; bi ++ )
+			ABC_CHECK( ! abPrevDiffers[ bi ] );
+	}
+}
+
+int main(void)
+{
+	// networks trained on objects of several sizes
+	CRegionTypeTrainer trainer;
+	ABC_CHECK( trainer.Initialize() );
+
+	RegionType arrTypes[ ABC_REGION_DIVIDE_2 ];
+
+	for ( int f = 0; f < 5; f ++ )
+	{
+		const int nRadius = 50 + f * 30;
+		const std::vector< WORD > vecPixels = test::MakeFrame( s_nSize, s_nSize, nRadius, 30 + f );
+
+		Label( nRadius, arrTypes );
+		ABC_CHECK( trainer.AddTrainingData( 0, 0.f, CFrameSnapshot( vecPixels.data(), s_nSize, s_nSize, s_nSize ), arrTypes ) );
+	}
+
+	ABC_CHECK( trainer.SaveTrainingResult( "coarse_objec.yml", "coarse_metal.yml" ) );
+
+	CRegionTypeClassifier classifier;
+	ABC_CHECK( classifier.Initialize( _T( "coarse_objec.yml" ), _T( "coarse_metal.yml" ) ) );
+
+	// other objects, sharp and fading
+	for ( int f = 0; f < 8; f ++ )
+	{
+		const std::vector< WORD > vecPixels = ( f % 2 == 0 ) ? test::MakeFrame( s_nSize, s_nSize, 65 + f * 20, 40 + f ) : MakeSoftFrame( 100 + f * 30, 40 + f );
+		const CFrameSnapshot frame( vecPixels.data(), s_nSize, s_nSize, s_nSize );
+
+		for ( int nCoarse = 4; nCoarse <= 8; nCoarse *= 2 )
+		{
+			int nDiffers0 = 0, nDiffers05 = 0;
+			CheckFrame( classifier, nCoarse, frame, &nDiffers0, &nDiffers05 );
+			ABC_CHECK( nDiffers0 * 8 <= s_nBlocks );
+			ABC_CHECK( nDiffers05 * 16 <= s_nBlocks );
+		}
+	}
+
+	// the same pixels in every block, the cells are the blocks
+	std::vector< WORD > vecPixels( s_nSize * s_nSize );
+	test::CRandom random( 50 );
+
+	for ( int y = 0; y < s_nBlock; y ++ )
+	for ( int x = 0; x < s_nBlock; x ++ )
+	{
+		const WORD w = (WORD)( 20000 + random.Next() % 8000 );
+
+		for ( int by = 0; by < ABC_REGION_DIVIDE; by ++ )
+		for ( int bx = 0; bx < ABC_REGION_DIVIDE; bx ++ )
+			vecPixels[ ( by * s_nBlock + y ) * s_nSize + bx * s_nBlock + x ] = w;
+	}
+
+	const CFrameSnapshot frame( vecPixels.data(), s_nSize, s_nSize, s_nSize );
+
+	for ( int nCoarse = 4; nCoarse <= 8; nCoarse *= 2 )
+	{
+		int nDiffers0 = 0, nDiffers05 = 0;
+		CheckFrame( classifier, nCoarse, frame, &nDiffers0, &nDiffers05 );
+		ABC_CHECK( nDiffers0 == 0 );
+	}
+
+	ABC_CHECK( classifier.SetCoarseToFine( 0 ) );
+
+	return ABC_TEST_RESULT();
+}
@@ -0,0 +1,135 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A frame dark outside a collimator field: CCollimation::Detect(...) finds the blocks of the field, a dark block
+// inside it stays exposed, and a dark frame has no field. The classifier detecting the field classifies as it does
+// with the field given as a rectangle and as a mask, the blocks outside it are background.
+
+#include "abc_test.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/FrameSnapshot.h"
+#include "Collimation.h"
+
+// platform
+#include <cstring>
+
+using namespace comed::abc;
+
+namespace
+{
+	const int s_nSize = 512;
+	const int s_nBlock = s_nSize / ABC_REGION_DIVIDE;
+
+	// the field in blocks, right and bottom excluded
+	const int s_nLeft = 3, s_nTop = 2, s_nRight = 13, s_nBottom = 14;
+
+	struct Result
+	{
+		RegionType arrResult[ ABC_REGION_DIVIDE_2 ];
+		int nNumObjBlocks, nMeanObjBlocks, nMinObj, nMaxObj;
+
+		bool operator==( const Result& other ) const
+		{
+			return nNumObjBlocks == other.nNumObjBlocks && nMeanObjBlocks == other.nMeanObjBlocks
+				&& nMinObj == other.nMinObj && nMaxObj == other.nMaxObj
+				&& memcmp( arrResult, other.arrResult, sizeof( arrResult ) ) == 0;
+		}
+	};
+
+	Result Classfy( const CRegionTypeClassifier& classifier, const CFrameSnapshot& frame )
+	{
+		Result result;
+		ABC_CHECK( classifier.ClassfyRegion( frame, result.arrResult, &result.nNumObjBlocks, &result.nMeanObjBlocks, &result.nMinObj, &result.nMaxObj ) );
+		return result;
+	}
+
+	bool InField( int bi )
+	{
+		const int bx = bi % ABC_REGION_DIVIDE, by = bi / ABC_REGION_DIVIDE;
+		return bx >= s_nLeft && bx < s_nRight && by >= s_nTop && by < s_nBottom;
+	}
+}
+
+int main(void)
+{
+	ABC_CHECK( test::WriteNetwork( "collimation_objec.yml", ABC_FEATURE_COUNT, 24, 91 ) );
+	ABC_CHECK( test::WriteNetwork( "collimation_metal.yml", ABC_FEATURE_COUNT, 16, 92 ) );
+
+	// the object in the field, the pixels outside below 1 % of the background
+	std::vector< WORD > vecPixels = test::MakeFrame( s_nSize, s_nSize, 70, 93 );
+	test::CRandom random( 94 );
+
+	for ( int y = 0; y < s_nSize; y ++ )
+	for ( int x = 0; x < s_nSize; x ++ )
+	{
+		if ( ! InField( x / s_nBlock + y / s_nBlock * ABC_REGION_DIVIDE ) )
+			vecPixels[ y * s_nSize + x ] = (WORD)( 100 + random.Next() % 100 );
+	}
+
+	// a block inside as dark as outside, at the edge of the field
+	for ( int y = 0; y < s_nBlock; y ++ )
+	for ( int x = 0; x < s_nBlock; x ++ )
+		vecPixels[ ( 7 * s_nBlock + y ) * s_nSize + s_nLeft * s_nBlock + x ] = 150;
+
+	const CFrameSnapshot frame( vecPixels.data(), s_nSize, s_nSize, s_nSize );
+
+	// the detected field
+	bool abExposed[ ABC_REGION_DIVIDE_2 ];
+	ABC_CHECK( CCollimation::Detect( vecPixels.data(), s_nSize, s_nBlock, s_nBlock, ABC_REGION_DIVIDE, 0.1, abExposed ) );
+
+	int nExposed = 0;
+	for ( int bi = 0; bi < ABC_REGION_DIVIDE_2; bi ++ )
+	{
+		ABC_CHECK( abExposed[ bi ] == InField( bi ) );
+		nExposed += abExposed[ bi ];
+	}
+	ABC_CHECK( nExposed == ( s_nRight - s_nLeft ) * ( s_nBottom - s_nTop ) );
+
+	// a dark frame has none
+	const std::vector< WORD > vecDark( s_nSize * s_nSize, 0 );
+	ABC_CHECK( ! CCollimation::Detect( vecDark.data(), s_nSize, s_nBlock, s_nBlock, ABC_REGION_DIVIDE, 0.1, abExposed ) );
+
+	// the classifier detecting it, given the rectangle and given the mask
+	CRegionTypeClassifier classifier;
+	ABC_CHECK( classifier.Initialize( _T( "collimation_objec.yml" ), _T( "collimation_metal.yml" ) ) );
+
+	const Result none = Classfy( classifier, frame );
+
+	ABC_CHECK( classifier.SetCollimation( kABCCollimation_Auto ) );
+	const Result detected = Classfy( classifier, frame );
+
+	const RECT rcField = { s_nLeft * s_nBlock, s_nTop * s_nBlock, s_nRight * s_nBlock, s_nBottom * s_nBlock };
+	ABC_CHECK( classifier.SetCollimation( kABCCollimation_Rect, &rcField ) );
+	ABC_CHECK( Classfy( classifier, frame ) == detected );
+
+	bool abField[ ABC_REGION_DIVIDE_2 ];
+	for ( int bi = 0; bi < ABC_REGION_DIVIDE_2; bi ++ )
+		abField[ bi ] = InField( bi );
+	classifier.SetExposureMask( abField );
+	ABC_CHECK( Classfy( classifier, frame ) == detected );
+
+	// the blocks outside are background, the dark pixels are not in the global features
+	int nOutside = 0;
+	for ( int bi = 0; bi < ABC_REGION_DIVIDE_2; bi ++ )
+	{
+		if ( InField( bi ) )
+			continue;
+
+		ABC_CHECK( detected.arrResult[ bi ].bBackground && ! detected.arrResult[ bi ].bMetal );
+		nOutside += ! none.arrResult[ bi ].bBackground || none.arrResult[ bi ].bMetal;
+	}
+
+	printf( "%d blocks outside the field not background without collimation\n", nOutside );
+	ABC_CHECK( ! ( detected == none ) );
+
+	// a dark frame is used whole
+	const CFrameSnapshot dark( vecDark.data(), s_nSize, s_nSize, s_nSize );
+
+	ABC_CHECK( classifier.SetCollimation( kABCCollimation_Auto ) );
+	const Result darkDetected = Classfy( classifier, dark );
+
+	ABC_CHECK( classifier.SetCollimation( kABCCollimation_None ) );
+	ABC_CHECK( Classfy( classifier, dark ) == darkDetected );
+
+	return ABC_TEST_RESULT();
+}
@@ -0,0 +1,234 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Several contexts on one classifier while InitializeAsync replaces its networks: every frame is classified
+// as one of the two networks classify it alone. A pool busy with the job of one thread runs the others inline.
+
+#include "abc_test.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/RegionTypeWorkspace.h"
+#include "abc/RegionTypeStream.h"
+#include "abc/FrameSnapshot.h"
+#include "ThreadPool.h"
+
+// platform
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+using namespace comed::abc;
+
+namespace
+{
+	const int s_nFrames = 4;
+	const int s_nSize = 512;
+
+	const TCHAR* const s_apszModels[ 2 ][ 2 ] =
+	{
+		{ _T( "contexts_objec_0.yml" ), _T( "contexts_metal_0.yml" ) },
+		{ _T( "contexts_objec_1.yml" ), _T( "contexts_metal_1.yml" ) },
+	};
+
+	struct Result
+	{
+		RegionType arrResult[ ABC_REGION_DIVIDE_2 ];
+		int nNumObjBlocks, nMeanObjBlocks, nMinObj, nMaxObj;
+
+		bool operator==( const Result& other ) const
+		{
+			return nNumObjBlocks == other.nNumObjBlocks && nMeanObjBlocks == other.nMeanObjBlocks
+				&& nMinObj == other.nMinObj && nMaxObj == other.nMaxObj
+				&& memcmp( arrResult, other.arrResult, sizeof( arrResult ) ) == 0;
+		}
+	};
+
+	// a thread holding the workers does not keep another one waiting: its task waits for the job of the other thread
+	void CheckBusyPool(void)
+	{
+		CThreadPool pool( 2 );
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool bOtherDone = false, bHolding = false, bWaited = false;
+		int anWorkers[ 8 ] = { 0 };
+
+		std::thread thread( [&]()
+		{
+			pool.ParallelFor( 2, [&]( int nTask, int nWorker )
+			{
+				UNREFERENCED_PARAMETER( nWorker );
+				if ( nTask != 0 )
+					return;
+
+				std::unique_lock< std::mutex > lock( mutex );
+				bHolding = true;
+				cv.notify_all();
+				bWaited = cv.wait_for( lock, std::chrono::seconds( 10 ), [&]() { return bOtherDone; } );
+			} );
+		} );
+
+		{
+			std::unique_lock< std::mutex > lock( mutex );
+			cv.wait( lock, [&]() { return bHolding; } );
+		}
+
+		pool.ParallelFor( 8, [&]( int nTask, int nWorker ) { anWorkers[ nTask ] = nWorker + 1; } );
+
+		{
+			std::lock_guard< std::mutex > lock( mutex );
+			bOtherDone = true;
+		}
+		cv.notify_all();
+		thread.join();
+
+		// the other job ran on its thread while the first held the workers
+		ABC_CHECK( bWaited );
+		for ( int i = 0; i < 8; i ++ )
+			ABC_CHECK( anWorkers[ i ] == 1 );
+	}
+}
+
+int main( int argc, char* argv[] )
+{
+	// frames a thread, a larger number for a longer run
+	const int nCount = argc > 1 ? atoi( argv[ 1 ] ) : 24;
+	const int nContexts = 4;
+
+	CheckBusyPool();
+
+	ABC_CHECK( test::WriteNetwork( "contexts_objec_0.yml", ABC_FEATURE_COUNT, 28, 31 ) );
+	ABC_CHECK( test::WriteNetwork( "contexts_metal_0.yml", ABC_FEATURE_COUNT, 20, 32 ) );
+	ABC_CHECK( test::WriteNetwork( "contexts_objec_1.yml", ABC_FEATURE_COUNT, 24, 33 ) );
+	ABC_CHECK( test::WriteNetwork( "contexts_metal_1.yml", ABC_FEATURE_COUNT, 16, 34 ) );
+
+	std::vector< std::vector< WORD > > vecPixels;
+	for ( int f = 0; f < s_nFrames; f ++ )
+		vecPixels.push_back( test::MakeFrame( s_nSize, s_nSize, 60 + f * 20, f ) );
+
+	// the results of each network alone
+	std::vector< Result > avecExpected[ 2 ];
+	for ( int m = 0; m < 2; m ++ )
+	{
+		CRegionTypeClassifier classifier;
+		ABC_CHECK( classifier.Initialize( s_apszModels[ m ][ 0 ], s_apszModels[ m ][ 1 ] ) );
+
+		avecExpected[ m ].resize( s_nFrames );
+		for ( int f = 0; f < s_nFrames; f ++ )
+		{
+			const CFrameSnapshot frame( vecPixels[ f ].data(), s_nSize, s_nSize, s_nSize );
+			Result& expected = avecExpected[ m ][ f ];
+			ABC_CHECK( classifier.ClassfyRegion( frame, expected.arrResult, &expected.nNumObjBlocks, &expected.nMeanObjBlocks, &expected.nMinObj, &expected.nMaxObj ) );
+		}
+	}
+
+	// the swaps are seen
+	int nDiffer = 0;
+	for ( int f = 0; f < s_nFrames; f ++ )
+		nDiffer += ! ( avecExpected[ 0 ][ f ] == avecExpected[ 1 ][ f ] );
+	ABC_CHECK( nDiffer > 0 );
+
+	CRegionTypeClassifier classifier;
+	ABC_CHECK( classifier.Initialize( s_apszModels[ 0 ][ 0 ], s_apszModels[ 0 ][ 1 ] ) );
+	ABC_CHECK( classifier.SetWorkerCount( 2 ) );
+	const UINT nVersion = classifier.GetModelVersion();
+
+	std::atomic< int > nMismatches( 0 ), nDone( 0 );
+
+	// a result of either network
+	auto fnCheck = [&]( const Result& result, int f )
+	{
+		if ( ! ( result == avecExpected[ 0 ][ f ] ) && ! ( result == avecExpected[ 1 ][ f ] ) )
+			nMismatches ++;
+		nDone ++;
+	};
+
+	std::vector< std::thread > vecThreads;
+
+	// contexts with the pool of the classifier ( 0 ), the calling thread ( 1 ) and a pool of their own ( 2 )
+	for ( int t = 0; t < nContexts; t ++ )
+	{
+		vecThreads.push_back( std::thread( [&, t]()
+		{
+			CRegionTypeWorkspace workspace;
+			VERIFY( workspace.SetWorkerCount( t % 3 ) );
+
+			for ( int i = 0; i < nCount; i ++ )
+			{
+				const int f = ( t + i ) % s_nFrames;
+				const CFrameSnapshot frame( vecPixels[ f ].data(), s_nSize, s_nSize, s_nSize );
+				Result result;
+				classifier.ClassfyRegion( frame, &workspace, result.arrResult, &result.nNumObjBlocks, &result.nMeanObjBlocks, &result.nMinObj, &result.nMaxObj );
+				fnCheck( result, f );
+			}
+		} ) );
+	}
+
+	// the workspace of the classifier and a stream
+	vecThreads.push_back( std::thread( [&]()
+	{
+		for ( int i = 0; i < nCount; i ++ )
+		{
+			const int f = i % s_nFrames;
+			const CFrameSnapshot frame( vecPixels[ f ].data(), s_nSize, s_nSize, s_nSize );
+			Result result;
+			classifier.ClassfyRegion( frame, result.arrResult, &result.nNumObjBlocks, &result.nMeanObjBlocks, &result.nMinObj, &result.nMaxObj );
+			fnCheck( result, f );
+		}
+	} ) );
+
+	vecThreads.push_back( std::thread( [&]()
+	{
+		CRegionTypeStream stream( classifier );
+
+		for ( int i = 0; i < nCount; i ++ )
+		{
+			const int f = i % s_nFrames;
+			const CFrameSnapshot frame( vecPixels[ f ].data(), s_nSize, s_nSize, s_nSize );
+			Result result;
+			stream.ClassfyRegion( frame, result.arrResult, &result.nNumObjBlocks, &result.nMeanObjBlocks, &result.nMinObj, &result.nMaxObj );
+			fnCheck( result, f );
+		}
+	} ) );
+
+	// the networks are swapped back and forth meanwhile
+	int nSwaps = 0;
+	while ( nDone < ( nContexts + 2 ) * nCount )
+	{
+		if ( ! classifier.IsInitializing() && classifier.InitializeAsync( s_apszModels[ ( nSwaps + 1 ) & 1 ][ 0 ], s_apszModels[ ( nSwaps + 1 ) & 1 ][ 1 ] ) )
+			nSwaps ++;
+		std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+	}
+
+	for ( size_t i = 0; i < vecThreads.size(); i ++ )
+		vecThreads[ i ].join();
+
+	while ( classifier.IsInitializing() )
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+
+	ABC_CHECK( nMismatches == 0 );
+	ABC_CHECK( nSwaps > 0 && classifier.GetModelVersion() > nVersion );
+
+	// each precision is published as a new version of the networks
+	{
+		const UINT nFloat = classifier.GetModelVersion();
+		const CFrameSnapshot frame( vecPixels[ 0 ].data(), s_nSize, s_nSize, s_nSize );
+		Result result;
+
+		ABC_CHECK( classifier.SetPrecision( kABCPrecision_Int16 ) );
+		ABC_CHECK( classifier.GetModelVersion() == nFloat + 1 );
+		ABC_CHECK( classifier.ClassfyRegion( frame, result.arrResult, &result.nNumObjBlocks, &result.nMeanObjBlocks, &result.nMinObj, &result.nMaxObj ) );
+
+		ABC_CHECK( classifier.SetPrecision( kABCPrecision_Float ) );
+		ABC_CHECK( classifier.GetModelVersion() == nFloat + 2 );
+		ABC_CHECK( classifier.ClassfyRegion( frame, result.arrResult, &result.nNumObjBlocks, &result.nMeanObjBlocks, &result.nMinObj, &result.nMaxObj ) );
+		ABC_CHECK( result == avecExpected[ 0 ][ 0 ] || result == avecExpected[ 1 ][ 0 ] );
+	}
+
+	printf( "%d frames, %d networks swapped in\n", (int) nDone, nSwaps );
+
+	return ABC_TEST_RESULT();
+}
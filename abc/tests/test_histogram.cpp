@@ -0,0 +1,147 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CHistogramBinning and CValueHistogram against counting the pixels one by one.
+
+#include "abc_test.h"
+#include "Histogram.h"
+
+// platform
+#include <cstring>
+
+using namespace comed::abc;
+
+namespace
+{
+	// the bin as defined: floor( ( w - wMin ) * HISTSIZE / ( wMax - wMin + 1 ) ), exact.
+	// The double factor of the original histogram rounds down at some exact bin boundaries ( 49 of 98 values ).
+	int BinOf( WORD w, WORD wMin, WORD wMax )
+	{
+		return (int)( (UINT64)( w - wMin ) * HISTSIZE / ( wMax - wMin + 1 ) );
+	}
+
+	// histogram of a block, pixels above the bit depth counted as its top value
+	void CountBlock( const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH, WORD wTop, WORD wMin, WORD wMax, OUT int anHist[] )
+	{
+		memset( anHist, 0, sizeof(int) * HISTSIZE );
+		for ( int y=0; y<nBlkH; y++ )
+		for ( int x=0; x<nBlkW; x++ )
+			anHist[ BinOf( CLU_MIN( pwBlk[ y * nStrider + x ], wTop ), wMin, wMax ) ] ++;
+	}
+
+	// random block of nBits bits, some pixels above them when bOver
+	void MakeBlock( test::CRandom& random, int nBits, int nRange, bool bOver, std::vector< WORD >* pvecBlk )
+	{
+		const int nTop = ( 1 << nBits ) - 1;
+		const int nBase = random.Next() % ( nTop + 1 );
+
+		for ( size_t i = 0; i < pvecBlk->size(); i ++ )
+		{
+			int n = CLU_MIN( nBase + (int)( random.Next() % nRange ), nTop );
+			if ( bOver && random.Next() % 16 == 0 )
+				n = nTop + 1 + random.Next() % ( 0xffff - nTop + 1 );
+			( *pvecBlk )[ i ] = (WORD) CLU_MIN( n, 0xffff );
+		}
+	}
+
+	void CheckBinning(void)
+	{
+		test::CRandom random( 3 );
+
+		// every value of random ranges, all widths of the small ones
+		for ( int n = 0; n < 3000; n ++ )
+		{
+			const int nWidth = ( n < 1024 ) ? n + 1 : 1 + random.Next() % 0x10000;
+			const WORD wMin = (WORD)( random.Next() % ( 0x10000 - nWidth + 1 ) );
+			const WORD wMax = (WORD)( wMin + nWidth - 1 );
+			const CHistogramBinning binning( wMin, wMax );
+
+			int nBad = 0;
+			for ( int w = wMin; w <= wMax; w ++ )
+				nBad += binning( (WORD) w ) != BinOf( (WORD) w, wMin, wMax );
+			ABC_CHECK( nBad == 0 );
+		}
+
+		const CHistogramBinning binning( 0, 0xffff );
+		ABC_CHECK( binning( 0xffff ) == HISTSIZE - 1 );
+	}
+
+	void CheckValueHistogram( int nBits )
+	{
+		const WORD wTop = (WORD)( ( 1 << nBits ) - 1 );
+		const int nBlkW = 37, nBlkH = 29, nStrider = 41;
+
+		test::CRandom random( nBits );
+		CValueHistogram hist( true, nBits ), target( false, nBits );
+		std::vector< int > vecTarget( wTop + 1 );
+		std::vector< WORD > vecBlk( nStrider * nBlkH );
+
+		for ( int n = 0; n < 200; n ++ )
+		{
+			// narrow ranges walk the values, wide ones the pixels
+			const int nRange = ( n % 3 == 0 ) ? 1 + random.Next() % 64 : 1 + random.Next() % ( wTop + 1 );
+			const bool bOver = nBits < 16 && n % 4 == 1;
+			MakeBlock( random, nBits, nRange, bOver, &vecBlk );
+
+			WORD wMin = 0xffff, wMax = 0;
+			for ( int y=0; y<nBlkH; y++ )
+			{
+				hist.AddLine( &vecBlk[ y * nStrider ], nBlkW );
+				for ( int x=0; x<nBlkW; x++ )
+				{
+					const WORD w = vecBlk[ y * nStrider + x ];
+					wMin = CLU_MIN( wMin, w );
+					wMax = CLU_MAX( wMax, w );
+					vecTarget[ CLU_MIN( w, wTop ) ] ++;
+				}
+			}
+
+			int anHist[ HISTSIZE ], anRef[ HISTSIZE ];
+			const WORD wMinC = CLU_MIN( wMin, wTop ), wMaxC = CLU_MIN( wMax, wTop );
+			const bool bBinned = hist.Collapse( wMin, wMax, anHist, &target, ( n & 1 ) ? &vecBlk[ 0 ] : nullptr, nStrider, nBlkW, nBlkH );
+
+			ABC_CHECK( bBinned == ( wMinC != wMaxC ) );
+			if ( bBinned )
+			{
+				CountBlock( &vecBlk[ 0 ], nStrider, nBlkW, nBlkH, wTop, wMinC, wMaxC, anRef );
+				ABC_CHECK( memcmp( anHist, anRef, sizeof( anRef ) ) == 0 );
+			}
+		}
+
+		// the target got every block, and collapsing cleared the banks
+		int anHist[ HISTSIZE ], anRef[ HISTSIZE ] = { 0 };
+		ABC_CHECK( target.Bin( 0, wTop, anHist ) );
+		for ( int w = 0; w <= wTop; w ++ )
+			anRef[ BinOf( (WORD) w, 0, wTop ) ] += vecTarget[ w ];
+		ABC_CHECK( memcmp( anHist, anRef, sizeof( anRef ) ) == 0 );
+
+		const WORD wLine[ 2 ] = { 0, wTop };
+		hist.AddLine( wLine, 2 );
+		ABC_CHECK( hist.Collapse( 0, wTop, anHist, nullptr, nullptr, 0, 0, 0 ) );
+		ABC_CHECK( anHist[ 0 ] == 1 && anHist[ HISTSIZE - 1 ] == 1 );
+
+		// removing the last block gives the histogram without it
+		for ( int y=0; y<nBlkH; y++ )
+		for ( int x=0; x<nBlkW; x++ )
+			vecTarget[ CLU_MIN( vecBlk[ y * nStrider + x ], wTop ) ] --;
+		target.RemoveBlock( &vecBlk[ 0 ], nStrider, nBlkW, nBlkH );
+
+		memset( anRef, 0, sizeof( anRef ) );
+		for ( int w = 0; w <= wTop; w ++ )
+			anRef[ BinOf( (WORD) w, 0, wTop ) ] += vecTarget[ w ];
+		ABC_CHECK( target.Bin( 0, wTop, anHist ) );
+		ABC_CHECK( memcmp( anHist, anRef, sizeof( anRef ) ) == 0 );
+	}
+}
+
+int main(void)
+{
+	CheckBinning();
+
+	CheckValueHistogram( 8 );
+	CheckValueHistogram( 12 );
+	CheckValueHistogram( 14 );
+	CheckValueHistogram( 16 );
+
+	return ABC_TEST_RESULT();
+}
@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The fused engine against CvANN_MLP::predict of the same networks, computed in double from their weights.
+
+#include "abc_test.h"
+#include "MLPEngine.h"
+
+using namespace comed::abc;
+
+int main(void)
+{
+	// hidden sizes that are and are not a multiple of the SIMD width
+	const test::Network netObjec = test::MakeNetwork( ABC_FEATURE_COUNT, 28, 11 );
+	const test::Network netMetal = test::MakeNetwork( ABC_FEATURE_COUNT, 13, 12 );
+
+	ABC_CHECK( test::WriteNetwork( "mlp_objec.yml", netObjec ) );
+	ABC_CHECK( test::WriteNetwork( "mlp_metal.yml", netMetal ) );
+
+	CMLPEngine engine;
+	ABC_CHECK( ! engine.IsLoaded() );
+	ABC_CHECK( ! engine.Load( _T( "mlp_objec.yml" ), _T( "mlp_missing.yml" ) ) );
+	ABC_CHECK( engine.Load( _T( "mlp_objec.yml" ), _T( "mlp_metal.yml" ) ) );
+	ABC_CHECK( engine.GetInputCount() == ABC_FEATURE_COUNT );
+	ABC_CHECK( engine.GetPrecision() == kABCPrecision_Float );
+
+	// rows of features, padded like the feature matrix
+	const int nRows = 37, nStride = ABC_FEATURE_COUNT + 2;
+	test::CRandom random( 13 );
+	std::vector< double > vecRows( nRows * nStride );
+	for ( size_t i = 0; i < vecRows.size(); i ++ )
+		vecRows[ i ] = random.Uniform( -0.1, 1.1 );
+
+	// every count of rows, up to more than a pass of the engine
+	for ( int n = 1; n <= nRows; n ++ )
+	{
+		std::vector< double > vecObjec( n ), vecMetal( n );
+		engine.Predict( vecRows.data(), nStride, nullptr, n, vecObjec.data(), vecMetal.data() );
+
+		for ( int r = 0; r < n; r ++ )
+		{
+			ABC_CHECK_NEAR( vecObjec[ r ], test::PredictNetwork( netObjec, &vecRows[ r * nStride ] ), 1e-5 );
+			ABC_CHECK_NEAR( vecMetal[ r ], test::PredictNetwork( netMetal, &vecRows[ r * nStride ] ), 1e-5 );
+		}
+	}
+
+	// selected rows, the outputs at the index of the row and nothing else written
+	{
+		const int anRows[] = { 3, 4, 9, 20, 21, 22, 36 };
+		const int nSelected = sizeof( anRows ) / sizeof( anRows[ 0 ] );
+		std::vector< double > vecObjec( nRows, -100.0 ), vecMetal( nRows, -100.0 );
+
+		engine.Predict( vecRows.data(), nStride, anRows, nSelected, vecObjec.data(), vecMetal.data() );
+
+		int nWritten = 0;
+		for ( int r = 0; r < nRows; r ++ )
+			nWritten += ( vecObjec[ r ] != -100.0 );
+		ABC_CHECK( nWritten == nSelected );
+
+		for ( int k = 0; k < nSelected; k ++ )
+		{
+			const int r = anRows[ k ];
+			ABC_CHECK_NEAR( vecObjec[ r ], test::PredictNetwork( netObjec, &vecRows[ r * nStride ] ), 1e-5 );
+			ABC_CHECK_NEAR( vecMetal[ r ], test::PredictNetwork( netMetal, &vecRows[ r * nStride ] ), 1e-5 );
+		}
+	}
+
+	// a copy predicts the same, and is quantized without the source
+	{
+		std::vector< double > vecObjec( nRows ), vecMetal( nRows ), vecCopyObjec( nRows ), vecCopyMetal( nRows );
+		engine.Predict( vecRows.data(), nStride, nullptr, nRows, vecObjec.data(), vecMetal.data() );
+
+		CMLPEngine copy;
+		ABC_CHECK( copy.CopyFrom( engine ) );
+		copy.Predict( vecRows.data(), nStride, nullptr, nRows, vecCopyObjec.data(), vecCopyMetal.data() );
+		ABC_CHECK( vecCopyObjec == vecObjec && vecCopyMetal == vecMetal );
+
+		ABC_CHECK( copy.Quantize( kABCPrecision_Int16 ) );
+		ABC_CHECK( copy.GetPrecision() == kABCPrecision_Int16 && engine.GetPrecision() == kABCPrecision_Float );
+
+		// the weights of a mapped file outlive it
+		CMLPEngine mapped, copyMapped;
+		ABC_CHECK( engine.SaveBinary( _T( "mlp.bin" ) ) );
+		ABC_CHECK( mapped.LoadBinary( _T( "mlp.bin" ) ) );
+		ABC_CHECK( copyMapped.CopyFrom( mapped ) );
+		mapped.Reset();
+		copyMapped.Predict( vecRows.data(), nStride, nullptr, nRows, vecCopyObjec.data(), vecCopyMetal.data() );
+		ABC_CHECK( vecCopyObjec == vecObjec && vecCopyMetal == vecMetal );
+
+		ABC_CHECK( ! copy.CopyFrom( mapped ) && ! copy.IsLoaded() );
+	}
+
+	// networks of different inputs can not be fused
+	ABC_CHECK( test::WriteNetwork( "mlp_12.yml", 12, 8, 14 ) );
+	CMLPEngine engine12;
+	ABC_CHECK( ! engine12.Load( _T( "mlp_objec.yml" ), _T( "mlp_12.yml" ) ) );
+
+	return ABC_TEST_RESULT();
+}
@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Model files of CMLPEngine::SaveBinary(...): the round trip, replacing a mapped file, and damaged files.
+
+#include "abc_test.h"
+#include "MLPEngine.h"
+
+// platform
+#include <fstream>
+#include <iterator>
+
+using namespace comed::abc;
+
+namespace
+{
+	// predictions of fixed random rows
+	std::vector< double > Predict( const CMLPEngine& engine )
+	{
+		const int nRows = 19;
+		test::CRandom random( 41 );
+		std::vector< double > vecRows( nRows * ABC_FEATURE_COUNT ), vecOut( nRows * 2 );
+		for ( size_t i = 0; i < vecRows.size(); i ++ )
+			vecRows[ i ] = random.Uniform( 0.0, 1.0 );
+
+		engine.Predict( vecRows.data(), ABC_FEATURE_COUNT, nullptr, nRows, &vecOut[ 0 ], &vecOut[ nRows ] );
+		return vecOut;
+	}
+
+	std::string ReadFile( const char* pszPath )
+	{
+		std::ifstream file( pszPath, std::ios::in | std::ios::binary );
+		return std::string( std::istreambuf_iterator< char >( file ), std::istreambuf_iterator< char >() );
+	}
+
+	void WriteFile( const char* pszPath, const std::string& strData )
+	{
+		std::ofstream file( pszPath, std::ios::out | std::ios::binary | std::ios::trunc );
+		file.write( strData.c_str(), (std::streamsize) strData.size() );
+	}
+
+	// a copy of the model file with the byte at nOffset changed, or cut at nOffset
+	bool LoadDamaged( const std::string& strModel, size_t nOffset, bool bCut )
+	{
+		std::string strDamaged = strModel;
+		if ( bCut )
+			strDamaged.resize( nOffset );
+		else
+			strDamaged[ nOffset ] ^= 0x10;
+		WriteFile( "model_damaged.bin", strDamaged );
+
+		CMLPEngine engine;
+		const bool bLoaded = engine.LoadBinary( _T( "model_damaged.bin" ) );
+		ABC_CHECK( bLoaded == engine.IsLoaded() );
+		return bLoaded;
+	}
+}
+
+int main(void)
+{
+	ABC_CHECK( test::WriteNetwork( "model_objec_a.yml", ABC_FEATURE_COUNT, 28, 51 ) );
+	ABC_CHECK( test::WriteNetwork( "model_metal_a.yml", ABC_FEATURE_COUNT, 20, 52 ) );
+	ABC_CHECK( test::WriteNetwork( "model_objec_b.yml", ABC_FEATURE_COUNT, 24, 53 ) );
+	ABC_CHECK( test::WriteNetwork( "model_metal_b.yml", ABC_FEATURE_COUNT, 16, 54 ) );
+
+	CMLPEngine engineA, engineB;
+	ABC_CHECK( engineA.Load( _T( "model_objec_a.yml" ), _T( "model_metal_a.yml" ) ) );
+	ABC_CHECK( engineB.Load( _T( "model_objec_b.yml" ), _T( "model_metal_b.yml" ) ) );
+
+	const std::vector< double > vecA = Predict( engineA ), vecB = Predict( engineB );
+	ABC_CHECK( vecA != vecB );
+
+	// the round trip predicts the same
+	ABC_CHECK( engineA.SaveBinary( _T( "model.bin" ) ) );
+
+	CMLPEngine mappedA;
+	ABC_CHECK( mappedA.LoadBinary( _T( "model.bin" ) ) );
+	ABC_CHECK( Predict( mappedA ) == vecA );
+
+	// Replacing the file while it is mapped: the mapping keeps the old model, a new load gets the new one.
+	// Truncating the file in place would fault ( SIGBUS ) on the next prediction of mappedA.
+	ABC_CHECK( engineB.SaveBinary( _T( "model.bin" ) ) );
+	ABC_CHECK( Predict( mappedA ) == vecA );
+
+	CMLPEngine mappedB;
+	ABC_CHECK( mappedB.LoadBinary( _T( "model.bin" ) ) );
+	ABC_CHECK( Predict( mappedB ) == vecB );
+
+	// nothing is left behind, or written where the directory does not exist
+	ABC_CHECK( ! std::ifstream( "model.bin.tmp" ).good() );
+	ABC_CHECK( ! engineA.SaveBinary( _T( "no_such_directory/model.bin" ) ) );
+
+	// damaged files are refused: the header ( magic, sizes, bias, scale, shift ), the weights, the size
+	const std::string strModel = ReadFile( "model.bin" );
+	ABC_CHECK( strModel.size() > 64 );
+	ABC_CHECK( ! LoadDamaged( strModel, 0, false ) );
+	ABC_CHECK( ! LoadDamaged( strModel, 4, false ) );
+	for ( size_t nOffset = 16; nOffset < 56; nOffset ++ )
+		ABC_CHECK( ! LoadDamaged( strModel, nOffset, false ) );
+	ABC_CHECK( ! LoadDamaged( strModel, 64, false ) );
+	ABC_CHECK( ! LoadDamaged( strModel, strModel.size() - 1, false ) );
+	ABC_CHECK( ! LoadDamaged( strModel, strModel.size() - 4, true ) );
+	ABC_CHECK( ! LoadDamaged( strModel, 32, true ) );
+
+	// sizes out of range are refused before they are used
+	{
+		std::string strHuge = strModel;
+		const int nHuge = 0x7fffffff;
+		strHuge.replace( 20, sizeof( nHuge ), reinterpret_cast< const char* >( &nHuge ), sizeof( nHuge ) );
+		WriteFile( "model_damaged.bin", strHuge );
+
+		CMLPEngine engine;
+		ABC_CHECK( ! engine.LoadBinary( _T( "model_damaged.bin" ) ) );
+	}
+
+	CMLPEngine engine;
+	ABC_CHECK( ! engine.LoadBinary( _T( "no_such_model.bin" ) ) );
+
+	return ABC_TEST_RESULT();
+}
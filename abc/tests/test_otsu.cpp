@@ -0,0 +1,155 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// COtsu against the O(bins^2) variance loop it replaced, and against the textbook definition.
+
+#include "abc_test.h"
+#include "Otsu.h"
+#include "Histogram.h"
+
+using namespace comed::abc;
+
+namespace
+{
+	// the otsu of the original CFeatureGen::_calcOtsu, on a histogram
+	void CalcOtsuLoop( const int anHist[], int nHistSize, double* pdOtsu, double* pdInner, double* pdInter, double* pdMode )
+	{
+		std::vector< int > vecCum( nHistSize ), vecCumMul( nHistSize );
+		int nSum = 0, nMulSum = 0, nMode = 0;
+
+		for ( int i=0; i<nHistSize; i++ )
+		{
+			nSum	+= anHist[ i ];
+			nMulSum += anHist[ i ] * i;
+			vecCum[ i ] = nSum;
+			vecCumMul[ i ] = nMulSum;
+
+			if ( anHist[ nMode ] < anHist[ i ] )
+				nMode = i;
+		}
+		*pdMode = (double) nMode / nHistSize;
+
+		std::vector< double > vecInner( nHistSize ), vecInter( nHistSize );
+		for ( int i=0; i<nHistSize; i++ )
+		{
+			const double dMeanB = (double) vecCumMul[ i ] / vecCum[ i ];
+			const double dMeanF = (double)( nMulSum - vecCumMul[ i ] ) / ( nSum - vecCum[ i ] );
+
+			double dCumVarB = 0.0, dCumVarF = 0.0;
+			for ( int j=0; j<i; j++ )
+				dCumVarB += CLU_SQUARE( j - dMeanB ) * anHist[ j ];
+			for ( int k=i; k<nHistSize; k++ )
+				dCumVarF += CLU_SQUARE( k - dMeanF ) * anHist[ k ];
+
+			const double dWeightB = vecCum[ i ] / (double) nSum;
+			const double dWeightF = 1.0 - dWeightB;
+
+			vecInner[ i ] = dWeightB * dCumVarB / vecCum[ i ] + dWeightF * dCumVarF / ( nSum - vecCum[ i ] );
+			vecInter[ i ] = dWeightB * dWeightF * CLU_SQUARE( dMeanB - dMeanF );
+		}
+
+		double dMax = 0.0;
+		int nMax = 0;
+		for ( int i=0; i<nHistSize; i++ )
+		{
+			if ( vecInter[ i ] / vecInner[ i ] > dMax )
+			{
+				dMax = vecInter[ i ] / vecInner[ i ];
+				nMax = i;
+			}
+		}
+
+		*pdOtsu = (double) nMax / nHistSize;
+		*pdInner = vecInner[ nMax ];
+		*pdInter = vecInter[ nMax ];
+	}
+
+	// the textbook otsu: the threshold t of the largest between class variance of [0, t] and (t, bins)
+	int CalcOtsuStandard( const int anHist[], int nHistSize )
+	{
+		double dMax = -1.0;
+		int nMax = 0;
+
+		for ( int t=0; t<nHistSize - 1; t++ )
+		{
+			double dCntB = 0, dSumB = 0, dCntF = 0, dSumF = 0;
+			for ( int i=0; i<nHistSize; i++ )
+			{
+				( i <= t ? dCntB : dCntF ) += anHist[ i ];
+				( i <= t ? dSumB : dSumF ) += (double) anHist[ i ] * i;
+			}
+			if ( dCntB == 0 || dCntF == 0 )
+				continue;
+
+			const double dN = dCntB + dCntF;
+			const double dInter = dCntB / dN * dCntF / dN * CLU_SQUARE( dSumB / dCntB - dSumF / dCntF );
+			if ( dInter > dMax * ( 1.0 + 1e-12 ) )
+			{
+				dMax = dInter;
+				nMax = t;
+			}
+		}
+		return nMax;
+	}
+
+	// random histogram of two humps, with empty bins around and between them
+	void MakeHistogram( test::CRandom& random, int nHistSize, OUT int anHist[] )
+	{
+		const int nFirst = random.Next() % ( nHistSize / 2 );
+		const int nSecond = nHistSize / 2 + random.Next() % ( nHistSize / 2 );
+		const int nWidth = 1 + random.Next() % ( nHistSize / 8 );
+
+		for ( int i=0; i<nHistSize; i++ )
+		{
+			const int nDist = CLU_MIN( abs( i - nFirst ), abs( i - nSecond ) );
+			anHist[ i ] = ( nDist < nWidth ) ? (int)( random.Next() % 2000 ) * ( nWidth - nDist ) / nWidth : 0;
+		}
+	}
+}
+
+int main(void)
+{
+	test::CRandom random( 7 );
+	int anHist[ 1024 ];
+
+	// the compatible mode is the loop, up to rounding of the moment sums
+	for ( int n = 0; n < 2000; n ++ )
+	{
+		const int nHistSize = ( n & 1 ) ? HISTSIZE : 64 + random.Next() % 960;
+		MakeHistogram( random, nHistSize, anHist );
+
+		double dOtsu, dInner, dInter, dMode;
+		double dRefOtsu, dRefInner, dRefInter, dRefMode;
+		COtsu::Calc( anHist, nHistSize, kOtsuMode_Compatible, &dOtsu, &dInner, &dInter, &dMode );
+		CalcOtsuLoop( anHist, nHistSize, &dRefOtsu, &dRefInner, &dRefInter, &dRefMode );
+
+		ABC_CHECK( dOtsu == dRefOtsu );
+		ABC_CHECK( dMode == dRefMode );
+		ABC_CHECK_NEAR( dInner, dRefInner, 1e-9 * dRefInner );
+		ABC_CHECK_NEAR( dInter, dRefInter, 1e-9 * dRefInter );
+	}
+
+	// the standard mode is the textbook otsu
+	for ( int n = 0; n < 500; n ++ )
+	{
+		MakeHistogram( random, HISTSIZE, anHist );
+
+		double dOtsu, dInner, dInter, dMode;
+		COtsu::Calc( anHist, HISTSIZE, kOtsuMode_Standard, &dOtsu, &dInner, &dInter, &dMode );
+
+		ABC_CHECK( dOtsu == (double) CalcOtsuStandard( anHist, HISTSIZE ) / HISTSIZE );
+	}
+
+	// a flat histogram has no threshold, the first bin is reported
+	{
+		int anFlat[ HISTSIZE ] = { 0 };
+		anFlat[ 17 ] = 100;
+
+		double dOtsu, dInner, dInter, dMode;
+		COtsu::Calc( anFlat, HISTSIZE, kOtsuMode_Standard, &dOtsu, &dInner, &dInter, &dMode );
+		ABC_CHECK( dOtsu == 0.0 );
+		ABC_CHECK( dMode == 17.0 / HISTSIZE );
+	}
+
+	return ABC_TEST_RESULT();
+}
@@ -0,0 +1,128 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CRegionTypePipeline with frames submitted back to back: every frame is classified as ClassfyRegion does,
+// or dropped, also when the callback is slower than the feature generation. With the instrumentation on, the
+// stages of every classified frame are recorded as ClassfyRegion records them.
+
+#include "abc_test.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/RegionTypePipeline.h"
+#include "abc/FrameSnapshot.h"
+
+// platform
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace comed::abc;
+
+namespace
+{
+	const int s_nFrames = 8;
+	const int s_nSize = 256;
+
+	struct Expected
+	{
+		RegionType arrResult[ ABC_REGION_DIVIDE_2 ];
+		int nNumObjBlocks, nMeanObjBlocks, nMinObj, nMaxObj;
+	};
+
+	// submit nSubmit frames nSubmitMs apart ( 0 back to back ), with a callback taking nCallbackMs. The frames classified returned.
+	int RunPipeline( const CRegionTypeClassifier& classifier, const std::vector< CFrameSnapshot >& vecFrames,
+					  const std::vector< Expected >& vecExpected, int nQueueSize, int nCallbackMs, int nSubmitMs, int nSubmit )
+	{
+		std::mutex mutex;
+		std::vector< UINT64 > vecIds;
+		int nMismatches = 0;
+
+		CRegionTypePipeline pipeline( classifier, [&]( const RegionTypeResult& result )
+		{
+			const Expected& expected = vecExpected[ result.ullFrameId % s_nFrames ];
+			const bool bSame = result.nNumObjBlocks == expected.nNumObjBlocks && result.nMeanObjBlocks == expected.nMeanObjBlocks
+							&& result.nMinObj == expected.nMinObj && result.nMaxObj == expected.nMaxObj
+							&& memcmp( result.arrResult, expected.arrResult, sizeof( expected.arrResult ) ) == 0;
+			{
+				std::lock_guard< std::mutex > lock( mutex );
+				vecIds.push_back( result.ullFrameId );
+				nMismatches += ! bSame;
+			}
+			if ( nCallbackMs > 0 )
+				std::this_thread::sleep_for( std::chrono::milliseconds( nCallbackMs ) );
+		}, nQueueSize );
+
+		for ( int i = 0; i < nSubmit; i ++ )
+		{
+			ABC_CHECK( pipeline.Submit( vecFrames[ i % s_nFrames ], i ) );
+			if ( nSubmitMs > 0 )
+				std::this_thread::sleep_for( std::chrono::milliseconds( nSubmitMs ) );
+		}
+		pipeline.Flush();
+
+		std::lock_guard< std::mutex > lock( mutex );
+
+		ABC_CHECK( nMismatches == 0 );
+		ABC_CHECK( vecIds.size() + pipeline.GetDroppedCount() == (size_t) nSubmit );
+		ABC_CHECK( ! vecIds.empty() && vecIds.back() == (UINT64)( nSubmit - 1 ) );
+		for ( size_t i = 1; i < vecIds.size(); i ++ )
+			ABC_CHECK( vecIds[ i - 1 ] < vecIds[ i ] );
+
+		printf( "queue %d, callback %d ms, submit %d ms: %d frames, %d classified, %d dropped\n",
+				nQueueSize, nCallbackMs, nSubmitMs, nSubmit, (int) vecIds.size(), (int) pipeline.GetDroppedCount() );
+
+		return (int) vecIds.size();
+	}
+}
+
+int main(void)
+{
+	ABC_CHECK( test::WriteNetwork( "pipeline_objec.yml", ABC_FEATURE_COUNT, 28, 21 ) );
+	ABC_CHECK( test::WriteNetwork( "pipeline_metal.yml", ABC_FEATURE_COUNT, 20, 22 ) );
+
+	CRegionTypeClassifier classifier;
+	ABC_CHECK( classifier.Initialize( _T( "pipeline_objec.yml" ), _T( "pipeline_metal.yml" ) ) );
+
+	// frames owning their pixels, and their results classified one by one
+	std::vector< CFrameSnapshot > vecFrames;
+	std::vector< Expected > vecExpected( s_nFrames );
+
+	for ( int f = 0; f < s_nFrames; f ++ )
+	{
+		std::shared_ptr< std::vector< WORD > > spPixels( new std::vector< WORD >( test::MakeFrame( s_nSize, s_nSize, 20 + f * 10, f ) ) );
+		vecFrames.push_back( CFrameSnapshot( std::shared_ptr< const WORD >( spPixels, spPixels->data() ), s_nSize, s_nSize, s_nSize ) );
+
+		Expected& expected = vecExpected[ f ];
+		ABC_CHECK( classifier.ClassfyRegion( vecFrames[ f ], expected.arrResult,
+						&expected.nNumObjBlocks, &expected.nMeanObjBlocks, &expected.nMinObj, &expected.nMaxObj ) );
+	}
+
+	// a slow callback: the feature stage finishes frames while the previous one is still predicted
+	RunPipeline( classifier, vecFrames, vecExpected, 1, 20, 0, 40 );
+	RunPipeline( classifier, vecFrames, vecExpected, 1, 10, 2, 40 );
+	RunPipeline( classifier, vecFrames, vecExpected, 4, 5, 1, 40 );
+
+	// a fast callback, most frames get through
+	RunPipeline( classifier, vecFrames, vecExpected, 4, 0, 3, 40 );
+
+	// the stages of the classified frames, the exposure of the dropped ones too
+	classifier.SetInstrumentation( true, 0 );
+	classifier.ResetStageLatency();
+
+	const int nClassified = RunPipeline( classifier, vecFrames, vecExpected, 2, 5, 1, 40 );
+	StageLatency aLatency[ _END_ABC_Stages ];
+
+	for ( int s = 0; s < _END_ABC_Stages; s ++ )
+		classifier.GetStageLatency( (E_ABCStage) s, &aLatency[ s ] );
+
+	ABC_CHECK( aLatency[ kABCStage_Exposure ].nCount >= (UINT) nClassified );
+	ABC_CHECK( aLatency[ kABCStage_Features ].nCount >= (UINT) nClassified );
+	ABC_CHECK( aLatency[ kABCStage_Output ].nCount == (UINT) nClassified );
+	ABC_CHECK( aLatency[ kABCStage_Total ].nCount == (UINT) nClassified );
+	ABC_CHECK( aLatency[ kABCStage_Total ].fMax >= aLatency[ kABCStage_Output ].fMax );
+
+	classifier.SetInstrumentation( false, 0 );
+
+	return ABC_TEST_RESULT();
+}
@@ -0,0 +1,288 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Decimation and the region grids. The features of a frame decimated by 2 or 4 are those of the frame reduced
+// beforehand ( the top left pixel or the rounded mean of each cell ), and 0 halves the frames of 1 MP only.
+// On a frame whose 64 pixel blocks each repeat one 16 pixel tile, the blocks of the 8, 16 and 32 grids hold the same
+// pixels as the blocks they are in: their features and classes are the same. The field is the non-boundary blocks of
+// the 8 grid, so that the global features are of the same pixels on every grid.
+
+#include "abc_test.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/RegionTypeTrainer.h"
+#include "abc/FrameSnapshot.h"
+#include "abc/FeatureBlock.h"
+#include "FeatureGen.h"
+#include "Collimation.h"
+
+// platform
+#include <cstring>
+
+using namespace comed::abc;
+
+namespace
+{
+	const int s_nLarge = 1024;
+	const int s_nSize = 512;
+
+	// the frame reduced by nDecimation as the sampling defines it
+	std::vector< WORD > Reduce( const std::vector< WORD >& vecPixels, int nWidth, int nDecimation, E_ABCSampling eSampling )
+	{
+		const int nReduced = nWidth / nDecimation;
+		std::vector< WORD > vecReduced( nReduced * nReduced );
+
+		for ( int y = 0; y < nReduced; y ++ )
+		for ( int x = 0; x < nReduced; x ++ )
+		{
+			const WORD* pwCell = &vecPixels[ y * nDecimation * nWidth + x * nDecimation ];
+			UINT nSum = 0;
+
+			for ( int dy = 0; dy < nDecimation; dy ++ )
+			for ( int dx = 0; dx < nDecimation; dx ++ )
+				nSum += pwCell[ dy * nWidth + dx ];
+
+			const UINT nCount = nDecimation * nDecimation;
+			vecReduced[ y * nReduced + x ] = (WORD)( eSampling == kABCSampling_Nearest ? pwCell[ 0 ] : ( nSum + nCount / 2 ) / nCount );
+		}
+
+		return vecReduced;
+	}
+
+	bool SameFeatures( const CFeatureBlock& a, int nBlockA, const CFeatureBlock& b, int nBlockB )
+	{
+		for ( int f = 0; f < ABC_FEATURE_COUNT; f ++ )
+		{
+			if ( a.Get( nBlockA, f ) != b.Get( nBlockB, f ) )
+				return false;
+		}
+
+		return true;
+	}
+
+	CFeatureBlock Features( const CFrameSnapshot& frame, int nDecimation, E_ABCSampling eSampling )
+	{
+		FeatureGenOptions options;
+		options.nDecimation = nDecimation;
+		options.eSampling = eSampling;
+
+		CFeatureBlock features;
+		ABC_CHECK( CFeatureGen::CalcFeatures( frame, &features, options ) );
+
+		return features;
+	}
+
+	// the features of every block of two frames of the default grid
+	void CheckSameFeatures( const CFeatureBlock& a, const CFeatureBlock& b, const char* pszCase )
+	{
+		int nDiffers = 0;
+		for ( int bi = 0; bi < ABC_REGION_DIVIDE_2; bi ++ )
+			nDiffers += ! SameFeatures( a, bi, b, bi );
+
+		if ( nDiffers > 0 )
+			printf( "%s: %d blocks differ\n", pszCase, nDiffers );
+		ABC_CHECK( nDiffers == 0 );
+	}
+
+	void CheckDecimation( void )
+	{
+		// in a wider buffer
+		const int nStrider = s_nLarge + 24;
+		const std::vector< WORD > vecPixels = test::MakeFrame( s_nLarge, s_nLarge, 300, 101 );
+		std::vector< WORD > vecBuffer( nStrider * s_nLarge );
+
+		for ( int y = 0; y < s_nLarge; y ++ )
+			memcpy( &vecBuffer[ y * nStrider ], &vecPixels[ y * s_nLarge ], sizeof( WORD ) * s_nLarge );
+
+		const CFrameSnapshot frame( vecBuffer.data(), s_nLarge, s_nLarge, nStrider );
+
+		for ( int nDecimation = 2; nDecimation <= 4; nDecimation *= 2 )
+		for ( int s = 0; s < _END_ABC_Samplings; s ++ )
+		{
+			const E_ABCSampling eSampling = (E_ABCSampling) s;
+			const std::vector< WORD > vecReduced = Reduce( vecPixels, s_nLarge, nDecimation, eSampling );
+			const int nReduced = s_nLarge / nDecimation;
+			const CFrameSnapshot reduced( vecReduced.data(), nReduced, nReduced, nReduced );
+
+			char szCase[ 64 ];
+			sprintf( szCase, "decimation %d, sampling %d", nDecimation, s );
+			CheckSameFeatures( Features( frame, nDecimation, eSampling ), Features( reduced, 1, eSampling ), szCase );
+		}
+
+		// 0 halves the 1 MP frame, not the smaller one
+		CheckSameFeatures( Features( frame, 0, kABCSampling_Nearest ), Features( frame, 2, kABCSampling_Nearest ), "default, 1 MP" );
+
+		const CFrameSnapshot half( vecPixels.data(), s_nSize, s_nSize, s_nLarge );
+		CheckSameFeatures( Features( half, 0, kABCSampling_BoxAverage ), Features( half, 1, kABCSampling_BoxAverage ), "default, 0.25 MP" );
+
+		// a block of the other layout is made row major
+		CFeatureBlock columns( ABC_REGION_DIVIDE_2, kABCFeatureLayout_SoA32 );
+		ABC_CHECK( CFeatureGen::CalcFeatures( half, &columns ) );
+		ABC_CHECK( columns.GetLayout() == kABCFeatureLayout_RowMajor && columns.GetRows() != nullptr );
+		CheckSameFeatures( columns, Features( half, 0, kABCSampling_Nearest ), "soa32 made row major" );
+
+		// the classifier sampling the frame as the reduced one is
+		CRegionTypeClassifier classifier;
+		ABC_CHECK( classifier.Initialize( _T( "sampling_objec.yml" ), _T( "sampling_metal.yml" ) ) );
+
+		const std::vector< WORD > vecReduced = Reduce( vecPixels, s_nLarge, 4, kABCSampling_BoxAverage );
+		const CFrameSnapshot reduced( vecReduced.data(), s_nLarge / 4, s_nLarge / 4, s_nLarge / 4 );
+
+		RegionType arrFrame[ ABC_REGION_DIVIDE_2 ], arrReduced[ ABC_REGION_DIVIDE_2 ];
+		int anFrame[ 4 ], anReduced[ 4 ];
+
+		ABC_CHECK( classifier.SetSampling( 4, kABCSampling_BoxAverage ) );
+		ABC_CHECK( classifier.ClassfyRegion( frame, arrFrame, &anFrame[ 0 ], &anFrame[ 1 ], &anFrame[ 2 ], &anFrame[ 3 ] ) );
+		ABC_CHECK( classifier.SetSampling( 1, kABCSampling_BoxAverage ) );
+		ABC_CHECK( classifier.ClassfyRegion( reduced, arrReduced, &anReduced[ 0 ], &anReduced[ 1 ], &anReduced[ 2 ], &anReduced[ 3 ] ) );
+
+		ABC_CHECK( memcmp( arrFrame, arrReduced, sizeof( arrFrame ) ) == 0 );
+		ABC_CHECK( memcmp( anFrame, anReduced, sizeof( anFrame ) ) == 0 );
+
+		ABC_CHECK( ! classifier.SetSampling( 3, kABCSampling_Nearest ) );
+	}
+
+	// features and classes of a frame on the grid DIVIDE
+	struct Grid
+	{
+		int nDivide;
+		CFeatureBlock features;
+		bool abExposed[ 32 * 32 ];
+		RegionType arrResult[ 32 * 32 ];
+		int nNumObjBlocks, nMeanObjBlocks, nMinObj, nMaxObj;
+	};
+
+	template< int DIVIDE >
+	void Classfy( const CRegionTypeClassifier& classifier, const CFrameSnapshot& frame, const RECT& rcField, Grid* pGrid )
+	{
+		int nBlkW = 0, nBlkH = 0;
+		CFeatureGenT< DIVIDE >::GetBlockSize( frame.GetWidth(), frame.GetHeight(), 1, &nBlkW, &nBlkH );
+		CCollimation::FromRect( rcField, nBlkW, nBlkH, DIVIDE, pGrid->abExposed );
+
+		FeatureGenOptions options;
+		options.nDecimation = 1;
+		options.pbExposed = pGrid->abExposed;
+
+		pGrid->nDivide = DIVIDE;
+		ABC_CHECK( CFeatureGenT< DIVIDE >::CalcFeatures( frame, &pGrid->features, options ) );
+		ABC_CHECK( classifier.ClassfyRegion( frame, DIVIDE, pGrid->arrResult,
+					&pGrid->nNumObjBlocks, &pGrid->nMeanObjBlocks, &pGrid->nMinObj, &pGrid->nMaxObj ) );
+	}
+
+	// the blocks of a grid against the blocks of a coarser one they are in
+	void CheckGrid( const Grid& fine, const Grid& coarse )
+	{
+		const int nRatio = fine.nDivide / coarse.nDivide;
+		int nFeaturesDiffer = 0, nResultsDiffer = 0;
+
+		for ( int by = 0; by < fine.nDivide; by ++ )
+		for ( int bx = 0; bx < fine.nDivide; bx ++ )
+		{
+			const int bi = bx + by * fine.nDivide;
+			const int ci = bx / nRatio + by / nRatio * coarse.nDivide;
+
+			ABC_CHECK( fine.abExposed[ bi ] == coarse.abExposed[ ci ] );
+
+			if ( fine.abExposed[ bi ] )
+				nFeaturesDiffer += ! SameFeatures( fine.features, bi, coarse.features, ci );
+
+			nResultsDiffer += fine.arrResult[ bi ].bMetal != coarse.arrResult[ ci ].bMetal
+							|| fine.arrResult[ bi ].bBackground != coarse.arrResult[ ci ].bBackground;
+		}
+
+		printf( "grid %d in %d: features of %d and classes of %d blocks differ, %d and %d object blocks\n",
+				fine.nDivide, coarse.nDivide, nFeaturesDiffer, nResultsDiffer, fine.nNumObjBlocks, coarse.nNumObjBlocks );
+		ABC_CHECK( nFeaturesDiffer == 0 );
+		ABC_CHECK( nResultsDiffer == 0 );
+		ABC_CHECK( fine.nNumObjBlocks == coarse.nNumObjBlocks * nRatio * nRatio );
+		ABC_CHECK( fine.nMinObj == coarse.nMinObj && fine.nMaxObj == coarse.nMaxObj );
+	}
+
+	void CheckGrids(void)
+	{
+		// an object of the 64 pixel blocks near the centre, each block one tile repeated
+		const int nCoarseBlock = s_nSize / 8, nTile = 16;
+		test::CRandom random( 102 );
+
+		std::vector< WORD > vecTile( nTile * nTile );
+		for ( size_t i = 0; i < vecTile.size(); i ++ )
+			vecTile[ i ] = (WORD)( random.Next() % 3000 );
+
+		std::vector< WORD > vecPixels( s_nSize * s_nSize );
+		for ( int y = 0; y < s_nSize; y ++ )
+		for ( int x = 0; x < s_nSize; x ++ )
+		{
+			const int cx = x / nCoarseBlock, cy = y / nCoarseBlock;
+			const bool bObject = cx >= 3 && cx <= 4 && cy >= 2 && cy <= 4;
+			const WORD wBase = (WORD)( bObject ? 4000 : 20000 + 1000 * ( ( cx + cy ) % 4 ) );
+
+			vecPixels[ y * s_nSize + x ] = (WORD)( wBase + vecTile[ ( y % nTile ) * nTile + x % nTile ] );
+		}
+
+		const CFrameSnapshot frame( vecPixels.data(), s_nSize, s_nSize, s_nSize );
+
+		// the non-boundary blocks of the 8 grid, the global features of the same pixels on every grid
+		const RECT rcField = { nCoarseBlock, nCoarseBlock, s_nSize - nCoarseBlock, s_nSize - nCoarseBlock };
+
+		CRegionTypeClassifier classifier;
+		ABC_CHECK( classifier.Initialize( _T( "sampling_objec.yml" ), _T( "sampling_metal.yml" ) ) );
+		ABC_CHECK( classifier.SetCollimation( kABCCollimation_Rect, &rcField ) );
+
+		Grid grid8, grid16, grid32;
+		Classfy< 8 >( classifier, frame, rcField, &grid8 );
+		Classfy< 16 >( classifier, frame, rcField, &grid16 );
+		Classfy< 32 >( classifier, frame, rcField, &grid32 );
+
+		// not all of the field in one class
+		int anClasses[ 4 ] = { 0, 0, 0, 0 };
+		for ( int bi = 0; bi < 8 * 8; bi ++ )
+		{
+			if ( grid8.abExposed[ bi ] )
+				anClasses[ grid8.arrResult[ bi ].bBackground * 2 + grid8.arrResult[ bi ].bMetal ] ++;
+		}
+		printf( "field of the 8 grid: %d object, %d metal, %d background, %d both\n", anClasses[ 0 ], anClasses[ 1 ], anClasses[ 2 ], anClasses[ 3 ] );
+		ABC_CHECK( CLU_MAX( CLU_MAX( anClasses[ 0 ], anClasses[ 1 ] ), CLU_MAX( anClasses[ 2 ], anClasses[ 3 ] ) ) < 36 );
+
+		CheckGrid( grid16, grid8 );
+		CheckGrid( grid32, grid8 );
+		CheckGrid( grid32, grid16 );
+
+		// no other grids
+		RegionType arrOther[ 12 * 12 ];
+		int nNumObjBlocks = 0, nMeanObjBlocks = 0, nMinObj = 0, nMaxObj = 0;
+		ABC_CHECK( ! classifier.ClassfyRegion( frame, 12, arrOther, &nNumObjBlocks, &nMeanObjBlocks, &nMinObj, &nMaxObj ) );
+	}
+}
+
+int main(void)
+{
+	// networks trained on objects of several sizes, the object metal
+	CRegionTypeTrainer trainer;
+	ABC_CHECK( trainer.Initialize() );
+
+	const int nBlock = s_nSize / ABC_REGION_DIVIDE;
+	RegionType arrTypes[ ABC_REGION_DIVIDE_2 ];
+
+	for ( int f = 0; f < 4; f ++ )
+	{
+		const int nRadius = 60 + f * 40;
+		const std::vector< WORD > vecPixels = test::MakeFrame( s_nSize, s_nSize, nRadius, 105 + f );
+
+		for ( int bi = 0; bi < ABC_REGION_DIVIDE_2; bi ++ )
+		{
+			const int nDx = ( bi % ABC_REGION_DIVIDE ) * nBlock + nBlock / 2 - s_nSize / 2;
+			const int nDy = ( bi / ABC_REGION_DIVIDE ) * nBlock + nBlock / 2 - s_nSize * 2 / 5;
+
+			arrTypes[ bi ].bMetal = nDx * nDx + nDy * nDy < nRadius * nRadius;
+			arrTypes[ bi ].bBackground = ! arrTypes[ bi ].bMetal;
+		}
+
+		ABC_CHECK( trainer.AddTrainingData( 0, 0.f, CFrameSnapshot( vecPixels.data(), s_nSize, s_nSize, s_nSize ), arrTypes ) );
+	}
+
+	ABC_CHECK( trainer.SaveTrainingResult( "sampling_objec.yml", "sampling_metal.yml" ) );
+
+	CheckDecimation();
+	CheckGrids();
+
+	return ABC_TEST_RESULT();
+}
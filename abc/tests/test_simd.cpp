@@ -0,0 +1,115 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Each block statistics kernel forced by CBlockStatistics::SetSimdLevel(...) against summing the pixels one by one:
+// min, max, sum and sum of square, and the value histogram against the plain c kernel. The blocks have odd widths,
+// start off the alignment and lie in lines of odd strides. Levels this cpu does not have are skipped and reported.
+
+#include "abc_test.h"
+#include "BlockStatistics.h"
+#include "Histogram.h"
+
+// platform
+#include <cstring>
+
+using namespace comed::abc;
+
+namespace
+{
+	const char* s_apszLevels[] = { "c", "SSE4.1", "AVX2", "AVX-512BW" };
+
+	// the statistics as defined
+	BlockStatistics Reference( const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH )
+	{
+		BlockStatistics stat = { 0x0000, 0xffff, 0, 0 };
+
+		for ( int y = 0; y < nBlkH; y ++ )
+		for ( int x = 0; x < nBlkW; x ++ )
+		{
+			const WORD w = pwBlk[ y * nStrider + x ];
+			stat.wMax = CLU_MAX( stat.wMax, w );
+			stat.wMin = CLU_MIN( stat.wMin, w );
+			stat.ullSum += w;
+			stat.ullSoS += (UINT64) w * w;
+		}
+
+		return stat;
+	}
+
+	// statistics and histogram of the kernel in use, the histogram binned and cleared
+	BlockStatistics Calc( const WORD* pwBlk, int nStrider, int nBlkW, int nBlkH, CValueHistogram* pValueHist, int anHist[ HISTSIZE ] )
+	{
+		BlockStatistics stat;
+		CBlockStatistics::Calc( pwBlk, nStrider, nBlkW, nBlkH, pValueHist, &stat );
+
+		memset( anHist, 0, sizeof( int ) * HISTSIZE );
+		pValueHist->Collapse( stat.wMin, stat.wMax, anHist, nullptr, pwBlk, nStrider, nBlkW, nBlkH );
+
+		return stat;
+	}
+}
+
+int main(void)
+{
+	const E_SimdLevel eSupported = CBlockStatistics::GetSupportedSimdLevel();
+	const E_SimdLevel eDefault = CBlockStatistics::GetSimdLevel();
+
+	ABC_CHECK( eDefault == eSupported );
+	ABC_CHECK( eSupported == kSimdLevel_AVX512BW || ! CBlockStatistics::SetSimdLevel( (E_SimdLevel)( eSupported + 1 ) ) );
+
+	for ( int l = eSupported + 1; l <= kSimdLevel_AVX512BW; l ++ )
+		printf( "%s not supported, skipped\n", s_apszLevels[ l ] );
+
+	const int anWidths[] = { 1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 63, 64, 65, 127, 129 };
+	const int anHeights[] = { 1, 5, 33 };
+	const int anPads[] = { 1, 3, 17 };
+
+	test::CRandom random( 17 );
+	CValueHistogram valueHist;
+	int anHist[ HISTSIZE ], anHistC[ HISTSIZE ];
+	int nBlocks = 0;
+
+	for ( int wi = 0; wi < (int)( sizeof( anWidths ) / sizeof( int ) ); wi ++ )
+	for ( int hi = 0; hi < (int)( sizeof( anHeights ) / sizeof( int ) ); hi ++ )
+	for ( int pi = 0; pi < (int)( sizeof( anPads ) / sizeof( int ) ); pi ++ )
+	for ( int nOffset = 0; nOffset < 4; nOffset ++ )
+	{
+		const int nBlkW = anWidths[ wi ], nBlkH = anHeights[ hi ];
+		const int nStrider = nBlkW + anPads[ pi ];
+
+		// full range, or near the top where the sums of squares are largest
+		const bool bHigh = ( nOffset % 2 == 1 );
+		std::vector< WORD > vecPixels( nOffset + nStrider * nBlkH );
+		for ( size_t i = 0; i < vecPixels.size(); i ++ )
+			vecPixels[ i ] = (WORD)( bHigh ? 0xffff - random.Next() % 256 : random.Next() % 0x10000 );
+
+		const WORD* pwBlk = &vecPixels[ nOffset ];
+		const BlockStatistics ref = Reference( pwBlk, nStrider, nBlkW, nBlkH );
+
+		ABC_CHECK( CBlockStatistics::SetSimdLevel( kSimdLevel_None ) );
+		Calc( pwBlk, nStrider, nBlkW, nBlkH, &valueHist, anHistC );
+
+		for ( int l = kSimdLevel_None; l <= eSupported; l ++ )
+		{
+			ABC_CHECK( CBlockStatistics::SetSimdLevel( (E_SimdLevel) l ) );
+			ABC_CHECK( CBlockStatistics::GetSimdLevel() == l );
+
+			const BlockStatistics stat = Calc( pwBlk, nStrider, nBlkW, nBlkH, &valueHist, anHist );
+
+			if ( stat.wMin != ref.wMin || stat.wMax != ref.wMax || stat.ullSum != ref.ullSum || stat.ullSoS != ref.ullSoS
+				|| memcmp( anHist, anHistC, sizeof( anHist ) ) != 0 )
+			{
+				printf( "%s: %d x %d, stride %d, offset %d differs\n", s_apszLevels[ l ], nBlkW, nBlkH, nStrider, nOffset );
+				ABC_CHECK( false );
+			}
+		}
+
+		nBlocks ++;
+	}
+
+	printf( "%d blocks, %s and below\n", nBlocks, s_apszLevels[ eSupported ] );
+
+	ABC_CHECK( CBlockStatistics::SetSimdLevel( eDefault ) );
+
+	return ABC_TEST_RESULT();
+}
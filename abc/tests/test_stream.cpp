@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A stream reusing its blocks classifies every frame as CRegionTypeClassifier::ClassfyRegion(...) classifies it
+// alone: the same frame again, two blocks swapped ( the global features stay, only the two are computed again ),
+// a block changed ( the global features change ), and after the networks, their precision and the cascade changed.
+
+#include "abc_test.h"
+#include "abc/RegionTypeClassifier.h"
+#include "abc/RegionTypeStream.h"
+#include "abc/FrameSnapshot.h"
+
+// platform
+#include <algorithm>
+#include <cstring>
+
+using namespace comed::abc;
+
+namespace
+{
+	const int s_nSize = 512;
+	const int s_nBlock = s_nSize / ABC_REGION_DIVIDE;
+
+	struct Result
+	{
+		RegionType arrResult[ ABC_REGION_DIVIDE_2 ];
+		int nNumObjBlocks, nMeanObjBlocks, nMinObj, nMaxObj;
+
+		bool operator==( const Result& other ) const
+		{
+			return nNumObjBlocks == other.nNumObjBlocks && nMeanObjBlocks == other.nMeanObjBlocks
+				&& nMinObj == other.nMinObj && nMaxObj == other.nMaxObj
+				&& memcmp( arrResult, other.arrResult, sizeof( arrResult ) ) == 0;
+		}
+	};
+
+	// the next frame by the stream against the frame alone, the blocks computed again returned
+	int CheckFrame( const CRegionTypeClassifier& classifier, CRegionTypeStream& stream, const std::vector< WORD >& vecPixels )
+	{
+		const CFrameSnapshot frame( vecPixels.data(), s_nSize, s_nSize, s_nSize );
+		Result streamed, alone;
+
+		ABC_CHECK( stream.ClassfyRegion( frame, streamed.arrResult, &streamed.nNumObjBlocks, &streamed.nMeanObjBlocks, &streamed.nMinObj, &streamed.nMaxObj ) );
+		ABC_CHECK( classifier.ClassfyRegion( frame, alone.arrResult, &alone.nNumObjBlocks, &alone.nMeanObjBlocks, &alone.nMinObj, &alone.nMaxObj ) );
+		ABC_CHECK( streamed == alone );
+
+		return stream.GetDirtyBlockCount();
+	}
+
+	// pixels of two blocks exchanged, the values of the frame are the same
+	void SwapBlocks( std::vector< WORD >* pvecPixels, int nBlock1, int nBlock2 )
+	{
+		const int nX1 = ( nBlock1 % ABC_REGION_DIVIDE ) * s_nBlock, nY1 = ( nBlock1 / ABC_REGION_DIVIDE ) * s_nBlock;
+		const int nX2 = ( nBlock2 % ABC_REGION_DIVIDE ) * s_nBlock, nY2 = ( nBlock2 / ABC_REGION_DIVIDE ) * s_nBlock;
+
+		for ( int y = 0; y < s_nBlock; y ++ )
+			std::swap_ranges( &( *pvecPixels )[ ( nY1 + y ) * s_nSize + nX1 ], &( *pvecPixels )[ ( nY1 + y ) * s_nSize + nX1 + s_nBlock ],
+							  &( *pvecPixels )[ ( nY2 + y ) * s_nSize + nX2 ] );
+	}
+}
+
+int main(void)
+{
+	ABC_CHECK( test::WriteNetwork( "stream_objec.yml", ABC_FEATURE_COUNT, 24, 81 ) );
+	ABC_CHECK( test::WriteNetwork( "stream_metal.yml", ABC_FEATURE_COUNT, 16, 82 ) );
+	ABC_CHECK( test::WriteNetwork( "stream_objec2.yml", ABC_FEATURE_COUNT, 24, 83 ) );
+	ABC_CHECK( test::WriteNetwork( "stream_metal2.yml", ABC_FEATURE_COUNT, 16, 84 ) );
+
+	CRegionTypeClassifier classifier;
+	ABC_CHECK( classifier.Initialize( _T( "stream_objec.yml" ), _T( "stream_metal.yml" ) ) );
+
+	CRegionTypeStream stream( classifier );
+	std::vector< WORD > vecPixels = test::MakeFrame( s_nSize, s_nSize, 100, 9 );
+
+	// the first frame, then the same one again
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == ABC_REGION_DIVIDE_2 );
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == 0 );
+
+	// an object block and a background block exchanged, only they are predicted
+	const int nObject = 6 * ABC_REGION_DIVIDE + 8, nBackground = 12 * ABC_REGION_DIVIDE + 3;
+	SwapBlocks( &vecPixels, nObject, nBackground );
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == 2 );
+
+	SwapBlocks( &vecPixels, nObject, nBackground );
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == 2 );
+
+	// a block saturated, all are predicted for the global features
+	for ( int y = 0; y < s_nBlock; y ++ )
+	for ( int x = 0; x < s_nBlock; x ++ )
+		vecPixels[ ( 3 * s_nBlock + y ) * s_nSize + 4 * s_nBlock + x ] = 0xffff;
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == 1 );
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == 0 );
+
+	// other networks, then quantized
+	ABC_CHECK( classifier.Initialize( _T( "stream_objec2.yml" ), _T( "stream_metal2.yml" ) ) );
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == 0 );
+
+	ABC_CHECK( classifier.SetPrecision( kABCPrecision_Int16 ) );
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == 0 );
+
+	// the cascade on, changed and off
+	CascadeThresholds thresholds;
+	thresholds.dBackgroundMin = 0.4;
+	thresholds.dBackgroundStd = 1.0;
+	thresholds.dMetalMin = 0.1;
+	thresholds.dMetalContrast = 0.0;
+
+	classifier.SetCascade( &thresholds );
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == 0 );
+
+	thresholds.dBackgroundMin = 2.0;
+	classifier.SetCascade( &thresholds );
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == 0 );
+
+	classifier.SetCascade( nullptr );
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == 0 );
+
+	// and blocks exchanged on them
+	SwapBlocks( &vecPixels, nObject, nBackground );
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == 2 );
+
+	// a new run
+	stream.Reset();
+	ABC_CHECK( CheckFrame( classifier, stream, vecPixels ) == ABC_REGION_DIVIDE_2 );
+
+	return ABC_TEST_RESULT();
+}
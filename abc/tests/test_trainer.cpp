@@ -0,0 +1,179 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The trainer without MFC and OpenCV: its data is written and read back, the networks it trains are read by the engine
+// and predict the labels, and the data file of the repository ( 12 features ) is read.
+// argv[ 1 ] is data/abc.training.data.
+
+#include "abc_test.h"
+#include "abc/RegionTypeTrainer.h"
+#include "abc/FrameSnapshot.h"
+#include "MLPEngine.h"
+#include "TrainingData.h"
+
+// platform
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace comed::abc;
+
+namespace
+{
+	const int s_nSize = 512;
+
+	// the blocks of the object are metal, the others background
+	void Label( int nRadius, RegionType arrTypes[ ABC_REGION_DIVIDE_2 ] )
+	{
+		const int nBlock = s_nSize / ABC_REGION_DIVIDE;
+
+		for ( int bi = 0; bi < ABC_REGION_DIVIDE_2; bi ++ )
+		{
+			const int nDx = ( bi % ABC_REGION_DIVIDE ) * nBlock + nBlock / 2 - s_nSize / 2;
+			const int nDy = ( bi / ABC_REGION_DIVIDE ) * nBlock + nBlock / 2 - s_nSize * 2 / 5;
+
+			arrTypes[ bi ].bMetal = nDx * nDx + nDy * nDy < nRadius * nRadius;
+			arrTypes[ bi ].bBackground = ! arrTypes[ bi ].bMetal;
+		}
+	}
+
+	// blocks of the file off the boundary
+	int CountBlocks( const char* pszPath )
+	{
+		std::ifstream file( pszPath );
+		std::string strLine;
+		int nBlocks = 0;
+
+		while ( std::getline( file, strLine ) )
+		{
+			std::istringstream stream( strLine );
+			int nCol = 0, nRow = 0;
+
+			if ( stream >> nCol >> nRow && nCol > 0 && nCol < ABC_REGION_DIVIDE - 1 && nRow > 0 && nRow < ABC_REGION_DIVIDE - 1 )
+				nBlocks ++;
+		}
+
+		return nBlocks;
+	}
+
+	// the shipped data, kV and mA are 0
+	void CheckLegacyData( const char* pszPath )
+	{
+		CTrainingData data;
+		ABC_CHECK( data.Read( pszPath ) );
+		ABC_CHECK( data.GetCount() > 0 && data.GetCount() == CountBlocks( pszPath ) );
+
+		int nBackground = 0;
+		for ( int n = 0; n < data.GetCount(); n ++ )
+		{
+			const TrainingRow& row = data.Get( n );
+			ABC_CHECK( row.adFeatures[ kABCFeatureId_Global_KV ] == 0. && row.adFeatures[ kABCFeatureId_Global_MA ] == 0. );
+			nBackground += row.adResults[ kABCResultId_Background ] > 0.;
+		}
+		ABC_CHECK( nBackground > 0 && nBackground < data.GetCount() );
+
+		// the first line: 1 1 is boundary, the first block read has the local features of the file in place
+		std::ifstream file( pszPath );
+		std::string strLine;
+		while ( std::getline( file, strLine ) )
+		{
+			std::istringstream stream( strLine );
+			int nCol = 0, nRow = 0;
+			double adValues[ 14 ];
+
+			stream >> nCol >> nRow;
+			if ( nCol <= 0 || nCol >= ABC_REGION_DIVIDE - 1 || nRow <= 0 || nRow >= ABC_REGION_DIVIDE - 1 )
+				continue;
+
+			for ( int i = 0; i < 14; i ++ )
+				stream >> adValues[ i ];
+
+			const TrainingRow& row = data.Get( 0 );
+			ABC_CHECK( row.nCol == nCol && row.nRow == nRow );
+			ABC_CHECK( row.adFeatures[ kABCFeatureId_Global_Mode ] == adValues[ 5 ] );
+			ABC_CHECK( row.adFeatures[ kABCFeatureId_Local_Otsu ] == adValues[ 6 ] );
+			ABC_CHECK( row.adFeatures[ kABCFeatureId_Local_Mode ] == adValues[ 11 ] );
+			ABC_CHECK( row.adResults[ kABCResultId_Metal ] == adValues[ 12 ] && row.adResults[ kABCResultId_Background ] == adValues[ 13 ] );
+			break;
+		}
+
+		// a line of another count adds nothing
+		{
+			std::ofstream bad( "trainer_bad.data" );
+			bad << "CXVIEW3.ABC.TRAININGDATA.V.1\n3\t3\t0.5\t0.5\t-1\t1\n";
+		}
+
+		CTrainingData other;
+		ABC_CHECK( ! other.Read( "trainer_bad.data" ) );
+		ABC_CHECK( other.GetCount() == 0 );
+	}
+}
+
+int main( int argc, char* argv[] )
+{
+	if ( argc > 1 )
+		CheckLegacyData( argv[ 1 ] );
+
+	// frames of objects of several sizes
+	CRegionTypeTrainer trainer;
+	ABC_CHECK( trainer.Initialize() );
+
+	RegionType arrTypes[ ABC_REGION_DIVIDE_2 ];
+	const int nFrames = 6;
+
+	for ( int f = 0; f < nFrames; f ++ )
+	{
+		const int nRadius = 60 + f * 25;
+		const std::vector< WORD > vecPixels = test::MakeFrame( s_nSize, s_nSize, nRadius, 10 + f );
+
+		Label( nRadius, arrTypes );
+		ABC_CHECK( trainer.AddTrainingData( 70 + f, 2.5f, CFrameSnapshot( vecPixels.data(), s_nSize, s_nSize, s_nSize ), arrTypes ) );
+	}
+
+	const int nBlocks = ( ABC_REGION_DIVIDE - 2 ) * ( ABC_REGION_DIVIDE - 2 );
+	ABC_CHECK( trainer.GetTrainingDataCount() == nFrames * nBlocks );
+
+	// written and read back
+	ABC_CHECK( trainer.SaveTrainingData( "trainer.data" ) );
+
+	CRegionTypeTrainer reader;
+	ABC_CHECK( reader.Initialize() );
+	ABC_CHECK( reader.AddTrainingDataFrom( "trainer.data" ) );
+	ABC_CHECK( reader.GetTrainingDataCount() == trainer.GetTrainingDataCount() );
+
+	RegionType arrWritten[ ABC_REGION_DIVIDE_2 ], arrRead[ ABC_REGION_DIVIDE_2 ];
+	ABC_CHECK( trainer.GetCurrentData( arrWritten ) );
+	ABC_CHECK( reader.GetCurrentData( arrRead ) );
+	ABC_CHECK( memcmp( arrWritten, arrRead, sizeof( arrRead ) ) == 0 );
+
+	CTrainingData data;
+	ABC_CHECK( data.Read( "trainer.data" ) );
+	ABC_CHECK( data.Get( 0 ).adFeatures[ kABCFeatureId_Global_KV ] == 70. && data.Get( 0 ).adFeatures[ kABCFeatureId_Global_MA ] == 2.5 );
+
+	// the trained networks predict the labels
+	ABC_CHECK( reader.SaveTrainingResult( "trainer_objec.yml", "trainer_metal.yml" ) );
+
+	CMLPEngine engine;
+	ABC_CHECK( engine.Load( _T( "trainer_objec.yml" ), _T( "trainer_metal.yml" ) ) );
+	ABC_CHECK( engine.GetInputCount() == ABC_FEATURE_COUNT );
+
+	std::vector< double > vecRows, vecLabels;
+	data.GetRows( &vecRows, &vecLabels );
+
+	const int nRows = data.GetCount();
+	std::vector< double > vecObjec( nRows ), vecMetal( nRows );
+	engine.Predict( vecRows.data(), ABC_FEATURE_COUNT, nullptr, nRows, vecObjec.data(), vecMetal.data() );
+
+	int nWrong = 0;
+	for ( int n = 0; n < nRows; n ++ )
+	{
+		nWrong += ( vecObjec[ n ] > 0. ) != ( vecLabels[ n * ABC_RESULT_COUNT + kABCResultId_Background ] > 0. );
+		nWrong += ( vecMetal[ n ] > 0. ) != ( vecLabels[ n * ABC_RESULT_COUNT + kABCResultId_Metal ] > 0. );
+	}
+
+	printf( "%d of %d outputs differ from the labels\n", nWrong, nRows * 2 );
+	ABC_CHECK( nWrong <= nRows * 2 / 50 );
+
+	return ABC_TEST_RESULT();
+}
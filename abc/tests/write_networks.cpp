@@ -0,0 +1,18 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// write_networks <objec network> <metal network>
+// The networks of test_builtin, written at build time for abc_mlpgen.
+
+#include "abc_test.h"
+#include "abc/abc_types.h"
+
+using namespace comed::abc;
+
+int main( int argc, char* argv[] )
+{
+	if ( argc != 3 )
+		return 2;
+
+	return test::WriteNetwork( argv[ 1 ], ABC_FEATURE_COUNT, 28, 31 ) && test::WriteNetwork( argv[ 2 ], ABC_FEATURE_COUNT, 13, 32 ) ? 0 : 1;
+}
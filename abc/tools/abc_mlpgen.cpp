@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+// Added by Hai Son
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// abc_mlpgen <objec network> <metal network> <MLPBuiltIn.h>
+// Writes the networks saved by CvANN_MLP as the header compiled in with ABC_BUILTIN_MLP. 
+// CMakeLists.txt runs it as a build step ( abc_builtin_mlp ), so the header follows the result files.
+
+#include "abc_core.h"
+#include "MLPEngine.h"
+
+// platform
+#include <cstdio>
+
+using namespace comed::abc;
+
+int main( int argc, char* argv[] )
+{
+	if ( argc != 4 )
+	{
+		fprintf( stderr, "usage: abc_mlpgen <objec network> <metal network> <MLPBuiltIn.h>\n" );
+		return 2;
+	}
+
+	CMLPEngine engine;
+
+	if ( ! engine.Load( argv[ 1 ], argv[ 2 ] ) )
+	{
+		fprintf( stderr, "abc_mlpgen: can't load the networks [%s] [%s]\n", argv[ 1 ], argv[ 2 ] );
+		return 1;
+	}
+
+	if ( engine.GetInputCount() != ABC_FEATURE_COUNT )
+	{
+		fprintf( stderr, "abc_mlpgen: the networks have %d inputs, the features are %d\n", engine.GetInputCount(), ABC_FEATURE_COUNT );
+		return 1;
+	}
+
+	return engine.SaveHeader( argv[ 3 ] ) ? 0 : 1;
+}